@@ -349,6 +349,9 @@ CConsoleCommands::CConsoleCommands()
 
 	m_sameCommandsExecuted = 0;
 	m_commandListDirty = false;
+	m_registryVersion = 0;
+	m_executeDepth = 0;
+	m_execDepth = 0;
 }
 
 void CConsoleCommands::RegisterCommands()
@@ -385,12 +388,14 @@ const ConCommand* CConsoleCommands::FindCommand(const char* name)
 
 const ConCommandBase* CConsoleCommands::FindBase(const char* name)
 {
-	SortCommands();
+	int hash = StringToHash(name, true);
+
+	std::pair<cmdHashMap_t::iterator, cmdHashMap_t::iterator> range = m_commandsByHash.equal_range(hash);
 
-	for ( int i = 0; i < m_registeredCommands.numElem(); i++ )
+	for (cmdHashMap_t::iterator it = range.first; it != range.second; ++it)
 	{
-		if ( !stricmp( name, m_registeredCommands[i]->GetName() ) )
-			return m_registeredCommands[i];
+		if ( !stricmp( name, it->second->GetName() ) )
+			return it->second;
 	}
 
 	return nullptr;
@@ -416,11 +421,13 @@ void CConsoleCommands::RegisterCommand(ConCommandBase *pCmd)
 		return;
 
 	m_registeredCommands.append( pCmd );
+	m_commandsByHash.insert( cmdHashMap_t::value_type(StringToHash(pCmd->GetName(), true), pCmd) );
 
 	pCmd->m_bIsRegistered = true;
 
 	// alphabetic sort
 	m_commandListDirty = true;
+	m_registryVersion++;
 }
 
 void CConsoleCommands::UnregisterCommand(ConCommandBase *pCmd)
@@ -429,6 +436,19 @@ void CConsoleCommands::UnregisterCommand(ConCommandBase *pCmd)
 		return;
 
 	m_registeredCommands.remove(pCmd);
+
+	std::pair<cmdHashMap_t::iterator, cmdHashMap_t::iterator> range = m_commandsByHash.equal_range(StringToHash(pCmd->GetName(), true));
+
+	for (cmdHashMap_t::iterator it = range.first; it != range.second; ++it)
+	{
+		if (it->second == pCmd)
+		{
+			m_commandsByHash.erase(it);
+			break;
+		}
+	}
+
+	m_registryVersion++;
 }
 
 void CConsoleCommands::DeInit()
@@ -437,6 +457,8 @@ void CConsoleCommands::DeInit()
 		((ConCommandBase*)m_registeredCommands[i])->m_bIsRegistered = false;
 
 	m_registeredCommands.clear();
+	m_commandsByHash.clear();
+	m_registryVersion++;
 }
 
 void CConsoleCommands::SortCommands()
@@ -508,8 +530,8 @@ void CConsoleCommands::ParseAndAppend(char* str, int len, void* extra)
 		
 }
 
-// Executes file
-void CConsoleCommands::ParseFileToCommandBuffer(const char* pszFilename)
+// Loads configuration file, searches in cfg/ folder and adds extension if needed
+char* CConsoleCommands::LoadConfigFile(const char* pszFilename)
 {
 	EqString cfgFileName(pszFilename);
 
@@ -529,15 +551,26 @@ void CConsoleCommands::ParseFileToCommandBuffer(const char* pszFilename)
 	if(!buf)
 	{
 		MsgError("Couldn't execute configuraton file '%s'\n",pszFilename);
-		return;
+		return NULL;
 	}
 
 	if(strlen(buf) < 1)
 	{
 		PPFree(buf);
-		return; //Don't parse me about empty file
+		return NULL; //Don't parse me about empty file
 	}
 
+	return buf;
+}
+
+// Executes file
+void CConsoleCommands::ParseFileToCommandBuffer(const char* pszFilename)
+{
+	char* buf = LoadConfigFile(pszFilename);
+
+	if(!buf)
+		return;
+
 	ForEachSeparated(buf, '\n', &CConsoleCommands::ParseAndAppend, NULL);
 	PPFree(buf);
 }
@@ -574,46 +607,8 @@ void CConsoleCommands::ResetCounter()
 	m_sameCommandsExecuted = 0; 
 }
 
-struct execOptions_t
-{
-	cmdFilterFn_t filterFn;
-	bool quiet;
-};
-
-void CConsoleCommands::SplitOnArgsAndExec(char* str, int len, void* extra)
+void CConsoleCommands::ExecuteCommand(ConCommandBase* pBase, DkList<EqString>& args)
 {
-	execOptions_t* options = (execOptions_t*)extra;
-
-	EqString commandStr(str,len);
-
-	DkList<EqString> cmdArgs;
-
-	// split it
-	SplitCommandForValidArguments(commandStr.ToCString(), cmdArgs);
-
-	if(cmdArgs.numElem() == 0)
-		return;
-
-	ConCommandBase *pBase = (ConCommandBase*)FindBase( cmdArgs[0].GetData() );
-
-	if(!pBase) //Failed?
-	{
-		if(!options->quiet)
-			MsgError("Unknown command or variable '%s'\n", cmdArgs[0].GetData());
-
-		m_failedCommands.append(commandStr);
-		return;
-	}
-
-	if(options->filterFn)
-	{
-		if(!(options->filterFn)(pBase, cmdArgs))
-			return;
-	}
-
-	// remove cmd name
-	cmdArgs.removeIndex(0);
-
 	if (!IsAllowedToExecute(pBase))
 	{
 		MsgWarning("Cannot access '%s' command/variable\n", pBase->GetName());
@@ -625,19 +620,19 @@ void CConsoleCommands::SplitOnArgsAndExec(char* str, int len, void* extra)
 		ConVar* pConVar = (ConVar*)pBase;
 
 		// Primitive executor tries to find optional arguments
-		if(cmdArgs.numElem() == 0)
+		if(args.numElem() == 0)
 		{
 			MsgInfo("%s is '%s' (default value is '%s')\n",pConVar->GetName(),pConVar->GetString(), pConVar->GetDefaultValue());
 			return;
 		}
 
-		pConVar->SetValue(cmdArgs[0].GetData());
+		pConVar->SetValue(args[0].GetData());
 		Msg("%s set to '%s'\n", pConVar->GetName(), pConVar->GetString());
 	}
 	else
 	{
 		ConCommand* pConCommand = (ConCommand*)pBase;
-		pConCommand->DispatchFunc(cmdArgs);
+		pConCommand->DispatchFunc(args);
 	}
 }
 
@@ -663,15 +658,181 @@ bool CConsoleCommands::ExecuteCommandBuffer(cmdFilterFn_t filterFn /*= nullptr*/
 	if(strlen(m_currentCommands) <= 0)
 		return false;
 
-	execOptions_t options;
-	options.filterFn = filterFn;
-	options.quiet = quiet;
+	// Same commands executed again (configs, UI and bound commands) are not parsed.
+	// Nested execution can't reuse the compiled buffer, it's being executed
+	compiledCmdBuffer_t nestedCompiled;
+	compiledCmdBuffer_t& compiled = m_executeDepth ? nestedCompiled : m_compiledCommands;
+
+	m_executeDepth++;
+
+	// commands may append to the buffer (exec, configs) while it's executed
+	int executedLen = 0;
+
+	while(executedLen < strlen(m_currentCommands))
+	{
+		const char* pending = m_currentCommands + executedLen;
+		executedLen = strlen(m_currentCommands);
+
+		if(&compiled != &m_compiledCommands || m_compiledSource.Compare(pending))
+		{
+			CompileCommandBuffer(pending, compiled);
+
+			if(&compiled == &m_compiledCommands)
+				m_compiledSource = pending;
+		}
+
+		RunCompiledCommands(compiled, filterFn, quiet);
+	}
 
-	ForEachSeparated(m_currentCommands, CON_SEPARATOR, &CConsoleCommands::SplitOnArgsAndExec,  &options);
+	m_executeDepth--;
 
 	return true;
 }
 
+void CConsoleCommands::CompileCommand(char* str, int len, void* extra)
+{
+	compiledCmdBuffer_t* compiled = (compiledCmdBuffer_t*)extra;
+
+	EqString cmdStr(str, len);
+	int commentIdx = cmdStr.Find("//");
+
+	if(commentIdx != -1)
+		cmdStr = cmdStr.Left(commentIdx);
+
+	cmdStr = cmdStr.TrimSpaces();
+
+	DkList<EqString> cmdArgs;
+	SplitCommandForValidArguments(cmdStr.ToCString(), cmdArgs);
+
+	if(cmdArgs.numElem() == 0)
+		return;
+
+	compiledCmd_t cmd;
+	cmd.cmdString = cmdStr;
+	cmd.name = cmdArgs[0];
+	cmd.base = (ConCommandBase*)FindBase( cmd.name.ToCString() );
+
+	// remove cmd name
+	cmdArgs.removeIndex(0);
+	cmd.args = cmdArgs;
+
+	compiled->commands.append(cmd);
+}
+
+// appends the commands to compiled buffer. String is modified
+void CConsoleCommands::CompileCommands(char* str, compiledCmdBuffer_t& compiled)
+{
+	// new lines are separating commands too
+	for(char* c = str; *c; c++)
+	{
+		if(*c == '\n')
+			*c = CON_SEPARATOR;
+	}
+
+	ForEachSeparated(str, CON_SEPARATOR, &CConsoleCommands::CompileCommand, &compiled);
+}
+
+// executes configuration file from the compiled commands
+void CConsoleCommands::ExecuteConfigFile(const char* pszFilename, cmdFilterFn_t filterFn, bool quiet)
+{
+	// config files can execute each other
+	if(m_execDepth >= MAX_EXEC_DEPTH)
+	{
+		MsgError("Couldn't execute configuraton file '%s', too many nested files\n", pszFilename);
+		return;
+	}
+
+	char* buf = LoadConfigFile(pszFilename);
+
+	if(!buf)
+		return;
+
+	compiledCmdBuffer_t compiled;
+	compiled.registryVersion = m_registryVersion;
+
+	CompileCommands(buf, compiled);
+	PPFree(buf);
+
+	m_execDepth++;
+	RunCompiledCommands(compiled, filterFn, quiet);
+	m_execDepth--;
+}
+
+// Splits the commands on arguments and resolves them once
+void CConsoleCommands::CompileCommandBuffer(const char* pszBuffer, compiledCmdBuffer_t& compiled)
+{
+	compiled.commands.clear();
+	compiled.registryVersion = m_registryVersion;
+
+	EqString buffer(pszBuffer);
+	CompileCommands((char*)buffer.GetData(), compiled);
+}
+
+// Executes compiled commands without parsing
+bool CConsoleCommands::ExecuteCompiledCommands(compiledCmdBuffer_t& compiled, cmdFilterFn_t filterFn /*= nullptr*/, bool quiet /*= false*/)
+{
+	m_failedCommands.clear();
+
+	return RunCompiledCommands(compiled, filterFn, quiet);
+}
+
+bool CConsoleCommands::RunCompiledCommands(compiledCmdBuffer_t& compiled, cmdFilterFn_t filterFn, bool quiet)
+{
+	// commands could be registered or unregistered since it was compiled
+	if(compiled.registryVersion != m_registryVersion)
+	{
+		for(int i = 0; i < compiled.commands.numElem(); i++)
+		{
+			compiledCmd_t& cmd = compiled.commands[i];
+			cmd.base = (ConCommandBase*)FindBase( cmd.name.ToCString() );
+		}
+
+		compiled.registryVersion = m_registryVersion;
+	}
+
+	for(int i = 0; i < compiled.commands.numElem(); i++)
+	{
+		compiledCmd_t& cmd = compiled.commands[i];
+
+		if(!cmd.base)
+		{
+			if(!quiet)
+				MsgError("Unknown command or variable '%s'\n", cmd.name.ToCString());
+
+			m_failedCommands.append(cmd.cmdString);
+			continue;
+		}
+
+		if(filterFn)
+		{
+			// filter gets command name as first argument
+			DkList<EqString> filterArgs;
+			filterArgs.append(cmd.name);
+			filterArgs.append(cmd.args);
+
+			if(!filterFn(cmd.base, filterArgs))
+				continue;
+		}
+
+		// exec puts file to the command buffer, it has to be executed in proper order instead
+		if(cmd.base == &exec && IsAllowedToExecute(cmd.base))
+		{
+			if(cmd.args.numElem())
+				ExecuteConfigFile(cmd.args[0].ToCString(), filterFn, quiet);
+
+			continue;
+		}
+
+		// commands are free to modify arguments, compiled ones are kept
+		DkList<EqString> args;
+		args.append(cmd.args);
+
+		ExecuteCommand(cmd.base, args);
+	}
+
+	return compiled.commands.numElem() > 0;
+}
+
 // returns failed commands
 DkList<EqString>& CConsoleCommands::GetFailedCommands()
 {
@@ -11,6 +11,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unordered_map>
 #include "core/ConVar.h"
 #include "core/ConCommand.h"
 #include "core/IConsoleCommands.h"
@@ -19,6 +20,7 @@
 
 // To prevent stack buffer overflow
 #define MAX_SAME_COMMANDS 5
+#define MAX_EXEC_DEPTH 16 // nested config files
 #define COMMANDBUFFER_SIZE (32*1024) // 32 kb buffer, equivalent of MAX_CFG_SIZE
 #define COM_TOKEN_MAX_LENGTH 1024
 #define	MAX_ARGS 80
@@ -27,6 +29,9 @@ class CConsoleCommands;
 
 typedef void (CConsoleCommands::*FUNC)(char* str, int len, void* extra);
 
+// case-insensitive name hash to command
+typedef std::unordered_multimap<int, ConCommandBase*> cmdHashMap_t;
+
 class CConsoleCommands : public IConsoleCommands
 {
 public:
@@ -69,6 +74,12 @@ public:
 	// Executes command buffer
 	bool								ExecuteCommandBuffer(cmdFilterFn_t filterFn = nullptr, bool quiet = false);
 
+	// Splits the commands on arguments and resolves them once
+	void								CompileCommandBuffer(const char* pszBuffer, compiledCmdBuffer_t& compiled);
+
+	// Executes compiled commands without parsing
+	bool								ExecuteCompiledCommands(compiledCmdBuffer_t& compiled, cmdFilterFn_t filterFn = nullptr, bool quiet = false);
+
 	// returns failed commands
 	DkList<EqString>&					GetFailedCommands();
 
@@ -79,17 +90,32 @@ public:
 private:
 	void								ForEachSeparated(char* str, char separator, FUNC fn, void* extra);
 	void								ParseAndAppend(char* str, int len, void* extra);
-	void								SplitOnArgsAndExec(char* str, int len, void* extra);
+	void								CompileCommand(char* str, int len, void* extra);
+
+	char*								LoadConfigFile(const char* pszFilename);
+
+	void								CompileCommands(char* str, compiledCmdBuffer_t& compiled);
+	void								ExecuteConfigFile(const char* pszFilename, cmdFilterFn_t filterFn, bool quiet);
+	bool								RunCompiledCommands(compiledCmdBuffer_t& compiled, cmdFilterFn_t filterFn, bool quiet);
+
+	void								ExecuteCommand(ConCommandBase* pBase, DkList<EqString>& args);
 
 	void								SortCommands();
 
 	DkList<ConCommandBase*>	m_registeredCommands;
+	cmdHashMap_t			m_commandsByHash;
+	int						m_registryVersion;
 
 	DkList<EqString>		m_failedCommands;
 
 	char					m_currentCommands[COMMANDBUFFER_SIZE];
 	char					m_lastExecutedCommands[COMMANDBUFFER_SIZE];
 
+	compiledCmdBuffer_t		m_compiledCommands;		// last executed command buffer
+	EqString				m_compiledSource;
+	int						m_executeDepth;
+	int						m_execDepth;
+
 	int						m_sameCommandsExecuted;
 	bool					m_commandListDirty;
 };
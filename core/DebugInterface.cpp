@@ -21,6 +21,8 @@
 #define EQENGINE_LOG_TAG(v) varargs("%s %s", GetCore()->GetApplicationName(), v)
 #endif // ANDROID
 
+using namespace Threading;
+
 static const char* s_spewTypeStr[] = {
 	"",
 	"[INFO]",
@@ -29,7 +31,12 @@ static const char* s_spewTypeStr[] = {
 	"",
 };
 
-Threading::CEqMutex g_debugOutputMutex;
+#define DEBUGMESSAGE_BUFFER_SIZE	2048
+
+#define LOG_ASYNC_QUEUE_SIZE		256		// must be power of two
+#define LOG_ASYNC_WAIT_TIME			100		// writer thread wakeup period, ms
+
+CEqMutex g_debugOutputMutex;
 bool g_bLoggingInitialized = false;
 FILE* g_logFile = NULL;
 
@@ -39,6 +46,172 @@ bool g_logForceFlush = true;
 
 void Log_WriteBOM(const char* fileName);
 
+//-------------------------------------------------------------------------------------------
+// Asynchronous logging
+//
+// Messages are formatted by the calling thread right into the slot of bounded
+// lock-free queue, the writer thread does the file and console output.
+// Each slot has a sequence number which tells whether it's free for writing
+// (sequence == position) or contains a message (sequence == position + 1)
+//-------------------------------------------------------------------------------------------
+
+struct logmessage_t
+{
+	InterlockedInt_t	sequence;
+	SpewType_t			type;
+	char				text[DEBUGMESSAGE_BUFFER_SIZE];
+};
+
+static logmessage_t					s_logQueue[LOG_ASYNC_QUEUE_SIZE];
+static InterlockedInt_t				s_logEnqueuePos = 0;
+static InterlockedInt_t				s_logDequeuePos = 0;
+static InterlockedInt_t				s_logDropped = 0;
+static int							s_logDroppedTotal = 0;
+static InterlockedInt_t				s_logWriterIdle = 0;
+
+static volatile bool				s_logAsync = false;
+static volatile bool				s_logCrashed = false;
+static bool							s_logQueueInit = false;
+
+static CEqInterlockedInteger		s_logProducers;
+static CEqSignal					s_logWriterSignal;
+
+static void Log_WriteMessage(SpewType_t type, const char* pMsg);
+
+static inline InterlockedInt_t Log_AtomicRead(InterlockedInt_t& value)
+{
+	return CompareExchangeInterlocked(value, 0, 0);
+}
+
+// reserves the queue slot and formats message into it. Returns false if queue is full
+static bool Log_AsyncEnqueue(SpewType_t type, const char* pMsgFormat, va_list args)
+{
+	logmessage_t* msg;
+	InterlockedInt_t pos = Log_AtomicRead(s_logEnqueuePos);
+
+	for(;;)
+	{
+		msg = &s_logQueue[pos & (LOG_ASYNC_QUEUE_SIZE-1)];
+
+		int diff = (int)((unsigned int)Log_AtomicRead(msg->sequence) - (unsigned int)pos);
+
+		if(diff == 0)
+		{
+			InterlockedInt_t prevPos = CompareExchangeInterlocked(s_logEnqueuePos, pos, (InterlockedInt_t)((unsigned int)pos + 1));
+
+			if(prevPos == pos)
+				break;
+
+			pos = prevPos;
+		}
+		else if(diff < 0)
+			return false;	// writer thread hasn't freed this slot yet
+		else
+			pos = Log_AtomicRead(s_logEnqueuePos);
+	}
+
+	msg->type = type;
+	vsnprintf(msg->text, DEBUGMESSAGE_BUFFER_SIZE, pMsgFormat, args);
+	msg->text[DEBUGMESSAGE_BUFFER_SIZE - 1] = 0;
+
+	// publish
+	ExchangeInterlocked(msg->sequence, (InterlockedInt_t)((unsigned int)pos + 1));
+
+	return true;
+}
+
+// writes out published messages. g_debugOutputMutex must be locked
+// If waitPending is set, it also waits for messages which are still being formatted
+static void Log_DrainQueue(bool waitPending = true)
+{
+	if(!s_logQueueInit)
+		return;
+
+	bool written = false;
+	InterlockedInt_t lastPos = Log_AtomicRead(s_logEnqueuePos);
+
+	for(;;)
+	{
+		InterlockedInt_t pos = Log_AtomicRead(s_logDequeuePos);
+		logmessage_t* msg = &s_logQueue[pos & (LOG_ASYNC_QUEUE_SIZE-1)];
+
+		if(Log_AtomicRead(msg->sequence) != (InterlockedInt_t)((unsigned int)pos + 1))
+		{
+			// everything reserved before the drain has started is written out
+			if(!waitPending || (int)((unsigned int)lastPos - (unsigned int)pos) <= 0)
+				break;
+
+			Yield();
+			continue;
+		}
+
+		Log_WriteMessage(msg->type, msg->text);
+
+		ExchangeInterlocked(s_logDequeuePos, (InterlockedInt_t)((unsigned int)pos + 1));
+
+		// release slot for the next round
+		ExchangeInterlocked(msg->sequence, (InterlockedInt_t)((unsigned int)pos + LOG_ASYNC_QUEUE_SIZE));
+
+		written = true;
+	}
+
+	int numDropped = ExchangeInterlocked(s_logDropped, 0);
+
+	if(numDropped > 0)
+	{
+		s_logDroppedTotal += numDropped;
+
+		char tmp[128];
+		snprintf(tmp, sizeof(tmp), "*** %d log messages dropped (%d total), log queue is full ***\n", numDropped, s_logDroppedTotal);
+
+		Log_WriteMessage(SPEW_WARNING, tmp);
+		written = true;
+	}
+
+	if(written && g_logFile && g_logForceFlush)
+		fflush(g_logFile);
+}
+
+// locks output. After the crash the mutex is only tried as crashed thread may hold it.
+// The crashed thread also could reserve the queue slot and never publish it,
+// so the queue is drained without waiting for pending messages then
+static bool Log_LockOutput()
+{
+	if(s_logCrashed)
+		return g_debugOutputMutex.Lock(false);
+
+	return g_debugOutputMutex.Lock();
+}
+
+class CLogWriterThread : public CEqThread
+{
+protected:
+	int Run()
+	{
+		while(!IsTerminating())
+		{
+			ExchangeInterlocked(s_logWriterIdle, 1);
+
+			// don't sleep if something was published meanwhile
+			InterlockedInt_t pos = Log_AtomicRead(s_logDequeuePos);
+
+			if(Log_AtomicRead(s_logQueue[pos & (LOG_ASYNC_QUEUE_SIZE-1)].sequence) != (InterlockedInt_t)((unsigned int)pos + 1))
+				s_logWriterSignal.Wait(LOG_ASYNC_WAIT_TIME);
+
+			ExchangeInterlocked(s_logWriterIdle, 0);
+
+			CScopedMutex m(g_debugOutputMutex);
+			Log_DrainQueue(false);
+		}
+
+		return 0;
+	}
+};
+
+static CLogWriterThread s_logWriterThread;
+
+//-------------------------------------------------------------------------------------------
+
 // initializes logging to the disk
 void Log_Init()
 {
@@ -71,15 +244,33 @@ void Log_Init()
 // flushes the console log to the disk
 void Log_Flush()
 {
-	if(!g_logFile)
-		return;
+	bool locked = Log_LockOutput();
+
+	Log_DrainQueue(!s_logCrashed);
+
+	if(g_logFile)
+		fflush(g_logFile);
 
-	fflush(g_logFile);
+	if(locked)
+		g_debugOutputMutex.Unlock();
+}
+
+// called by the exception handler. Makes logging synchronous and writes out published messages
+void Log_OnCrash()
+{
+	s_logCrashed = true;
+	s_logAsync = false;
+
+	Log_Flush();
 }
 
 // closes the log file
 void Log_Close()
 {
+	CScopedMutex m(g_debugOutputMutex);
+
+	Log_DrainQueue();
+
 	if(!g_logFile)
 		return;
 
@@ -87,6 +278,44 @@ void Log_Close()
 	g_logFile = NULL;
 }
 
+// enables asynchronous logging, messages are written by the separate thread
+void Log_InitAsync()
+{
+	if(s_logAsync)
+		return;
+
+	if(!s_logQueueInit)
+	{
+		for(int i = 0; i < LOG_ASYNC_QUEUE_SIZE; i++)
+			s_logQueue[i].sequence = i;
+
+		s_logQueueInit = true;
+	}
+
+	s_logWriterThread.StartThread("LogWriter", TP_BELOW_NORMAL);
+
+	s_logAsync = true;
+}
+
+// stops the writer thread and flushes pending messages
+void Log_ShutdownAsync()
+{
+	if(!s_logAsync)
+		return;
+
+	s_logAsync = false;
+
+	// wait for the threads which are still enqueueing
+	while(s_logProducers.GetValue() > 0)
+		Yield();
+
+	s_logWriterThread.StopThread(false);
+	s_logWriterSignal.Raise();
+	s_logWriterThread.WaitForThread();
+
+	Log_Flush();
+}
+
 int g_developerMode = 0;
 
 DECLARE_CONCOMMAND_FN(developer)
@@ -163,6 +392,32 @@ IEXPORTS void SetSpewFunction(SpewFunc_fn newfunc)
 		g_fnConSpewFunc = newfunc;
 }
 
+// writes message to all outputs. g_debugOutputMutex must be locked
+static void Log_WriteMessage(SpewType_t type, const char* pMsg)
+{
+	ASSERT( g_fnConSpewFunc );
+
+#ifdef ANDROID
+	const char* logTag = EQENGINE_LOG_TAG(s_spewTypeStr[type]);
+
+	// force log into android debug output
+	__android_log_print(ANDROID_LOG_DEBUG, logTag, "%s", pMsg);
+#else
+
+#endif // ANDROID
+
+	if(!g_bLoggingInitialized)
+	{
+		printf( "%s", pMsg );
+	}
+
+	// print to log file if enabled
+	if(g_logFile)
+		fprintf(g_logFile, "%s", pMsg);
+
+	(g_fnConSpewFunc)(type, pMsg);
+}
+
 DECLARE_CONCOMMAND_FN(echo)
 {
 	if(CMD_ARGC == 0)
@@ -209,11 +464,40 @@ void Log_WriteBOM(const char* fileName)
 
 #pragma warning(pop)
 
-#define DEBUGMESSAGE_BUFFER_SIZE 2048
-
 void SpewMessageToOutput(SpewType_t spewtype,char const* pMsgFormat, va_list args)
 {
-	Threading::CScopedMutex m(g_debugOutputMutex);
+	if(s_logAsync)
+	{
+		s_logProducers.Increment();
+
+		bool queued = s_logAsync && Log_AsyncEnqueue(spewtype, pMsgFormat, args);
+
+		if(queued && ExchangeInterlocked(s_logWriterIdle, 0))
+			s_logWriterSignal.Raise();
+
+		s_logProducers.Decrement();
+
+		if(queued)
+		{
+			// errors are usually followed by crash or exit, get them on the disk now
+			if(spewtype == SPEW_ERROR)
+				Log_Flush();
+
+			return;
+		}
+
+		// queue is full - only errors are allowed to stall the caller
+		if(s_logAsync && spewtype != SPEW_ERROR)
+		{
+			IncrementInterlocked(s_logDropped);
+			return;
+		}
+	}
+
+	bool locked = Log_LockOutput();
+
+	// keep the message order
+	Log_DrainQueue(!s_logCrashed);
 
 	char pTempBuffer[DEBUGMESSAGE_BUFFER_SIZE];
 	int len = 0;
@@ -223,35 +507,16 @@ void SpewMessageToOutput(SpewType_t spewtype,char const* pMsgFormat, va_list arg
 	pTempBuffer[DEBUGMESSAGE_BUFFER_SIZE - 1] = 0;
 
 	ASSERT( len < 2048 );
-	ASSERT( g_fnConSpewFunc );
-
-#ifdef ANDROID
-	const char* logTag = EQENGINE_LOG_TAG(s_spewTypeStr[spewtype]);
-
-	// force log into android debug output
-	__android_log_print(ANDROID_LOG_DEBUG, logTag, "%s", pTempBuffer);
-#else
-
-#endif // ANDROID
 
-	if(!g_bLoggingInitialized)
-	{
-		printf( "%s", pTempBuffer );
-	}
+	Log_WriteMessage(spewtype, pTempBuffer);
 
-	// print to log file if enabled
-	if(g_logFile)
-	{
-		fprintf(g_logFile, "%s", pTempBuffer);
-
-		if(g_logForceFlush)
-			Log_Flush();
-	}
+	if(g_logFile && g_logForceFlush)
+		fflush(g_logFile);
 
-	(g_fnConSpewFunc)(spewtype,pTempBuffer);
+	if(locked)
+		g_debugOutputMutex.Unlock();
 }
 
-
 // Simple messages
 IEXPORTS void Msg(const char *fmt,...)
 {
@@ -16,6 +16,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+extern void Log_OnCrash();
+extern void Log_Flush();
+
 #ifdef _WIN32
 
 #include <DbgHelp.h>
@@ -164,6 +167,9 @@ static LONG WINAPI _exceptionCB(EXCEPTION_POINTERS *ExceptionInfo)
 	char tmp_path[2048];
 	sprintf(tmp_path, "\nUnhandled Exception !!!\nException code: %s (0x%x)\nAddress: %p\n\n\nSee application log for details.",pName, pRecord->ExceptionCode, pRecord->ExceptionAddress);
 
+	// crashed thread may hold the log or have an unpublished async log message
+	Log_OnCrash();
+
 	_InternalAssert(NULL, NULL, tmp_path);
 
 	CrashMsg(tmp_path);
@@ -244,6 +250,9 @@ static LONG WINAPI _exceptionCB(EXCEPTION_POINTERS *ExceptionInfo)
 
 	PPMemInfo();
 
+	// write out everything that is still in the async log queue
+	Log_Flush();
+
 	CreateMiniDump(ExceptionInfo);
 
     return EXCEPTION_EXECUTE_HANDLER;
@@ -132,6 +132,8 @@ void CLocalize::AddTokensFile(const char* pszFilePrefix)
 	sprintf(path, "resources/%s_%s.txt", pszFilePrefix, GetLanguageName());
 
 	kvkeybase_t kvSec;
+	kvSec.InitArena();
+
 	if (!KV_LoadFromFile(path, -1, &kvSec))
 	{
 		MsgWarning("Cannot load language file 'resources/%s_%s.txt'\n", pszFilePrefix, GetLanguageName());
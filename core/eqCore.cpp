@@ -22,6 +22,7 @@
 #include "core/ILocalize.h"
 #include "core/DebugInterface.h"
 #include "eqCPUServices.h"
+#include "eqProfiler.h"
 
 #include "ExceptionHandler.h"
 #include "ConsoleCommands.h"
@@ -85,6 +86,8 @@ extern ConCommand c_echo;
 extern void Log_Init();
 extern void Log_Flush();
 extern void Log_Close();
+extern void Log_InitAsync();
+extern void Log_ShutdownAsync();
 
 extern bool g_bLoggingInitialized;
 
@@ -168,6 +171,7 @@ bool CDkCore::Init(const char* pszApplicationName, const char* pszCommandLine)
 	}
 
 	bool logEnabled = false;
+	bool asyncLog = false;
 
 	kvkeybase_t* pAppDebug = coreConfigRoot->FindKeyBase("ApplicationDebug", KV_FLAG_SECTION);
 	if(pAppDebug)
@@ -178,6 +182,9 @@ bool CDkCore::Init(const char* pszApplicationName, const char* pszCommandLine)
 		if(pAppDebug->FindKeyBase("PrintLeaksOnExit", KV_FLAG_NOVALUE))
 			g_bPrintLeaksOnShutdown = true;
 
+		if(pAppDebug->FindKeyBase("AsyncLog", KV_FLAG_NOVALUE))
+			asyncLog = true;
+
 		DkList<EqString> devModeList;
 
 		kvkeybase_t* devModesKv = pAppDebug->FindKeyBase("DeveloperMode");
@@ -221,6 +228,13 @@ bool CDkCore::Init(const char* pszApplicationName, const char* pszCommandLine)
 		Log_Init();
 	}
 
+	if(g_cmdLine->FindArgument("-asynclog") != -1)
+		asyncLog = true;
+
+	// messages are written to the outputs by the separate thread
+	if(asyncLog)
+		Log_InitAsync();
+
 	//Remove log files
 	remove("logs/Assert.log");
 
@@ -300,6 +314,7 @@ void CDkCore::InitSubInterfaces()
 	RegisterInterface( CMDLINE_INTERFACE_VERSION, GetCCommandLine());
 	RegisterInterface( LOCALIZER_INTERFACE_VERSION , GetCLocalize());
 	RegisterInterface( CPUSERVICES_INTERFACE_VERSION , GetCEqCPUCaps());
+	RegisterInterface( PROFILER_INTERFACE_VERSION , GetCEqProfiler());
 }
 
 KeyValues* CDkCore::GetConfig() const
@@ -365,6 +380,8 @@ void CDkCore::Shutdown()
     Msg("===================================\nLog closed: %s\n",datetime);
 #endif
 
+	Log_ShutdownAsync();
+
 	// shutdown memory
 	PPMemShutdown();
 
@@ -102,8 +102,8 @@ bool CEqParallelJobThreads::Init(int numJobTypes, eqJobThreadDesc_t* jobTypes)
 	{
 		for (int j = 0; j < jobTypes[i].numThreads; j++)
 		{
-			m_jobThreads.append(new CEqJobThread(this, jobTypes[i].jobTypeId));
-			m_jobThreads[i]->StartWorkerThread(varargs("jobThread_%d_%d", jobTypes[i].jobTypeId, j));
+			int threadIdx = m_jobThreads.append(new CEqJobThread(this, jobTypes[i].jobTypeId));
+			m_jobThreads[threadIdx]->StartWorkerThread(varargs("jobThread_%d_%d", jobTypes[i].jobTypeId, j));
 			numThreadsSpawned++;
 		}
 	}
@@ -197,6 +197,11 @@ bool CEqParallelJobThreads::AllJobsCompleted() const
 	return m_workQueue.getCount() == 0;
 }
 
+int CEqParallelJobThreads::GetJobThreadsCount() const
+{
+	return m_jobThreads.numElem();
+}
+
 // wait for completion
 void CEqParallelJobThreads::Wait()
 {
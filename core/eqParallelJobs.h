@@ -81,6 +81,9 @@ public:
 	// returns state if all jobs has been done
 	bool							AllJobsCompleted() const;
 
+	// returns the number of running job threads
+	int								GetJobThreadsCount() const;
+
 	// wait for specific job
 	void							WaitForJob(eqParallelJob_t* job);
 
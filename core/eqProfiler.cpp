@@ -0,0 +1,528 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Eq Engine hierarchical CPU profiler
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "eqProfiler.h"
+#include "core/DebugInterface.h"
+#include "core/IFileSystem.h"
+#include "core/platform/Platform.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <time.h>
+#endif // _WIN32
+
+EXPORTED_INTERFACE(IEqProfiler, CEqProfiler);
+
+#define PROFILER_AVG_FACTOR			0.1f
+
+using namespace Threading;
+
+static int64 Prof_GetTicks()
+{
+#ifdef _WIN32
+	LARGE_INTEGER curr;
+	QueryPerformanceCounter(&curr);
+
+	return curr.QuadPart;
+#else
+	timespec curr;
+	clock_gettime(CLOCK_MONOTONIC, &curr);
+
+	return (int64)curr.tv_sec * 1000000000LL + curr.tv_nsec;
+#endif // _WIN32
+}
+
+static int64 Prof_GetTickFrequency()
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+
+	return freq.QuadPart;
+#else
+	return 1000000000LL;
+#endif // _WIN32
+}
+
+// used when marker table is full
+static eqProfMarker_t s_nullMarker = { "", -1, false };
+
+// escapes string for JSON. Output size must be at least (strlen(str)*6 + 1)
+static const char* Prof_EscapeJSON(const char* str, char* out)
+{
+	char* dst = out;
+
+	for(const char* c = str; *c; c++)
+	{
+		unsigned char ch = *c;
+
+		if(ch == '"' || ch == '\\')
+		{
+			*dst++ = '\\';
+			*dst++ = ch;
+		}
+		else if(ch < 0x20)
+			dst += sprintf(dst, "\\u%04x", ch);
+		else
+			*dst++ = ch;
+	}
+
+	*dst = 0;
+
+	return out;
+}
+
+//-------------------------------------------------------------------------------------------
+
+CEqProfiler::CEqProfiler() :
+	m_numMarkers(0),
+	m_numThreads(0),
+	m_enabled(false),
+	m_captureFrames(0),
+	m_captureStart(0),
+	m_captureRestoreEnabled(false)
+{
+	memset(m_threads, 0, sizeof(m_threads));
+	m_tickFrequency = Prof_GetTickFrequency();
+}
+
+CEqProfiler::~CEqProfiler()
+{
+	for(int i = 0; i < m_numThreads; i++)
+		delete m_threads[i];
+}
+
+void CEqProfiler::SetEnabled(bool enable)
+{
+	CScopedMutex m(m_mutex);
+
+	// EndFrame does nothing when disabled, save the frames captured so far
+	if(!enable && m_captureFrames > 0)
+	{
+		m_captureFrames = 0;
+		WriteCapture();
+	}
+
+	m_enabled = enable;
+
+	for(int i = 0; i < m_numMarkers; i++)
+		m_markers[i].enabled = enable;
+}
+
+eqProfMarker_t* CEqProfiler::RegisterMarker(const char* name)
+{
+	CScopedMutex m(m_mutex);
+
+	for(int i = 0; i < m_numMarkers; i++)
+	{
+		if(!strcmp(m_markers[i].name, name))
+			return &m_markers[i];
+	}
+
+	if(m_numMarkers >= PROFILER_MAX_MARKERS)
+	{
+		MsgWarning("Profiler: too many markers, '%s' ignored\n", name);
+		return &s_nullMarker;
+	}
+
+	int id = m_numMarkers;
+
+	// modules can be unloaded, so keep the copy
+	strncpy(m_markerNames[id], name, PROFILER_MARKER_NAME_LEN);
+	m_markerNames[id][PROFILER_MARKER_NAME_LEN-1] = 0;
+
+	eqProfMarker_t& marker = m_markers[id];
+	marker.name = m_markerNames[id];
+	marker.id = id;
+	marker.enabled = m_enabled;
+
+	m_numMarkers++;
+
+	return &marker;
+}
+
+profThread_t* CEqProfiler::GetThreadContext()
+{
+	uintptr_t threadId = GetCurrentThreadID();
+
+	int numThreads = m_numThreads;
+
+	for(int i = 0; i < numThreads; i++)
+	{
+		if(m_threads[i]->threadId == threadId)
+			return m_threads[i];
+	}
+
+	CScopedMutex m(m_mutex);
+
+	// someone might add it meanwhile
+	for(int i = numThreads; i < m_numThreads; i++)
+	{
+		if(m_threads[i]->threadId == threadId)
+			return m_threads[i];
+	}
+
+	if(m_numThreads >= PROFILER_MAX_THREADS)
+		return nullptr;
+
+	profThread_t* thread = new profThread_t();
+	thread->threadId = threadId;
+	thread->numNodes = 0;
+	thread->firstRoot = -1;
+	thread->lastRoot = -1;
+	thread->stackDepth = 0;
+	snprintf(thread->name, sizeof(thread->name), "Thread %d", (int)m_numThreads);
+
+	m_threads[m_numThreads] = thread;
+
+	// publish after the context is set up
+	IncrementInterlocked(m_numThreads);
+
+	return thread;
+}
+
+int CEqProfiler::FindOrAddNode(profThread_t* thread, int parent, eqProfMarker_t* marker)
+{
+	profNode_t* nodes = thread->nodes;
+
+	int child = (parent == -1) ? thread->firstRoot : nodes[parent].firstChild;
+
+	for(; child != -1; child = nodes[child].nextSibling)
+	{
+		if(nodes[child].marker == marker)
+			return child;
+	}
+
+	if(thread->numNodes >= PROFILER_MAX_NODES)
+		return -1;
+
+	int idx = thread->numNodes;
+
+	profNode_t& node = nodes[idx];
+	node.marker = marker;
+	node.parent = parent;
+	node.firstChild = -1;
+	node.lastChild = -1;
+	node.nextSibling = -1;
+	node.depth = (parent == -1) ? 0 : nodes[parent].depth + 1;
+	node.frameTicks = 0;
+	node.frameCalls = 0;
+	node.lastCalls = 0;
+	node.lastMs = 0.0f;
+	node.avgMs = 0.0f;
+	node.maxMs = 0.0f;
+
+	thread->numNodes = idx + 1;
+
+	// link it last, stats readers are walking the tree without locking
+	if(parent == -1)
+	{
+		if(thread->lastRoot != -1)
+			nodes[thread->lastRoot].nextSibling = idx;
+		else
+			thread->firstRoot = idx;
+
+		thread->lastRoot = idx;
+	}
+	else
+	{
+		profNode_t& parentNode = nodes[parent];
+
+		if(parentNode.lastChild != -1)
+			nodes[parentNode.lastChild].nextSibling = idx;
+		else
+			parentNode.firstChild = idx;
+
+		parentNode.lastChild = idx;
+	}
+
+	return idx;
+}
+
+void CEqProfiler::BeginScope(eqProfMarker_t* marker)
+{
+	profThread_t* thread = GetThreadContext();
+
+	if(!thread)
+		return;
+
+	int depth = thread->stackDepth++;
+
+	if(depth >= PROFILER_MAX_DEPTH)
+		return;
+
+	int parent = (depth > 0) ? thread->stack[depth-1] : -1;
+
+	// children of the dropped scope are dropped too
+	int node = (depth > 0 && parent == -1) ? -1 : FindOrAddNode(thread, parent, marker);
+
+	thread->stack[depth] = node;
+	thread->stackStart[depth] = Prof_GetTicks();
+}
+
+void CEqProfiler::EndScope(eqProfMarker_t* marker)
+{
+	int64 endTicks = Prof_GetTicks();
+
+	profThread_t* thread = GetThreadContext();
+
+	if(!thread || thread->stackDepth == 0)
+		return;
+
+	int depth = --thread->stackDepth;
+
+	if(depth >= PROFILER_MAX_DEPTH)
+		return;
+
+	int nodeIdx = thread->stack[depth];
+
+	if(nodeIdx == -1)
+		return;
+
+	profNode_t& node = thread->nodes[nodeIdx];
+
+	ASSERT(node.marker == marker);
+
+	int64 startTicks = thread->stackStart[depth];
+
+	node.frameTicks += endTicks - startTicks;
+	node.frameCalls++;
+
+	if(m_captureFrames > 0)
+	{
+		profEvent_t evt;
+		evt.marker = marker->id;
+		evt.depth = depth;
+		evt.start = startTicks;
+		evt.end = endTicks;
+
+		CScopedMutex m(thread->captureMutex);
+		thread->captureEvents.append(evt);
+	}
+}
+
+void CEqProfiler::EndFrame()
+{
+	if(!m_enabled)
+		return;
+
+	profThread_t* mainThread = GetThreadContext();
+
+	if(mainThread)
+		strcpy(mainThread->name, "Main");
+
+	const float ticksToMs = 1000.0f / (float)m_tickFrequency;
+
+	bool captureDone = false;
+
+	{
+		CScopedMutex m(m_mutex);
+
+		for(int i = 0; i < m_numThreads; i++)
+		{
+			profThread_t* thread = m_threads[i];
+
+			// NOTE: other threads are not stopped here, scopes which are closing
+			// right now may go either to this frame or the next one
+			int numNodes = thread->numNodes;
+
+			for(int j = 0; j < numNodes; j++)
+			{
+				profNode_t& node = thread->nodes[j];
+
+				int64 ticks = node.frameTicks;
+				int calls = node.frameCalls;
+
+				node.frameTicks = 0;
+				node.frameCalls = 0;
+
+				float timeMs = (float)ticks * ticksToMs;
+
+				node.lastCalls = calls;
+				node.lastMs = timeMs;
+				node.avgMs += (timeMs - node.avgMs) * PROFILER_AVG_FACTOR;
+
+				if(timeMs > node.maxMs)
+					node.maxMs = timeMs;
+			}
+		}
+
+		if(m_captureFrames > 0)
+		{
+			m_captureFrames--;
+
+			if(m_captureFrames == 0)
+			{
+				WriteCapture();
+				captureDone = true;
+			}
+		}
+	}
+
+	if(captureDone && m_captureRestoreEnabled)
+		SetEnabled(false);
+}
+
+const char* CEqProfiler::GetThreadName(int thread) const
+{
+	if(thread < 0 || thread >= m_numThreads)
+		return nullptr;
+
+	return m_threads[thread]->name;
+}
+
+int CEqProfiler::GetFrameStats(int threadIdx, eqProfNodeStats_t* stats, int maxStats) const
+{
+	if(threadIdx < 0 || threadIdx >= m_numThreads)
+		return 0;
+
+	const profThread_t* thread = m_threads[threadIdx];
+	const profNode_t* nodes = thread->nodes;
+
+	int numStats = 0;
+	int nodeIdx = thread->firstRoot;
+
+	// depth-first walk
+	while(nodeIdx != -1 && numStats < maxStats)
+	{
+		const profNode_t& node = nodes[nodeIdx];
+
+		eqProfNodeStats_t& stat = stats[numStats++];
+		stat.name = node.marker->name;
+		stat.depth = node.depth;
+		stat.calls = node.lastCalls;
+		stat.timeMs = node.lastMs;
+		stat.avgTimeMs = node.avgMs;
+		stat.maxTimeMs = node.maxMs;
+
+		if(node.firstChild != -1)
+		{
+			nodeIdx = node.firstChild;
+			continue;
+		}
+
+		while(nodeIdx != -1 && nodes[nodeIdx].nextSibling == -1)
+			nodeIdx = nodes[nodeIdx].parent;
+
+		if(nodeIdx != -1)
+			nodeIdx = nodes[nodeIdx].nextSibling;
+	}
+
+	return numStats;
+}
+
+void CEqProfiler::ResetStats()
+{
+	CScopedMutex m(m_mutex);
+
+	for(int i = 0; i < m_numThreads; i++)
+	{
+		profThread_t* thread = m_threads[i];
+
+		for(int j = 0; j < thread->numNodes; j++)
+		{
+			thread->nodes[j].avgMs = 0.0f;
+			thread->nodes[j].maxMs = 0.0f;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------------
+
+bool CEqProfiler::StartCapture(const char* fileName, int numFrames)
+{
+	if(numFrames <= 0)
+		return false;
+
+	{
+		CScopedMutex m(m_mutex);
+
+		if(m_captureFrames > 0)
+		{
+			MsgWarning("Profiler: capture is already in progress\n");
+			return false;
+		}
+
+		for(int i = 0; i < m_numThreads; i++)
+		{
+			CScopedMutex cm(m_threads[i]->captureMutex);
+			m_threads[i]->captureEvents.clear(false);
+		}
+
+		m_captureFileName = fileName;
+		m_captureStart = Prof_GetTicks();
+		m_captureRestoreEnabled = !m_enabled;
+		m_captureFrames = numFrames;
+	}
+
+	if(m_captureRestoreEnabled)
+		SetEnabled(true);
+
+	MsgInfo("Profiler: capturing %d frames to '%s'\n", numFrames, fileName);
+
+	return true;
+}
+
+// writes capture in Chrome trace event format. m_mutex must be locked
+void CEqProfiler::WriteCapture()
+{
+	IFile* file = g_fileSystem->Open(m_captureFileName.ToCString(), "wt", SP_ROOT);
+
+	if(!file)
+	{
+		MsgError("Profiler: can't open '%s' for writing\n", m_captureFileName.ToCString());
+		return;
+	}
+
+	const double ticksToUs = 1000000.0 / (double)m_tickFrequency;
+
+	int numEvents = 0;
+	bool first = true;
+
+	char escapedName[PROFILER_MARKER_NAME_LEN*6];
+
+	file->Print("{\"traceEvents\":[\n");
+
+	for(int i = 0; i < m_numThreads; i++)
+	{
+		profThread_t* thread = m_threads[i];
+
+		file->Print("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", i, Prof_EscapeJSON(thread->name, escapedName));
+		first = false;
+
+		DkList<profEvent_t> events;
+
+		{
+			CScopedMutex m(thread->captureMutex);
+			events.swap(thread->captureEvents);
+		}
+
+		for(int j = 0; j < events.numElem(); j++)
+		{
+			const profEvent_t& evt = events[j];
+
+			// scopes which were opened before the capture
+			if(evt.start < m_captureStart)
+				continue;
+
+			file->Print(",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				Prof_EscapeJSON(m_markers[evt.marker].name, escapedName), i,
+				(double)(evt.start - m_captureStart) * ticksToUs,
+				(double)(evt.end - evt.start) * ticksToUs);
+		}
+
+		numEvents += events.numElem();
+	}
+
+	file->Print("\n]}\n");
+
+	g_fileSystem->Close(file);
+
+	MsgInfo("Profiler: %d events saved to '%s'\n", numEvents, m_captureFileName.ToCString());
+}
@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Eq Engine hierarchical CPU profiler
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef EQPROFILER_H
+#define EQPROFILER_H
+
+#include "core/IEqProfiler.h"
+#include "utils/eqthread.h"
+#include "utils/eqstring.h"
+#include "utils/DkList.h"
+
+#define PROFILER_MAX_THREADS		32
+#define PROFILER_MAX_MARKERS		512
+#define PROFILER_MAX_NODES			512		// unique scope paths per thread
+#define PROFILER_MAX_DEPTH			32
+#define PROFILER_MARKER_NAME_LEN	64
+
+// scope path node
+struct profNode_t
+{
+	eqProfMarker_t*		marker;
+	int					parent;
+	int					firstChild;
+	int					lastChild;
+	int					nextSibling;
+	int					depth;
+
+	// accumulated by the owner thread during the frame
+	int64				frameTicks;
+	int					frameCalls;
+
+	// updated by EndFrame
+	int					lastCalls;
+	float				lastMs;
+	float				avgMs;
+	float				maxMs;
+};
+
+// captured scope
+struct profEvent_t
+{
+	int					marker;
+	int					depth;
+	int64				start;
+	int64				end;
+};
+
+// per-thread scope tree
+struct profThread_t
+{
+	uintptr_t			threadId;
+	char				name[32];
+
+	profNode_t			nodes[PROFILER_MAX_NODES];
+	volatile int		numNodes;
+	int					firstRoot;
+	int					lastRoot;
+
+	int					stack[PROFILER_MAX_DEPTH];
+	int64				stackStart[PROFILER_MAX_DEPTH];
+	int					stackDepth;
+
+	DkList<profEvent_t>	captureEvents;
+	Threading::CEqMutex	captureMutex;
+};
+
+class CEqProfiler : public IEqProfiler
+{
+public:
+								CEqProfiler();
+								~CEqProfiler();
+
+	bool						IsInitialized() const		{ return true; }
+	const char*					GetInterfaceName() const	{ return PROFILER_INTERFACE_VERSION; }
+
+	void						SetEnabled(bool enable);
+	bool						IsEnabled() const			{ return m_enabled; }
+
+	eqProfMarker_t*				RegisterMarker(const char* name);
+
+	void						BeginScope(eqProfMarker_t* marker);
+	void						EndScope(eqProfMarker_t* marker);
+
+	void						EndFrame();
+
+	int							GetThreadCount() const		{ return m_numThreads; }
+	const char*					GetThreadName(int thread) const;
+
+	int							GetFrameStats(int thread, eqProfNodeStats_t* stats, int maxStats) const;
+
+	void						ResetStats();
+
+	bool						StartCapture(const char* fileName, int numFrames);
+	bool						IsCapturing() const			{ return m_captureFrames > 0; }
+
+protected:
+	profThread_t*				GetThreadContext();
+	int							FindOrAddNode(profThread_t* thread, int parent, eqProfMarker_t* marker);
+
+	void						WriteCapture();
+
+	eqProfMarker_t				m_markers[PROFILER_MAX_MARKERS];
+	char						m_markerNames[PROFILER_MAX_MARKERS][PROFILER_MARKER_NAME_LEN];
+	int							m_numMarkers;
+
+	profThread_t*				m_threads[PROFILER_MAX_THREADS];
+	Threading::InterlockedInt_t	m_numThreads;
+
+	Threading::CEqMutex			m_mutex;
+
+	int64						m_tickFrequency;
+	volatile bool				m_enabled;
+
+	// capture
+	EqString					m_captureFileName;
+	int							m_captureFrames;
+	int64						m_captureStart;
+	bool						m_captureRestoreEnabled;
+};
+
+#endif // EQPROFILER_H
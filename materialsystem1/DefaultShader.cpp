@@ -51,7 +51,8 @@ BEGIN_SHADER_CLASS(Default)
 	void SetColorModulation()
 	{
 		ColorRGBA setColor = materials->GetAmbientColor();
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor);
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor, s_constAmbientColor);
 	}
 
 	ITexture*	GetBaseTexture(int stage) {return NULL;}
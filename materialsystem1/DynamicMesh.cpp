@@ -58,18 +58,23 @@ Sizes:
 CDynamicMesh::CDynamicMesh() :
 	m_primType( PRIM_TRIANGLES ),
 	m_vertexFormat(nullptr),
-	m_vertexBuffer(nullptr),
-	m_indexBuffer(nullptr),
 	m_numVertices(0),
 	m_numIndices(0),
+	m_uploadedVertices(0),
+	m_uploadedIndices(0),
 	m_vertices(nullptr),
 	m_indices(nullptr),
-	m_lockVertices(nullptr),
-	m_lockIndices(nullptr),
-	m_vboDirty(-1),
-	m_vboAqquired(-1)
+	m_curBuffer(0),
+	m_bufferVertexPos(0),
+	m_bufferIndexPos(0),
+	m_batchVertexOfs(0),
+	m_batchIndexOfs(0)
 {
+	memset(m_vertexBuffers, 0, sizeof(m_vertexBuffers));
+	memset(m_indexBuffers, 0, sizeof(m_indexBuffers));
 
+	memset(&m_frameStats, 0, sizeof(m_frameStats));
+	memset(&m_lastFrameStats, 0, sizeof(m_lastFrameStats));
 }
 
 CDynamicMesh::~CDynamicMesh()
@@ -78,7 +83,7 @@ CDynamicMesh::~CDynamicMesh()
 
 bool CDynamicMesh::Init( VertexFormatDesc_t* desc, int numAttribs )
 {
-	if(m_vertexBuffer != nullptr && m_indexBuffer != nullptr && m_vertexFormat != nullptr)
+	if(m_vertexFormat != nullptr)
 		return true;
 
 	ASSERTMSG(numAttribs > 0, "CDynamicMesh::Init - numAttribs is ZERO!\n");
@@ -97,36 +102,52 @@ bool CDynamicMesh::Init( VertexFormatDesc_t* desc, int numAttribs )
 
 	m_vertexStride = vertexSize;
 
-	m_vertexBuffer = g_pShaderAPI->CreateVertexBuffer(BUFFER_DYNAMIC, MAX_DYNAMIC_VERTICES, m_vertexStride, NULL);
-	m_indexBuffer = g_pShaderAPI->CreateIndexBuffer(MAX_DYNAMIC_INDICES, sizeof(uint16), BUFFER_DYNAMIC, NULL);
+	for(int i = 0; i < DYNAMICMESH_BUFFERS; i++)
+	{
+		m_vertexBuffers[i] = g_pShaderAPI->CreateVertexBuffer(BUFFER_DYNAMIC, MAX_DYNAMIC_VERTICES, m_vertexStride, NULL);
+		m_indexBuffers[i] = g_pShaderAPI->CreateIndexBuffer(MAX_DYNAMIC_INDICES, sizeof(uint16), BUFFER_DYNAMIC, NULL);
+
+		if(!m_vertexBuffers[i] || !m_indexBuffers[i])
+			return false;
+	}
 
 	m_vertexFormat = g_pShaderAPI->CreateVertexFormat(desc, numAttribs);
 
 	m_vertices = PPAlloc(MAX_DYNAMIC_VERTICES*m_vertexStride);
 	m_indices = (uint16*)PPAlloc(MAX_DYNAMIC_INDICES*sizeof(uint16));
 
-	return (m_vertexBuffer != nullptr && m_indexBuffer != nullptr && m_vertexFormat != nullptr);
+	m_curBuffer = 0;
+	m_bufferVertexPos = 0;
+	m_bufferIndexPos = 0;
+
+	return (m_vertexFormat != nullptr);
 }
 
 void CDynamicMesh::Destroy()
 {
-	if(m_vertexBuffer == nullptr && m_indexBuffer == nullptr && m_vertexFormat == nullptr)
+	if(m_vertexFormat == nullptr && m_vertexBuffers[0] == nullptr)
 		return;
 
 	Reset();
-	Unlock();
 
-	g_pShaderAPI->DestroyIndexBuffer(m_indexBuffer);
-	g_pShaderAPI->DestroyVertexBuffer(m_vertexBuffer);
+	for(int i = 0; i < DYNAMICMESH_BUFFERS; i++)
+	{
+		if(m_indexBuffers[i])
+			g_pShaderAPI->DestroyIndexBuffer(m_indexBuffers[i]);
+
+		if(m_vertexBuffers[i])
+			g_pShaderAPI->DestroyVertexBuffer(m_vertexBuffers[i]);
+
+		m_vertexBuffers[i] = nullptr;
+		m_indexBuffers[i] = nullptr;
+	}
 
-	g_pShaderAPI->DestroyVertexFormat(m_vertexFormat);
+	if(m_vertexFormat)
+		g_pShaderAPI->DestroyVertexFormat(m_vertexFormat);
 
 	PPFree(m_vertices);
 	PPFree(m_indices);
 
-	m_vertexBuffer = nullptr;
-	m_indexBuffer = nullptr;
-
 	m_vertexFormat = nullptr;
 
 	m_vertices = nullptr;
@@ -162,6 +183,9 @@ void CDynamicMesh::AddStripBreak()
 	if(m_numIndices == 0)
 		return; // no problemo 
 
+	if(m_numIndices + 2 > MAX_DYNAMIC_INDICES)
+		return;
+
 	int num_ind = m_numIndices;
 
 	uint16 nIndicesCurr = 0;
@@ -178,8 +202,6 @@ void CDynamicMesh::AddStripBreak()
 		memcpy(&m_indices[m_numIndices], degenerate, sizeof(uint16) * 2);
 		m_numIndices += 2;
 	}
-
-	m_vboDirty = 0;
 }
 
 // allocates geometry chunk. Returns the start index. Will return -1 if failed
@@ -189,104 +211,126 @@ int CDynamicMesh::AllocateGeom( int nVertices, int nIndices, void** verts, uint1
 	if(nVertices == 0 && nIndices == 0)
 		return -1;
 
+	if(!indices)
+		nIndices = 0;
+
 	if(addStripBreak)
 		AddStripBreak();
 
+	if(m_numVertices + nVertices > MAX_DYNAMIC_VERTICES || m_numIndices + nIndices > MAX_DYNAMIC_INDICES)
+		return -1;
+
 	int startVertex = m_numVertices;
 	int startIndex = m_numIndices;
 
 	// apply offsets first
 	m_numVertices += nVertices;
+	m_numIndices += nIndices;
 
-	if(indices && nIndices)
-		m_numIndices += nIndices;
-
-	// give the pointers
+	// give the pointers. Caller fills the whole range so it's not cleared
 	*verts = (ubyte*)m_vertices + startVertex * m_vertexStride;
 
-	memset(*verts, 0, m_vertexStride*nVertices);
-
 	// indices are optional
-	if(indices && nIndices)
-	{
+	if(nIndices)
 		*indices = &m_indices[startIndex];
-		memset(*indices, 0, sizeof(uint16)*nIndices);
-	}
-
-	memset(*verts, 0, m_vertexStride*nVertices);
-
-	m_vboDirty = 0;
 
 	return startVertex;
 }
 
-bool CDynamicMesh::Lock()
+// uploads the part of geometry that is not in buffers yet
+void CDynamicMesh::Upload()
 {
-	if(m_vboAqquired == -1)
+	if(m_uploadedVertices == m_numVertices && m_uploadedIndices == m_numIndices)
+		return;
+
+	if(m_uploadedVertices == 0 && m_uploadedIndices == 0)
 	{
-		if(!m_vertexBuffer->Lock(0, m_numVertices, &m_lockVertices, false))
-			return false;
+		// new geometry goes right after previously rendered
+		m_batchVertexOfs = m_bufferVertexPos;
+		m_batchIndexOfs = m_bufferIndexPos;
+	}
 
-		if (!m_indexBuffer->Lock(0, m_numIndices, (void**)&m_lockIndices, false))
-		{
-			m_vertexBuffer->Unlock();
-			return false;
-		}
+	// geometry must be contiguous because indices are relative to first vertex.
+	// If it doesn't fit anymore, switch to next buffer and upload it entirely
+	if(m_batchVertexOfs + m_numVertices > MAX_DYNAMIC_VERTICES ||
+		m_batchIndexOfs + m_numIndices > MAX_DYNAMIC_INDICES)
+	{
+		m_curBuffer = (m_curBuffer + 1) % DYNAMICMESH_BUFFERS;
+
+		m_batchVertexOfs = 0;
+		m_batchIndexOfs = 0;
 
-		m_vboAqquired = 0;
+		m_uploadedVertices = 0;
+		m_uploadedIndices = 0;
+
+		m_frameStats.bufferSwitches++;
 	}
 
-	return true;
-}
+	// buffer is discarded by first write to it, the rest is appended without overwrite
+	int newVertices = m_numVertices - m_uploadedVertices;
+	int newIndices = m_numIndices - m_uploadedIndices;
 
-void CDynamicMesh::Unlock()
-{
-	if (m_vboAqquired == -1)
-		return;
+	if(newVertices > 0)
+	{
+		int vertexOfs = m_batchVertexOfs + m_uploadedVertices;
+		ubyte* data = (ubyte*)m_vertices + m_uploadedVertices*m_vertexStride;
+
+		m_vertexBuffers[m_curBuffer]->Update(data, newVertices, vertexOfs, vertexOfs == 0);
+
+		m_frameStats.uploadBytes += newVertices*m_vertexStride;
+	}
+
+	if(newIndices > 0)
+	{
+		int indexOfs = m_batchIndexOfs + m_uploadedIndices;
 
-	m_vertexBuffer->Unlock();
-	m_indexBuffer->Unlock();
+		m_indexBuffers[m_curBuffer]->Update(m_indices + m_uploadedIndices, newIndices, indexOfs, indexOfs == 0);
 
-	m_vboAqquired = -1;
-	m_vboDirty = -1;
+		m_frameStats.uploadBytes += newIndices*sizeof(uint16);
+	}
+
+	m_frameStats.uploads++;
+
+	m_uploadedVertices = m_numVertices;
+	m_uploadedIndices = m_numIndices;
+
+	m_bufferVertexPos = m_batchVertexOfs + m_numVertices;
+	m_bufferIndexPos = m_batchIndexOfs + m_numIndices;
 }
 
 // uploads buffers and renders the mesh. Note that you has been set material and adjusted RTs
 void CDynamicMesh::Render()
 {
-	if(m_numVertices == 0)
+	Render(0, m_numIndices > 0 ? m_numIndices : m_numVertices);
+}
+
+// renders the range of indices (or vertices if there are no indices)
+void CDynamicMesh::Render( int firstIndex, int numIndices )
+{
+	if(m_numVertices == 0 || numIndices <= 0)
 		return;
 
-	ASSERT(m_vboAqquired != 0);
+	Upload();
 
 	bool drawIndexed = m_numIndices > 0;
 
-	if(m_vboDirty == 0)
-	{
-		m_vertexBuffer->Update(m_vertices, m_numVertices, 0, true);
-
-		if(drawIndexed)
-			m_indexBuffer->Update(m_indices, m_numIndices, 0, true);
-
-		m_vboDirty = -1;
-	}
-
-	//g_pShaderAPI->Reset(STATE_RESET_VBO);
-
+	// buffer offset works as base vertex
 	g_pShaderAPI->SetVertexFormat(m_vertexFormat);
-	g_pShaderAPI->SetVertexBuffer(m_vertexBuffer, 0);
+	g_pShaderAPI->SetVertexBuffer(m_vertexBuffers[m_curBuffer], 0, m_batchVertexOfs);
 
 	if (drawIndexed)
-		g_pShaderAPI->SetIndexBuffer(m_indexBuffer);
+		g_pShaderAPI->SetIndexBuffer(m_indexBuffers[m_curBuffer]);
 	else
 		g_pShaderAPI->SetIndexBuffer(nullptr);
 
 	g_pShaderAPI->ApplyBuffers();
 
 	if(drawIndexed)
-		g_pShaderAPI->DrawIndexedPrimitives(m_primType, 0, m_numIndices, 0, m_numVertices);
+		g_pShaderAPI->DrawIndexedPrimitives(m_primType, m_batchIndexOfs + firstIndex, numIndices, 0, m_numVertices);
 	else
-		g_pShaderAPI->DrawNonIndexedPrimitives(m_primType, 0, m_numVertices);
+		g_pShaderAPI->DrawNonIndexedPrimitives(m_primType, firstIndex, numIndices);
+
+	m_frameStats.draws++;
 }
 
 // resets the dynamic mesh
@@ -295,7 +339,28 @@ void CDynamicMesh::Reset()
 	m_numVertices = 0;
 	m_numIndices = 0;
 
-	m_vboDirty = -1;
+	m_uploadedVertices = 0;
+	m_uploadedIndices = 0;
+}
 
-	Unlock();
-}
\ No newline at end of file
+// returns byte count uploaded during last frame
+int CDynamicMesh::GetUploadedBytes() const
+{
+	return m_lastFrameStats.uploadBytes;
+}
+
+// called by material system after the frame is presented
+void CDynamicMesh::OnFrameEnd()
+{
+	m_lastFrameStats = m_frameStats;
+	memset(&m_frameStats, 0, sizeof(m_frameStats));
+}
+
+void CDynamicMesh::PrintStats()
+{
+	Msg("Dynamic mesh last frame: %d uploads (%.2f KB), %d draws, %d buffer switches\n",
+		m_lastFrameStats.uploads,
+		m_lastFrameStats.uploadBytes / 1024.0f,
+		m_lastFrameStats.draws,
+		m_lastFrameStats.bufferSwitches);
+}
@@ -11,6 +11,20 @@
 #include "materialsystem1/IDynamicMesh.h"
 #include "materialsystem1/renderers/IShaderAPI.h"
 
+#define DYNAMICMESH_BUFFERS		3		// buffers in ring, each one is discarded when writing wraps to it
+
+struct dynMeshStats_t
+{
+	int				uploads;
+	int				uploadBytes;
+	int				draws;
+	int				bufferSwitches;
+};
+
+//
+// Geometry is built in CPU copy and appended to the ring of vertex and index buffers
+// with no-overwrite semantics, only the part that wasn't uploaded yet is sent on Render.
+//
 class CDynamicMesh : public IDynamicMesh
 {
 public:
@@ -34,15 +48,23 @@ public:
 	// uploads buffers and renders the mesh. Note that you has been set material and adjusted RTs
 	void			Render();
 
+	// renders the range of indices (or vertices if there are no indices)
+	void			Render( int firstIndex, int numIndices );
+
 	// resets the dynamic mesh
 	void			Reset();
 
 	void			AddStripBreak();
 
-protected:
+	// returns byte count uploaded during last frame
+	int				GetUploadedBytes() const;
 
-	bool			Lock();
-	void			Unlock();
+	// called by material system after the frame is presented
+	void			OnFrameEnd();
+	void			PrintStats();
+
+protected:
+	void			Upload();
 
 	ER_PrimitiveType	m_primType;
 
@@ -52,17 +74,25 @@ protected:
 	uint16			m_numVertices;
 	uint16			m_numIndices;
 
-	void*			m_lockVertices;
-	uint16*			m_lockIndices;
+	uint16			m_uploadedVertices;		// part of CPU copy that is already in buffers
+	uint16			m_uploadedIndices;
 
 	IVertexFormat*	m_vertexFormat;
-	IVertexBuffer*	m_vertexBuffer;
-	IIndexBuffer*	m_indexBuffer;
+	IVertexBuffer*	m_vertexBuffers[DYNAMICMESH_BUFFERS];
+	IIndexBuffer*	m_indexBuffers[DYNAMICMESH_BUFFERS];
+
+	int				m_curBuffer;
+
+	int				m_bufferVertexPos;		// write position in current buffers
+	int				m_bufferIndexPos;
+
+	int				m_batchVertexOfs;		// CPU copy placement in current buffers
+	int				m_batchIndexOfs;
 
 	int				m_vertexStride;
 
-	int				m_vboAqquired;
-	int				m_vboDirty;
+	dynMeshStats_t	m_frameStats;
+	dynMeshStats_t	m_lastFrameStats;
 };
 
 #endif // DYNAMICMESH_H
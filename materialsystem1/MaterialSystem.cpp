@@ -15,19 +15,26 @@
 #include "core/ConVar.h"
 #include "core/ConCommand.h"
 #include "core/IFileSystem.h"
+#include "core/IEqProfiler.h"
+#include "core/IEqCPUServices.h"
+#include "core/IEqParallelJobs.h"
 
 #include "utils/strtools.h"
 #include "utils/KeyValues.h"
+#include "utils/eqtimer.h"
 
 #include "materialsystem1/MeshBuilder.h"
 
 #include "Renderers/Shared/IRenderLibrary.h"
+#include "ShaderAPIDeferred.h"
 #include "imaging/ImageLoader.h"
 #include "imaging/PixWriter.h"
 
 
 #include "MaterialProxy.h"
 
+#include <queue>
+
 DECLARE_INTERNAL_SHADERS()
 
 IShaderAPI*				g_pShaderAPI = NULL;
@@ -89,64 +96,312 @@ DECLARE_CMD(mat_releaseUnused, "Releases unused materials",0)
 // Threaded material loader
 //
 
-class CEqMatSystemThreadedLoader : public CEqThread
+#define MATSYSTEM_MAX_LOADER_THREADS	4
+
+ConVar				r_loaderThreads("r_loaderThreads", "0", 0, MATSYSTEM_MAX_LOADER_THREADS, "Material loader thread count, 0 is by CPU count. Takes effect on next start", CV_ARCHIVE);
+
+class CEqMatSystemThreadedLoader;
+
+class CEqMatSystemLoaderWorker : public CEqThread
 {
 public:
-	virtual int Run()
+	CEqMatSystemThreadedLoader*	m_loader;
+
+protected:
+	virtual int Run();
+};
+
+// multiple loader threads with shared priority queue
+// materials with same priority are loaded in FIFO order
+class CEqMatSystemThreadedLoader
+{
+	friend class CEqMatSystemLoaderWorker;
+public:
+	CEqMatSystemThreadedLoader() : m_numWorkers(0), m_order(0), m_numQueued(0), m_loadedSignal(true)
+	{
+		ResetStats();
+	}
+
+	void Start()
 	{
-		int counter = 0;
+		CScopedMutex m(m_Mutex);
+
+		if(m_numWorkers)
+			return;
+
+		int numWorkers = r_loaderThreads.GetInt();
+
+		if(numWorkers <= 0)
+			numWorkers = g_cpuCaps->GetCPUCount()-1;
 
-		while(true)
+		numWorkers = clamp(numWorkers, 1, MATSYSTEM_MAX_LOADER_THREADS);
+
+		for(int i = 0; i < numWorkers; i++)
 		{
-			m_Mutex.Lock();
-				// out of bounds
-				if(counter >= m_newMaterials.numElem())
-				{
-					m_newMaterials.setNum(0);
-					m_Mutex.Unlock();
-					break;
-				}
+			m_workers[i].m_loader = this;
+			m_workers[i].StartWorkerThread(varargs("matSystemLoader%d", i));
+		}
 
-				IMaterial* material = m_newMaterials[counter];
-				counter++;
-			m_Mutex.Unlock();
+		m_numWorkers = numWorkers;
+	}
+
+	void Stop()
+	{
+		for(int i = 0; i < m_numWorkers; i++)
+			m_workers[i].StopThread(true);
+
+		CScopedMutex m(m_Mutex);
+
+		m_numWorkers = 0;
+		m_queue = std::priority_queue<loadRequest_t>();
+		m_queued.clear();
+		m_numQueued = 0;
+	}
+
+	bool IsRunning() const
+	{
+		return m_numWorkers > 0;
+	}
+
+	void SignalWork()
+	{
+		for(int i = 0; i < m_numWorkers; i++)
+			m_workers[i].SignalWork();
+	}
 
-			if (material)
+	void WaitForThreads()
+	{
+		if(m_numQueued)
+			SignalWork();
+
+		for(int i = 0; i < m_numWorkers; i++)
+			m_workers[i].WaitForThread();
+	}
+
+	// adds material or raises priority of the already queued one
+	void AddMaterial(IMaterial* pMaterial, int priority)
+	{
+		CScopedMutex m(m_Mutex);
+
+		queuedMap_t::iterator it = m_queued.find(pMaterial);
+
+		if(it != m_queued.end())
+		{
+			// loading or the priority is high enough
+			if(it->second.loading || it->second.priority >= priority)
+				return;
+
+			// the old entry in queue is going to be skipped
+			it->second.priority = priority;
+		}
+		else
+		{
+			queuedMaterial_t& queued = m_queued[pMaterial];
+			queued.priority = priority;
+			queued.queueTime = m_timer.GetTime();
+			queued.loading = false;
+
+			m_numQueued++;
+
+			if(m_numQueued > m_stats.peakQueued)
+				m_stats.peakQueued = m_numQueued;
+		}
+
+		loadRequest_t req;
+		req.material = pMaterial;
+		req.priority = priority;
+		req.order = m_order++;
+
+		m_queue.push(req);
+	}
+
+	// removes material from queue or waits if it's being loaded
+	void RemoveMaterial(IMaterial* pMaterial)
+	{
+		for(;;)
+		{
 			{
-				// load this material
-				material->LoadShaderAndTextures();
+				CScopedMutex m(m_Mutex);
+
+				queuedMap_t::iterator it = m_queued.find(pMaterial);
+
+				if(it == m_queued.end())
+					return;
+
+				if(!it->second.loading)
+				{
+					m_queued.erase(it);
+					m_numQueued--;
+					return;
+				}
+
+				// cleared under the lock, so MaterialLoaded can't be missed
+				m_loadedSignal.Clear();
 			}
+
+			m_loadedSignal.Wait();
 		}
+	}
 
-		// run thread code here
-		return 0;
+	int GetCount() const
+	{
+		return m_numQueued;
 	}
 
-	void AddMaterial(IMaterial* pMaterial)
+	void ResetStats()
 	{
 		CScopedMutex m(m_Mutex);
-		m_newMaterials.addUnique( pMaterial );
+
+		m_stats.numLoaded = 0;
+		m_stats.peakQueued = m_numQueued;
+		m_stats.totalTimeToReady = 0.0;
+		m_stats.maxTimeToReady = 0.0;
 	}
 
-	int GetCount() const
+	void PrintStats()
 	{
-		return m_newMaterials.numElem();
+		CScopedMutex m(m_Mutex);
+
+		MsgInfo("Material loader: %d threads\n", m_numWorkers);
+		MsgInfo("  queued: %d (peak %d)\n", m_numQueued, m_stats.peakQueued);
+		MsgInfo("  loaded: %d\n", m_stats.numLoaded);
+
+		if(m_stats.numLoaded)
+			MsgInfo("  time to ready: avg %.2f ms, max %.2f ms\n", m_stats.totalTimeToReady / m_stats.numLoaded * 1000.0, m_stats.maxTimeToReady * 1000.0);
 	}
 
 protected:
-	DkList<IMaterial*>	m_newMaterials;
+	struct loadRequest_t
+	{
+		IMaterial*	material;
+		int			priority;
+		uint		order;
+
+		// std::priority_queue gives the greatest element first
+		bool operator < (const loadRequest_t& other) const
+		{
+			if(priority != other.priority)
+				return priority < other.priority;
+
+			return (int)(order - other.order) > 0;
+		}
+	};
+
+	struct queuedMaterial_t
+	{
+		double		queueTime;
+		int			priority;
+		bool		loading;
+	};
+
+	typedef std::unordered_map<IMaterial*, queuedMaterial_t> queuedMap_t;
+
+	// takes the material with highest priority and marks it as loading
+	IMaterial* PopMaterial()
+	{
+		CScopedMutex m(m_Mutex);
+
+		while(!m_queue.empty())
+		{
+			loadRequest_t req = m_queue.top();
+			m_queue.pop();
+
+			queuedMap_t::iterator it = m_queued.find(req.material);
+
+			// removed, taken by other thread or queued again with higher priority
+			if(it == m_queued.end() || it->second.loading || it->second.priority != req.priority)
+				continue;
+
+			it->second.loading = true;
+			return req.material;
+		}
+
+		return nullptr;
+	}
+
+	void MaterialLoaded(IMaterial* pMaterial)
+	{
+		CScopedMutex m(m_Mutex);
+
+		queuedMap_t::iterator it = m_queued.find(pMaterial);
+
+		if(it == m_queued.end())
+			return;
+
+		double timeToReady = m_timer.GetTime() - it->second.queueTime;
+
+		m_stats.numLoaded++;
+		m_stats.totalTimeToReady += timeToReady;
+
+		if(timeToReady > m_stats.maxTimeToReady)
+			m_stats.maxTimeToReady = timeToReady;
+
+		m_queued.erase(it);
+		m_numQueued--;
+
+		m_loadedSignal.Raise();
+	}
 
-	CEqMutex			m_Mutex;
+	CEqMatSystemLoaderWorker			m_workers[MATSYSTEM_MAX_LOADER_THREADS];
+	int									m_numWorkers;
+
+	std::priority_queue<loadRequest_t>	m_queue;
+	queuedMap_t							m_queued;
+	uint								m_order;
+	volatile int						m_numQueued;
+
+	struct
+	{
+		int		numLoaded;
+		int		peakQueued;
+		double	totalTimeToReady;
+		double	maxTimeToReady;
+	} m_stats;
+
+	CEqTimer							m_timer;
+	CEqMutex							m_Mutex;
+	CEqSignal							m_loadedSignal;		// raised by each loaded material
 };
 
+int CEqMatSystemLoaderWorker::Run()
+{
+	IMaterial* material;
+
+	while((material = m_loader->PopMaterial()) != nullptr)
+	{
+		PROF_EVENT("MatSystem LoadMaterial");
+
+		// load this material
+		material->LoadShaderAndTextures();
+		m_loader->MaterialLoaded(material);
+	}
+
+	// run thread code here
+	return 0;
+}
+
 CEqMatSystemThreadedLoader g_threadedMaterialLoader;
 
+DECLARE_CMD(mat_loaderStats, "Prints material loader queue statistics", 0)
+{
+	g_threadedMaterialLoader.PrintStats();
+
+	if(CMD_ARGC > 0 && !stricmp(CMD_ARGV(0).ToCString(), "reset"))
+		g_threadedMaterialLoader.ResetStats();
+}
+
+DECLARE_CMD(mat_dynamicMeshStats, "Prints dynamic mesh statistics of last frame", 0)
+{
+	((CDynamicMesh*)materials->GetDynamicMesh())->PrintStats();
+}
+
 //---------------------------------------------------------------------------
 
 CMaterialSystem::CMaterialSystem()
 {
 	m_cullMode = CULL_BACK;
 	m_shaderAPI = NULL;
+	m_deferredAPI = NULL;
 
 	m_forcePreloadMaterials = false;
 
@@ -170,6 +425,9 @@ CMaterialSystem::CMaterialSystem()
 	for(int i = 0; i < 4; i++)
 		m_matrices[i] = identity4();
 
+	m_sharedConstantsDirty = true;
+	m_sharedConstantsOverdraw = false;
+
 	m_whiteTexture = NULL;
 	m_pDefaultMaterial = NULL;
 	m_currentEnvmapTexture = NULL;
@@ -265,6 +523,25 @@ bool CMaterialSystem::Init(const char* materialsDirectory, const char* szShaderA
 	else
 		return false;
 
+	if(m_config.threadedRenderer)
+	{
+		// GL context is bound to the thread which created it
+		if(m_shaderAPI->GetShaderAPIClass() == SHADERAPI_OPENGL)
+		{
+			MsgWarning("MatSystem: render thread is not supported by %s, rendering from main thread\n", m_shaderAPI->GetRendererName());
+			m_config.threadedRenderer = false;
+		}
+		else
+		{
+			MsgInfo("MatSystem: using render thread\n");
+
+			m_deferredAPI = new ShaderAPIDeferred(m_shaderAPI, m_renderLibrary);
+			m_deferredAPI->StartRenderThread();
+
+			m_shaderAPI = m_deferredAPI;
+		}
+	}
+
 	g_pShaderAPI = m_shaderAPI;
 
 	if(!m_dynamicMesh.Init( g_standardVertexFormatDesc, elementsOf(g_standardVertexFormatDesc)))
@@ -289,8 +566,12 @@ void CMaterialSystem::Shutdown()
 	{
 		Msg("MatSystem shutdown...\n");
 
-		// shutdown thread first
-		g_threadedMaterialLoader.StopThread(true);
+		// shutdown threads first
+		g_threadedMaterialLoader.Stop();
+
+		// objects are released right after render thread is stopped
+		if(m_deferredAPI)
+			m_deferredAPI->StopRenderThread();
 		
 		ClearRenderStates();
 		m_dynamicMesh.Destroy();
@@ -317,6 +598,9 @@ void CMaterialSystem::Shutdown()
 		g_pShaderAPI->Shutdown();
 		m_renderLibrary->ExitAPI();
 
+		delete m_deferredAPI;
+		m_deferredAPI = NULL;
+
 		// shutdown render libraries, all shaders and other
 		g_fileSystem->FreeModule( m_rendermodule );
 	}
@@ -483,8 +767,7 @@ bool CMaterialSystem::IsMaterialExist(const char* szMaterialName)
 	return g_fileSystem->FileExist(mat_path.GetData());
 }
 
-// creates new material with defined parameters
-IMaterial* CMaterialSystem::CreateMaterial(const char* szMaterialName, kvkeybase_t* params)
+CMaterial* CMaterialSystem::CreateMaterialInstance(const char* szMaterialName, kvkeybase_t* params)
 {
 	// must have names
 	ASSERT(strlen(szMaterialName) > 0);
@@ -498,16 +781,61 @@ IMaterial* CMaterialSystem::CreateMaterial(const char* szMaterialName, kvkeybase
 	else
 		pMaterial->Init( szMaterialName, params);
 
-	g_pLoadBeginCallback();
+	return pMaterial;
+}
 
-	// add to list
+IMaterial* CMaterialSystem::RegisterMaterial(CMaterial* pMaterial, bool findExisting)
+{
+	int nameHash = NameToHash(pMaterial->GetName());
+
+	CScopedMutex m(m_Mutex);
+	CScopedWriteLock wl(m_materialMapLock);
+
+	// other thread may have been loaded it meanwhile
+	if(findExisting)
 	{
-		CScopedMutex m(m_Mutex);
-		m_loadedMaterials.append(pMaterial);
+		IMaterial* existing = FindMaterialByName(pMaterial->GetName(), nameHash);
+
+		if(existing)
+		{
+			pMaterial->Cleanup();
+			delete pMaterial;
+
+			return existing;
+		}
 	}
 
+	m_loadedMaterials.append(pMaterial);
+	m_materialMap.insert(materialMap_t::value_type(nameHash, pMaterial));
+
+	return pMaterial;
+}
+
+IMaterial* CMaterialSystem::FindMaterialByName(const char* szMaterialName, int nameHash) const
+{
+	std::pair<materialMap_t::const_iterator, materialMap_t::const_iterator> range = m_materialMap.equal_range(nameHash);
+
+	for(materialMap_t::const_iterator it = range.first; it != range.second; ++it)
+	{
+		if(NameIsEqual(it->second->GetName(), szMaterialName))
+			return it->second;
+	}
+
+	return nullptr;
+}
+
+// creates new material with defined parameters
+IMaterial* CMaterialSystem::CreateMaterial(const char* szMaterialName, kvkeybase_t* params)
+{
+	CMaterial* pMaterial = CreateMaterialInstance(szMaterialName, params);
+
+	g_pLoadBeginCallback();
+
+	// add to list
+	RegisterMaterial(pMaterial, false);
+
 	if (m_forcePreloadMaterials)
-		PutMaterialToLoadingQueue(pMaterial);
+		PutMaterialToLoadingQueue(pMaterial, MATERIAL_LOAD_PRIORITY_LOW);
 	
 	g_pLoadEndCallback();
 
@@ -516,38 +844,73 @@ IMaterial* CMaterialSystem::CreateMaterial(const char* szMaterialName, kvkeybase
 
 IMaterial* CMaterialSystem::GetMaterial(const char* szMaterialName/* = true*/)
 {
-	// Don't load null materials
-	if( strlen(szMaterialName) == 0 )
-		return NULL;
+	IMaterial* material = nullptr;
+	GetMaterials(&szMaterialName, &material, 1);
 
-	// fix slashes first
-	EqString search_string;
-
-	if( szMaterialName[0] == '/' || szMaterialName[0] == '\\' )
-		search_string = szMaterialName+1;
-	else
-		search_string = szMaterialName;
+	return material;
+}
 
-	search_string.Path_FixSlashes();
+void CMaterialSystem::GetMaterials(const char** materialNames, IMaterial** outMaterials, int count)
+{
+	int numMissing = 0;
 
-	// find the material with existing name
+	// find the materials with existing names
 	{
-		CScopedMutex m(m_Mutex);
+		CScopedReadLock rl(m_materialMapLock);
 
-		for (int i = 0; i < m_loadedMaterials.numElem(); i++)
+		for(int i = 0; i < count; i++)
 		{
-			if (m_loadedMaterials[i] != NULL)
+			const char* name = materialNames[i];
+
+			// Don't load null materials
+			if(!name || *name == 0)
 			{
-				if (!search_string.CompareCaseIns(m_loadedMaterials[i]->GetName()))
-				{
-					g_pLoadEndCallback();
-					return m_loadedMaterials[i];
-				}
+				outMaterials[i] = nullptr;
+				continue;
 			}
+
+			outMaterials[i] = FindMaterialByName(name, NameToHash(name));
+
+			if(outMaterials[i])
+				g_pLoadEndCallback();
+			else
+				numMissing++;
 		}
 	}
 
-	return CreateMaterial(szMaterialName, nullptr);
+	if(!numMissing)
+		return;
+
+	// load the rest without holding any locks
+	for(int i = 0; i < count; i++)
+	{
+		const char* name = materialNames[i];
+
+		if(outMaterials[i] || !name || *name == 0)
+			continue;
+
+		// same name might be earlier in this batch
+		{
+			CScopedReadLock rl(m_materialMapLock);
+			outMaterials[i] = FindMaterialByName(name, NameToHash(name));
+		}
+
+		if(outMaterials[i])
+			continue;
+
+		CMaterial* pMaterial = CreateMaterialInstance(name, nullptr);
+
+		g_pLoadBeginCallback();
+
+		IMaterial* material = RegisterMaterial(pMaterial, true);
+
+		if (m_forcePreloadMaterials && material == pMaterial)
+			PutMaterialToLoadingQueue(material, MATERIAL_LOAD_PRIORITY_LOW);
+
+		g_pLoadEndCallback();
+
+		outMaterials[i] = material;
+	}
 }
 
 // If we have unliaded material, just load it
@@ -624,6 +987,9 @@ void CMaterialSystem::ReloadAllMaterials()
 
 	g_pLoadBeginCallback();
 
+	// shaders are going to be compiled from the fresh sources
+	g_pShaderAPI->ReloadShaderSources();
+
 	DkList<IMaterial*> loadingList;
 
 	for(int i = 0; i < m_loadedMaterials.numElem(); i++)
@@ -676,6 +1042,9 @@ void CMaterialSystem::FreeMaterials()
 	}
 
 	m_loadedMaterials.clear();
+
+	CScopedWriteLock wl(m_materialMapLock);
+	m_materialMap.clear();
 }
 
 void CMaterialSystem::ClearRenderStates()
@@ -699,21 +1068,27 @@ void CMaterialSystem::FreeMaterial(IMaterial *pMaterial)
 	if(pMaterial == NULL)
 		return;
 
-	CScopedMutex m(m_Mutex);
-
-	pMaterial->Ref_Drop();
+	CMaterial* material = (CMaterial*)pMaterial;
 
-	if(pMaterial->Ref_Count() <= 0)
 	{
-		CMaterial* material = (CMaterial*)pMaterial;
+		CScopedMutex m(m_Mutex);
 
-		if(m_loadedMaterials.fastRemove(material))
-		{
-			DevMsg(DEVMSG_MATSYSTEM,"freeing %s\n", material->GetName());
-			material->Cleanup();
-			delete material;
-		}
+		pMaterial->Ref_Drop();
+
+		if(pMaterial->Ref_Count() > 0 || !m_loadedMaterials.fastRemove(material))
+			return;
+
+		CScopedWriteLock wl(m_materialMapLock);
+		NameHashMap_Remove(m_materialMap, NameToHash(material->GetName()), (IMaterial*)material);
 	}
+
+	// material is unreachable now. Loader may still hold it,
+	// wait outside of the lock as loading could request other materials
+	g_threadedMaterialLoader.RemoveMaterial(material);
+
+	DevMsg(DEVMSG_MATSYSTEM,"freeing %s\n", material->GetName());
+	material->Cleanup();
+	delete material;
 }
 
 void CMaterialSystem::RegisterProxy(PROXY_DISPATCHER dispfunc, const char* pszName)
@@ -848,8 +1223,8 @@ enum EMaterialRenderSubroutine
 	MATERIAL_SUBROUTINE_NORMAL,
 };
 
-// loads material or sends it to loader thread
-void CMaterialSystem::PutMaterialToLoadingQueue(IMaterial* pMaterial)
+// loads material or sends it to loader threads
+void CMaterialSystem::PutMaterialToLoadingQueue(IMaterial* pMaterial, int priority)
 {
 	if(pMaterial->GetState() != MATERIAL_LOAD_NEED_LOAD)
 		return;
@@ -857,9 +1232,9 @@ void CMaterialSystem::PutMaterialToLoadingQueue(IMaterial* pMaterial)
 	if( m_config.threadedloader )
 	{
 		if(!g_threadedMaterialLoader.IsRunning())
-			g_threadedMaterialLoader.StartWorkerThread("matSystemLoader");
+			g_threadedMaterialLoader.Start();
 
-		g_threadedMaterialLoader.AddMaterial(pMaterial);
+		g_threadedMaterialLoader.AddMaterial(pMaterial, priority);
 	}
 	else
 	{
@@ -882,6 +1257,8 @@ void CMaterialSystem::SetShaderParameterOverriden(ShaderDefaultParams_e param, b
 
 bool CMaterialSystem::BindMaterial(IMaterial* pMaterial, int flags)
 {
+	PROF_EVENT("MatSystem BindMaterial");
+
 	if(!pMaterial)
 	{
 		InitDefaultMaterial();
@@ -890,12 +1267,12 @@ bool CMaterialSystem::BindMaterial(IMaterial* pMaterial, int flags)
 
 	CMaterial* pSetupMaterial = (CMaterial*)pMaterial;
 
-	// proxy update is dirty if material was not bound to this frame
-	pSetupMaterial->m_proxyIsDirty = (pSetupMaterial->m_frameBound != m_frame);
+	// proxy update is dirty if material was not bound or updated by UpdateMaterialProxies in this frame
+	pSetupMaterial->m_proxyIsDirty = (pSetupMaterial->m_frameBound != m_frame) && (pSetupMaterial->m_frameProxyUpdate != m_frame);
 	pSetupMaterial->m_frameBound = m_frame;
 
 	// it's now a more critical section to the material
-	PutMaterialToLoadingQueue( pMaterial );
+	PutMaterialToLoadingQueue( pMaterial, MATERIAL_LOAD_PRIORITY_BOUND );
 
 	// set the current material
 	IMaterial* setMaterial = pMaterial;
@@ -970,7 +1347,7 @@ IMaterial* CMaterialSystem::GetBoundMaterial()
 void CMaterialSystem::Wait()
 {
 	if (m_config.threadedloader)
-		g_threadedMaterialLoader.WaitForThread();
+		g_threadedMaterialLoader.WaitForThreads();
 }
 
 // transform operations
@@ -979,6 +1356,9 @@ void CMaterialSystem::SetMatrix(ER_MatrixMode mode, const Matrix4x4 &matrix)
 {
 	m_matrices[(int)mode] = matrix;
 
+	if(mode == MATRIXMODE_VIEW || mode == MATRIXMODE_PROJECTION)
+		m_sharedConstantsDirty = true;
+
 	g_pShaderAPI->SetMatrixMode(mode);
 
 	g_pShaderAPI->PopMatrix();
@@ -995,7 +1375,32 @@ void CMaterialSystem::GetMatrix(ER_MatrixMode mode, Matrix4x4 &matrix)
 // retunrs multiplied matrix
 void CMaterialSystem::GetWorldViewProjection(Matrix4x4 &matrix)
 {
-	matrix = identity4() * m_matrices[MATRIXMODE_PROJECTION] * (m_matrices[MATRIXMODE_VIEW] * (m_matrices[MATRIXMODE_WORLD2] * m_matrices[MATRIXMODE_WORLD]));
+	matrix = GetSharedConstants().viewProj * (m_matrices[MATRIXMODE_WORLD2] * m_matrices[MATRIXMODE_WORLD]);
+}
+
+// returns view, projection and fog constants shared by all materials
+const matsystem_shared_constants_t& CMaterialSystem::GetSharedConstants()
+{
+	if(m_sharedConstantsOverdraw != m_config.overdrawMode)
+		m_sharedConstantsDirty = true;
+
+	if(!m_sharedConstantsDirty)
+		return m_sharedConstants;
+
+	m_sharedConstants.viewProj = m_matrices[MATRIXMODE_PROJECTION] * m_matrices[MATRIXMODE_VIEW];
+
+	FogInfo_t fog;
+	GetFogInfo(fog);
+
+	m_sharedConstants.viewPos = fog.viewPos;
+	m_sharedConstants.fogParams = Vector4D(fog.fognear, fog.fogfar, 1.0f / (fog.fogfar - fog.fognear), 1.0f);
+	m_sharedConstants.fogColor = fog.fogColor;
+	m_sharedConstants.fogEnable = fog.enableFog;
+
+	m_sharedConstantsOverdraw = m_config.overdrawMode;
+	m_sharedConstantsDirty = false;
+
+	return m_sharedConstants;
 }
 
 // sets an ambient light
@@ -1060,7 +1465,16 @@ bool CMaterialSystem::BeginFrame()
 	if(g_threadedMaterialLoader.GetCount())
 		g_threadedMaterialLoader.SignalWork();
 
-	m_renderLibrary->BeginFrame();
+	// device restoration must not happen while render thread uses it
+	if(m_deferredAPI && (!state || state != oldState))
+	{
+		m_deferredAPI->WaitForRenderThread();
+		m_renderLibrary->BeginFrame();
+	}
+	else if(m_deferredAPI)
+		m_deferredAPI->BeginFrame();
+	else
+		m_renderLibrary->BeginFrame();
 
 	if(state && state != oldState)
 	{
@@ -1077,12 +1491,82 @@ bool CMaterialSystem::BeginFrame()
 	return true;
 }
 
+//
+// Parallel proxy update
+//
+
+static ConVar r_parallelProxies("r_parallelProxies", "1", "Update material proxies on job threads");
+
+#define MATSYSTEM_PROXY_BATCH			16		// materials taken by job thread at once
+#define MATSYSTEM_PROXY_MIN_PARALLEL	64		// less materials are updated on the calling thread
+
+// Shared by the calling thread and proxy jobs
+struct matProxyUpdate_t : public CEqParallelWork
+{
+	DkList<CMaterial*>		materials;
+	float					fDt;
+
+	void ProcessChunk(int chunk, int first, int count)
+	{
+		for(int i = first; i < first+count; i++)
+			materials[i]->UpdateProxy(fDt);
+	}
+};
+
+// updates proxies of materials that were bound last frame on job threads
+void CMaterialSystem::UpdateMaterialProxies(float fDt)
+{
+	PROF_EVENT("MatSystem UpdateMaterialProxies");
+
+	matProxyUpdate_t* update = new matProxyUpdate_t;
+	update->fDt = fDt;
+
+	{
+		CScopedMutex m(m_Mutex);
+
+		for(int i = 0; i < m_loadedMaterials.numElem(); i++)
+		{
+			CMaterial* material = (CMaterial*)m_loadedMaterials[i];
+
+			if(material->m_frameBound != m_frame-1 || !material->m_proxies.numElem())
+				continue;
+
+			if(material->GetState() != MATERIAL_LOAD_OK)
+				continue;
+
+			// BindMaterial will not update it again
+			material->m_proxyIsDirty = true;
+			material->m_frameProxyUpdate = m_frame;
+
+			update->materials.append(material);
+		}
+	}
+
+	int numMaterials = update->materials.numElem();
+
+	// any thread type is fine, proxies are short
+	bool parallel = r_parallelProxies.GetBool() && numMaterials >= MATSYSTEM_PROXY_MIN_PARALLEL;
+
+	update->Run(numMaterials, MATSYSTEM_PROXY_BATCH, JOB_TYPE_ANY, parallel);
+}
+
 // tells 3d device to end and present frame
 bool CMaterialSystem::EndFrame(IEqSwapChain* swapChain)
 {
-	if(m_renderLibrary)
+	if(m_deferredAPI)
+		m_deferredAPI->EndFrame(swapChain);
+	else if(m_renderLibrary)
 		m_renderLibrary->EndFrame(swapChain);
 
+	if(g_pShaderAPI)
+		g_pShaderAPI->UpdateTextureStreaming();
+
+	// render thread submits this frame while next one is recorded
+	if(m_deferredAPI)
+		m_deferredAPI->SubmitFrame();
+
+	m_dynamicMesh.OnFrameEnd();
+
 	m_frame++;
 
 	return true;
@@ -1091,12 +1575,23 @@ bool CMaterialSystem::EndFrame(IEqSwapChain* swapChain)
 // captures screenshot to CImage data
 bool CMaterialSystem::CaptureScreenshot(CImage &img)
 {
+	WaitForRenderThread();
+
 	return m_renderLibrary->CaptureScreenshot( img );
 }
 
+// waits until render thread completes all recorded commands
+void CMaterialSystem::WaitForRenderThread()
+{
+	if(m_deferredAPI)
+		m_deferredAPI->WaitForRenderThread();
+}
+
 // resizes device back buffer. Must be called if window resized
 void CMaterialSystem::SetDeviceBackbufferSize(int wide, int tall)
 {
+	WaitForRenderThread();
+
 	if(m_renderLibrary)
 		m_renderLibrary->SetBackbufferSize(wide, tall);
 }
@@ -1104,12 +1599,16 @@ void CMaterialSystem::SetDeviceBackbufferSize(int wide, int tall)
 // reports device focus mode
 void CMaterialSystem::SetDeviceFocused(bool inFocus)
 {
+	WaitForRenderThread();
+
 	if (m_renderLibrary)
 		m_renderLibrary->SetFocused(inFocus);
 }
 
 IEqSwapChain* CMaterialSystem::CreateSwapChain(void* windowHandle)
 {
+	WaitForRenderThread();
+
 	if(m_renderLibrary)
 		return m_renderLibrary->CreateSwapChain(windowHandle, m_config.shaderapi_params.windowedMode);
 
@@ -1118,6 +1617,8 @@ IEqSwapChain* CMaterialSystem::CreateSwapChain(void* windowHandle)
 
 void CMaterialSystem::DestroySwapChain(IEqSwapChain* swapChain)
 {
+	WaitForRenderThread();
+
 	if(m_renderLibrary)
 		m_renderLibrary->DestroySwapChain(swapChain);
 }
@@ -1128,6 +1629,8 @@ bool CMaterialSystem::SetWindowed(bool enable)
 	bool old = m_config.shaderapi_params.windowedMode;
 	m_config.shaderapi_params.windowedMode = enable;
 	
+	WaitForRenderThread();
+
 	if (m_renderLibrary)
 	{
 		if (!m_renderLibrary->SetWindowed(enable))
@@ -1158,6 +1661,7 @@ IShaderAPI* CMaterialSystem::GetShaderAPI()
 void CMaterialSystem::SetFogInfo(const FogInfo_t &info)
 {
 	m_fogInfo = info;
+	m_sharedConstantsDirty = true;
 }
 
 // returns fog info
@@ -1549,6 +2053,8 @@ void CMaterialSystem::PrintLoadedMaterials()
 		MsgInfo("%s - %s (%d refs) %s\n", material->GetShaderName(), material->GetName(), material->Ref_Count(), (material->m_state == MATERIAL_LOAD_NEED_LOAD) ? "(not loaded)" : "");
 	}
 	Msg("Total loaded materials: %d\n", m_loadedMaterials.numElem());
+
+	g_threadedMaterialLoader.PrintStats();
 }
 
 // removes callbacks from list
@@ -40,10 +40,12 @@ struct shaderoverride_t
 };
 
 class IRenderLibrary;
+class ShaderAPIDeferred;
 
 typedef std::unordered_map<ushort,IRenderState*> blendStateMap_t;
 typedef std::unordered_map<ubyte,IRenderState*> depthStateMap_t;
 typedef std::unordered_map<ubyte,IRenderState*> rasterStateMap_t;
+typedef std::unordered_multimap<int,IMaterial*> materialMap_t;
 
 struct DKMODULE;
 
@@ -98,6 +100,9 @@ public:
 	// Finds or loads material (if findExisting is false then it will be loaded as new material instance)
 	IMaterial*						GetMaterial(const char* szMaterialName);
 
+	// Finds or loads the bunch of materials at once. Empty or NULL names are giving NULL materials
+	void							GetMaterials(const char** materialNames, IMaterial** outMaterials, int count);
+
 	// checks material for existence
 	bool							IsMaterialExist(const char* szMaterialName);
 
@@ -117,7 +122,7 @@ public:
 	void							Wait();
 
 	// loads material or sends it to loader thread
-	void							PutMaterialToLoadingQueue(IMaterial* pMaterial);
+	void							PutMaterialToLoadingQueue(IMaterial* pMaterial, int priority = MATERIAL_LOAD_PRIORITY_NORMAL);
 
 	// returns material count which is currently loading or awaiting for load
 	int								GetLoadingQueue() const;
@@ -258,6 +263,9 @@ public:
 	// retunrs multiplied matrix
 	void							GetWorldViewProjection(Matrix4x4 &matrix);
 
+	// returns view, projection and fog constants shared by all materials
+	const matsystem_shared_constants_t&	GetSharedConstants();
+
 	//-----------------------------
 	// Swap chains
 	//-----------------------------
@@ -265,6 +273,9 @@ public:
 	// tells device to begin frame
 	bool							BeginFrame();
 
+	// updates proxies of materials that were bound last frame on job threads. Call it before rendering
+	void							UpdateMaterialProxies(float fDt);
+
 	// tells device to end and present frame. Also swapchain can be overriden.
 	bool							EndFrame(IEqSwapChain* swapChain);
 
@@ -286,6 +297,9 @@ public:
 	// captures screenshot to CImage data
 	bool							CaptureScreenshot( CImage &img );
 
+	// waits until render thread completes all recorded commands
+	void							WaitForRenderThread();
+
 	//-----------------------------
 	// Internal operations
 	//-----------------------------
@@ -316,12 +330,21 @@ private:
 	void							CreateWhiteTexture();
 	void							InitDefaultMaterial();
 
+	CMaterial*						CreateMaterialInstance(const char* szMaterialName, kvkeybase_t* params);
+
+	// adds material to the registry. If findExisting is set and material with same name is registered, it's returned instead
+	IMaterial*						RegisterMaterial(CMaterial* pMaterial, bool findExisting);
+
+	// m_materialMapLock must be locked
+	IMaterial*						FindMaterialByName(const char* szMaterialName, int nameHash) const;
+
 	matsystem_render_config_t		m_config;
 
 	IRenderLibrary*					m_renderLibrary;					// render library.
 	DKMODULE*						m_rendermodule;					// render dll.
 
 	IShaderAPI*						m_shaderAPI;					// the main renderer interface
+	ShaderAPIDeferred*				m_deferredAPI;					// render thread command recorder, if enabled
 	EqString						m_materialsPath;				// material path
 
 	DkList<DKMODULE*>				m_shaderLibs;				// loaded shader libraries
@@ -331,6 +354,8 @@ private:
 	DkList<proxyfactory_t>			m_proxyFactoryList;
 
 	DkList<IMaterial*>				m_loadedMaterials;				// loaded material list
+	materialMap_t					m_materialMap;					// materials by name hash
+	CEqReadWriteLock				m_materialMapLock;
 	ER_CullMode						m_cullMode;				// culling mode. For shaders. TODO: remove, and check matrix handedness.
 
 	CDynamicMesh					m_dynamicMesh;
@@ -349,6 +374,10 @@ private:
 
 	Matrix4x4						m_matrices[5];					// matrix modes
 
+	matsystem_shared_constants_t	m_sharedConstants;
+	bool							m_sharedConstantsDirty;
+	bool							m_sharedConstantsOverdraw;		// overdraw mode disables fog
+
 	IMaterial*						m_setMaterial;				// currently binded material
 	uint							m_paramOverrideMask;			// parameter setup mask for overrides
 
@@ -11,6 +11,8 @@
 #include "IShaderProgram.h"
 #include "Utils/EqString.h"
 
+#include "../Shared/ShaderConstantMap.h"
+
 typedef struct DX10ShaderConstant 
 {
 	char*	name;
@@ -39,6 +41,9 @@ public:
 	int						GetConstantsNum();
 	int						GetSamplersNum();
 
+	// returns constant index by name, -1 if not found
+	int						FindConstant(const char* pszName) const;
+
 protected:
 	EqString					m_szName;
 
@@ -70,6 +75,8 @@ protected:
 	int						m_numConstants;
 	int						m_numSamplers;
 	int						m_numTextures;
+
+	CShaderConstantMap		m_constantMap;
 };
 
 #endif //D3D9SHADERPROGRAM_H
@@ -112,7 +112,11 @@ bool CD3D10SwapChain::CreateOrUpdateBackbuffer()
 
 		m_backbuffer->Ref_Grab();
 
-		((ShaderAPID3DX10*)g_pShaderAPI)->m_TextureList.append(m_backbuffer);
+		ShaderAPID3DX10* pShaderAPI = (ShaderAPID3DX10*)g_pShaderAPI;
+
+		pShaderAPI->ThreadLock();
+		pShaderAPI->AddTextureToList(m_backbuffer);
+		pShaderAPI->ThreadUnlock();
 	}
 
 	ID3D10Texture2D*		backbufferTex;
@@ -624,7 +624,7 @@ void ShaderAPID3DX10::FreeTexture(ITexture* pTexture)
 		if(pTex->m_pD3D10SamplerState)
 			DestroyRenderState(pTex->m_pD3D10SamplerState);
 
-		m_TextureList.remove(pTexture);
+		RemoveTextureFromList(pTexture);
 		delete pTex;
 	}
 }
@@ -880,7 +880,7 @@ ITexture* ShaderAPID3DX10::CreateRenderTarget(int width, int height, ETextureFor
 		return NULL;
 	}
 
-	m_TextureList.append(pTexture);
+	AddTextureToList(pTexture);
 
 	Finish();
 
@@ -915,7 +915,7 @@ ITexture* ShaderAPID3DX10::CreateNamedRenderTarget(const char* pszName,int width
 		return NULL;
 	}
 
-	m_TextureList.append(pTexture);
+	AddTextureToList(pTexture);
 
 	return pTexture;
 }
@@ -1326,29 +1326,6 @@ void ShaderAPID3DX10::DestroyMeshBuilder(IMeshBuilder* pBuilder)
 // Shaders and it's operations
 //-------------------------------------------------------------
 
-// search for existing shader program
-IShaderProgram* ShaderAPID3DX10::FindShaderProgram(const char* pszName, const char* query)
-{
-	CScopedMutex scoped(m_Mutex);
-
-	for(register int i = 0; i < m_ShaderList.numElem(); i++)
-	{
-		char findtext[1024];
-		findtext[0] = '\0';
-		strcpy(findtext, pszName);
-
-		if(query)
-			strcat(findtext, query);
-
-		if(!stricmp(m_ShaderList[i]->GetName(), findtext))
-		{
-			return m_ShaderList[i];
-		}
-	}
-
-	return NULL;
-}
-
 // Creates shader class for needed ShaderAPI
 IShaderProgram* ShaderAPID3DX10::CreateNewShaderProgram(const char* pszName, const char* query)
 {
@@ -1357,7 +1334,7 @@ IShaderProgram* ShaderAPID3DX10::CreateNewShaderProgram(const char* pszName, con
 
 	CScopedMutex scoped(m_Mutex);
 
-	m_ShaderList.append(pNewProgram);
+	AddShaderProgramToList(pNewProgram);
 
 	return pNewProgram;
 }
@@ -1381,7 +1358,7 @@ void ShaderAPID3DX10::DestroyShaderProgram(IShaderProgram* pShaderProgram)
 		Reset(STATE_RESET_SHADER);
 		Apply();
 
-		m_ShaderList.remove(pShader);
+		RemoveShaderProgramFromList(pShader);
 
 		delete pShader;
 	}
@@ -1914,6 +1891,8 @@ create_constant_buffers:
 	memcpy(pShader->m_pConstants, constants.ptr(), pShader->m_numConstants * sizeof(DX10ShaderConstant_t));
 	qsort(pShader->m_pConstants, pShader->m_numConstants, sizeof(DX10ShaderConstant_t), ConstantComp);
 
+	pShader->m_constantMap.Clear();
+
 	uint nMaxVSRes = vsRefl? vsDesc.BoundResources : 0;
 	uint nMaxGSRes = gsRefl? gsDesc.BoundResources : 0;
 	uint nMaxPSRes = psRefl? psDesc.BoundResources : 0;
@@ -2518,83 +2497,43 @@ int ShaderAPID3DX10::SetShaderConstantRaw(const char *pszName, const void *data,
 	if(!pProgram)
 		return -1;
 
-	DX10ShaderConstant_t *constants = pProgram->m_pConstants;
-	/*
-	if(nConstID != -1)
-	{
-		DX10ShaderConstant_t *c = constants + nConstID;
+	if(nConstID < 0)
+		nConstID = GetShaderConstantHandle(pszName);
 
-		if (c->vsData)
-		{
-			if (memcmp(c->vsData, data, nSize))
-			{
-				memcpy(c->vsData, data, nSize);
-				pProgram->m_pvsDirty[c->vsBuffer] = true;
-			}
-		}
-		if (c->gsData)
-		{
-			if (memcmp(c->gsData, data, nSize))
-			{
-				memcpy(c->gsData, data, nSize);
-				pProgram->m_pgsDirty[c->gsBuffer] = true;
-			}
-		}
-		if (c->psData)
-		{
-			if (memcmp(c->psData, data, nSize))
-			{
-				memcpy(c->psData, data, nSize);
-				pProgram->m_ppsDirty[c->psBuffer] = true;
-			}
-		}
-
-		return nConstID;
-	}
-	*/
+	if(nConstID < 0)
+		return -1;
 
-	int minConstant = 0;
-	int maxConstant = pProgram->m_numConstants - 1;
+	// name lookup is only done once per program and handle
+	int index = pProgram->m_constantMap.Get(nConstID);
 
-	// Do a quick lookup in the sorted table with a binary search
-	while (minConstant <= maxConstant)
+	if(index == SHADERCONST_UNRESOLVED)
 	{
-		int currConstant = (minConstant + maxConstant) >> 1;
+		index = pProgram->FindConstant(GetShaderConstantName(nConstID));
+		pProgram->m_constantMap.Set(nConstID, index);
+	}
 
-		int res = strcmp(pszName, constants[currConstant].name);
-		if (res == 0)
-		{
-			DX10ShaderConstant_t *c = constants + currConstant;
+	if(index == -1)
+		return nConstID;
 
-			if (c->vsData)
-			{
-				memcpy(c->vsData, data, nSize);
-				pProgram->m_pvsDirty[c->vsBuffer] = true;
-			}
-			if (c->gsData)
-			{
-				memcpy(c->gsData, data, nSize);
-				pProgram->m_pgsDirty[c->gsBuffer] = true;
-			}
-			if (c->psData)
-			{
-				memcpy(c->psData, data, nSize);
-				pProgram->m_ppsDirty[c->psBuffer] = true;
-			}
+	DX10ShaderConstant_t *c = pProgram->m_pConstants + index;
 
-			return currConstant;
-		}
-		else if (res > 0)
-		{
-			minConstant = currConstant + 1;
-		}
-		else
-		{
-			maxConstant = currConstant - 1;
-		}
+	if (c->vsData)
+	{
+		memcpy(c->vsData, data, nSize);
+		pProgram->m_pvsDirty[c->vsBuffer] = true;
+	}
+	if (c->gsData)
+	{
+		memcpy(c->gsData, data, nSize);
+		pProgram->m_pgsDirty[c->gsBuffer] = true;
+	}
+	if (c->psData)
+	{
+		memcpy(c->psData, data, nSize);
+		pProgram->m_ppsDirty[c->psBuffer] = true;
 	}
 
-	return -1;
+	return nConstID;
 }
 
 //-----------------------------------------------------
@@ -3798,10 +3737,16 @@ ID3D10DepthStencilView* ShaderAPID3DX10::TexResource_CreateShaderDepthStencilVie
 }
 
 
-void ShaderAPID3DX10::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
+void ShaderAPID3DX10::ReleaseTextureInternal(ITexture* pTexture)
+{
+	CD3D10Texture* pTex = (CD3D10Texture*)pTexture;
+	pTex->Release();
+}
+
+bool ShaderAPID3DX10::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
 {
 	if(!pImages.numElem())
-		return;
+		return false;
 
 	CD3D10Texture* pTexture = NULL;
 
@@ -3813,6 +3758,11 @@ void ShaderAPID3DX10::CreateTextureInternal(ITexture** pTex, const DkList<CImage
 
 	int wide = 0, tall = 0;
 
+	// images are created aside, so re-created texture keeps the current ones on failure
+	DkList<ID3D10Resource*> textures;
+	DkList<ID3D10ShaderResourceView*> srv;
+	DXGI_FORMAT texFormat = DXGI_FORMAT_UNKNOWN;
+
 	for(int i = 0; i < pImages.numElem(); i++)
 	{
 		ID3D10Resource* pD3DTex = CreateD3DTextureFromImage(pImages[i], wide, tall, nFlags);
@@ -3820,25 +3770,34 @@ void ShaderAPID3DX10::CreateTextureInternal(ITexture** pTex, const DkList<CImage
 		if(pD3DTex)
 		{
 			// add and make shader resource view for it
-			pTexture->textures.append(pD3DTex);
+			textures.append(pD3DTex);
 
-			pTexture->texFormat = formats[pImages[i]->GetFormat()];
-			pTexture->srvFormat = pTexture->texFormat;
+			texFormat = formats[pImages[i]->GetFormat()];
 
-			pTexture->srv.append( TexResource_CreateShaderResourceView(pD3DTex, pTexture->srvFormat) );
+			srv.append( TexResource_CreateShaderResourceView(pD3DTex, texFormat) );
 		}
 	}
 
-	if(!pTexture->textures.numElem())
+	if(!textures.numElem())
 	{
 		if(!(*pTex))
 			delete pTexture;
-		else
+		else if(!pTexture->textures.numElem())
 			FreeTexture(pTexture);
 
-		return;
+		return false;
 	}
 
+	// replace images of re-created texture
+	if(pTexture->textures.numElem())
+		ReleaseTextureInternal(pTexture);
+
+	pTexture->textures.append(textures);
+	pTexture->srv.append(srv);
+
+	pTexture->texFormat = texFormat;
+	pTexture->srvFormat = texFormat;
+
 	pTexture->m_numAnimatedTextureFrames = pTexture->textures.numElem();
 
 	pTexture->m_pD3D10SamplerState = CreateSamplerState(sampler);
@@ -3854,12 +3813,14 @@ void ShaderAPID3DX10::CreateTextureInternal(ITexture** pTex, const DkList<CImage
 	if(!(*pTex))
 	{
 		m_Mutex.Lock();
-		m_TextureList.append(pTexture);
+		AddTextureToList(pTexture);
 		m_Mutex.Unlock();
 	}
 
 	// set for output
 	*pTex = pTexture;
+
+	return true;
 }
 
 ID3D10Resource* ShaderAPID3DX10::CreateD3DTextureFromImage(CImage* pSrc, int& wide, int& tall, int nFlags)
@@ -4177,7 +4138,7 @@ void ShaderAPID3DX10::AddTextureInternal(ITexture** pTex, CImage *texImage, Samp
 	pTexture->SetName(texImage->GetName());
 
 	if(! (*pTex) )
-		m_TextureList.append(pTexture);
+		AddTextureToList(pTexture);
 
 	*pTex = pTexture;
 }
@@ -4355,7 +4316,8 @@ bool ShaderAPID3DX10::CreateBackbufferDepth(int wide, int tall, DXGI_FORMAT dept
 		m_pDepthBufferTexture->SetFlags(TEXFLAG_RENDERTARGET | TEXFLAG_FOREIGN | TEXFLAG_NOQUALITYLOD);
 		m_pDepthBufferTexture->Ref_Grab();
 
-		m_TextureList.append(m_pDepthBufferTexture);
+		CScopedMutex scoped(m_Mutex);
+		AddTextureToList(m_pDepthBufferTexture);
 	}
 
 	CD3D10Texture* pDepthBuffer = (CD3D10Texture*)m_pDepthBufferTexture;
@@ -229,9 +229,6 @@ public:
 // Shaders and it's operations
 //-------------------------------------------------------------
 
-	// search for existing shader program
-	IShaderProgram*				FindShaderProgram(const char* pszName, const char* query = NULL);
-
 	// Creates shader class for needed ShaderAPI
 	IShaderProgram*				CreateNewShaderProgram(const char* pszName, const char* query = NULL);
 
@@ -335,7 +332,8 @@ public:
 	ID3D10RenderTargetView*		TexResource_CreateShaderRenderTargetView(ID3D10Resource *resource, DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN, int firstSlice = -1, int sliceCount = -1);
 	ID3D10DepthStencilView*		TexResource_CreateShaderDepthStencilView(ID3D10Resource *resource, DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN, int firstSlice = -1, int sliceCount = -1);
 
-	void						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sSamplingParams,int nFlags = 0);
+	bool						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sSamplingParams,int nFlags = 0);
+	void						ReleaseTextureInternal(ITexture* pTexture);
 
 protected:
 
@@ -64,4 +64,28 @@ int	CD3D9ShaderProgram::GetConstantsNum()
 int	CD3D9ShaderProgram::GetSamplersNum()
 {
 	return m_numSamplers;
+}
+
+// returns constant index by name, -1 if not found
+int CD3D9ShaderProgram::FindConstant(const char* pszName) const
+{
+	int minConstant = 0;
+	int maxConstant = m_numConstants - 1;
+
+	// Do a quick lookup in the sorted table with a binary search
+	while (minConstant <= maxConstant)
+	{
+		int currConstant = (minConstant + maxConstant) >> 1;
+
+		int res = strcmp(pszName, m_pConstants[currConstant].name);
+
+		if (res == 0)
+			return currConstant;
+		else if (res > 0)
+			minConstant = currConstant + 1;
+		else
+			maxConstant = currConstant - 1;
+	}
+
+	return -1;
 }
\ No newline at end of file
@@ -11,6 +11,9 @@
 #include "renderers/IShaderProgram.h"
 #include "renderers/ShaderAPI_defs.h"
 #include "utils/EqString.h"
+
+#include "../Shared/ShaderConstantMap.h"
+
 #include <d3d9.h>
 
 #define MAX_CONSTANT_NAMELEN 64
@@ -42,6 +45,9 @@ public:
 	int						GetConstantsNum();
 	int						GetSamplersNum();
 
+	// returns constant index by name, -1 if not found
+	int						FindConstant(const char* pszName) const;
+
 protected:
 	EqString				m_szName;
 
@@ -55,6 +61,8 @@ protected:
 
 	int						m_numConstants;
 	int						m_numSamplers;
+
+	CShaderConstantMap		m_constantMap;
 };
 
 #endif //D3D9SHADERPROGRAM_H
@@ -60,7 +60,7 @@ bool CD3D9SwapChain::CreateOrUpdateBackbuffer()
 
 		m_backbuffer->Ref_Grab();
 
-		((ShaderAPID3DX10*)g_pShaderAPI)->m_TextureList.append(m_backbuffer);
+		((ShaderAPID3DX10*)g_pShaderAPI)->AddTextureToList(m_backbuffer);
 	}
 
 	ID3D10Texture2D*		backbufferTex;
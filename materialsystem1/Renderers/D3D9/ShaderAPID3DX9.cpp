@@ -1228,7 +1228,7 @@ void ShaderAPID3DX9::FreeTexture(ITexture* pTexture)
 		pTex->Ref_Drop();
 
 		if (pTex->Ref_Count() <= 0)
-			deleted = m_TextureList.remove(pTexture);
+			deleted = RemoveTextureFromList(pTexture);
 	}
 
 	if (deleted)
@@ -1351,7 +1351,7 @@ ITexture* ShaderAPID3DX9::CreateRenderTarget(int width, int height, ETextureForm
 	{
 		CScopedMutex scoped(m_Mutex);
 
-		m_TextureList.append(pTexture);
+		AddTextureToList(pTexture);
 		return pTexture;
 	} 
 	else 
@@ -1380,7 +1380,7 @@ ITexture* ShaderAPID3DX9::CreateNamedRenderTarget(const char* pszName,int width,
 	if (InternalCreateRenderTarget(m_pD3DDevice, pTexture, nFlags))
 	{
 		CScopedMutex scoped(m_Mutex);
-		m_TextureList.append(pTexture);
+		AddTextureToList(pTexture);
 		return pTexture;
 	} 
 	else 
@@ -1847,29 +1847,6 @@ void ShaderAPID3DX9::DestroyIndexBuffer(IIndexBuffer* pIndexBuffer)
 // Shaders and it's operations
 //-------------------------------------------------------------
 
-// search for existing shader program
-IShaderProgram* ShaderAPID3DX9::FindShaderProgram(const char* pszName, const char* query)
-{
-	CScopedMutex m(m_Mutex);
-
-	for(int i = 0; i < m_ShaderList.numElem(); i++)
-	{
-		char findtext[1024];
-		findtext[0] = '\0';
-		strcpy(findtext, pszName);
-
-		if(query)
-			strcat(findtext, query);
-
-		if(!stricmp(m_ShaderList[i]->GetName(), findtext))
-		{
-			return m_ShaderList[i];
-		}
-	}
-
-	return NULL;
-}
-
 // Creates shader class for needed ShaderAPI
 IShaderProgram* ShaderAPID3DX9::CreateNewShaderProgram(const char* pszName, const char* query)
 {
@@ -1878,7 +1855,7 @@ IShaderProgram* ShaderAPID3DX9::CreateNewShaderProgram(const char* pszName, cons
 
 	CScopedMutex scoped(m_Mutex);
 
-	m_ShaderList.append(pNewProgram);
+	AddShaderProgramToList(pNewProgram);
 
 	return pNewProgram;
 }
@@ -1898,7 +1875,7 @@ void ShaderAPID3DX9::DestroyShaderProgram(IShaderProgram* pShaderProgram)
 
 		// remove it if reference is zero
 		if (pShader->Ref_Count() <= 0)
-			deleted = m_ShaderList.remove(pShader);
+			deleted = RemoveShaderProgramFromList(pShader);
 	}
 
 	if (deleted)
@@ -1993,6 +1970,8 @@ bool ShaderAPID3DX9::CompileShadersFromStream(	IShaderProgram* pShaderOutput,
 				pShader->m_numSamplers  = scHdr.numSamplers;
 				pShader->m_numConstants = scHdr.numConstants;
 
+				pShader->m_constantMap.Clear();
+
 				needsCompile = false;
 			}
 			else
@@ -2333,6 +2312,8 @@ bool ShaderAPID3DX9::CompileShadersFromStream(	IShaderProgram* pShaderOutput,
 	pShader->m_numConstants = nConstants;
 	pShader->m_numSamplers  = nSamplers;
 
+	pShader->m_constantMap.Clear();
+
 	return true;
 }
 
@@ -2416,112 +2397,61 @@ int ShaderAPID3DX9::SetShaderConstantRaw(const char *pszName, const void *data,
 	if(!pShader)
 		return -1;
 
-	DX9ShaderConstant *constants = pShader->m_pConstants;
-	/*
-	if(nConstId != -1)
-	{
-		DX9ShaderConstant* c = constants + nConstId;
-
-		if (c->vsReg >= 0)
-		{
-			if (memcmp(m_vsRegs + c->vsReg, data, nSize))
-			{
-				memcpy(m_vsRegs + c->vsReg, data, nSize);
-					
-				int r0 = c->vsReg;
-				int r1 = c->vsReg + ((nSize + 15) >> 4);
-
-				if (r0 < m_nMinVSDirty)
-					m_nMinVSDirty = r0;
-
-				if (r1 > m_nMaxVSDirty)
-					m_nMaxVSDirty = r1;
-			}
-		}
+	if(nConstId < 0)
+		nConstId = GetShaderConstantHandle(pszName);
 
-		if (c->psReg >= 0)
-		{
-			if (memcmp(m_psRegs + c->psReg, data, nSize))
-			{
-				memcpy(m_psRegs + c->psReg, data, nSize);
-					
-				int r0 = c->psReg;
-				int r1 = c->psReg + ((nSize + 15) >> 4);
+	if(nConstId < 0)
+		return -1;
 
-				if (r0 < m_nMinPSDirty)
-					m_nMinPSDirty = r0;
+	// name lookup is only done once per program and handle
+	int index = pShader->m_constantMap.Get(nConstId);
 
-				if (r1 > m_nMaxPSDirty)
-					m_nMaxPSDirty = r1;
-			}
-		}
+	if(index == SHADERCONST_UNRESOLVED)
+	{
+		index = pShader->FindConstant(GetShaderConstantName(nConstId));
+		pShader->m_constantMap.Set(nConstId, index);
+	}
 
+	if(index == -1)
 		return nConstId;
-	}*/
 
-	int minConstant = 0;
-	int maxConstant = pShader->m_numConstants - 1;
+	DX9ShaderConstant *c = pShader->m_pConstants + index;
 
-	// TODO: fix it up and do better
-	
-	// Do a quick lookup in the sorted table with a binary search
-	while (minConstant <= maxConstant)
+	if (c->vsReg >= 0)
 	{
-		int currConstant = (minConstant + maxConstant) >> 1;
-
-		int res = strcmp(pszName, constants[currConstant].name);
-
-		if (res == 0)
+		if (memcmp(m_vsRegs + c->vsReg, data, nSize))
 		{
-			DX9ShaderConstant *c = constants + currConstant;
+			memcpy(m_vsRegs + c->vsReg, data, nSize);
 
-			if (c->vsReg >= 0)
-			{
-				if (memcmp(m_vsRegs + c->vsReg, data, nSize))
-				{
-					memcpy(m_vsRegs + c->vsReg, data, nSize);
-
-					int r0 = c->vsReg;
-					int r1 = c->vsReg + ((nSize + 15) >> 4);
+			int r0 = c->vsReg;
+			int r1 = c->vsReg + ((nSize + 15) >> 4);
 
-					if (r0 < m_nMinVSDirty)
-						m_nMinVSDirty = r0;
+			if (r0 < m_nMinVSDirty)
+				m_nMinVSDirty = r0;
 
-					if (r1 > m_nMaxVSDirty)
-						m_nMaxVSDirty = r1;
-				}
-			}
+			if (r1 > m_nMaxVSDirty)
+				m_nMaxVSDirty = r1;
+		}
+	}
 
-			if (c->psReg >= 0)
-			{
-				if (memcmp(m_psRegs + c->psReg, data, nSize))
-				{
-					memcpy(m_psRegs + c->psReg, data, nSize);
-					
-					int r0 = c->psReg;
-					int r1 = c->psReg + ((nSize + 15) >> 4);
+	if (c->psReg >= 0)
+	{
+		if (memcmp(m_psRegs + c->psReg, data, nSize))
+		{
+			memcpy(m_psRegs + c->psReg, data, nSize);
 
-					if (r0 < m_nMinPSDirty)
-						m_nMinPSDirty = r0;
+			int r0 = c->psReg;
+			int r1 = c->psReg + ((nSize + 15) >> 4);
 
-					if (r1 > m_nMaxPSDirty)
-						m_nMaxPSDirty = r1;
-				}
-			}
+			if (r0 < m_nMinPSDirty)
+				m_nMinPSDirty = r0;
 
-			return currConstant;
-		} 
-		else if (res > 0)
-		{
-			minConstant = currConstant + 1;
-		}
-		else 
-		{
-			maxConstant = currConstant - 1;
+			if (r1 > m_nMaxPSDirty)
+				m_nMaxPSDirty = r1;
 		}
 	}
 
-	return -1;
+	return nConstId;
 }
 
 //-------------------------------------------------------------
@@ -2763,10 +2693,18 @@ IDirect3DBaseTexture9* ShaderAPID3DX9::CreateD3DTextureFromImage(CImage* pSrc, i
 	return pTexture;
 }
 
-void ShaderAPID3DX9::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
+void ShaderAPID3DX9::ReleaseTextureInternal(ITexture* pTexture)
+{
+	CD3D9Texture* pTex = (CD3D9Texture*)pTexture;
+
+	pTex->ReleaseTextures();
+	pTex->m_texSize = 0;
+}
+
+bool ShaderAPID3DX9::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
 {
 	if(!pImages.numElem())
-		return;
+		return false;
 
 	CD3D9Texture* pTexture = NULL;
 
@@ -2779,6 +2717,10 @@ void ShaderAPID3DX9::CreateTextureInternal(ITexture** pTex, const DkList<CImage*
 	int wide = 0, tall = 0;
 	int numMips = 0;
 
+	// images are created aside, so re-created texture keeps the current ones on failure
+	DkList<IDirect3DBaseTexture9*> textures;
+	int texSize = 0;
+
 	for(int i = 0; i < pImages.numElem(); i++)
 	{
 		IDirect3DBaseTexture9* pD3DTex = CreateD3DTextureFromImage(pImages[i], wide, tall, nFlags);
@@ -2793,23 +2735,30 @@ void ShaderAPID3DX9::CreateTextureInternal(ITexture** pTex, const DkList<CImage*
 
 			numMips += pImages[i]->GetMipMapCount() - nQuality;
 
-			pTexture->m_texSize += pImages[i]->GetMipMappedSize(nQuality);
+			texSize += pImages[i]->GetMipMappedSize(nQuality);
 
-			pTexture->textures.append(pD3DTex);
+			textures.append(pD3DTex);
 		}
 			
 	}
 
-	if(!pTexture->textures.numElem())
+	if(!textures.numElem())
 	{
 		if(!(*pTex))
 			delete pTexture;
-		else
+		else if(!pTexture->textures.numElem())
 			FreeTexture(pTexture);
 
-		return;
+		return false;
 	}
 
+	// replace images of re-created texture
+	if(pTexture->textures.numElem())
+		ReleaseTextureInternal(pTexture);
+
+	pTexture->textures.append(textures);
+	pTexture->m_texSize = texSize;
+
 	pTexture->m_numAnimatedTextureFrames = pTexture->textures.numElem();
 
 	// Bind this sampler state to texture
@@ -2826,10 +2775,12 @@ void ShaderAPID3DX9::CreateTextureInternal(ITexture** pTex, const DkList<CImage*
 	if(!(*pTex))
 	{
 		m_Mutex.Lock();
-		m_TextureList.append(pTexture);
+		AddTextureToList(pTexture);
 		m_Mutex.Unlock();
 	}
 
 	// set for output
 	*pTex = pTexture;
+
+	return true;
 }
\ No newline at end of file
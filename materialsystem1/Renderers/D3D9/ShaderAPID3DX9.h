@@ -284,9 +284,6 @@ public:
 // Shaders and it's operations
 //-------------------------------------------------------------
 
-	// search for existing shader program
-	IShaderProgram*				FindShaderProgram(const char* pszName, const char* query = NULL);
-
 	// Creates shader class for needed ShaderAPI
 	IShaderProgram*				CreateNewShaderProgram(const char* pszName, const char* query = NULL);
 
@@ -305,7 +302,8 @@ public:
 	// RAW Constant (Used for structure types, etc.)
 	int							SetShaderConstantRaw(const char *pszName, const void *data, int nSize, int nConstId);
 
-	void						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sSamplingParams,int nFlags = 0);
+	bool						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sSamplingParams,int nFlags = 0);
+	void						ReleaseTextureInternal(ITexture* pTexture);
 protected:
 
 	IDirect3DBaseTexture9*		CreateD3DTextureFromImage(CImage* pSrc, int& wide, int& tall, int nFlags = 0);
@@ -139,9 +139,12 @@ void CVertexBufferD3DX9::Update(void* data, int size, int offset, bool discard /
 
 	int nLockByteCount = size*m_nStrideSize;
 
+	// without discard dynamic buffers are appended, caller guarantees that range is not used by pending draws
+	DWORD lockFlags = dynamic ? (discard ? D3DLOCK_DISCARD : D3DLOCK_NOOVERWRITE) : 0;
+
 	void* outData = NULL;
 
-	if(m_pVertexBuffer->Lock(offset*m_nStrideSize, nLockByteCount, &outData, (dynamic ? D3DLOCK_DISCARD : 0) | D3DLOCK_NOSYSLOCK ) == D3D_OK)
+	if(m_pVertexBuffer->Lock(offset*m_nStrideSize, nLockByteCount, &outData, lockFlags | D3DLOCK_NOSYSLOCK ) == D3D_OK)
 	{
 		memcpy(outData, data, nLockByteCount);
 		m_pVertexBuffer->Unlock();
@@ -16,20 +16,32 @@ class CEmptyTexture : public CTexture
 public:
 	friend class ShaderAPIEmpty;
 
-	CEmptyTexture() : m_lockData(NULL) {}
+	CEmptyTexture() : m_lockData(NULL), m_lockSize(0) {}
+	~CEmptyTexture() {PPFree(m_lockData);}
 
 	// dummy class
 	// locks texture for modifications, etc
 	void	Lock(texlockdata_t* pLockData, Rectangle_t* pRect = NULL, bool bDiscard = false, bool bReadOnly = false, int nLevel = 0, int nCubeFaceId = 0) 
 	{
-		m_lockData = malloc(1024*1024);
+		int bpp = max(GetBytesPerPixel(GetFormat()), 4);
+		int lockSize = max(GetWidth(), 1) * max(GetHeight(), 1) * bpp;
+
+		// lock memory is kept until texture is destroyed
+		if(lockSize > m_lockSize)
+		{
+			m_lockData = PPReAlloc(m_lockData, lockSize);
+			m_lockSize = lockSize;
+		}
+
 		pLockData->pData = (ubyte*)m_lockData;
+		pLockData->nPitch = max(GetWidth(), 1) * bpp;
 	}
 	
 	// unlocks texture for modifications, etc
-	void	Unlock() {free(m_lockData); m_lockData = NULL;}
+	void	Unlock() {}
 
 	void*	m_lockData;
+	int		m_lockSize;
 };
 
 #endif // CEMPTYTEXTURE_H
\ No newline at end of file
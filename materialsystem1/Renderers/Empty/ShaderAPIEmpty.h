@@ -13,16 +13,39 @@
 #include "CEmptyTexture.h"
 #include "imaging/ImageLoader.h"
 
+// CPU copy of buffer contents. Allocated on first lock or update and kept for next ones
+class CEmptyBufferStorage
+{
+public:
+				CEmptyBufferStorage() : m_data(NULL), m_size(0) {}
+				~CEmptyBufferStorage() {PPFree(m_data);}
+
+	// returns pointer to the byte range, grows storage if needed
+	ubyte*		GetRange(int offset, int size)
+	{
+		if(offset + size > m_size)
+		{
+			m_data = (ubyte*)PPReAlloc(m_data, offset + size);
+			m_size = offset + size;
+		}
+
+		return m_data + offset;
+	}
+
+	ubyte*		m_data;
+	int			m_size;
+};
+
 class CEmptyVertexBuffer : public IVertexBuffer
 {
 public:
-				CEmptyVertexBuffer(int stride) : m_lockData(NULL), m_stride(stride) {}
+				CEmptyVertexBuffer(int numVerts, int stride) : m_numVerts(numVerts), m_stride(stride), m_lockOfs(0), m_lockSize(0), m_lockReadOnly(false) {}
 
 	// returns size in bytes
-	long		GetSizeInBytes() {return 0;}
+	long		GetSizeInBytes() {return m_numVerts*m_stride;}
 
 	// returns vertex count
-	int			GetVertexCount() {return 0;}
+	int			GetVertexCount() {return m_numVerts;}
 
 	// retuns stride size
 	int			GetStrideSize() {return m_stride;}
@@ -30,58 +53,84 @@ public:
 	// updates buffer without map/unmap operations which are slower
 	void		Update(void* data, int size, int offset, bool discard = true)
 	{
+		memcpy(m_storage.GetRange(offset*m_stride, size*m_stride), data, size*m_stride);
+
+		if(discard && offset == 0)
+			m_numVerts = size;
 	}
 
 	// locks vertex buffer and gives to programmer buffer data
 	bool		Lock(int lockOfs, int sizeToLock, void** outdata, bool readOnly)
 	{
-		*outdata = malloc(sizeToLock*m_stride);
+		m_lockOfs = lockOfs;
+		m_lockSize = sizeToLock;
+		m_lockReadOnly = readOnly;
+
+		*outdata = m_storage.GetRange(lockOfs*m_stride, sizeToLock*m_stride);
 		return true;
 	}
 
 	// unlocks buffer
-	void		Unlock() {free(m_lockData); m_lockData = NULL;}
+	void		Unlock() {m_lockSize = 0;}
 
 	// sets vertex buffer flags
 	void		SetFlags( int flags ) {}
 	int			GetFlags() {return 0;}
 
-	void*		m_lockData;
+	CEmptyBufferStorage	m_storage;
+	int			m_numVerts;
 	int			m_stride;
+
+	int			m_lockOfs;
+	int			m_lockSize;
+	bool		m_lockReadOnly;
 };
 
 class CEmptyIndexBuffer : public IIndexBuffer
 {
 public:
-				CEmptyIndexBuffer(int stride) : m_lockData(NULL), m_stride(stride) {}
+				CEmptyIndexBuffer(int numIndices, int stride) : m_numIndices(numIndices), m_stride(stride), m_lockOfs(0), m_lockSize(0), m_lockReadOnly(false) {}
 
 	// returns index size
 	int8		GetIndexSize() {return m_stride;}
 
 	// returns index count
-	int			GetIndicesCount() {return 0;}
+	int			GetIndicesCount() {return m_numIndices;}
 
 	// updates buffer without map/unmap operations which are slower
 	void		Update(void* data, int size, int offset, bool discard = true)
 	{
+		memcpy(m_storage.GetRange(offset*m_stride, size*m_stride), data, size*m_stride);
+
+		if(discard && offset == 0)
+			m_numIndices = size;
 	}
 
 	// locks vertex buffer and gives to programmer buffer data
 	bool		Lock(int lockOfs, int sizeToLock, void** outdata, bool readOnly)
 	{
-		*outdata = malloc(sizeToLock*m_stride);
+		m_lockOfs = lockOfs;
+		m_lockSize = sizeToLock;
+		m_lockReadOnly = readOnly;
+
+		*outdata = m_storage.GetRange(lockOfs*m_stride, sizeToLock*m_stride);
 		return true;
 	}
 
 	// unlocks buffer
-	void		Unlock() {free(m_lockData); m_lockData = NULL;}
+	void		Unlock() {m_lockSize = 0;}
 
 	// sets vertex buffer flags
 	void		SetFlags( int flags ) {}
 	int			GetFlags() {return 0;}
 
-	void*		m_lockData;
+	CEmptyBufferStorage	m_storage;
+	int			m_numIndices;
 	int			m_stride;
+
+	int			m_lockOfs;
+	int			m_lockSize;
+	bool		m_lockReadOnly;
 };
 
 class CEmptyVertexFormat : public IVertexFormat
@@ -224,13 +273,15 @@ public:
 		if(pTex == NULL)
 			return;
 
+		CScopedMutex m( m_Mutex );
+
 		pTex->Ref_Drop();
 
 		if(pTex->Ref_Count() <= 0)
 		{
 			DevMsg(DEVMSG_SHADERAPI,"Texture unloaded: %s\n",pTexture->GetName());
 
-			m_TextureList.remove(pTexture);
+			RemoveTextureFromList(pTexture);
 			delete pTex;
 		}
 	}
@@ -243,8 +294,10 @@ public:
 
 		pTex->SetDimensions(width, height);
 		pTex->SetFormat(nRTFormat);
+		pTex->SetFlags(nFlags | TEXFLAG_RENDERTARGET);
 
-		m_TextureList.append(pTex);
+		CScopedMutex m( m_Mutex );
+		AddTextureToList(pTex);
 
 		return pTex;
 	}
@@ -255,10 +308,12 @@ public:
 		CEmptyTexture* pTex = new CEmptyTexture();
 		pTex->SetName(pszName);
 
-		m_TextureList.append(pTex);
-
 		pTex->SetDimensions(width, height);
 		pTex->SetFormat(nRTFormat);
+		pTex->SetFlags(nFlags | TEXFLAG_RENDERTARGET);
+
+		CScopedMutex m( m_Mutex );
+		AddTextureToList(pTex);
 
 		return pTex;
 	}
@@ -382,7 +437,7 @@ public:
 	void						SetTexture(ITexture* pTexture, const char* pszName, int index){}
 
 	// RAW Constant (Used for structure types, etc.)
-	int							SetShaderConstantRaw(const char *pszName, const void *data, int nSize, int nConstID){ return nConstID;}
+	int							SetShaderConstantRaw(const char *pszName, const void *data, int nSize, int nConstID){ return nConstID >= 0 ? nConstID : GetShaderConstantHandle(pszName);}
 
 
 	//-----------------------------------------------------
@@ -424,8 +479,8 @@ public:
 //-------------------------------------------------------------
 
 	IVertexFormat*				CreateVertexFormat(VertexFormatDesc_s *formatDesc, int nAttribs){return new CEmptyVertexFormat(formatDesc, nAttribs);}
-	IVertexBuffer*				CreateVertexBuffer(ER_BufferAccess nBufAccess, int nNumVerts, int strideSize, void *pData = NULL){return new CEmptyVertexBuffer(strideSize);}
-	IIndexBuffer*				CreateIndexBuffer(int nIndices, int nIndexSize, ER_BufferAccess nBufAccess, void *pData = NULL){return new CEmptyIndexBuffer(nIndexSize);}
+	IVertexBuffer*				CreateVertexBuffer(ER_BufferAccess nBufAccess, int nNumVerts, int strideSize, void *pData = NULL){return new CEmptyVertexBuffer(nNumVerts, strideSize);}
+	IIndexBuffer*				CreateIndexBuffer(int nIndices, int nIndexSize, ER_BufferAccess nBufAccess, void *pData = NULL){return new CEmptyIndexBuffer(nIndices, nIndexSize);}
 
 //-------------------------------------------------------------
 // Primitive drawing (lower level than DrawPrimitives2D)
@@ -439,10 +494,10 @@ public:
 
 protected:
 
-	void						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
+	bool						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
 	{
 		if(!pImages.numElem())
-			return;
+			return false;
 
 		CEmptyTexture* pTexture = NULL;
 
@@ -465,10 +520,12 @@ protected:
 
 		// if this is a new texture, add
 		if(!(*pTex))
-			m_TextureList.append(pTexture);
+			AddTextureToList(pTexture);
 
 		// set for output
 		*pTex = pTexture;
+
+		return true;
 	}
 
 	int							GetSamplerUnit(IShaderProgram* pProgram,const char* pszSamplerName) {return 0;}
@@ -0,0 +1,1826 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Recording ShaderAPI
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "core/DebugInterface.h"
+#include "core/ConCommand.h"
+#include "core/IFileSystem.h"
+#include "utils/strtools.h"
+#include "utils/eqtimer.h"
+
+#include "ShaderAPIRecorder.h"
+
+static ShaderAPIRecorder* s_recorder = NULL;
+
+DECLARE_CMD(r_record_start, "Starts recording of render commands. Usage: r_record_start [numFrames]", 0)
+{
+	if(!s_recorder)
+	{
+		MsgError("Render recording requires '-rhirecord' command line argument\n");
+		return;
+	}
+
+	s_recorder->StartRecording(CMD_ARGC > 0 ? atoi(CMD_ARGV(0).ToCString()) : 0);
+}
+
+DECLARE_CMD(r_record_stop, "Stops recording of render commands", 0)
+{
+	if(s_recorder)
+		s_recorder->StopRecording();
+}
+
+DECLARE_CMD(r_record_save, "Saves recorded render commands to file. Usage: r_record_save <filename>", 0)
+{
+	if(!s_recorder || CMD_ARGC == 0)
+		return;
+
+	s_recorder->SaveRecording(CMD_ARGV(0).ToCString());
+}
+
+DECLARE_CMD(r_record_replay, "Replays render commands file. Usage: r_record_replay <filename> [numRepeats]", 0)
+{
+	if(CMD_ARGC == 0)
+		return;
+
+	if(s_recorder && s_recorder->IsRecording())
+	{
+		MsgError("Cannot replay while recording\n");
+		return;
+	}
+
+	ShaderAPIRecorder::ReplayRecording(g_pShaderAPI, CMD_ARGV(0).ToCString(), CMD_ARGC > 1 ? atoi(CMD_ARGV(1).ToCString()) : 1);
+}
+
+DECLARE_CMD(r_record_stats, "Prints render command statistics", 0)
+{
+	if(s_recorder)
+		s_recorder->PrintStats();
+}
+
+static PRIMCOUNTER s_recordPrimCounters[] =
+{
+	PrimCount_TriangleList,
+	PrimCount_TriangleFanStrip,
+	PrimCount_TriangleFanStrip,
+	PrimCount_QuadList,
+	PrimCount_ListList,
+	PrimCount_ListStrip,
+	PrimCount_ListStrip,
+	PrimCount_Points,
+};
+
+static const int s_renderStateDescSize[] =
+{
+	sizeof(DepthStencilStateParams_t),
+	sizeof(BlendStateParam_t),
+	sizeof(RasterizerStateParams_t),
+	0,
+};
+
+void recordFrameStats_t::Add(const recordFrameStats_t& s)
+{
+	drawCalls += s.drawCalls;
+	primitives += s.primitives;
+	stateChanges += s.stateChanges;
+	shaderChanges += s.shaderChanges;
+	textureChanges += s.textureChanges;
+	renderStateChanges += s.renderStateChanges;
+	bufferChanges += s.bufferChanges;
+	targetChanges += s.targetChanges;
+	constantUpdates += s.constantUpdates;
+	bufferBytes += s.bufferBytes;
+	constantBytes += s.constantBytes;
+	commandBytes += s.commandBytes;
+}
+
+//--------------------------------------------------------------------------------
+
+void CRecorderVertexBuffer::Update(void* data, int size, int offset, bool discard)
+{
+	CEmptyVertexBuffer::Update(data, size, offset, discard);
+	s_recorder->OnBufferUpload(this, offset*m_stride, data, size*m_stride);
+}
+
+void CRecorderVertexBuffer::Unlock()
+{
+	if(m_lockSize > 0 && !m_lockReadOnly)
+		s_recorder->OnBufferUpload(this, m_lockOfs*m_stride, m_storage.m_data + m_lockOfs*m_stride, m_lockSize*m_stride);
+
+	CEmptyVertexBuffer::Unlock();
+}
+
+void CRecorderIndexBuffer::Update(void* data, int size, int offset, bool discard)
+{
+	CEmptyIndexBuffer::Update(data, size, offset, discard);
+	s_recorder->OnBufferUpload(this, offset*m_stride, data, size*m_stride);
+}
+
+void CRecorderIndexBuffer::Unlock()
+{
+	if(m_lockSize > 0 && !m_lockReadOnly)
+		s_recorder->OnBufferUpload(this, m_lockOfs*m_stride, m_storage.m_data + m_lockOfs*m_stride, m_lockSize*m_stride);
+
+	CEmptyIndexBuffer::Unlock();
+}
+
+//--------------------------------------------------------------------------------
+
+ShaderAPIRecorder::ShaderAPIRecorder() :
+	m_stream(NULL), m_streamSize(0), m_streamAllocated(0), m_frameStreamStart(0),
+	m_numFrames(0), m_maxFrames(0), m_recording(false), m_startPending(false),
+	m_nextObjectId(1), m_totalFrames(0)
+{
+	m_frameStats.Reset();
+	m_lastFrameStats.Reset();
+	m_totalStats.Reset();
+}
+
+ShaderAPIRecorder::~ShaderAPIRecorder()
+{
+	PPFree(m_stream);
+}
+
+void ShaderAPIRecorder::Init(shaderAPIParams_t &params)
+{
+	ShaderAPIEmpty::Init(params);
+
+	// to have the same texture and buffer setup as real renderers do
+	m_caps.maxTextureUnits = MAX_TEXTUREUNIT;
+	m_caps.maxVertexTextureUnits = MAX_VERTEXTEXTURES;
+	m_caps.maxRenderTargets = MAX_MRTS;
+	m_caps.maxVertexStreams = MAX_VERTEXSTREAM;
+	m_caps.maxSamplerStates = MAX_SAMPLERSTATE;
+
+	s_recorder = this;
+}
+
+void ShaderAPIRecorder::Shutdown()
+{
+	StopRecording();
+
+	ShaderAPIEmpty::Shutdown();
+
+	for(int i = 0; i < m_ShaderList.numElem(); i++)
+		delete m_ShaderList[i];
+
+	for(int i = 0; i < m_BlendStates.numElem(); i++)
+		delete m_BlendStates[i];
+
+	for(int i = 0; i < m_DepthStates.numElem(); i++)
+		delete m_DepthStates[i];
+
+	for(int i = 0; i < m_RasterizerStates.numElem(); i++)
+		delete m_RasterizerStates[i];
+
+	m_ShaderList.clear();
+	m_BlendStates.clear();
+	m_DepthStates.clear();
+	m_RasterizerStates.clear();
+
+	s_recorder = NULL;
+}
+
+//-------------------------------------------------------------
+// Recording
+//-------------------------------------------------------------
+
+void ShaderAPIRecorder::StartRecording(int maxFrames)
+{
+	CScopedMutex m(m_recordMutex);
+
+	// actual recording starts from the next frame
+	m_startPending = true;
+	m_maxFrames = maxFrames;
+}
+
+void ShaderAPIRecorder::StopRecording()
+{
+	CScopedMutex m(m_recordMutex);
+
+	m_startPending = false;
+
+	if(!m_recording)
+		return;
+
+	m_recording = false;
+
+	MsgInfo("Render recording stopped: %d frames, %d KB\n", m_numFrames, m_streamSize / 1024);
+}
+
+void ShaderAPIRecorder::EndFrame()
+{
+	CScopedMutex m(m_recordMutex);
+
+	if(m_recording)
+	{
+		WriteCmd(RCMD_FRAME_END);
+
+		m_frameStats.commandBytes = m_streamSize - m_frameStreamStart;
+		m_frameStreamStart = m_streamSize;
+		m_numFrames++;
+	}
+
+	m_lastFrameStats = m_frameStats;
+	m_totalStats.Add(m_frameStats);
+	m_totalFrames++;
+
+	m_frameStats.Reset();
+
+	if(m_recording && m_maxFrames > 0 && m_numFrames >= m_maxFrames)
+	{
+		m_recording = false;
+		MsgInfo("Render recording finished: %d frames, %d KB\n", m_numFrames, m_streamSize / 1024);
+	}
+
+	if(!m_startPending)
+		return;
+
+	m_startPending = false;
+
+	m_streamSize = 0;
+	m_frameStreamStart = 0;
+	m_numFrames = 0;
+
+	m_objectIds.clear();
+	m_constantIds.clear();
+	m_nextObjectId = 1;
+
+	m_totalStats.Reset();
+	m_totalFrames = 0;
+
+	m_recording = true;
+
+	WriteCurrentState();
+
+	MsgInfo("Render recording started\n");
+}
+
+// writes all currently applied states, so replay starts from the same setup
+void ShaderAPIRecorder::WriteCurrentState()
+{
+	uint id;
+
+	WriteCmd(RCMD_SET_VIEWPORT);
+	WriteInt(0);
+	WriteInt(0);
+	WriteInt(m_nViewportWidth);
+	WriteInt(m_nViewportHeight);
+
+	// object ids are taken before the command as they may write declarations
+	id = GetObjectId(m_pCurrentShader, RCMD_DECLARE_SHADER);
+	WriteCmd(RCMD_SET_SHADER);
+	WriteInt(id);
+
+	for(int i = 0; i < MAX_TEXTUREUNIT; i++)
+	{
+		if(!m_pCurrentTextures[i])
+			continue;
+
+		id = GetObjectId(m_pCurrentTextures[i], RCMD_DECLARE_TEXTURE);
+		WriteCmd(RCMD_SET_TEXTURE);
+		WriteInt(i);
+		WriteInt(id);
+	}
+
+	for(int i = 0; i < MAX_VERTEXTEXTURES; i++)
+	{
+		if(!m_pCurrentVertexTextures[i])
+			continue;
+
+		id = GetObjectId(m_pCurrentVertexTextures[i], RCMD_DECLARE_TEXTURE);
+		WriteCmd(RCMD_SET_VERTEXTEXTURE);
+		WriteInt(i);
+		WriteInt(id);
+	}
+
+	IRenderState* states[] = {m_pCurrentDepthState, m_pCurrentBlendstate, m_pCurrentRasterizerState};
+
+	for(int i = 0; i < RENDERSTATE_SAMPLER; i++)
+	{
+		id = GetObjectId(states[i], RCMD_DECLARE_RENDERSTATE);
+		WriteCmd(RCMD_SET_RENDERSTATE);
+		WriteInt(i);
+		WriteInt(id);
+	}
+
+	id = GetObjectId(m_pCurrentVertexFormat, RCMD_DECLARE_VERTEXFORMAT);
+	WriteCmd(RCMD_SET_VERTEXFORMAT);
+	WriteInt(id);
+
+	for(int i = 0; i < MAX_VERTEXSTREAM; i++)
+	{
+		id = GetObjectId(m_pCurrentVertexBuffers[i], RCMD_DECLARE_VERTEXBUFFER);
+		WriteCmd(RCMD_SET_VERTEXBUFFER);
+		WriteInt(i);
+		WriteInt(id);
+		WriteInt((int)m_nCurrentOffsets[i]);
+	}
+
+	id = GetObjectId(m_pCurrentIndexBuffer, RCMD_DECLARE_INDEXBUFFER);
+	WriteCmd(RCMD_SET_INDEXBUFFER);
+	WriteInt(id);
+}
+
+bool ShaderAPIRecorder::SaveRecording(const char* pszFileName)
+{
+	CScopedMutex m(m_recordMutex);
+
+	if(m_recording)
+	{
+		MsgError("Stop render recording before saving\n");
+		return false;
+	}
+
+	if(!m_numFrames)
+	{
+		MsgError("Nothing recorded\n");
+		return false;
+	}
+
+	IFile* pFile = g_fileSystem->Open(pszFileName, "wb", SP_MOD);
+
+	if(!pFile)
+	{
+		MsgError("Cannot open '%s' for writing\n", pszFileName);
+		return false;
+	}
+
+	recordStreamHdr_t hdr;
+	hdr.ident = RECORD_STREAM_IDENT;
+	hdr.version = RECORD_STREAM_VERSION;
+	hdr.numFrames = m_numFrames;
+	hdr.streamSize = m_streamSize;
+
+	pFile->Write(&hdr, 1, sizeof(hdr));
+	pFile->Write(m_stream, 1, m_streamSize);
+
+	g_fileSystem->Close(pFile);
+
+	MsgInfo("Render recording saved to '%s' (%d frames, %d KB)\n", pszFileName, m_numFrames, m_streamSize / 1024);
+
+	return true;
+}
+
+static void PrintFrameStats(const recordFrameStats_t& s, int numFrames)
+{
+	if(numFrames <= 0)
+		numFrames = 1;
+
+	MsgInfo("  draw calls: %d, primitives: %d\n", s.drawCalls / numFrames, s.primitives / numFrames);
+	MsgInfo("  state changes: %d (shader %d, texture %d, render state %d, buffer %d, target %d)\n",
+		s.stateChanges / numFrames, s.shaderChanges / numFrames, s.textureChanges / numFrames,
+		s.renderStateChanges / numFrames, s.bufferChanges / numFrames, s.targetChanges / numFrames);
+	MsgInfo("  constant updates: %d, %d bytes\n", s.constantUpdates / numFrames, (int)(s.constantBytes / numFrames));
+	MsgInfo("  buffer uploads: %d bytes\n", (int)(s.bufferBytes / numFrames));
+
+	if(s.commandBytes)
+		MsgInfo("  command stream: %d bytes\n", s.commandBytes / numFrames);
+}
+
+void ShaderAPIRecorder::PrintStats()
+{
+	MsgInfo("--- Last frame ---\n");
+	PrintFrameStats(m_lastFrameStats, 1);
+
+	MsgInfo("--- Average of %d frames ---\n", m_totalFrames);
+	PrintFrameStats(m_totalStats, m_totalFrames);
+
+	if(m_recording)
+		MsgInfo("Recording: %d frames, %d KB\n", m_numFrames, m_streamSize / 1024);
+}
+
+//-------------------------------------------------------------
+// Stream writing
+//-------------------------------------------------------------
+
+void ShaderAPIRecorder::WriteBytes(const void* data, int size)
+{
+	if(m_streamSize + size > m_streamAllocated)
+	{
+		int newSize = max(m_streamAllocated * 2, 64 * 1024);
+
+		while(newSize < m_streamSize + size)
+			newSize *= 2;
+
+		m_stream = (ubyte*)PPReAlloc(m_stream, newSize);
+		m_streamAllocated = newSize;
+	}
+
+	memcpy(m_stream + m_streamSize, data, size);
+	m_streamSize += size;
+}
+
+void ShaderAPIRecorder::WriteString(const char* str)
+{
+	if(!str)
+		str = "";
+
+	int len = strlen(str);
+
+	// null-terminated, so replay can use strings in place
+	WriteInt(len);
+	WriteBytes(str, len + 1);
+}
+
+uint ShaderAPIRecorder::GetObjectId(void* object, ERecordCommand declType)
+{
+	if(!object)
+		return 0;
+
+	std::unordered_map<void*, uint>::iterator it = m_objectIds.find(object);
+
+	if(it != m_objectIds.end())
+		return it->second;
+
+	uint id = m_nextObjectId++;
+	m_objectIds[object] = id;
+
+	WriteCmd(declType);
+	WriteInt(id);
+
+	switch(declType)
+	{
+		case RCMD_DECLARE_VERTEXFORMAT:
+		{
+			VertexFormatDesc_t* desc = NULL;
+			int numAttribs = 0;
+			((IVertexFormat*)object)->GetFormatDesc(&desc, numAttribs);
+
+			WriteInt(numAttribs);
+
+			for(int i = 0; i < numAttribs; i++)
+			{
+				WriteInt(desc[i].streamId);
+				WriteInt(desc[i].elemCount);
+				WriteInt(desc[i].attribType);
+				WriteInt(desc[i].attribFormat);
+				WriteString(desc[i].name);
+			}
+			break;
+		}
+		case RCMD_DECLARE_VERTEXBUFFER:
+		{
+			CEmptyVertexBuffer* vb = (CEmptyVertexBuffer*)object;
+			int dataSize = min(vb->m_storage.m_size, vb->m_numVerts*vb->m_stride);
+
+			WriteInt(vb->m_numVerts);
+			WriteInt(vb->m_stride);
+			WriteInt(dataSize);
+			WriteBytes(vb->m_storage.m_data, dataSize);
+			break;
+		}
+		case RCMD_DECLARE_INDEXBUFFER:
+		{
+			CEmptyIndexBuffer* ib = (CEmptyIndexBuffer*)object;
+			int dataSize = min(ib->m_storage.m_size, ib->m_numIndices*ib->m_stride);
+
+			WriteInt(ib->m_numIndices);
+			WriteInt(ib->m_stride);
+			WriteInt(dataSize);
+			WriteBytes(ib->m_storage.m_data, dataSize);
+			break;
+		}
+		case RCMD_DECLARE_TEXTURE:
+		{
+			ITexture* tex = (ITexture*)object;
+
+			WriteInt(tex->GetWidth());
+			WriteInt(tex->GetHeight());
+			WriteInt(tex->GetFormat());
+			WriteInt(tex->GetFlags());
+			WriteString(tex->GetName());
+			break;
+		}
+		case RCMD_DECLARE_SHADER:
+		{
+			WriteString(((IShaderProgram*)object)->GetName());
+			break;
+		}
+		case RCMD_DECLARE_RENDERSTATE:
+		{
+			CRecorderRenderState* state = (CRecorderRenderState*)object;
+
+			WriteInt(state->m_type);
+			WriteInt(state->m_descSize);
+			WriteBytes(state->m_desc, state->m_descSize);
+			break;
+		}
+		default:
+			ASSERT(!"GetObjectId - invalid declaration type");
+	}
+
+	return id;
+}
+
+void ShaderAPIRecorder::OnObjectDestroyed(void* object)
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	std::unordered_map<void*, uint>::iterator it = m_objectIds.find(object);
+
+	if(it == m_objectIds.end())
+		return;
+
+	WriteCmd(RCMD_DESTROY);
+	WriteInt(it->second);
+
+	m_objectIds.erase(it);
+}
+
+void ShaderAPIRecorder::OnBufferUpload(void* buffer, int byteOffset, const void* data, int size)
+{
+	CScopedMutex m(m_recordMutex);
+
+	m_frameStats.bufferBytes += size;
+
+	if(!m_recording)
+		return;
+
+	// buffer declaration already carries the contents
+	if(m_objectIds.find(buffer) == m_objectIds.end())
+		return;
+
+	WriteCmd(RCMD_UPDATE_BUFFER);
+	WriteInt(m_objectIds[buffer]);
+	WriteInt(byteOffset);
+	WriteInt(size);
+	WriteBytes(data, size);
+}
+
+//-------------------------------------------------------------
+// Rendering's applies
+//-------------------------------------------------------------
+
+void ShaderAPIRecorder::ApplyTextures()
+{
+	CScopedMutex m(m_recordMutex);
+
+	for(int i = 0; i < MAX_TEXTUREUNIT; i++)
+	{
+		if(m_pSelectedTextures[i] == m_pCurrentTextures[i])
+			continue;
+
+		m_pCurrentTextures[i] = m_pSelectedTextures[i];
+
+		m_frameStats.textureChanges++;
+		m_frameStats.stateChanges++;
+
+		if(!m_recording)
+			continue;
+
+		uint id = GetObjectId(m_pCurrentTextures[i], RCMD_DECLARE_TEXTURE);
+
+		WriteCmd(RCMD_SET_TEXTURE);
+		WriteInt(i);
+		WriteInt(id);
+	}
+
+	for(int i = 0; i < MAX_VERTEXTEXTURES; i++)
+	{
+		if(m_pSelectedVertexTextures[i] == m_pCurrentVertexTextures[i])
+			continue;
+
+		m_pCurrentVertexTextures[i] = m_pSelectedVertexTextures[i];
+
+		m_frameStats.textureChanges++;
+		m_frameStats.stateChanges++;
+
+		if(!m_recording)
+			continue;
+
+		uint id = GetObjectId(m_pCurrentVertexTextures[i], RCMD_DECLARE_TEXTURE);
+
+		WriteCmd(RCMD_SET_VERTEXTEXTURE);
+		WriteInt(i);
+		WriteInt(id);
+	}
+}
+
+#define RECORDER_APPLY_STATE(type, selected, current)				\
+	if(selected == current)											\
+		return;														\
+	current = selected;												\
+	m_frameStats.renderStateChanges++;								\
+	m_frameStats.stateChanges++;									\
+	if(!m_recording)												\
+		return;														\
+	CScopedMutex m(m_recordMutex);									\
+	uint id = GetObjectId(current, RCMD_DECLARE_RENDERSTATE);		\
+	WriteCmd(RCMD_SET_RENDERSTATE);									\
+	WriteInt(type);													\
+	WriteInt(id);
+
+void ShaderAPIRecorder::ApplyBlendState()
+{
+	RECORDER_APPLY_STATE(RENDERSTATE_BLENDING, m_pSelectedBlendstate, m_pCurrentBlendstate)
+}
+
+void ShaderAPIRecorder::ApplyDepthState()
+{
+	RECORDER_APPLY_STATE(RENDERSTATE_DEPTHSTENCIL, m_pSelectedDepthState, m_pCurrentDepthState)
+}
+
+void ShaderAPIRecorder::ApplyRasterizerState()
+{
+	RECORDER_APPLY_STATE(RENDERSTATE_RASTERIZER, m_pSelectedRasterizerState, m_pCurrentRasterizerState)
+}
+
+#undef RECORDER_APPLY_STATE
+
+void ShaderAPIRecorder::ApplyShaderProgram()
+{
+	if(m_pSelectedShader == m_pCurrentShader)
+		return;
+
+	m_pCurrentShader = m_pSelectedShader;
+
+	m_frameStats.shaderChanges++;
+	m_frameStats.stateChanges++;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	uint id = GetObjectId(m_pCurrentShader, RCMD_DECLARE_SHADER);
+
+	WriteCmd(RCMD_SET_SHADER);
+	WriteInt(id);
+}
+
+void ShaderAPIRecorder::Clear(bool bClearColor, bool bClearDepth, bool bClearStencil, const ColorRGBA &fillColor,float fDepth, int nStencil)
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_CLEAR);
+	WriteInt((bClearColor ? 1 : 0) | (bClearDepth ? 2 : 0) | (bClearStencil ? 4 : 0));
+	WriteBytes(&fillColor, sizeof(ColorRGBA));
+	WriteFloat(fDepth);
+	WriteInt(nStencil);
+}
+
+void ShaderAPIRecorder::SetViewport(int x, int y, int w, int h)
+{
+	ShaderAPIEmpty::SetViewport(x, y, w, h);
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_SET_VIEWPORT);
+	WriteInt(x);
+	WriteInt(y);
+	WriteInt(w);
+	WriteInt(h);
+}
+
+void ShaderAPIRecorder::SetScissorRectangle( const IRectangle &rect )
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_SET_SCISSOR);
+	WriteInt(rect.vleftTop.x);
+	WriteInt(rect.vleftTop.y);
+	WriteInt(rect.vrightBottom.x);
+	WriteInt(rect.vrightBottom.y);
+}
+
+void ShaderAPIRecorder::SetDepthRange(float fZNear,float fZFar)
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_SET_DEPTHRANGE);
+	WriteFloat(fZNear);
+	WriteFloat(fZFar);
+}
+
+void ShaderAPIRecorder::ChangeRenderTargets(ITexture** pRenderTargets, int nNumRTs, int* nCubemapFaces, ITexture* pDepthTarget, int nDepthSlice)
+{
+	m_frameStats.targetChanges++;
+	m_frameStats.stateChanges++;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	uint ids[MAX_MRTS];
+
+	for(int i = 0; i < nNumRTs; i++)
+		ids[i] = GetObjectId(pRenderTargets[i], RCMD_DECLARE_TEXTURE);
+
+	uint depthId = GetObjectId(pDepthTarget, RCMD_DECLARE_TEXTURE);
+
+	WriteCmd(RCMD_SET_RENDERTARGETS);
+	WriteInt(nNumRTs);
+
+	for(int i = 0; i < nNumRTs; i++)
+	{
+		WriteInt(ids[i]);
+		WriteInt(nCubemapFaces ? nCubemapFaces[i] : 0);
+	}
+
+	WriteInt(depthId);
+	WriteInt(nDepthSlice);
+}
+
+void ShaderAPIRecorder::ChangeRenderTargetToBackBuffer()
+{
+	m_frameStats.targetChanges++;
+	m_frameStats.stateChanges++;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+	WriteCmd(RCMD_SET_BACKBUFFER);
+}
+
+void ShaderAPIRecorder::SetMatrixMode(ER_MatrixMode nMatrixMode)
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_MATRIX_MODE);
+	WriteInt(nMatrixMode);
+}
+
+void ShaderAPIRecorder::PushMatrix()
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+	WriteCmd(RCMD_MATRIX_PUSH);
+}
+
+void ShaderAPIRecorder::PopMatrix()
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+	WriteCmd(RCMD_MATRIX_POP);
+}
+
+void ShaderAPIRecorder::LoadIdentityMatrix()
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+	WriteCmd(RCMD_MATRIX_IDENTITY);
+}
+
+void ShaderAPIRecorder::LoadMatrix(const Matrix4x4 &matrix)
+{
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_MATRIX_LOAD);
+	WriteBytes(&matrix, sizeof(Matrix4x4));
+}
+
+void ShaderAPIRecorder::ChangeVertexFormat(IVertexFormat* pVertexFormat)
+{
+	if(m_pCurrentVertexFormat == pVertexFormat)
+		return;
+
+	m_pCurrentVertexFormat = pVertexFormat;
+
+	m_frameStats.bufferChanges++;
+	m_frameStats.stateChanges++;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	uint id = GetObjectId(pVertexFormat, RCMD_DECLARE_VERTEXFORMAT);
+
+	WriteCmd(RCMD_SET_VERTEXFORMAT);
+	WriteInt(id);
+}
+
+void ShaderAPIRecorder::ChangeVertexBuffer(IVertexBuffer* pVertexBuffer,int nStream, const intptr offset)
+{
+	if(m_pCurrentVertexBuffers[nStream] == pVertexBuffer && m_nCurrentOffsets[nStream] == offset)
+		return;
+
+	m_pCurrentVertexBuffers[nStream] = pVertexBuffer;
+	m_nCurrentOffsets[nStream] = offset;
+
+	m_frameStats.bufferChanges++;
+	m_frameStats.stateChanges++;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	uint id = GetObjectId(pVertexBuffer, RCMD_DECLARE_VERTEXBUFFER);
+
+	WriteCmd(RCMD_SET_VERTEXBUFFER);
+	WriteInt(nStream);
+	WriteInt(id);
+	WriteInt((int)offset);
+}
+
+void ShaderAPIRecorder::ChangeIndexBuffer(IIndexBuffer* pIndexBuffer)
+{
+	if(m_pCurrentIndexBuffer == pIndexBuffer)
+		return;
+
+	m_pCurrentIndexBuffer = pIndexBuffer;
+
+	m_frameStats.bufferChanges++;
+	m_frameStats.stateChanges++;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	uint id = GetObjectId(pIndexBuffer, RCMD_DECLARE_INDEXBUFFER);
+
+	WriteCmd(RCMD_SET_INDEXBUFFER);
+	WriteInt(id);
+}
+
+//-------------------------------------------------------------
+// Objects
+//-------------------------------------------------------------
+
+void ShaderAPIRecorder::FreeTexture(ITexture* pTexture)
+{
+	if(pTexture && pTexture->Ref_Count() <= 1)
+		OnObjectDestroyed(pTexture);
+
+	ShaderAPIEmpty::FreeTexture(pTexture);
+}
+
+IRenderState* ShaderAPIRecorder::CreateBlendingState( const BlendStateParam_t &blendDesc )
+{
+	CScopedMutex m(m_Mutex);
+
+	for(int i = 0; i < m_BlendStates.numElem(); i++)
+	{
+		BlendStateParam_t& desc = *(BlendStateParam_t*)m_BlendStates[i]->GetDescPtr();
+
+		if(	desc.blendEnable == blendDesc.blendEnable &&
+			desc.srcFactor == blendDesc.srcFactor &&
+			desc.dstFactor == blendDesc.dstFactor &&
+			desc.blendFunc == blendDesc.blendFunc &&
+			desc.mask == blendDesc.mask &&
+			desc.alphaTest == blendDesc.alphaTest &&
+			desc.alphaTestRef == blendDesc.alphaTestRef)
+		{
+			m_BlendStates[i]->AddReference();
+			return m_BlendStates[i];
+		}
+	}
+
+	IRenderState* pState = new CRecorderRenderState(RENDERSTATE_BLENDING, &blendDesc, sizeof(blendDesc));
+	pState->AddReference();
+
+	m_BlendStates.append(pState);
+
+	return pState;
+}
+
+IRenderState* ShaderAPIRecorder::CreateDepthStencilState( const DepthStencilStateParams_t &depthDesc )
+{
+	CScopedMutex m(m_Mutex);
+
+	for(int i = 0; i < m_DepthStates.numElem(); i++)
+	{
+		DepthStencilStateParams_t& desc = *(DepthStencilStateParams_t*)m_DepthStates[i]->GetDescPtr();
+
+		if(	desc.depthTest == depthDesc.depthTest &&
+			desc.depthWrite == depthDesc.depthWrite &&
+			desc.depthFunc == depthDesc.depthFunc &&
+			desc.doStencilTest == depthDesc.doStencilTest &&
+			desc.nStencilMask == depthDesc.nStencilMask &&
+			desc.nStencilWriteMask == depthDesc.nStencilWriteMask &&
+			desc.nStencilRef == depthDesc.nStencilRef &&
+			desc.nStencilFunc == depthDesc.nStencilFunc &&
+			desc.nStencilFail == depthDesc.nStencilFail &&
+			desc.nDepthFail == depthDesc.nDepthFail &&
+			desc.nStencilPass == depthDesc.nStencilPass)
+		{
+			m_DepthStates[i]->AddReference();
+			return m_DepthStates[i];
+		}
+	}
+
+	IRenderState* pState = new CRecorderRenderState(RENDERSTATE_DEPTHSTENCIL, &depthDesc, sizeof(depthDesc));
+	pState->AddReference();
+
+	m_DepthStates.append(pState);
+
+	return pState;
+}
+
+IRenderState* ShaderAPIRecorder::CreateRasterizerState( const RasterizerStateParams_t &rasterDesc )
+{
+	CScopedMutex m(m_Mutex);
+
+	for(int i = 0; i < m_RasterizerStates.numElem(); i++)
+	{
+		RasterizerStateParams_t& desc = *(RasterizerStateParams_t*)m_RasterizerStates[i]->GetDescPtr();
+
+		if(	desc.cullMode == rasterDesc.cullMode &&
+			desc.fillMode == rasterDesc.fillMode &&
+			desc.useDepthBias == rasterDesc.useDepthBias &&
+			desc.depthBias == rasterDesc.depthBias &&
+			desc.slopeDepthBias == rasterDesc.slopeDepthBias &&
+			desc.multiSample == rasterDesc.multiSample &&
+			desc.scissor == rasterDesc.scissor)
+		{
+			m_RasterizerStates[i]->AddReference();
+			return m_RasterizerStates[i];
+		}
+	}
+
+	IRenderState* pState = new CRecorderRenderState(RENDERSTATE_RASTERIZER, &rasterDesc, sizeof(rasterDesc));
+	pState->AddReference();
+
+	m_RasterizerStates.append(pState);
+
+	return pState;
+}
+
+void ShaderAPIRecorder::DestroyRenderState( IRenderState* pState, bool removeAllRefs)
+{
+	if(!pState)
+		return;
+
+	{
+		CScopedMutex m(m_Mutex);
+
+		pState->RemoveReference();
+
+		if(pState->GetReferenceNum() > 0 && !removeAllRefs)
+			return;
+
+		switch(pState->GetType())
+		{
+			case RENDERSTATE_BLENDING:
+				m_BlendStates.remove(pState);
+				break;
+			case RENDERSTATE_RASTERIZER:
+				m_RasterizerStates.remove(pState);
+				break;
+			case RENDERSTATE_DEPTHSTENCIL:
+				m_DepthStates.remove(pState);
+				break;
+		}
+	}
+
+	OnObjectDestroyed(pState);
+	delete (CRecorderRenderState*)pState;
+}
+
+IShaderProgram* ShaderAPIRecorder::CreateNewShaderProgram(const char* pszName, const char* query)
+{
+	IShaderProgram* pNewProgram = new CRecorderShaderProgram();
+	pNewProgram->SetName((_Es(pszName) + (query ? query : "")).ToCString());
+
+	CScopedMutex m(m_Mutex);
+	AddShaderProgramToList(pNewProgram);
+
+	return pNewProgram;
+}
+
+void ShaderAPIRecorder::DestroyShaderProgram(IShaderProgram* pShaderProgram)
+{
+	if(!pShaderProgram)
+		return;
+
+	bool deleted = false;
+	{
+		CScopedMutex m(m_Mutex);
+		pShaderProgram->Ref_Drop();
+
+		if(pShaderProgram->Ref_Count() <= 0)
+			deleted = RemoveShaderProgramFromList(pShaderProgram);
+	}
+
+	if(deleted)
+	{
+		OnObjectDestroyed(pShaderProgram);
+		delete (CRecorderShaderProgram*)pShaderProgram;
+	}
+}
+
+IVertexFormat* ShaderAPIRecorder::CreateVertexFormat(VertexFormatDesc_s *formatDesc, int nAttribs)
+{
+	return new CEmptyVertexFormat(formatDesc, nAttribs);
+}
+
+IVertexBuffer* ShaderAPIRecorder::CreateVertexBuffer(ER_BufferAccess nBufAccess, int nNumVerts, int strideSize, void *pData)
+{
+	CRecorderVertexBuffer* pBuffer = new CRecorderVertexBuffer(nNumVerts, strideSize);
+
+	// keep initial contents for the declaration
+	if(pData && nNumVerts > 0)
+		memcpy(pBuffer->m_storage.GetRange(0, nNumVerts*strideSize), pData, nNumVerts*strideSize);
+
+	return pBuffer;
+}
+
+IIndexBuffer* ShaderAPIRecorder::CreateIndexBuffer(int nIndices, int nIndexSize, ER_BufferAccess nBufAccess, void *pData)
+{
+	CRecorderIndexBuffer* pBuffer = new CRecorderIndexBuffer(nIndices, nIndexSize);
+
+	if(pData && nIndices > 0)
+		memcpy(pBuffer->m_storage.GetRange(0, nIndices*nIndexSize), pData, nIndices*nIndexSize);
+
+	return pBuffer;
+}
+
+void ShaderAPIRecorder::DestroyVertexFormat(IVertexFormat* pFormat)
+{
+	OnObjectDestroyed(pFormat);
+	ShaderAPIEmpty::DestroyVertexFormat(pFormat);
+}
+
+void ShaderAPIRecorder::DestroyVertexBuffer(IVertexBuffer* pVertexBuffer)
+{
+	OnObjectDestroyed(pVertexBuffer);
+	ShaderAPIEmpty::DestroyVertexBuffer(pVertexBuffer);
+}
+
+void ShaderAPIRecorder::DestroyIndexBuffer(IIndexBuffer* pIndexBuffer)
+{
+	OnObjectDestroyed(pIndexBuffer);
+	ShaderAPIEmpty::DestroyIndexBuffer(pIndexBuffer);
+}
+
+//-------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------
+
+int ShaderAPIRecorder::SetShaderConstantRaw(const char *pszName, const void *data, int nSize, int nConstID)
+{
+	if(nConstID < 0)
+		nConstID = GetShaderConstantHandle(pszName);
+
+	if(!data || !nSize || nConstID < 0)
+		return nConstID;
+
+	m_frameStats.constantUpdates++;
+	m_frameStats.constantBytes += nSize;
+
+	if(!m_recording)
+		return nConstID;
+
+	CScopedMutex m(m_recordMutex);
+
+	std::unordered_map<int, uint>::iterator it = m_constantIds.find(nConstID);
+
+	uint id;
+	if(it == m_constantIds.end())
+	{
+		id = m_constantIds.size();
+		m_constantIds[nConstID] = id;
+
+		WriteCmd(RCMD_DECLARE_CONSTANT);
+		WriteInt(id);
+		WriteString(GetShaderConstantName(nConstID));
+	}
+	else
+		id = it->second;
+
+	WriteCmd(RCMD_SET_CONSTANT);
+	WriteInt(id);
+	WriteInt(nSize);
+	WriteBytes(data, nSize);
+
+	return nConstID;
+}
+
+//-------------------------------------------------------------
+// Drawing
+//-------------------------------------------------------------
+
+void ShaderAPIRecorder::DrawIndexedPrimitives(ER_PrimitiveType nType, int nFirstIndex, int nIndices, int nFirstVertex, int nVertices, int nBaseVertex)
+{
+	int nTris = s_recordPrimCounters[nType](nIndices);
+
+	m_nDrawIndexedPrimitiveCalls++;
+	m_nDrawCalls++;
+	m_nTrianglesCount += nTris;
+
+	m_frameStats.drawCalls++;
+	m_frameStats.primitives += nTris;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_DRAW_INDEXED);
+	WriteInt(nType);
+	WriteInt(nFirstIndex);
+	WriteInt(nIndices);
+	WriteInt(nFirstVertex);
+	WriteInt(nVertices);
+	WriteInt(nBaseVertex);
+}
+
+void ShaderAPIRecorder::DrawNonIndexedPrimitives(ER_PrimitiveType nType, int nFirstVertex, int nVertices)
+{
+	int nTris = s_recordPrimCounters[nType](nVertices);
+
+	m_nDrawCalls++;
+	m_nTrianglesCount += nTris;
+
+	m_frameStats.drawCalls++;
+	m_frameStats.primitives += nTris;
+
+	if(!m_recording)
+		return;
+
+	CScopedMutex m(m_recordMutex);
+
+	WriteCmd(RCMD_DRAW);
+	WriteInt(nType);
+	WriteInt(nFirstVertex);
+	WriteInt(nVertices);
+}
+
+//-------------------------------------------------------------
+// Replay
+//-------------------------------------------------------------
+
+#define RECORD_MAX_TEXTURE_SIZE		16384
+
+struct replayObject_t
+{
+	int		type;		// ERecordCommand declaration
+	void*	ptr;
+	int		stride;
+	int		numElems;	// buffer size in elements
+	bool	owned;		// created by replay
+};
+
+class CRecordStreamReader
+{
+public:
+	CRecordStreamReader(const ubyte* data, int size) : m_start(data), m_ptr(data), m_end(data + size) {}
+
+	bool		IsEnd() const				{return m_ptr >= m_end;}
+	void		Rewind()					{m_ptr = m_start;}
+
+	const void*	ReadBytes(int size)
+	{
+		if(size < 0 || size > m_end - m_ptr)
+		{
+			m_ptr = m_end;
+			return NULL;
+		}
+
+		const void* data = m_ptr;
+		m_ptr += size;
+		return data;
+	}
+
+	int			ReadInt()		{int v = 0; const void* p = ReadBytes(sizeof(int)); if(p) memcpy(&v, p, sizeof(int)); return v;}
+	float		ReadFloat()		{float v = 0; const void* p = ReadBytes(sizeof(float)); if(p) memcpy(&v, p, sizeof(float)); return v;}
+	ubyte		ReadCmd()		{const ubyte* p = (const ubyte*)ReadBytes(1); return p ? *p : RCMD_FRAME_END;}
+	const char*	ReadString()
+	{
+		int len = ReadInt();
+
+		if(len < 0)
+		{
+			m_ptr = m_end;
+			return "";
+		}
+
+		const char* str = (const char*)ReadBytes(len + 1);
+
+		// must be null-terminated as strings are used in place
+		if(!str || str[len] != '\0')
+			return "";
+
+		return str;
+	}
+
+private:
+	const ubyte*	m_start;
+	const ubyte*	m_ptr;
+	const ubyte*	m_end;
+};
+
+static void Replay_DestroyObject(IShaderAPI* api, replayObject_t& obj)
+{
+	if(obj.owned && obj.ptr)
+	{
+		switch(obj.type)
+		{
+			case RCMD_DECLARE_VERTEXFORMAT:
+				api->DestroyVertexFormat((IVertexFormat*)obj.ptr);
+				break;
+			case RCMD_DECLARE_VERTEXBUFFER:
+				api->DestroyVertexBuffer((IVertexBuffer*)obj.ptr);
+				break;
+			case RCMD_DECLARE_INDEXBUFFER:
+				api->DestroyIndexBuffer((IIndexBuffer*)obj.ptr);
+				break;
+			case RCMD_DECLARE_TEXTURE:
+				api->FreeTexture((ITexture*)obj.ptr);
+				break;
+			case RCMD_DECLARE_RENDERSTATE:
+				api->DestroyRenderState((IRenderState*)obj.ptr);
+				break;
+		}
+	}
+
+	memset(&obj, 0, sizeof(replayObject_t));
+}
+
+// returns replay object by id or NULL if id is out of range
+static replayObject_t* Replay_GetObject(DkList<replayObject_t>& objects, int id)
+{
+	if(id < 0 || id >= objects.numElem())
+		return NULL;
+
+	return &objects[id];
+}
+
+// returns object pointer only if it was declared with the expected type
+static void* Replay_GetObjectPtr(DkList<replayObject_t>& objects, int id, ERecordCommand declType)
+{
+	replayObject_t* obj = Replay_GetObject(objects, id);
+	return (obj && obj->type == declType) ? obj->ptr : NULL;
+}
+
+// creates object from declaration. Skipped on repeats if object still exists
+// returns false if declaration is invalid
+static bool Replay_DeclareObject(IShaderAPI* api, CRecordStreamReader& reader, ERecordCommand type, DkList<replayObject_t>& objects, int maxObjectId)
+{
+	int id = reader.ReadInt();
+
+	if(id < 0 || id > maxObjectId)
+	{
+		MsgError("Replay: invalid object id %d\n", id);
+		return false;
+	}
+
+	if(id >= objects.numElem())
+	{
+		int oldNum = objects.numElem();
+		objects.setNum(id + 1);
+
+		memset(objects.ptr() + oldNum, 0, (objects.numElem() - oldNum) * sizeof(replayObject_t));
+	}
+
+	replayObject_t& obj = objects[id];
+
+	bool exists = (obj.type != 0);
+
+	switch(type)
+	{
+		case RCMD_DECLARE_VERTEXFORMAT:
+		{
+			int numAttribs = reader.ReadInt();
+
+			VertexFormatDesc_t desc[MAX_GENERIC_ATTRIB*MAX_VERTEXSTREAM];
+			numAttribs = clamp(numAttribs, 0, (int)elementsOf(desc));
+
+			for(int i = 0; i < numAttribs; i++)
+			{
+				desc[i].streamId = reader.ReadInt();
+				desc[i].elemCount = reader.ReadInt();
+				desc[i].attribType = (ER_VertexAttribType)reader.ReadInt();
+				desc[i].attribFormat = (ER_AttributeFormat)reader.ReadInt();
+				desc[i].name = reader.ReadString();	// string lives in stream memory
+
+				// renderers are indexing tables with those
+				if(desc[i].streamId < 0 || desc[i].streamId >= MAX_VERTEXSTREAM ||
+					desc[i].elemCount < 0 || desc[i].elemCount > 4 ||
+					desc[i].attribType < VERTEXATTRIB_UNUSED || desc[i].attribType > VERTEXATTRIB_BINORMAL ||
+					desc[i].attribFormat < ATTRIBUTEFORMAT_FLOAT || desc[i].attribFormat > ATTRIBUTEFORMAT_UBYTE)
+				{
+					MsgError("Replay: invalid vertex format declaration %d\n", id);
+					return false;
+				}
+			}
+
+			if(!exists)
+				obj.ptr = api->CreateVertexFormat(desc, numAttribs);
+			break;
+		}
+		case RCMD_DECLARE_VERTEXBUFFER:
+		case RCMD_DECLARE_INDEXBUFFER:
+		{
+			int numElems = reader.ReadInt();
+			int stride = reader.ReadInt();
+			int dataSize = reader.ReadInt();
+			void* data = (void*)reader.ReadBytes(dataSize);
+
+			if(numElems < 0 || stride <= 0 || dataSize < 0 || (int64)max(numElems, 1)*stride > INT_MAX)
+			{
+				MsgError("Replay: invalid buffer declaration %d\n", id);
+				return false;
+			}
+
+			if(exists)
+				break;
+
+			// empty buffers can't be created
+			numElems = max(numElems, 1);
+
+			bool fullData = (dataSize >= numElems*stride);
+
+			if(type == RCMD_DECLARE_VERTEXBUFFER)
+			{
+				IVertexBuffer* vb = api->CreateVertexBuffer(BUFFER_DYNAMIC, numElems, stride, fullData ? data : NULL);
+
+				if(!fullData && data)
+					vb->Update(data, dataSize / stride, 0, false);
+
+				obj.ptr = vb;
+			}
+			else
+			{
+				IIndexBuffer* ib = api->CreateIndexBuffer(numElems, stride, BUFFER_DYNAMIC, fullData ? data : NULL);
+
+				if(!fullData && data)
+					ib->Update(data, dataSize / stride, 0, false);
+
+				obj.ptr = ib;
+			}
+
+			obj.stride = stride;
+			obj.numElems = numElems;
+			break;
+		}
+		case RCMD_DECLARE_TEXTURE:
+		{
+			int width = reader.ReadInt();
+			int height = reader.ReadInt();
+			ETextureFormat format = (ETextureFormat)reader.ReadInt();
+			int flags = reader.ReadInt();
+			const char* name = reader.ReadString();
+
+			if(format <= FORMAT_NONE || format >= FORMAT_COUNT ||
+				width < 0 || width > RECORD_MAX_TEXTURE_SIZE ||
+				height < 0 || height > RECORD_MAX_TEXTURE_SIZE)
+			{
+				MsgError("Replay: invalid texture declaration %d\n", id);
+				return false;
+			}
+
+			if(exists)
+				break;
+
+			if(flags & TEXFLAG_RENDERTARGET)
+			{
+				obj.ptr = api->CreateNamedRenderTarget(name, width, height, format);
+				obj.owned = true;
+				break;
+			}
+
+			obj.ptr = api->FindTexture(name);
+
+			if(!obj.ptr)
+			{
+				// only the size matters for the benchmark
+				if(IsCompressedFormat(format))
+					format = FORMAT_RGBA8;
+
+				obj.ptr = api->CreateProceduralTexture(name, format, max(width, 1), max(height, 1), 1, 1, TEXFILTER_LINEAR, TEXADDRESS_WRAP, TEXFLAG_NOQUALITYLOD);
+				obj.owned = true;
+			}
+			break;
+		}
+		case RCMD_DECLARE_SHADER:
+		{
+			const char* name = reader.ReadString();
+
+			// shaders can't be made from recording, they must be loaded by materials
+			if(!exists)
+				obj.ptr = api->FindShaderProgram(name);
+
+			if(!obj.ptr)
+				DevMsg(DEVMSG_SHADERAPI, "Replay: shader '%s' is not loaded\n", name);
+			break;
+		}
+		case RCMD_DECLARE_RENDERSTATE:
+		{
+			RenderStateType_e stateType = (RenderStateType_e)reader.ReadInt();
+			int descSize = reader.ReadInt();
+			const void* desc = reader.ReadBytes(descSize);
+
+			if(exists || !desc || stateType < 0 || stateType >= RENDERSTATE_SAMPLER || descSize != s_renderStateDescSize[stateType])
+				break;
+
+			if(stateType == RENDERSTATE_BLENDING)
+			{
+				BlendStateParam_t params;
+				memcpy(&params, desc, descSize);
+				obj.ptr = api->CreateBlendingState(params);
+			}
+			else if(stateType == RENDERSTATE_DEPTHSTENCIL)
+			{
+				DepthStencilStateParams_t params;
+				memcpy(&params, desc, descSize);
+				obj.ptr = api->CreateDepthStencilState(params);
+			}
+			else if(stateType == RENDERSTATE_RASTERIZER)
+			{
+				RasterizerStateParams_t params;
+				memcpy(&params, desc, descSize);
+				obj.ptr = api->CreateRasterizerState(params);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+
+	if(exists)
+		return true;
+
+	obj.type = type;
+
+	if(type != RCMD_DECLARE_TEXTURE && type != RCMD_DECLARE_SHADER)
+		obj.owned = true;
+
+	return true;
+}
+
+bool ShaderAPIRecorder::ReplayRecording(IShaderAPI* api, const char* pszFileName, int numRepeats)
+{
+	long fileSize = 0;
+	ubyte* fileData = (ubyte*)g_fileSystem->GetFileBuffer(pszFileName, &fileSize);
+
+	if(!fileData)
+	{
+		MsgError("Cannot open render recording '%s'\n", pszFileName);
+		return false;
+	}
+
+	recordStreamHdr_t* hdr = (recordStreamHdr_t*)fileData;
+
+	if(fileSize < (long)sizeof(recordStreamHdr_t) ||
+		hdr->ident != RECORD_STREAM_IDENT ||
+		hdr->version != RECORD_STREAM_VERSION ||
+		hdr->streamSize > fileSize - (long)sizeof(recordStreamHdr_t))
+	{
+		MsgError("'%s' is not a valid render recording\n", pszFileName);
+		PPFree(fileData);
+		return false;
+	}
+
+	CRecordStreamReader reader(fileData + sizeof(recordStreamHdr_t), hdr->streamSize);
+
+	DkList<replayObject_t> objects;
+	DkList<const char*> constNames;
+	DkList<int> constIds;
+
+	numRepeats = max(numRepeats, 1);
+
+	// every declaration takes more than a byte of stream, so no valid id is above that
+	int maxObjectId = hdr->streamSize;
+	bool valid = true;
+
+	int numFrames = 0;
+	double totalTime = 0.0;
+	double minFrameTime = 1000.0;
+	double maxFrameTime = 0.0;
+
+	CEqTimer timer;
+	timer.GetTime(true);
+
+	for(int r = 0; r < numRepeats && valid; r++)
+	{
+		reader.Rewind();
+
+		while(valid && !reader.IsEnd())
+		{
+			ERecordCommand cmd = (ERecordCommand)reader.ReadCmd();
+
+			switch(cmd)
+			{
+				case RCMD_FRAME_END:
+				{
+					api->Finish();
+
+					double frameTime = timer.GetTime(true);
+
+					totalTime += frameTime;
+					minFrameTime = min(minFrameTime, frameTime);
+					maxFrameTime = max(maxFrameTime, frameTime);
+					numFrames++;
+					break;
+				}
+				case RCMD_DECLARE_VERTEXFORMAT:
+				case RCMD_DECLARE_VERTEXBUFFER:
+				case RCMD_DECLARE_INDEXBUFFER:
+				case RCMD_DECLARE_TEXTURE:
+				case RCMD_DECLARE_SHADER:
+				case RCMD_DECLARE_RENDERSTATE:
+					valid = Replay_DeclareObject(api, reader, cmd, objects, maxObjectId);
+					break;
+				case RCMD_DECLARE_CONSTANT:
+				{
+					int id = reader.ReadInt();
+					const char* name = reader.ReadString();
+
+					if(id < 0 || id > maxObjectId)
+					{
+						MsgError("Replay: invalid constant id %d\n", id);
+						valid = false;
+						break;
+					}
+
+					// constants that weren't declared have no names
+					while(id >= constNames.numElem())
+					{
+						constNames.append(NULL);
+						constIds.append(-1);
+					}
+
+					constNames[id] = name;
+					constIds[id] = -1;
+					break;
+				}
+				case RCMD_DESTROY:
+				{
+					int id = reader.ReadInt();
+
+					replayObject_t* obj = Replay_GetObject(objects, id);
+
+					if(obj)
+						Replay_DestroyObject(api, *obj);
+					break;
+				}
+				case RCMD_SET_SHADER:
+				{
+					int id = reader.ReadInt();
+					api->SetShader((IShaderProgram*)Replay_GetObjectPtr(objects, id, RCMD_DECLARE_SHADER));
+					break;
+				}
+				case RCMD_SET_TEXTURE:
+				case RCMD_SET_VERTEXTEXTURE:
+				{
+					int unit = reader.ReadInt();
+					int id = reader.ReadInt();
+
+					if(unit < 0 || unit >= (cmd == RCMD_SET_VERTEXTEXTURE ? MAX_VERTEXTEXTURES : MAX_TEXTUREUNIT))
+						break;
+
+					// vertex texture units are negative
+					if(cmd == RCMD_SET_VERTEXTEXTURE)
+						unit = unit - (MAX_VERTEXTEXTURES+1);
+
+					api->SetTexture((ITexture*)Replay_GetObjectPtr(objects, id, RCMD_DECLARE_TEXTURE), NULL, unit);
+					break;
+				}
+				case RCMD_SET_RENDERSTATE:
+				{
+					int type = reader.ReadInt();
+					int id = reader.ReadInt();
+					IRenderState* state = (IRenderState*)Replay_GetObjectPtr(objects, id, RCMD_DECLARE_RENDERSTATE);
+
+					if(state && state->GetType() != type)
+						state = NULL;
+
+					if(type == RENDERSTATE_BLENDING)
+						api->SetBlendingState(state);
+					else if(type == RENDERSTATE_DEPTHSTENCIL)
+						api->SetDepthStencilState(state);
+					else if(type == RENDERSTATE_RASTERIZER)
+						api->SetRasterizerState(state);
+					break;
+				}
+				case RCMD_SET_VERTEXFORMAT:
+				{
+					int id = reader.ReadInt();
+					api->SetVertexFormat((IVertexFormat*)Replay_GetObjectPtr(objects, id, RCMD_DECLARE_VERTEXFORMAT));
+					break;
+				}
+				case RCMD_SET_VERTEXBUFFER:
+				{
+					int stream = reader.ReadInt();
+					int id = reader.ReadInt();
+					int offset = reader.ReadInt();
+
+					if(stream >= 0 && stream < MAX_VERTEXSTREAM)
+						api->SetVertexBuffer((IVertexBuffer*)Replay_GetObjectPtr(objects, id, RCMD_DECLARE_VERTEXBUFFER), stream, offset);
+					break;
+				}
+				case RCMD_SET_INDEXBUFFER:
+				{
+					int id = reader.ReadInt();
+					api->SetIndexBuffer((IIndexBuffer*)Replay_GetObjectPtr(objects, id, RCMD_DECLARE_INDEXBUFFER));
+					break;
+				}
+				case RCMD_SET_RENDERTARGETS:
+				{
+					ITexture* targets[MAX_MRTS];
+					int cubeFaces[MAX_MRTS];
+
+					int numRTs = clamp(reader.ReadInt(), 0, MAX_MRTS);
+
+					for(int i = 0; i < numRTs; i++)
+					{
+						int id = reader.ReadInt();
+						targets[i] = (ITexture*)Replay_GetObjectPtr(objects, id, RCMD_DECLARE_TEXTURE);
+						cubeFaces[i] = reader.ReadInt();
+					}
+
+					int depthId = reader.ReadInt();
+					int depthSlice = reader.ReadInt();
+
+					api->ChangeRenderTargets(targets, numRTs, cubeFaces, (ITexture*)Replay_GetObjectPtr(objects, depthId, RCMD_DECLARE_TEXTURE), depthSlice);
+					break;
+				}
+				case RCMD_SET_BACKBUFFER:
+					api->ChangeRenderTargetToBackBuffer();
+					break;
+				case RCMD_SET_VIEWPORT:
+				{
+					int x = reader.ReadInt();
+					int y = reader.ReadInt();
+					int w = reader.ReadInt();
+					int h = reader.ReadInt();
+					api->SetViewport(x, y, w, h);
+					break;
+				}
+				case RCMD_SET_SCISSOR:
+				{
+					IRectangle rect;
+					rect.vleftTop.x = reader.ReadInt();
+					rect.vleftTop.y = reader.ReadInt();
+					rect.vrightBottom.x = reader.ReadInt();
+					rect.vrightBottom.y = reader.ReadInt();
+					api->SetScissorRectangle(rect);
+					break;
+				}
+				case RCMD_SET_DEPTHRANGE:
+				{
+					float zNear = reader.ReadFloat();
+					float zFar = reader.ReadFloat();
+					api->SetDepthRange(zNear, zFar);
+					break;
+				}
+				case RCMD_MATRIX_MODE:
+				{
+					int mode = reader.ReadInt();
+
+					if(mode >= MATRIXMODE_VIEW && mode <= MATRIXMODE_TEXTURE)
+						api->SetMatrixMode((ER_MatrixMode)mode);
+					break;
+				}
+				case RCMD_MATRIX_PUSH:
+					api->PushMatrix();
+					break;
+				case RCMD_MATRIX_POP:
+					api->PopMatrix();
+					break;
+				case RCMD_MATRIX_IDENTITY:
+					api->LoadIdentityMatrix();
+					break;
+				case RCMD_MATRIX_LOAD:
+				{
+					Matrix4x4 mat;
+					const void* data = reader.ReadBytes(sizeof(Matrix4x4));
+
+					if(data)
+					{
+						memcpy(&mat, data, sizeof(Matrix4x4));
+						api->LoadMatrix(mat);
+					}
+					break;
+				}
+				case RCMD_SET_CONSTANT:
+				{
+					int id = reader.ReadInt();
+					int size = reader.ReadInt();
+					const void* data = reader.ReadBytes(size);
+
+					if(data && id >= 0 && id < constNames.numElem() && constNames[id])
+						constIds[id] = api->SetShaderConstantRaw(constNames[id], data, size, constIds[id]);
+					break;
+				}
+				case RCMD_UPDATE_BUFFER:
+				{
+					int id = reader.ReadInt();
+					int offset = reader.ReadInt();
+					int size = reader.ReadInt();
+					void* data = (void*)reader.ReadBytes(size);
+
+					replayObject_t* objPtr = Replay_GetObject(objects, id);
+
+					if(!data || !objPtr || !objPtr->ptr)
+						break;
+
+					replayObject_t& obj = *objPtr;
+
+					// buffer declaration guarantees stride, updates must fit the buffer
+					if(offset < 0 || (int64)offset + size > (int64)obj.numElems*obj.stride)
+						break;
+
+					if(obj.type == RCMD_DECLARE_VERTEXBUFFER)
+						((IVertexBuffer*)obj.ptr)->Update(data, size / obj.stride, offset / obj.stride, offset == 0);
+					else if(obj.type == RCMD_DECLARE_INDEXBUFFER)
+						((IIndexBuffer*)obj.ptr)->Update(data, size / obj.stride, offset / obj.stride, offset == 0);
+					break;
+				}
+				case RCMD_CLEAR:
+				{
+					int flags = reader.ReadInt();
+					ColorRGBA color;
+					const void* data = reader.ReadBytes(sizeof(ColorRGBA));
+					float depth = reader.ReadFloat();
+					int stencil = reader.ReadInt();
+
+					if(data)
+					{
+						memcpy(&color, data, sizeof(ColorRGBA));
+						api->Clear((flags & 1) != 0, (flags & 2) != 0, (flags & 4) != 0, color, depth, stencil);
+					}
+					break;
+				}
+				case RCMD_DRAW_INDEXED:
+				{
+					ER_PrimitiveType primType = (ER_PrimitiveType)reader.ReadInt();
+					int firstIndex = reader.ReadInt();
+					int numIndices = reader.ReadInt();
+					int firstVertex = reader.ReadInt();
+					int numVertices = reader.ReadInt();
+					int baseVertex = reader.ReadInt();
+
+					if(primType < PRIM_TRIANGLES || primType > PRIM_POINTS)
+						break;
+
+					api->Apply();
+					api->DrawIndexedPrimitives(primType, firstIndex, numIndices, firstVertex, numVertices, baseVertex);
+					break;
+				}
+				case RCMD_DRAW:
+				{
+					ER_PrimitiveType primType = (ER_PrimitiveType)reader.ReadInt();
+					int firstVertex = reader.ReadInt();
+					int numVertices = reader.ReadInt();
+
+					if(primType < PRIM_TRIANGLES || primType > PRIM_POINTS)
+						break;
+
+					api->Apply();
+					api->DrawNonIndexedPrimitives(primType, firstVertex, numVertices);
+					break;
+				}
+				default:
+				{
+					MsgError("Replay: invalid command %d, stopped\n", cmd);
+					valid = false;
+					break;
+				}
+			}
+		}
+	}
+
+	// restore state and release everything replay has created
+	api->Reset(STATE_RESET_ALL);
+	api->ChangeRenderTargetToBackBuffer();
+	api->Apply();
+
+	for(int i = 0; i < objects.numElem(); i++)
+		Replay_DestroyObject(api, objects[i]);
+
+	PPFree(fileData);
+
+	if(numFrames)
+	{
+		MsgInfo("Replayed '%s': %d frames, avg %.3f ms, min %.3f ms, max %.3f ms\n", pszFileName, numFrames,
+			(totalTime / numFrames) * 1000.0, minFrameTime * 1000.0, maxFrameTime * 1000.0);
+	}
+
+	return valid;
+}
@@ -0,0 +1,295 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Recording ShaderAPI. Works like Empty ShaderAPI but writes every
+//				state change, constant, buffer upload and draw call into a
+//				command stream that can be saved and replayed for benchmarks
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHADERAPIRECORDER_H
+#define SHADERAPIRECORDER_H
+
+#include "ShaderAPIEmpty.h"
+
+#include <unordered_map>
+
+#define RECORD_STREAM_IDENT		MCHAR4('R','H','I','R')
+#define RECORD_STREAM_VERSION	1
+
+// command stream opcodes
+enum ERecordCommand
+{
+	RCMD_FRAME_END = 0,				//
+
+	// object declarations. Objects are declared at their first use in recording
+	RCMD_DECLARE_VERTEXFORMAT,		// id, numAttribs, [streamId, elemCount, attribType, attribFormat, name]
+	RCMD_DECLARE_VERTEXBUFFER,		// id, numVerts, stride, data
+	RCMD_DECLARE_INDEXBUFFER,		// id, numIndices, indexSize, data
+	RCMD_DECLARE_TEXTURE,			// id, width, height, format, flags, name
+	RCMD_DECLARE_SHADER,			// id, name
+	RCMD_DECLARE_RENDERSTATE,		// id, type, desc
+	RCMD_DECLARE_CONSTANT,			// id, name
+	RCMD_DESTROY,					// id
+
+	// state
+	RCMD_SET_SHADER,				// id
+	RCMD_SET_TEXTURE,				// unit, id
+	RCMD_SET_VERTEXTEXTURE,			// unit, id
+	RCMD_SET_RENDERSTATE,			// type, id
+	RCMD_SET_VERTEXFORMAT,			// id
+	RCMD_SET_VERTEXBUFFER,			// stream, id, offset
+	RCMD_SET_INDEXBUFFER,			// id
+	RCMD_SET_RENDERTARGETS,			// numRTs, [id, cubeFace], depth id, depth slice
+	RCMD_SET_BACKBUFFER,			//
+	RCMD_SET_VIEWPORT,				// x, y, w, h
+	RCMD_SET_SCISSOR,				// left, top, right, bottom
+	RCMD_SET_DEPTHRANGE,			// near, far
+
+	// matrices
+	RCMD_MATRIX_MODE,				// mode
+	RCMD_MATRIX_PUSH,				//
+	RCMD_MATRIX_POP,				//
+	RCMD_MATRIX_IDENTITY,			//
+	RCMD_MATRIX_LOAD,				// matrix
+
+	// data
+	RCMD_SET_CONSTANT,				// constant id, size, data
+	RCMD_UPDATE_BUFFER,				// id, byte offset, size, data
+
+	// drawing
+	RCMD_CLEAR,						// flags, color, depth, stencil
+	RCMD_DRAW_INDEXED,				// primType, firstIndex, numIndices, firstVertex, numVertices, baseVertex
+	RCMD_DRAW,						// primType, firstVertex, numVertices
+
+	RCMD_COUNT,
+};
+
+struct recordStreamHdr_t
+{
+	int		ident;
+	int		version;
+	int		numFrames;
+	int		streamSize;
+};
+
+// per-frame counters
+struct recordFrameStats_t
+{
+	int		drawCalls;
+	int		primitives;
+
+	int		stateChanges;		// all below changes
+	int		shaderChanges;
+	int		textureChanges;
+	int		renderStateChanges;
+	int		bufferChanges;		// vertex format, vertex and index buffers
+	int		targetChanges;
+
+	int		constantUpdates;
+
+	int64	bufferBytes;		// uploaded vertex and index data
+	int64	constantBytes;
+	int		commandBytes;		// recorded stream size of the frame
+
+	void	Reset()				{memset(this, 0, sizeof(recordFrameStats_t));}
+	void	Add(const recordFrameStats_t& s);
+};
+
+//--------------------------------------------------------------------------------
+// objects. Those are only carrying the descriptions needed for the recording
+//--------------------------------------------------------------------------------
+
+class CRecorderRenderState : public IRenderState
+{
+public:
+	CRecorderRenderState(RenderStateType_e type, const void* desc, int descSize) : m_type(type), m_descSize(descSize)
+	{
+		memcpy(m_desc, desc, descSize);
+	}
+
+	RenderStateType_e	GetType()		{return m_type;}
+	void*				GetDescPtr()	{return m_desc;}
+
+	RenderStateType_e	m_type;
+	int					m_descSize;
+	ubyte				m_desc[64];
+};
+
+class CRecorderShaderProgram : public IShaderProgram
+{
+public:
+	const char*			GetName()						{return m_name.ToCString();}
+	void				SetName(const char* pszName)	{m_name = pszName;}
+
+	int					GetConstantsNum()				{return 0;}
+	int					GetSamplersNum()				{return 0;}
+
+	EqString			m_name;
+};
+
+class CRecorderVertexBuffer : public CEmptyVertexBuffer
+{
+public:
+				CRecorderVertexBuffer(int numVerts, int stride) : CEmptyVertexBuffer(numVerts, stride) {}
+
+	void		Update(void* data, int size, int offset, bool discard = true);
+	void		Unlock();
+};
+
+class CRecorderIndexBuffer : public CEmptyIndexBuffer
+{
+public:
+				CRecorderIndexBuffer(int numIndices, int stride) : CEmptyIndexBuffer(numIndices, stride) {}
+
+	void		Update(void* data, int size, int offset, bool discard = true);
+	void		Unlock();
+};
+
+//--------------------------------------------------------------------------------
+
+class ShaderAPIRecorder : public ShaderAPIEmpty
+{
+	friend class CRecorderVertexBuffer;
+	friend class CRecorderIndexBuffer;
+public:
+								ShaderAPIRecorder();
+								~ShaderAPIRecorder();
+
+	void						Init(shaderAPIParams_t &params);
+	void						Shutdown();
+
+	const char*					GetRendererName() const {return "Recorder";}
+
+//-------------------------------------------------------------
+// Recording
+//-------------------------------------------------------------
+
+	// starts recording. maxFrames <= 0 records until StopRecording
+	void						StartRecording(int maxFrames = 0);
+	void						StopRecording();
+
+	bool						IsRecording() const {return m_recording;}
+
+	// saves recorded stream to file
+	bool						SaveRecording(const char* pszFileName);
+
+	// replays saved stream on the specified ShaderAPI. Returns false if stream is invalid
+	static bool					ReplayRecording(IShaderAPI* targetApi, const char* pszFileName, int numRepeats = 1);
+
+	// called by render library at the end of the frame
+	void						EndFrame();
+
+	const recordFrameStats_t&	GetLastFrameStats() const {return m_lastFrameStats;}
+	void						PrintStats();
+
+//-------------------------------------------------------------
+// Rendering's applies
+//-------------------------------------------------------------
+
+	void						ApplyTextures();
+	void						ApplyBlendState();
+	void						ApplyDepthState();
+	void						ApplyRasterizerState();
+	void						ApplyShaderProgram();
+
+	void						SetShader(IShaderProgram* pShader) {m_pSelectedShader = pShader;}
+	void						SetTexture(ITexture* pTexture, const char* pszName, int index) {SetTextureOnIndex(pTexture, index);}
+
+	void						Clear(bool bClearColor, bool bClearDepth, bool bClearStencil, const ColorRGBA &fillColor,float fDepth, int nStencil);
+
+	void						SetViewport(int x, int y, int w, int h);
+	void						SetScissorRectangle( const IRectangle &rect );
+	void						SetDepthRange(float fZNear,float fZFar);
+
+	void						ChangeRenderTargets(ITexture** pRenderTargets, int nNumRTs, int* nCubemapFaces = NULL, ITexture* pDepthTarget = NULL, int nDepthSlice = 0);
+	void						ChangeRenderTargetToBackBuffer();
+
+	void						SetMatrixMode(ER_MatrixMode nMatrixMode);
+	void						PushMatrix();
+	void						PopMatrix();
+	void						LoadIdentityMatrix();
+	void						LoadMatrix(const Matrix4x4 &matrix);
+
+	void						ChangeVertexFormat(IVertexFormat* pVertexFormat);
+	void						ChangeVertexBuffer(IVertexBuffer* pVertexBuffer,int nStream, const intptr offset = 0);
+	void						ChangeIndexBuffer(IIndexBuffer* pIndexBuffer);
+
+//-------------------------------------------------------------
+// Objects
+//-------------------------------------------------------------
+
+	void						FreeTexture(ITexture* pTexture);
+
+	IRenderState*				CreateBlendingState( const BlendStateParam_t &blendDesc );
+	IRenderState*				CreateDepthStencilState( const DepthStencilStateParams_t &depthDesc );
+	IRenderState*				CreateRasterizerState( const RasterizerStateParams_t &rasterDesc );
+	void						DestroyRenderState( IRenderState* pState, bool removeAllRefs = false);
+
+	IShaderProgram*				FindShaderProgram(const char* pszName, const char* query = NULL) {return ShaderAPI_Base::FindShaderProgram(pszName, query);}
+	IShaderProgram*				CreateNewShaderProgram(const char* pszName, const char* query = NULL);
+	void						DestroyShaderProgram(IShaderProgram* pShaderProgram);
+
+	IVertexFormat*				CreateVertexFormat(VertexFormatDesc_s *formatDesc, int nAttribs);
+	IVertexBuffer*				CreateVertexBuffer(ER_BufferAccess nBufAccess, int nNumVerts, int strideSize, void *pData = NULL);
+	IIndexBuffer*				CreateIndexBuffer(int nIndices, int nIndexSize, ER_BufferAccess nBufAccess, void *pData = NULL);
+
+	void						DestroyVertexFormat(IVertexFormat* pFormat);
+	void						DestroyVertexBuffer(IVertexBuffer* pVertexBuffer);
+	void						DestroyIndexBuffer(IIndexBuffer* pIndexBuffer);
+
+//-------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------
+
+	int							SetShaderConstantRaw(const char *pszName, const void *data, int nSize, int nConstID);
+
+//-------------------------------------------------------------
+// Drawing
+//-------------------------------------------------------------
+
+	void						DrawIndexedPrimitives(ER_PrimitiveType nType, int nFirstIndex, int nIndices, int nFirstVertex, int nVertices, int nBaseVertex = 0);
+	void						DrawNonIndexedPrimitives(ER_PrimitiveType nType, int nFirstVertex, int nVertices);
+
+protected:
+	void						OnBufferUpload(void* buffer, int byteOffset, const void* data, int size);
+
+	// returns id of the object, declares it in stream if needed. m_recordMutex must be locked
+	uint						GetObjectId(void* object, ERecordCommand declType);
+	void						OnObjectDestroyed(void* object);
+
+	// writes all currently applied states. m_recordMutex must be locked
+	void						WriteCurrentState();
+
+	// stream writing. m_recordMutex must be locked
+	void						WriteBytes(const void* data, int size);
+	void						WriteCmd(ERecordCommand cmd)	{ubyte c = cmd; WriteBytes(&c, 1);}
+	void						WriteInt(int value)				{WriteBytes(&value, sizeof(int));}
+	void						WriteFloat(float value)			{WriteBytes(&value, sizeof(float));}
+	void						WriteString(const char* str);
+
+	// stream
+	ubyte*						m_stream;
+	int							m_streamSize;
+	int							m_streamAllocated;
+	int							m_frameStreamStart;
+	int							m_numFrames;
+	int							m_maxFrames;
+	bool						m_recording;
+	bool						m_startPending;
+
+	std::unordered_map<void*, uint>	m_objectIds;
+	uint						m_nextObjectId;
+
+	std::unordered_map<int, uint>	m_constantIds;	// constant handle to declared constant
+
+	CEqMutex					m_recordMutex;
+
+	// stats
+	recordFrameStats_t			m_frameStats;
+	recordFrameStats_t			m_lastFrameStats;
+	recordFrameStats_t			m_totalStats;
+	int							m_totalFrames;
+};
+
+#endif // SHADERAPIRECORDER_H
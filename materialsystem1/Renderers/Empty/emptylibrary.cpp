@@ -10,7 +10,8 @@
 #include "core/IConsoleCommands.h"
 
 #include "emptyLibrary.h"
-#include "ShaderAPIEmpty.h"
+#include "ShaderAPIRecorder.h"
+#include "core/ICommandLine.h"
 
 HOOK_TO_CVAR(r_screen);
 
@@ -36,7 +37,11 @@ bool CEmptyRenderLib::InitCaps()
 
 bool CEmptyRenderLib::InitAPI( shaderAPIParams_t &params)
 {
-	m_Renderer = new ShaderAPIEmpty();
+	// recording renderer is used for render benchmarks
+	if(g_cmdLine->FindArgument("-rhirecord") != -1)
+		m_Renderer = new ShaderAPIRecorder();
+	else
+		m_Renderer = new ShaderAPIEmpty();
 	m_Renderer->Init(params);
 
 	g_pShaderAPI = m_Renderer;
@@ -60,7 +65,8 @@ void CEmptyRenderLib::BeginFrame()
 
 void CEmptyRenderLib::EndFrame(IEqSwapChain* swapChain)
 {
-
+	if(!stricmp(m_Renderer->GetRendererName(), "Recorder"))
+		((ShaderAPIRecorder*)m_Renderer)->EndFrame();
 }
 
 void CEmptyRenderLib::SetBackbufferSize(const int w, const int h)
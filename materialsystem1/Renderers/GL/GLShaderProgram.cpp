@@ -36,3 +36,26 @@ CGLShaderProgram::~CGLShaderProgram()
 	}
 		
 }
+
+// returns constant index by name, -1 if not found
+int CGLShaderProgram::FindConstant(const char* pszName) const
+{
+	int minUniform = 0;
+	int maxUniform = m_numConstants - 1;
+
+	// Do a quick lookup in the sorted table with a binary search
+	while (minUniform <= maxUniform)
+	{
+		int currUniform = (minUniform + maxUniform) >> 1;
+		int res = strcmp(pszName, m_constants[currUniform].name);
+
+		if (res == 0)
+			return currUniform;
+		else if (res > 0)
+			minUniform = currUniform + 1;
+		else
+			maxUniform = currUniform - 1;
+	}
+
+	return -1;
+}
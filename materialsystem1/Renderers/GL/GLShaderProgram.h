@@ -13,6 +13,8 @@
 
 #include "utils/eqstring.h"
 
+#include "../Shared/ShaderConstantMap.h"
+
 #ifdef USE_GLES2
 #include <glad_es3.h>
 #else
@@ -51,6 +53,9 @@ public:
 	int						GetConstantsNum() {return m_numConstants;}
 	int						GetSamplersNum() {return m_numSamplers;}
 
+	// returns constant index by name, -1 if not found
+	int						FindConstant(const char* pszName) const;
+
 protected:
 	EqString				m_szName;
 
@@ -66,6 +71,8 @@ protected:
 
 	int						m_numConstants;
 	int						m_numSamplers;
+
+	CShaderConstantMap		m_constantMap;
 };
 
 #endif //GLSHADERPROGRAM_H
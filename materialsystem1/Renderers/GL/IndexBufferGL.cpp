@@ -27,6 +27,7 @@ extern bool GLCheckError(const char* op);
 CIndexBufferGL::CIndexBufferGL()
 {
 	m_nIndices = 0;
+	m_allocatedIndices = 0;
 	m_nIndexSize = 0;
 
 	m_bIsLocked = false;
@@ -79,16 +80,27 @@ void CIndexBufferGL::Update(void* data, int size, int offset, bool discard /*= t
 
 	CIndexBufferGL* currIB = (CIndexBufferGL*)g_shaderApi.m_pCurrentIndexBuffer;
 
-	if(offset > 0)
+	bool orphan = dynamic && discard;
+
+	if(orphan)
+	{
+		// switch buffer so draws from the previous contents aren't stalled
 		IncrementBuffer();
 
+		if(offset+size > m_allocatedIndices)
+			m_allocatedIndices = offset+size;
+	}
+
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GetCurrentBuffer());
 	GLCheckError("indexbuffer update bind");
 
-	if (offset > 0) // streaming
+	if (orphan) // orphaning, keep whole storage for the following no-overwrite updates
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_allocatedIndices*m_nIndexSize, NULL, glBufferUsages[m_access]);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset*m_nIndexSize, size*m_nIndexSize, data);
+	}
+	else // streaming, caller guarantees that range is not used by pending draws
 		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset*m_nIndexSize, size*m_nIndexSize, data);
-	else // orphaning
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, size*m_nIndexSize, data, glBufferUsages[m_access]);
 
 	GLCheckError("indexbuffer update");
 
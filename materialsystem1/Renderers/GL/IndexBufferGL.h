@@ -44,6 +44,7 @@ protected:
 	int				m_bufferIdx;
 
 	uint			m_nIndices;
+	int				m_allocatedIndices;
 	ER_BufferAccess	m_access;
 
 	ubyte*			m_lockPtr;
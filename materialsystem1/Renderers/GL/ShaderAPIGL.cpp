@@ -929,7 +929,7 @@ void ShaderAPIGL::FreeTexture(ITexture* pTexture)
 	{
 		DevMsg(DEVMSG_SHADERAPI,"Texture unloaded: %s\n",pTex->GetName());
 
-		m_TextureList.remove(pTexture);
+		RemoveTextureFromList(pTexture);
 		delete pTex;
 	}
 }
@@ -988,7 +988,7 @@ ITexture* ShaderAPIGL::CreateNamedRenderTarget(	const char* pszName,
 	// this generates the render target
 	ResizeRenderTarget(pTexture, width,height);
 	
-	m_TextureList.append(pTexture);
+	AddTextureToList(pTexture);
 	m_Mutex.Unlock();
 
 	return pTexture;
@@ -1137,10 +1137,19 @@ GLTextureRef_t ShaderAPIGL::CreateGLTextureFromImage(CImage* pSrc, const Sampler
 	return texture;
 }
 
-void ShaderAPIGL::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
+void ShaderAPIGL::ReleaseTextureInternal(ITexture* pTexture)
+{
+	CGLTexture* pTex = (CGLTexture*)pTexture;
+
+	pTex->ReleaseTextures();
+	pTex->textures.clear();
+	pTex->m_texSize = 0;
+}
+
+bool ShaderAPIGL::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags)
 {
 	if(!pImages.numElem())
-		return;
+		return false;
 
 	CGLTexture* pTexture = NULL;
 
@@ -1153,6 +1162,10 @@ void ShaderAPIGL::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>&
 	int wide = 0, tall = 0;
 	int mipCount = 0;
 
+	// images are created aside, so re-created texture keeps the current ones on failure
+	DkList<GLTextureRef_t> textures;
+	int texSize = 0;
+
 	for(int i = 0; i < pImages.numElem(); i++)
 	{
 		SamplerStateParam_t ss = sampler;
@@ -1183,21 +1196,28 @@ void ShaderAPIGL::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>&
 
 			mipCount += pImages[i]->GetMipMapCount()-nQuality;
 
-			pTexture->m_texSize += pImages[i]->GetMipMappedSize(nQuality);
-			pTexture->textures.append(textureRef);
+			texSize += pImages[i]->GetMipMappedSize(nQuality);
+			textures.append(textureRef);
 		}
 	}
 
-	if(!pTexture->textures.numElem())
+	if(!textures.numElem())
 	{
 		if(!(*pTex))
 			delete pTexture;
-		else
+		else if(!pTexture->textures.numElem())
 			FreeTexture(pTexture);
 
-		return;
+		return false;
 	}
 
+	// replace images of re-created texture
+	if(pTexture->textures.numElem())
+		ReleaseTextureInternal(pTexture);
+
+	pTexture->textures.append(textures);
+	pTexture->m_texSize = texSize;
+
 	pTexture->m_numAnimatedTextureFrames = pTexture->textures.numElem();
 
 	// Bind this sampler state to texture
@@ -1214,12 +1234,14 @@ void ShaderAPIGL::CreateTextureInternal(ITexture** pTex, const DkList<CImage*>&
 	if(!(*pTex))
 	{
 		m_Mutex.Lock();
-		m_TextureList.append(pTexture);
+		AddTextureToList(pTexture);
 		m_Mutex.Unlock();
 	}
 
 	// set for output
 	*pTex = pTexture;
+
+	return true;
 }
 
 void ShaderAPIGL::SetupGLSamplerState(uint texTarget, const SamplerStateParam_t& sampler, int mipMapCount)
@@ -1780,34 +1802,11 @@ IShaderProgram* ShaderAPIGL::CreateNewShaderProgram(const char* pszName, const c
 
 	CScopedMutex scoped(m_Mutex);
 
-	m_ShaderList.append(pNewProgram);
+	AddShaderProgramToList(pNewProgram);
 
 	return pNewProgram;
 }
 
-// search for existing shader program
-IShaderProgram* ShaderAPIGL::FindShaderProgram(const char* pszName, const char* query)
-{
-	CScopedMutex m(m_Mutex);
-
-	for(int i = 0; i < m_ShaderList.numElem(); i++)
-	{
-		char findtext[1024];
-		findtext[0] = '\0';
-		strcpy(findtext, pszName);
-
-		if(query)
-			strcat(findtext, query);
-
-		if(!stricmp(m_ShaderList[i]->GetName(), findtext))
-		{
-			return m_ShaderList[i];
-		}
-	}
-
-	return NULL;
-}
-
 // Destroy all shader
 void ShaderAPIGL::DestroyShaderProgram(IShaderProgram* pShaderProgram)
 {
@@ -1823,7 +1822,7 @@ void ShaderAPIGL::DestroyShaderProgram(IShaderProgram* pShaderProgram)
 	// remove it if reference is zero
 	if(pShader->Ref_Count() <= 0)
 	{
-		m_ShaderList.remove(pShader);
+		RemoveShaderProgramFromList(pShader);
 
 		glWorker.Execute([pShader]() {
 			delete pShader;
@@ -2218,6 +2217,8 @@ bool ShaderAPIGL::CompileShadersFromStream(	IShaderProgram* pShaderOutput,const
 			prog->m_numSamplers = nSamplers;
 			prog->m_numConstants = nUniforms;
 
+			prog->m_constantMap.Clear();
+
 			return 0;
 		});
 
@@ -2244,37 +2245,36 @@ int ShaderAPIGL::SetShaderConstantRaw(const char *pszName, const void *data, int
 
 	CGLShaderProgram* prog = (CGLShaderProgram*)m_pSelectedShader;
 
-	int minUniform = 0;
-	int maxUniform = prog->m_numConstants - 1;
-	GLShaderConstant_t* uniforms = prog->m_constants;
+	if(nConstId < 0)
+		nConstId = GetShaderConstantHandle(pszName);
 
-	// Do a quick lookup in the sorted table with a binary search
-	while (minUniform <= maxUniform)
-	{
-		int currUniform = (minUniform + maxUniform) >> 1;
-		int res = strcmp(pszName, uniforms[currUniform].name);
+	if(nConstId < 0)
+		return -1;
 
-		if (res == 0)
-		{
-			GLShaderConstant_t *uni = uniforms + currUniform;
+	// name lookup is only done once per program and handle
+	int index = prog->m_constantMap.Get(nConstId);
 
-			if (memcmp(uni->data, data, nSize))
-			{
-				memcpy(uni->data, data, nSize);
-				uni->dirty = true;
-			}
+	if(index == SHADERCONST_UNRESOLVED)
+	{
+		index = prog->FindConstant(GetShaderConstantName(nConstId));
+		prog->m_constantMap.Set(nConstId, index);
+	}
 
-			return currUniform;
-		}
-		else if (res > 0)
-			minUniform = currUniform + 1;
-		else
-			maxUniform = currUniform - 1;
+	if(index == -1)
+	{
+		//MsgError("[SHADER] error: constant '%s' not found\n", pszName);
+		return nConstId;
 	}
 
-	//MsgError("[SHADER] error: constant '%s' not found\n", pszName);
+	GLShaderConstant_t *uni = prog->m_constants + index;
 
-	return -1;
+	if (memcmp(uni->data, data, nSize))
+	{
+		memcpy(uni->data, data, nSize);
+		uni->dirty = true;
+	}
+
+	return nConstId;
 }
 
 //-------------------------------------------------------------
@@ -2297,6 +2297,7 @@ IVertexBuffer* ShaderAPIGL::CreateVertexBuffer(ER_BufferAccess nBufAccess, int n
 	CVertexBufferGL* pVB = new CVertexBufferGL();
 
 	pVB->m_numVerts = nNumVerts;
+	pVB->m_allocatedVerts = nNumVerts;
 	pVB->m_strideSize = strideSize;
 	pVB->m_access = nBufAccess;
 
@@ -2343,6 +2344,7 @@ IIndexBuffer* ShaderAPIGL::CreateIndexBuffer(int nIndices, int nIndexSize, ER_Bu
 	CIndexBufferGL* pIB = new CIndexBufferGL();
 
 	pIB->m_nIndices = nIndices;
+	pIB->m_allocatedIndices = nIndices;
 	pIB->m_nIndexSize = nIndexSize;
 	pIB->m_access = nBufAccess;
 
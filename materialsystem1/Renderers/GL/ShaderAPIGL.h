@@ -304,9 +304,6 @@ public:
 // Shaders and it's operations
 //-------------------------------------------------------------
 
-	// search for existing shader program
-	IShaderProgram*		FindShaderProgram(const char* pszName, const char* query = NULL);
-
 	// Creates shader class for needed ShaderAPI
 	IShaderProgram*		CreateNewShaderProgram(const char* pszName, const char* query = NULL);
 
@@ -345,7 +342,8 @@ public:
 
 protected:
 
-	void				CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags = 0);
+	bool				CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler,int nFlags = 0);
+	void				ReleaseTextureInternal(ITexture* pTexture);
 	GLTextureRef_t		CreateGLTextureFromImage(CImage* pSrc, const SamplerStateParam_t& sampler, int& wide, int& tall, int nFlags);
 
 	// prepares for async operation (required to be called in main thread)
@@ -28,6 +28,7 @@ extern bool GLCheckError(const char* op);
 CVertexBufferGL::CVertexBufferGL()
 {
 	m_numVerts = 0;
+	m_allocatedVerts = 0;
 	m_strideSize = 0;
 
 	m_bIsLocked = false;
@@ -90,16 +91,27 @@ void CVertexBufferGL::Update(void* data, int size, int offset, bool discard /*=
 		return;
 	}
 
-	if (offset > 0)
+	bool orphan = dynamic && discard;
+
+	if (orphan)
+	{
+		// switch buffer so draws from the previous contents aren't stalled
 		IncrementBuffer();
 
+		if (offset+size > m_allocatedVerts)
+			m_allocatedVerts = offset+size;
+	}
+
 	glBindBuffer(GL_ARRAY_BUFFER, GetCurrentBuffer());
 	GLCheckError("vertexbuffer update bind");
 
-	if (offset > 0) // streaming
+	if (orphan) // orphaning, keep whole storage for the following no-overwrite updates
+	{
+		glBufferData(GL_ARRAY_BUFFER, m_allocatedVerts*m_strideSize, NULL, glBufferUsages[m_access]);
+		glBufferSubData(GL_ARRAY_BUFFER, offset*m_strideSize, size*m_strideSize, data);
+	}
+	else // streaming, caller guarantees that range is not used by pending draws
 		glBufferSubData(GL_ARRAY_BUFFER, offset*m_strideSize, size*m_strideSize, data);
-	else // orphaning
-		glBufferData(GL_ARRAY_BUFFER, size*m_strideSize, data, glBufferUsages[m_access]);
 
 	GLCheckError("vertexbuffer update");
 
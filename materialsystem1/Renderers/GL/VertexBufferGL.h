@@ -51,6 +51,7 @@ protected:
 
 	int				m_flags;
 	int				m_numVerts;
+	int				m_allocatedVerts;
 	int				m_strideSize;
 	ER_BufferAccess	m_access;
 
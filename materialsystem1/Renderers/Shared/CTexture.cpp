@@ -24,6 +24,18 @@ CTexture::CTexture()
 
 	// can be one
 	m_numAnimatedTextureFrames = 1;
+
+	m_streamBindFrame = 0;
+	m_streamHintFrame = 0;
+	m_streamUsage = 0.0f;
+	m_streamSize = 0;
+	m_streamFlags = 0;
+	m_streamScreenSize = 0;
+	m_streamMipCount = 0;
+	m_streamFirstMip = 0;
+	m_streamBaseMip = 0;
+	m_streamWantedMip = 0;
+	m_streamPending = false;
 }
 
 CTexture::~CTexture()
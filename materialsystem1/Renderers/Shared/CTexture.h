@@ -59,6 +59,19 @@ protected:
 	ETextureFormat			m_iFormat;
 
 	SamplerStateParam_t		m_samplerState;
+
+	// mip streaming
+	uint					m_streamBindFrame;		// last frame this texture was bound
+	uint					m_streamHintFrame;		// frame of the last screen size hint
+	float					m_streamUsage;			// bind frequency, used as streaming priority
+	int						m_streamSize;			// resident size in bytes
+	int						m_streamFlags;			// texture flags without streaming overrides
+	ushort					m_streamScreenSize;		// screen size hint
+	ushort					m_streamMipCount;		// mip count in file, zero if texture is not streamed
+	ushort					m_streamFirstMip;		// top resident mip level
+	ushort					m_streamBaseMip;		// lowest quality top mip level which is always resident
+	ushort					m_streamWantedMip;		// top mip level required
+	bool					m_streamPending;		// mip levels are being loaded
 };
 
 #endif //CTEXTURE_H
\ No newline at end of file
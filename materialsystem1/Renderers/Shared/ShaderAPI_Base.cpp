@@ -14,6 +14,7 @@
 
 #include "core/DebugInterface.h"
 #include "core/IConsoleCommands.h"
+#include "core/ConCommand.h"
 #include "core/IFileSystem.h"
 
 #include "imaging/PixWriter.h"
@@ -27,7 +28,56 @@
 static ConVar rs_echo_texture_loading("r_echo_texture_loading","0","Echo textrue loading");
 static ConVar r_nomip("r_nomip", "0");
 
-ShaderAPI_Base::ShaderAPI_Base()
+static ConVar r_textureStreaming("r_textureStreaming", "0", "Load only low mip levels first and stream the rest, needs texture reloading", CV_ARCHIVE);
+static ConVar r_textureStreamingBudget("r_textureStreamingBudget", "256", 16, 2047, "Texture streaming memory budget in megabytes", CV_ARCHIVE);
+static ConVar r_textureStreamingBaseSize("r_textureStreamingBaseSize", "64", 4, 1024, "Size of the top mip level loaded before streaming, needs texture reloading", CV_ARCHIVE);
+static ConVar r_textureStreamingIdleFrames("r_textureStreamingIdleFrames", "300", "Not bound texture mip levels can be evicted after this frame count");
+static ConVar r_textureStreamingRequests("r_textureStreamingRequests", "8", "Max texture mip requests per frame");
+static ConVar r_textureStreamingUploads("r_textureStreamingUploads", "4", "Max streamed textures updated per frame");
+
+#define TEXSTREAM_USAGE_DECAY	0.95f
+
+DECLARE_CMD(r_textureStreamingInfo, "Prints resident and streaming textures", 0)
+{
+	((ShaderAPI_Base*)g_pShaderAPI)->PrintTextureStreamingInfo();
+}
+
+#define SHADER_VARIANTS_DEFAULT_FILE	"cfg/shader_variants.txt"
+
+DECLARE_CMD(r_shaderVariantsSave, "Saves the loaded shader permutations to the variant list file", 0)
+{
+	const char* fileName = CMD_ARGC > 0 ? CMD_ARGV(0).ToCString() : SHADER_VARIANTS_DEFAULT_FILE;
+
+	((ShaderAPI_Base*)g_pShaderAPI)->SaveShaderVariants(fileName);
+}
+
+DECLARE_CMD(r_shaderVariantsPrebuild, "Compiles the shader permutations from the variant list file and keeps them loaded", 0)
+{
+	const char* fileName = CMD_ARGC > 0 ? CMD_ARGV(0).ToCString() : SHADER_VARIANTS_DEFAULT_FILE;
+
+	((ShaderAPI_Base*)g_pShaderAPI)->PrebuildShaderVariants(fileName);
+}
+
+//
+// Texture mip levels loader thread
+//
+
+class CTextureStreamerThread : public CEqThread
+{
+public:
+	ShaderAPI_Base*	m_api;
+
+protected:
+	virtual int Run()
+	{
+		m_api->ProcessStreamingRequests();
+		return 0;
+	}
+};
+
+static CTextureStreamerThread s_textureStreamer;
+
+ShaderAPI_Base::ShaderAPI_Base() : m_textureLoadedSignal(true)
 {
 	m_nViewportWidth			= 800;
 	m_nViewportHeight			= 600;
@@ -79,6 +129,10 @@ ShaderAPI_Base::ShaderAPI_Base()
 
 	m_nDrawCalls				= 0;
 	m_nTrianglesCount			= 0;
+
+	m_streamFrame				= 0;
+	m_streamNumUploads			= 0;
+	m_streamNumEvictions		= 0;
 }
 
 // Init + Shurdown
@@ -124,6 +178,24 @@ void ShaderAPI_Base::Shutdown()
 
 	Reset();
 
+	// drop streaming requests, the textures are freed below
+	s_textureStreamer.StopThread(true);
+
+	m_streamRequests.append(m_streamCompleted);
+	m_streamCompleted.clear();
+
+	for(int i = 0; i < m_streamRequests.numElem(); i++)
+	{
+		texStreamRequest_t* req = m_streamRequests[i];
+
+		req->texture->m_streamPending = false;
+		req->texture->Ref_Drop();
+
+		delete req->image;
+		delete req;
+	}
+	m_streamRequests.clear();
+
 	FreeTexture(m_pErrorTexture);
 	m_pErrorTexture = nullptr;
 
@@ -134,6 +206,13 @@ void ShaderAPI_Base::Shutdown()
 	}
 	m_TextureList.clear();
 
+	{
+		CScopedWriteLock wl(m_textureMapLock);
+		m_textureMap.clear();
+	}
+
+	ReleasePrebuiltShaders();
+
 	for(int i = 0; i < m_ShaderList.numElem();i++)
 	{
 		DestroyShaderProgram(m_ShaderList[i]);
@@ -141,6 +220,22 @@ void ShaderAPI_Base::Shutdown()
 	}
 	m_ShaderList.clear();
 
+	{
+		CScopedWriteLock wl(m_shaderMapLock);
+		m_shaderMap.clear();
+	}
+
+	ClearShaderSources();
+
+	{
+		CScopedMutex m(m_shaderVariantsMutex);
+
+		for(int i = 0; i < m_shaderVariants.numElem(); i++)
+			delete m_shaderVariants[i];
+
+		m_shaderVariants.clear();
+	}
+
 	for(int i = 0; i < m_VFList.numElem();i++)
 	{
 		DestroyVertexFormat(m_VFList[i]);
@@ -347,21 +442,40 @@ void ShaderAPI_Base::GetViewport(int &x, int &y, int &w, int &h)
 // Find texture
 ITexture* ShaderAPI_Base::FindTexture(const char* pszName)
 {
-	EqString searchStr(pszName);
-	searchStr.Path_FixSlashes();
+	int nameHash = NameToHash(pszName);
 
-	int nameHash = StringToHash(pszName, true);
+	CScopedReadLock rl(m_textureMapLock);
 
-	CScopedMutex m(m_Mutex);
-	for(int i = 0; i < m_TextureList.numElem();i++)
+	std::pair<textureMap_t::const_iterator, textureMap_t::const_iterator> range = m_textureMap.equal_range(nameHash);
+
+	for(textureMap_t::const_iterator it = range.first; it != range.second; ++it)
 	{
-		if(((CTexture*)m_TextureList[i])->m_nameHash == nameHash)
-			return m_TextureList[i];
+		if(NameIsEqual(it->second->GetName(), pszName))
+			return it->second;
 	}
 
 	return NULL;
 }
 
+void ShaderAPI_Base::AddTextureToList(ITexture* pTexture)
+{
+	m_TextureList.append(pTexture);
+
+	CScopedWriteLock wl(m_textureMapLock);
+	m_textureMap.insert(textureMap_t::value_type(NameToHash(pTexture->GetName()), pTexture));
+}
+
+bool ShaderAPI_Base::RemoveTextureFromList(ITexture* pTexture)
+{
+	if(!m_TextureList.remove(pTexture))
+		return false;
+
+	CScopedWriteLock wl(m_textureMapLock);
+	NameHashMap_Remove(m_textureMap, NameToHash(pTexture->GetName()), pTexture);
+
+	return true;
+}
+
 
 SamplerStateParam_t ShaderAPI_Base::MakeSamplerState(ER_TextureFilterMode textureFilterType,ER_TextureAddressMode addressS, ER_TextureAddressMode addressT, ER_TextureAddressMode addressR)
 {
@@ -474,10 +588,7 @@ ITexture* ShaderAPI_Base::LoadTexture( const char* pszFileName, ER_TextureFilter
 	textureAnimPathExt.Path_FixSlashes();
 
 	if(!pFoundTexture)
-		pFoundTexture = FindTexture(texturePathExt.GetData());
-
-	if(!pFoundTexture)
-		pFoundTexture = FindTexture(textureAnimPathExt.GetData());
+		pFoundTexture = FindLoadedTexture(NULL, texturePathExt, textureAnimPathExt);
 
 	// found?
 	if(pFoundTexture != NULL)
@@ -487,6 +598,21 @@ ITexture* ShaderAPI_Base::LoadTexture( const char* pszFileName, ER_TextureFilter
 	if(pszFileName[0] == '$')
 		return NULL;
 
+	// material loader threads may request the same texture at once
+	int loadingHash = StringToHash(texturePathExt.GetData(), true);
+
+	while(!BeginTextureLoading(loadingHash))
+		m_textureLoadedSignal.Wait();
+
+	// check if it was loaded while we've been waiting
+	pFoundTexture = FindLoadedTexture(pszFileName, texturePathExt, textureAnimPathExt);
+
+	if(pFoundTexture != NULL)
+	{
+		EndTextureLoading(loadingHash);
+		return pFoundTexture;
+	}
+
 	// create sampler state
 	SamplerStateParam_t texSamplerParams = MakeSamplerState(textureFilterType,textureAddress,textureAddress,textureAddress);
 
@@ -495,6 +621,12 @@ ITexture* ShaderAPI_Base::LoadTexture( const char* pszFileName, ER_TextureFilter
 
 	DkList<CImage*> pImages;
 
+	// streamed textures are created with low mip levels only
+	int streamFirstMip = 0;
+	int streamWidth = 0;
+	int streamHeight = 0;
+	int streamMipCount = 0;
+
 	if(animScriptBuffer)
 	{
 		if(rs_echo_texture_loading.GetBool())
@@ -555,6 +687,8 @@ ITexture* ShaderAPI_Base::LoadTexture( const char* pszFileName, ER_TextureFilter
 
 			PPFree(animScriptBuffer);
 
+			EndTextureLoading(loadingHash);
+
 			return m_pErrorTexture;
 		}
 
@@ -566,6 +700,18 @@ ITexture* ShaderAPI_Base::LoadTexture( const char* pszFileName, ER_TextureFilter
 
 		bool stateLoad = pImage->LoadDDS(texturePathExt.GetData(),0);
 
+		if(stateLoad)
+			streamFirstMip = GetTextureStreamingBaseMip(pImage, nFlags);
+
+		if(streamFirstMip > 0)
+		{
+			streamWidth = pImage->GetWidth();
+			streamHeight = pImage->GetHeight();
+			streamMipCount = pImage->GetMipMapCount();
+
+			pImage->RemoveMipMaps(streamFirstMip);
+		}
+
 		if(!stateLoad)
 		{
 			texturePathExt = texturePath + EqString(TEXTURE_SECONDARY_EXTENSION);
@@ -589,12 +735,40 @@ ITexture* ShaderAPI_Base::LoadTexture( const char* pszFileName, ER_TextureFilter
 	}
 
 	// Now create the texture
-	pFoundTexture = CreateTexture(pImages, texSamplerParams, nFlags);
+	if(streamFirstMip > 0)
+	{
+		// mips are already dropped, don't let r_loadmiplevel do that
+		pFoundTexture = CreateTexture(pImages, texSamplerParams, nFlags | TEXFLAG_NOQUALITYLOD);
+
+		if(pFoundTexture)
+		{
+			CTexture* pTexture = (CTexture*)pFoundTexture;
+
+			CScopedMutex m(m_Mutex);
+
+			// texture reports it's full size
+			pTexture->SetDimensions(streamWidth, streamHeight);
+			pTexture->SetMipCount(streamMipCount);
+			pTexture->SetFlags(pTexture->GetFlags() & ~TEXFLAG_NOQUALITYLOD);
+
+			pTexture->m_streamFlags = pTexture->GetFlags();
+			pTexture->m_streamSize = pImages[0]->GetMipMappedSize();
+			pTexture->m_streamBindFrame = m_streamFrame;
+			pTexture->m_streamFirstMip = streamFirstMip;
+			pTexture->m_streamBaseMip = streamFirstMip;
+			pTexture->m_streamWantedMip = streamFirstMip;
+			pTexture->m_streamMipCount = streamMipCount;
+		}
+	}
+	else
+		pFoundTexture = CreateTexture(pImages, texSamplerParams, nFlags);
 
 	// free images
 	for(int i = 0;i < pImages.numElem();i++)
 		delete pImages[i];
 
+	EndTextureLoading(loadingHash);
+
 	// Generate the error
 	if(!pFoundTexture)
 		pFoundTexture = m_pErrorTexture;
@@ -602,6 +776,487 @@ ITexture* ShaderAPI_Base::LoadTexture( const char* pszFileName, ER_TextureFilter
 	return pFoundTexture;
 }
 
+// searches for texture by the name and paths LoadTexture gives to animated, DDS and TGA textures
+ITexture* ShaderAPI_Base::FindLoadedTexture(const char* pszFileName, const EqString& texturePathExt, const EqString& textureAnimPathExt)
+{
+	ITexture* pFoundTexture = pszFileName ? FindTexture(pszFileName) : NULL;
+
+	// TGA textures are named with the default extension too
+	if(!pFoundTexture)
+		pFoundTexture = FindTexture(texturePathExt.GetData());
+
+	if(!pFoundTexture)
+		pFoundTexture = FindTexture(textureAnimPathExt.GetData());
+
+	return pFoundTexture;
+}
+
+bool ShaderAPI_Base::BeginTextureLoading(int nameHash)
+{
+	CScopedMutex m(m_Mutex);
+
+	if(m_loadingTextures.findIndex(nameHash) != -1)
+	{
+		// cleared under the lock, so EndTextureLoading can't be missed
+		m_textureLoadedSignal.Clear();
+		return false;
+	}
+
+	m_loadingTextures.append(nameHash);
+	return true;
+}
+
+void ShaderAPI_Base::EndTextureLoading(int nameHash)
+{
+	CScopedMutex m(m_Mutex);
+	m_loadingTextures.fastRemove(nameHash);
+
+	// wake up threads waiting for this texture
+	m_textureLoadedSignal.Raise();
+}
+
+//-------------------------------------------------------------
+// Texture streaming
+//-------------------------------------------------------------
+
+static int Texture_GetQualityMip(int mipCount)
+{
+	HOOK_TO_CVAR(r_loadmiplevel);
+
+	int quality = r_loadmiplevel ? r_loadmiplevel->GetInt() : 0;
+
+	return clamp(quality, 0, mipCount-1);
+}
+
+// computes size of mip levels starting from firstMip
+static int Texture_GetStreamSize(const CTexture* pTexture, int firstMip)
+{
+	ETextureFormat format = pTexture->GetFormat();
+
+	int w = max(pTexture->GetWidth() >> firstMip, 1);
+	int h = max(pTexture->GetHeight() >> firstMip, 1);
+
+	int size = 0;
+
+	for(int i = firstMip; i < pTexture->GetMipCount(); i++)
+	{
+		if(IsCompressedFormat(format))
+			size += ((w + 3) >> 2) * ((h + 3) >> 2);
+		else
+			size += w * h;
+
+		w = max(w >> 1, 1);
+		h = max(h >> 1, 1);
+	}
+
+	if(IsCompressedFormat(format))
+		return size * GetBytesPerBlock(format);
+
+	return size * GetBytesPerPixel(format);
+}
+
+int ShaderAPI_Base::CompareTextureStreamUsage(CTexture* const& a, CTexture* const& b)
+{
+	if(a->m_streamUsage == b->m_streamUsage)
+		return 0;
+
+	return (a->m_streamUsage > b->m_streamUsage) ? -1 : 1;
+}
+
+int ShaderAPI_Base::GetTextureStreamingBaseMip(const CImage* pImage, int nFlags) const
+{
+	if(!r_textureStreaming.GetBool() || r_nomip.GetBool())
+		return 0;
+
+	if(nFlags & (TEXFLAG_NOQUALITYLOD | TEXFLAG_RENDERTARGET))
+		return 0;
+
+	// only plain 2D textures can drop mips
+	if(!pImage->Is2D() || pImage->IsArray() || pImage->GetMipMapCount() <= 1)
+		return 0;
+
+	int baseSize = r_textureStreamingBaseSize.GetInt();
+	int baseMip = 0;
+
+	while(baseMip < pImage->GetMipMapCount()-1 && max(pImage->GetWidth(baseMip), pImage->GetHeight(baseMip)) > baseSize)
+		baseMip++;
+
+	// small enough, nothing to stream
+	if(baseMip <= Texture_GetQualityMip(pImage->GetMipMapCount()))
+		return 0;
+
+	return baseMip;
+}
+
+void ShaderAPI_Base::SetTextureStreamingSize(ITexture* pTexture, int screenSize)
+{
+	CTexture* pTex = (CTexture*)pTexture;
+
+	if(!pTex || !pTex->m_streamMipCount)
+		return;
+
+	screenSize = clamp(screenSize, 1, 65535);
+
+	// biggest size during the frame is used
+	if(pTex->m_streamHintFrame != m_streamFrame || pTex->m_streamScreenSize < screenSize)
+		pTex->m_streamScreenSize = screenSize;
+
+	pTex->m_streamHintFrame = m_streamFrame;
+}
+
+void ShaderAPI_Base::RequestTextureMips(CTexture* pTexture, int firstMip)
+{
+	// keep it alive until request is complete
+	pTexture->Ref_Grab();
+	pTexture->m_streamPending = true;
+	pTexture->m_streamWantedMip = firstMip;
+
+	texStreamRequest_t* req = new texStreamRequest_t;
+	req->texture = pTexture;
+	req->image = nullptr;
+	req->fileName = pTexture->GetName();
+	req->firstMip = firstMip;
+
+	CScopedMutex m(m_streamMutex);
+	m_streamRequests.append(req);
+}
+
+void ShaderAPI_Base::ProcessStreamingRequests()
+{
+	while(true)
+	{
+		texStreamRequest_t* req;
+
+		{
+			CScopedMutex m(m_streamMutex);
+
+			if(!m_streamRequests.numElem())
+				break;
+
+			req = m_streamRequests[0];
+			m_streamRequests.removeIndex(0);
+		}
+
+		CImage* pImage = new CImage();
+
+		// file could be changed, check the mip count
+		if( pImage->LoadDDSMipMaps(req->fileName.ToCString(), req->firstMip) &&
+			pImage->GetMipMapCount() + req->firstMip == req->texture->m_streamMipCount)
+		{
+			pImage->SetName(req->fileName.ToCString());
+			req->image = pImage;
+		}
+		else
+		{
+			MsgError("Can't stream texture '%s'\n", req->fileName.ToCString());
+			delete pImage;
+		}
+
+		CScopedMutex m(m_streamMutex);
+		m_streamCompleted.append(req);
+	}
+}
+
+// forces texture units holding the texture to be re-bound on the next ApplyTextures
+void ShaderAPI_Base::InvalidateTextureBindings(ITexture* pTexture)
+{
+	for(int i = 0; i < MAX_TEXTUREUNIT; i++)
+	{
+		if(m_pCurrentTextures[i] == pTexture)
+			m_pCurrentTextures[i] = NULL;
+	}
+
+	for(int i = 0; i < MAX_VERTEXTEXTURES; i++)
+	{
+		if(m_pCurrentVertexTextures[i] == pTexture)
+			m_pCurrentVertexTextures[i] = NULL;
+	}
+}
+
+void ShaderAPI_Base::ApplyStreamedTextures()
+{
+	int maxUploads = r_textureStreamingUploads.GetInt();
+
+	for(int numUploads = 0; numUploads < maxUploads; )
+	{
+		texStreamRequest_t* req;
+
+		{
+			CScopedMutex m(m_streamMutex);
+
+			if(!m_streamCompleted.numElem())
+				break;
+
+			req = m_streamCompleted[0];
+			m_streamCompleted.removeIndex(0);
+		}
+
+		CTexture* pTexture = req->texture;
+
+		// freed by everyone else while streaming?
+		bool isUsed = pTexture->Ref_Count() > 1;
+
+		if(isUsed && req->image)
+		{
+			DkList<CImage*> images;
+			images.append(req->image);
+
+			ITexture* pTex = pTexture;
+
+			int fullWidth = pTexture->GetWidth();
+			int fullHeight = pTexture->GetHeight();
+
+			// current mip levels are kept if it fails
+			if(!CreateTextureInternal(&pTex, images, pTexture->GetSamplerState(), pTexture->m_streamFlags | TEXFLAG_NOQUALITYLOD))
+			{
+				MsgError("Can't upload streamed texture '%s'\n", pTexture->GetName());
+
+				pTexture->m_streamWantedMip = pTexture->m_streamFirstMip;
+				pTexture->m_streamPending = false;
+				pTexture->Ref_Drop();
+
+				delete req->image;
+				delete req;
+				continue;
+			}
+
+			// texture object is the same, ApplyTextures must not think it's still bound
+			InvalidateTextureBindings(pTexture);
+
+			CScopedMutex m(m_Mutex);
+
+			pTexture->SetDimensions(fullWidth, fullHeight);
+			pTexture->SetMipCount(pTexture->m_streamMipCount);
+			pTexture->SetFlags(pTexture->m_streamFlags);
+
+			if(req->firstMip > pTexture->m_streamFirstMip)
+				m_streamNumEvictions++;
+			else
+				m_streamNumUploads++;
+
+			pTexture->m_streamSize = req->image->GetMipMappedSize();
+			pTexture->m_streamFirstMip = req->firstMip;
+
+			numUploads++;
+		}
+
+		pTexture->m_streamPending = false;
+
+		if(isUsed)
+			pTexture->Ref_Drop();
+		else
+			FreeTexture(pTexture);
+
+		delete req->image;
+		delete req;
+	}
+}
+
+void ShaderAPI_Base::UpdateTextureStreaming()
+{
+	ApplyStreamedTextures();
+
+	if(!r_textureStreaming.GetBool())
+	{
+		m_streamFrame++;
+		return;
+	}
+
+	int64 budget = (int64)r_textureStreamingBudget.GetInt() * 1024 * 1024;
+	uint idleFrames = r_textureStreamingIdleFrames.GetInt();
+
+	DkList<CTexture*> upgrades;
+	DkList<CTexture*> trimmable;
+	DkList<CTexture*> evictable;
+
+	int64 residentSize = 0;
+
+	CScopedMutex m(m_Mutex);
+
+	for(int i = 0; i < m_TextureList.numElem(); i++)
+	{
+		CTexture* pTexture = (CTexture*)m_TextureList[i];
+
+		if(!pTexture->m_streamMipCount)
+			continue;
+
+		bool bound = (pTexture->m_streamBindFrame == m_streamFrame);
+		pTexture->m_streamUsage = pTexture->m_streamUsage * TEXSTREAM_USAGE_DECAY + (bound ? 1.0f : 0.0f);
+
+		// requested mips are accounted before they arrive
+		if(pTexture->m_streamPending)
+		{
+			residentSize += max((int64)pTexture->m_streamSize, (int64)Texture_GetStreamSize(pTexture, pTexture->m_streamWantedMip));
+			continue;
+		}
+
+		residentSize += pTexture->m_streamSize;
+
+		// freed by everyone else
+		if(pTexture->Ref_Count() <= 0)
+			continue;
+
+		int wantedMip = Texture_GetQualityMip(pTexture->m_streamMipCount);
+
+		if(m_streamFrame - pTexture->m_streamBindFrame > idleFrames)
+		{
+			wantedMip = pTexture->m_streamBaseMip;
+		}
+		else if(m_streamFrame - pTexture->m_streamHintFrame <= idleFrames && pTexture->m_streamScreenSize)
+		{
+			// no need for mip levels bigger than it's size on screen
+			int size = max(pTexture->GetWidth(), pTexture->GetHeight());
+			int hintMip = 0;
+
+			while((size >> (hintMip+1)) >= pTexture->m_streamScreenSize)
+				hintMip++;
+
+			wantedMip = max(wantedMip, hintMip);
+		}
+
+		wantedMip = min(wantedMip, (int)pTexture->m_streamBaseMip);
+		pTexture->m_streamWantedMip = wantedMip;
+
+		if(wantedMip < pTexture->m_streamFirstMip)
+			upgrades.append(pTexture);
+		else if(wantedMip > pTexture->m_streamFirstMip)
+			trimmable.append(pTexture);
+		else if(pTexture->m_streamFirstMip < pTexture->m_streamBaseMip)
+			evictable.append(pTexture);
+	}
+
+	// most used textures are first to stream in, least used are first to be evicted
+	upgrades.sort(CompareTextureStreamUsage);
+	trimmable.sort(CompareTextureStreamUsage);
+	evictable.sort(CompareTextureStreamUsage);
+
+	int maxRequests = r_textureStreamingRequests.GetInt();
+	int numRequests = 0;
+	int numTrimmed = 0;
+	int numEvicted = 0;
+
+	for(int i = 0; i < upgrades.numElem() && numRequests < maxRequests; i++)
+	{
+		CTexture* pTexture = upgrades[i];
+
+		int64 requiredSize = Texture_GetStreamSize(pTexture, pTexture->m_streamWantedMip) - pTexture->m_streamSize;
+
+		// mips that are not needed anymore go first
+		while(residentSize + requiredSize > budget && numTrimmed < trimmable.numElem())
+		{
+			CTexture* pTrim = trimmable[trimmable.numElem()-1-numTrimmed];
+
+			residentSize -= pTrim->m_streamSize - Texture_GetStreamSize(pTrim, pTrim->m_streamWantedMip);
+			RequestTextureMips(pTrim, pTrim->m_streamWantedMip);
+
+			numTrimmed++;
+		}
+
+		while(residentSize + requiredSize > budget && numEvicted < evictable.numElem())
+		{
+			CTexture* pEvict = evictable[evictable.numElem()-1-numEvicted];
+
+			if(pEvict->m_streamUsage >= pTexture->m_streamUsage)
+				break;
+
+			residentSize -= pEvict->m_streamSize - Texture_GetStreamSize(pEvict, pEvict->m_streamBaseMip);
+			RequestTextureMips(pEvict, pEvict->m_streamBaseMip);
+
+			numEvicted++;
+		}
+
+		// if all mips don't fit, stream as much as possible
+		int firstMip = pTexture->m_streamWantedMip;
+
+		while(firstMip < pTexture->m_streamFirstMip && residentSize + requiredSize > budget)
+		{
+			firstMip++;
+			requiredSize = Texture_GetStreamSize(pTexture, firstMip) - pTexture->m_streamSize;
+		}
+
+		if(firstMip == pTexture->m_streamFirstMip)
+			continue;
+
+		residentSize += requiredSize;
+		RequestTextureMips(pTexture, firstMip);
+
+		numRequests++;
+	}
+
+	// budget could be lowered
+	while(residentSize > budget && numTrimmed < trimmable.numElem())
+	{
+		CTexture* pTrim = trimmable[trimmable.numElem()-1-numTrimmed];
+
+		residentSize -= pTrim->m_streamSize - Texture_GetStreamSize(pTrim, pTrim->m_streamWantedMip);
+		RequestTextureMips(pTrim, pTrim->m_streamWantedMip);
+
+		numTrimmed++;
+	}
+
+	while(residentSize > budget && numEvicted < evictable.numElem())
+	{
+		CTexture* pEvict = evictable[evictable.numElem()-1-numEvicted];
+
+		residentSize -= pEvict->m_streamSize - Texture_GetStreamSize(pEvict, pEvict->m_streamBaseMip);
+		RequestTextureMips(pEvict, pEvict->m_streamBaseMip);
+
+		numEvicted++;
+	}
+
+	if(numRequests || numTrimmed || numEvicted)
+	{
+		if(!s_textureStreamer.IsRunning())
+		{
+			s_textureStreamer.m_api = this;
+			s_textureStreamer.StartWorkerThread("textureStreamer", TP_BELOW_NORMAL);
+		}
+
+		s_textureStreamer.SignalWork();
+	}
+
+	m_streamFrame++;
+}
+
+void ShaderAPI_Base::PrintTextureStreamingInfo()
+{
+	CScopedMutex m(m_Mutex);
+
+	int64 residentSize = 0;
+	int64 fullSize = 0;
+	int numStreamed = 0;
+	int numPending = 0;
+
+	MsgInfo("--- Streamed textures ---\n");
+
+	for(int i = 0; i < m_TextureList.numElem(); i++)
+	{
+		CTexture* pTexture = (CTexture*)m_TextureList[i];
+
+		if(!pTexture->m_streamMipCount)
+			continue;
+
+		int fullTexSize = Texture_GetStreamSize(pTexture, 0);
+
+		Msg("  %s: %dx%d, mip %d (want %d, base %d), %d/%d KB, usage %.2f%s\n",
+			pTexture->GetName(), pTexture->GetWidth(), pTexture->GetHeight(),
+			pTexture->m_streamFirstMip, pTexture->m_streamWantedMip, pTexture->m_streamBaseMip,
+			pTexture->m_streamSize / 1024, fullTexSize / 1024,
+			pTexture->m_streamUsage, pTexture->m_streamPending ? " (streaming)" : "");
+
+		residentSize += pTexture->m_streamSize;
+		fullSize += fullTexSize;
+		numStreamed++;
+
+		if(pTexture->m_streamPending)
+			numPending++;
+	}
+
+	MsgInfo("%d streamed textures, %d being streamed\n", numStreamed, numPending);
+	MsgInfo("resident %.2f MB of %.2f MB, budget %d MB\n", residentSize / (1024.0f*1024.0f), fullSize / (1024.0f*1024.0f), r_textureStreamingBudget.GetInt());
+	MsgInfo("total %d mip uploads, %d evictions\n", m_streamNumUploads, m_streamNumEvictions);
+}
+
 ITexture* ShaderAPI_Base::CreateTexture(const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler, int nFlags)
 {
 	if(!pImages.numElem())
@@ -904,6 +1559,10 @@ void ShaderAPI_Base::SetTextureOnIndex(ITexture* pTexture,int level /* = 0*/)
 	}
 	else
 		m_pSelectedTextures[level] = pTexture;
+
+	// used by texture streaming
+	if(pTexture)
+		((CTexture*)pTexture)->m_streamBindFrame = m_streamFrame;
 }
 
 // returns the currently set textre at level
@@ -1055,42 +1714,131 @@ void ProcessShaderFileIncludes(char** buffer, const char* pszFileName, shaderPro
 	strcpy(*buffer, newSrc.GetData());
 }
 
-// Loads and compiles shaders from files
-bool ShaderAPI_Base::LoadShadersFromFile(IShaderProgram* pShaderOutput, const char* pszFilePrefix, const char *extra)
+//
+// Shader descriptor and preprocessed sources.
+// Shared by all permutations of the shader
+//
+struct shaderSourceCache_t
 {
-	if(pShaderOutput == NULL)
+	shaderSourceCache_t() : apiPrefs(nullptr), disableCache(false), psRequired(false), gsRequired(false)
+	{
+		numRefs.SetValue(1);	// the cache reference
+	}
+
+	~shaderSourceCache_t()
+	{
+		PPFree(vs.text);
+		PPFree(ps.text);
+		PPFree(gs.text);
+	}
+
+	EqString			filePrefix;
+
+	KeyValues			descriptor;
+	kvkeybase_t*		apiPrefs;		// points to descriptor section
+	bool				disableCache;
+
+	bool				psRequired;		// vertex shader is always required
+	bool				gsRequired;
+
+	shaderProgramText_t	vs;
+	shaderProgramText_t	ps;
+	shaderProgramText_t	gs;
+
+	// cache and the shader loaders that are using it
+	Threading::CEqInterlockedInteger	numRefs;
+};
+
+struct shaderVariant_t
+{
+	EqString			programName;	// name with permutation query
+	EqString			filePrefix;
+	EqString			defines;
+};
+
+// Search for existing shader program by it's name and permutation query
+IShaderProgram* ShaderAPI_Base::FindShaderProgram(const char* pszName, const char* query)
+{
+	CScopedReadLock rl(m_shaderMapLock);
+
+	std::pair<shaderProgramMap_t::const_iterator, shaderProgramMap_t::const_iterator> range = m_shaderMap.equal_range(NameToHash(pszName, query));
+
+	for(shaderProgramMap_t::const_iterator it = range.first; it != range.second; ++it)
+	{
+		if(NameIsEqual(it->second->GetName(), pszName, query))
+			return it->second;
+	}
+
+	return NULL;
+}
+
+void ShaderAPI_Base::AddShaderProgramToList(IShaderProgram* pProgram)
+{
+	CScopedWriteLock wl(m_shaderMapLock);
+
+	m_ShaderList.append(pProgram);
+	m_shaderMap.insert(shaderProgramMap_t::value_type(NameToHash(pProgram->GetName()), pProgram));
+}
+
+bool ShaderAPI_Base::RemoveShaderProgramFromList(IShaderProgram* pProgram)
+{
+	CScopedWriteLock wl(m_shaderMapLock);
+
+	if(!m_ShaderList.remove(pProgram))
 		return false;
 
-	bool bResult = false;
+	NameHashMap_Remove(m_shaderMap, NameToHash(pProgram->GetName()), pProgram);
+
+	return true;
+}
+
+// returns descriptor and preprocessed sources of the shader, loads them once.
+// Must be released with ReleaseShaderSources
+shaderSourceCache_t* ShaderAPI_Base::GetShaderSources(const char* pszFilePrefix)
+{
+	typedef std::unordered_multimap<int, shaderSourceCache_t*>::const_iterator sourceIter_t;
+
+	int nameHash = StringToHash(pszFilePrefix);
+
+	{
+		CScopedReadLock rl(m_shaderSourcesLock);
+
+		std::pair<sourceIter_t, sourceIter_t> range = m_shaderSources.equal_range(nameHash);
+
+		for(sourceIter_t it = range.first; it != range.second; ++it)
+		{
+			if(!strcmp(it->second->filePrefix.ToCString(), pszFilePrefix))
+			{
+				it->second->numRefs.Increment();
+				return it->second;
+			}
+		}
+	}
+
+	// loaded without lock, other thread may load the same sources
+	shaderSourceCache_t* sources = new shaderSourceCache_t();
+	sources->filePrefix = pszFilePrefix;
 
 	EqString fileNameVS(varargs(SHADERS_DEFAULT_PATH "%s/%s.vs", GetRendererName(), pszFilePrefix));
 	EqString fileNamePS(varargs(SHADERS_DEFAULT_PATH "%s/%s.ps", GetRendererName(), pszFilePrefix));
 	EqString fileNameGS(varargs(SHADERS_DEFAULT_PATH "%s/%s.gs", GetRendererName(), pszFilePrefix));
 
-	bool vsRequiried = true;	// vertex shader is always required
-	bool psRequiried = false;
-	bool gsRequiried = false;
-
-	shaderProgramCompileInfo_t info;
-
 	// Load KeyValues
-	KeyValues pKv;
-
-	if( pKv.LoadFromFile((EqString(SHADERS_DEFAULT_PATH) + pszFilePrefix + ".txt").GetData()) )
+	if( sources->descriptor.LoadFromFile((EqString(SHADERS_DEFAULT_PATH) + pszFilePrefix + ".txt").GetData()) )
 	{
-		kvkeybase_t* sec = pKv.GetRootSection();
+		kvkeybase_t* sec = sources->descriptor.GetRootSection();
 
 		kvkeybase_t* pixelProgramName = sec->FindKeyBase("PixelShaderProgram");
 		kvkeybase_t* vertexProgramName = sec->FindKeyBase("VertexShaderProgram");
 		kvkeybase_t* geometryProgramName = sec->FindKeyBase("GeometryShaderProgram");
 
-		info.disableCache = KV_GetValueBool(sec->FindKeyBase("DisableCache"));
+		sources->disableCache = KV_GetValueBool(sec->FindKeyBase("DisableCache"));
 
 		if(pixelProgramName)
-			psRequiried = true;
+			sources->psRequired = true;
 
 		if(geometryProgramName)
-			gsRequiried = true;
+			sources->gsRequired = true;
 
 		const char* vertexProgNameStr = KV_GetValueString(vertexProgramName, 0, pszFilePrefix);
 		const char* pixelProgNameStr = KV_GetValueString(pixelProgramName, 0, pszFilePrefix);
@@ -1112,76 +1860,328 @@ bool ShaderAPI_Base::LoadShadersFromFile(IShaderProgram* pShaderOutput, const ch
 				{
 					if(!stricmp(KV_GetValueString(apiKey, j), GetRendererName()))
 					{
-						info.apiPrefs = apiKey;
+						sources->apiPrefs = apiKey;
 						break;
 					}
 				}
 
-				if(info.apiPrefs)
+				if(sources->apiPrefs)
 					break;
 			}
 		}
 	}
 
 	// add first files as includes (index = 0)
-	info.vs.includes.append(fileNameVS);
-	info.ps.includes.append(fileNamePS);
-	info.gs.includes.append(fileNameGS);
+	sources->vs.includes.append(fileNameVS);
+	sources->ps.includes.append(fileNamePS);
+	sources->gs.includes.append(fileNameGS);
 
 	// load them
-	info.vs.text = g_fileSystem->GetFileBuffer(fileNameVS.GetData());
-	info.ps.text = g_fileSystem->GetFileBuffer(fileNamePS.GetData());
-	info.gs.text = g_fileSystem->GetFileBuffer(fileNameGS.GetData());
+	sources->vs.text = g_fileSystem->GetFileBuffer(fileNameVS.GetData());
+	sources->ps.text = g_fileSystem->GetFileBuffer(fileNamePS.GetData());
+	sources->gs.text = g_fileSystem->GetFileBuffer(fileNameGS.GetData());
 
-	if (!info.ps.text && psRequiried)
+	ProcessShaderFileIncludes(&sources->vs.text, fileNameVS.GetData(), sources->vs, true);
+	ProcessShaderFileIncludes(&sources->ps.text, fileNamePS.GetData(), sources->ps, true);
+	ProcessShaderFileIncludes(&sources->gs.text, fileNameGS.GetData(), sources->gs, true);
+
+	// checksum please
+	if(sources->vs.text)
+		sources->vs.checksum = CRC32_BlockChecksum(sources->vs.text, strlen(sources->vs.text));
+
+	if(sources->ps.text)
+		sources->ps.checksum = CRC32_BlockChecksum(sources->ps.text, strlen(sources->ps.text));
+
+	if(sources->gs.text)
+		sources->gs.checksum = CRC32_BlockChecksum(sources->gs.text, strlen(sources->gs.text));
+
+	CScopedWriteLock wl(m_shaderSourcesLock);
+
+	std::pair<sourceIter_t, sourceIter_t> range = m_shaderSources.equal_range(nameHash);
+
+	for(sourceIter_t it = range.first; it != range.second; ++it)
 	{
-		MsgError("Can't open pixel shader file '%s'!\n", fileNamePS.GetData());
-		PPFree(info.vs.text);
-		PPFree(info.ps.text);
-		PPFree(info.gs.text);
+		if(!strcmp(it->second->filePrefix.ToCString(), pszFilePrefix))
+		{
+			delete sources;
+
+			it->second->numRefs.Increment();
+			return it->second;
+		}
+	}
+
+	// one reference for cache and one for caller
+	sources->numRefs.Increment();
+
+	m_shaderSources.insert(std::unordered_multimap<int, shaderSourceCache_t*>::value_type(nameHash, sources));
+
+	return sources;
+}
+
+// drops reference returned by GetShaderSources
+void ShaderAPI_Base::ReleaseShaderSources(shaderSourceCache_t* sources)
+{
+	if(sources->numRefs.Decrement() == 0)
+		delete sources;
+}
+
+// releases cached shader sources. Loaders that still use them are keeping them until they finish
+void ShaderAPI_Base::ClearShaderSources()
+{
+	CScopedWriteLock wl(m_shaderSourcesLock);
+
+	for(std::unordered_multimap<int, shaderSourceCache_t*>::iterator it = m_shaderSources.begin(); it != m_shaderSources.end(); ++it)
+		ReleaseShaderSources(it->second);
+
+	m_shaderSources.clear();
+}
+
+// releases the programs which were kept loaded by PrebuildShaderVariants
+void ShaderAPI_Base::ReleasePrebuiltShaders()
+{
+	DkList<IShaderProgram*> prebuilt;
+
+	{
+		CScopedMutex m(m_shaderVariantsMutex);
+
+		prebuilt.append(m_prebuiltShaders);
+		m_prebuiltShaders.clear();
+	}
+
+	for(int i = 0; i < prebuilt.numElem(); i++)
+		DestroyShaderProgram(prebuilt[i]);
+}
+
+// drops shader sources and prebuilt programs, so they are loaded from disk again
+void ShaderAPI_Base::ReloadShaderSources()
+{
+	ReleasePrebuiltShaders();
+	ClearShaderSources();
+}
+
+// Loads and compiles shaders from files
+bool ShaderAPI_Base::LoadShadersFromFile(IShaderProgram* pShaderOutput, const char* pszFilePrefix, const char *extra)
+{
+	if(pShaderOutput == NULL)
+		return false;
+
+	shaderSourceCache_t* sources = GetShaderSources(pszFilePrefix);
+
+	if (!sources->ps.text && sources->psRequired)
+	{
+		MsgError("Can't open pixel shader file '%s'!\n", sources->ps.includes[0].GetData());
+		ReleaseShaderSources(sources);
 		return false;
 	}
 
-	if(!info.vs.text && vsRequiried)
+	if(!sources->vs.text)
 	{
-		MsgError("Can't open vertex shader file '%s'!\n",fileNameVS.GetData());
-		PPFree(info.vs.text);
-		PPFree(info.ps.text);
-		PPFree(info.gs.text);
+		MsgError("Can't open vertex shader file '%s'!\n", sources->vs.includes[0].GetData());
+		ReleaseShaderSources(sources);
 		return false;
 	}
 
-	if (!info.gs.text && gsRequiried)
+	if (!sources->gs.text && sources->gsRequired)
 	{
-		MsgError("Can't open geometry shader file '%s'!\n", fileNameVS.GetData());
-		PPFree(info.vs.text);
-		PPFree(info.ps.text);
-		PPFree(info.gs.text);
+		MsgError("Can't open geometry shader file '%s'!\n", sources->gs.includes[0].GetData());
+		ReleaseShaderSources(sources);
 		return false;
 	}
 
-	ProcessShaderFileIncludes(&info.vs.text, fileNameVS.GetData(), info.vs, true);
-	ProcessShaderFileIncludes(&info.ps.text, fileNamePS.GetData(), info.ps, true);
-	ProcessShaderFileIncludes(&info.gs.text, fileNameGS.GetData(), info.gs, true);
+	// texts are owned by the cache, so they aren't freed here
+	shaderProgramCompileInfo_t info;
+	info.disableCache = sources->disableCache;
+	info.apiPrefs = sources->apiPrefs;
 
-	// checksum please
-	if(info.vs.text)
-		info.vs.checksum = CRC32_BlockChecksum(info.vs.text, strlen(info.vs.text));
+	info.vs = sources->vs;
+	info.ps = sources->ps;
+	info.gs = sources->gs;
 
-	if(info.ps.text)
-		info.ps.checksum = CRC32_BlockChecksum(info.ps.text, strlen(info.ps.text));
+	// compile the shaders
+	bool compiled = CompileShadersFromStream( pShaderOutput, info, extra );
 
-	if(info.gs.text)
-		info.gs.checksum = CRC32_BlockChecksum(info.gs.text, strlen(info.gs.text));
+	ReleaseShaderSources(sources);
 
-	// compile the shaders
-	bResult = CompileShadersFromStream( pShaderOutput, info, extra );
+	if(!compiled)
+		return false;
+
+	// remember the permutation for SaveShaderVariants
+	CScopedMutex m(m_shaderVariantsMutex);
+
+	for(int i = 0; i < m_shaderVariants.numElem(); i++)
+	{
+		if(!stricmp(m_shaderVariants[i]->programName.ToCString(), pShaderOutput->GetName()))
+			return true;
+	}
+
+	shaderVariant_t* variant = new shaderVariant_t();
+	variant->programName = pShaderOutput->GetName();
+	variant->filePrefix = pszFilePrefix;
+	variant->defines = extra ? extra : "";
+
+	m_shaderVariants.append(variant);
+
+	return true;
+}
+
+// writes the shader permutations that were loaded to the variant list file
+bool ShaderAPI_Base::SaveShaderVariants(const char* pszFileName)
+{
+	KeyValues kvs;
+	kvkeybase_t* root = kvs.GetRootSection();
+
+	int numVariants;
+	{
+		CScopedMutex m(m_shaderVariantsMutex);
+
+		numVariants = m_shaderVariants.numElem();
+
+		for(int i = 0; i < m_shaderVariants.numElem(); i++)
+		{
+			shaderVariant_t* variant = m_shaderVariants[i];
+
+			kvkeybase_t* sec = root->AddKeyBase(variant->programName.ToCString());
+			sec->SetKey("shader", variant->filePrefix.ToCString());
+
+			// one define per line, without the directive
+			const char* str = variant->defines.ToCString();
+
+			while(*str)
+			{
+				const char* lineEnd = strchr(str, '\n');
+				int lineLen = lineEnd ? lineEnd - str : strlen(str);
+
+				EqString line(str, lineLen);
+
+				if(line.Find("#define ") == 0)
+					line = line.Mid(8, line.Length() - 8);
+
+				if(line.Length())
+					sec->AddKeyBase("define", line.ToCString());
 
-	PPFree(info.vs.text);
-	PPFree(info.ps.text);
-	PPFree(info.gs.text);
+				str += lineLen;
+
+				if(*str)
+					str++;
+			}
+		}
+	}
+
+	kvs.SaveToFile(pszFileName, SP_MOD);
+
+	MsgInfo("%d shader variants saved to '%s'\n", numVariants, pszFileName);
+
+	return true;
+}
+
+// compiles the permutations from variant list file, fills the shader caches. Returns number of compiled programs
+int ShaderAPI_Base::PrebuildShaderVariants(const char* pszFileName)
+{
+	KeyValues kvs;
+
+	if(!kvs.LoadFromFile(pszFileName))
+	{
+		MsgError("Can't open shader variant list '%s'\n", pszFileName);
+		return 0;
+	}
+
+	kvkeybase_t* root = kvs.GetRootSection();
+
+	int numCompiled = 0;
+	int numFailed = 0;
+
+	for(int i = 0; i < root->keys.numElem(); i++)
+	{
+		kvkeybase_t* sec = root->keys[i];
+
+		const char* programName = sec->GetName();
+		const char* filePrefix = KV_GetValueString(sec->FindKeyBase("shader"), 0, NULL);
+
+		if(!filePrefix || FindShaderProgram(programName, NULL))
+			continue;
+
+		EqString defines;
+
+		for(int j = 0; j < sec->keys.numElem(); j++)
+		{
+			if(!stricmp(sec->keys[j]->GetName(), "define"))
+				defines.Append(EqString("#define ") + KV_GetValueString(sec->keys[j]) + "\n");
+		}
+
+		IShaderProgram* pProgram = CreateNewShaderProgram(programName, "");
+
+		if(!LoadShadersFromFile(pProgram, filePrefix, defines.ToCString()))
+		{
+			DestroyShaderProgram(pProgram);
+			numFailed++;
+			continue;
+		}
+
+		// keep it loaded, materials are going to find it. Released on reload and shutdown
+		pProgram->Ref_Grab();
+
+		{
+			CScopedMutex m(m_shaderVariantsMutex);
+			m_prebuiltShaders.append(pProgram);
+		}
+
+		numCompiled++;
+	}
+
+	MsgInfo("Shader variants from '%s': %d compiled, %d failed\n", pszFileName, numCompiled, numFailed);
+
+	return numCompiled;
+}
+
+// Returns global shader constant handle, valid for any shader program
+int ShaderAPI_Base::GetShaderConstantHandle(const char *pszName)
+{
+	if(!pszName)
+		return -1;
+
+	int nameHash = StringToHash(pszName);
+
+	typedef std::unordered_multimap<int, int>::const_iterator constHandleIter_t;
+
+	{
+		CScopedReadLock rl(m_constHandleLock);
+
+		std::pair<constHandleIter_t, constHandleIter_t> range = m_constHandleMap.equal_range(nameHash);
+
+		for(constHandleIter_t it = range.first; it != range.second; ++it)
+		{
+			if(!strcmp(m_constHandleNames[it->second], pszName))
+				return it->second;
+		}
+	}
+
+	CScopedWriteLock wl(m_constHandleLock);
+
+	// other thread could add it while we were unlocked
+	std::pair<constHandleIter_t, constHandleIter_t> range = m_constHandleMap.equal_range(nameHash);
+
+	for(constHandleIter_t it = range.first; it != range.second; ++it)
+	{
+		if(!strcmp(m_constHandleNames[it->second], pszName))
+			return it->second;
+	}
+
+	int handle = m_constHandleNames.append(m_constHandleNameArena.AllocString(pszName));
+	m_constHandleMap.insert(std::unordered_multimap<int, int>::value_type(nameHash, handle));
+
+	return handle;
+}
+
+// Returns constant name of the handle
+const char* ShaderAPI_Base::GetShaderConstantName(int handle)
+{
+	CScopedReadLock rl(m_constHandleLock);
+
+	if(!m_constHandleNames.inRange(handle))
+		return NULL;
 
-	return bResult;
+	// strings are in arena and never moved
+	return m_constHandleNames[handle];
 }
 
 // Shader constants setup
@@ -14,13 +14,24 @@
 #include "renderers/IShaderAPI.h"
 #include "utils/DkList.h"
 #include "utils/eqthread.h"
+#include "utils/MemoryArena.h"
+
+#include <unordered_map>
 
 using namespace Threading;
 
+typedef std::unordered_multimap<int, ITexture*> textureMap_t;
+typedef std::unordered_multimap<int, IShaderProgram*> shaderProgramMap_t;
+
+struct shaderSourceCache_t;
+struct shaderVariant_t;
+
 class ConCommandBase;
+class CTexture;
 
 class ShaderAPI_Base : public IShaderAPI
 {
+	friend class CTextureStreamerThread;
 public:
 										ShaderAPI_Base();
 
@@ -105,9 +116,28 @@ public:
 	// Finds texture by name
 	ITexture*							FindTexture(const char* pszName);
 
+	// adds texture to the list and name map. Must be used instead of m_TextureList.append. m_Mutex must be locked
+	void								AddTextureToList(ITexture* pTexture);
+
+	// removes texture from the list and name map. Returns false if texture wasn't there. m_Mutex must be locked
+	bool								RemoveTextureFromList(ITexture* pTexture);
+
 	// Error texture generator
 	ITexture*							GenerateErrorTexture(int nFlags = 0);
 
+//-------------------------------------------------------------
+// Texture streaming
+//-------------------------------------------------------------
+
+	// updates texture mip streaming. Called by material system at the end of frame
+	void								UpdateTextureStreaming();
+
+	// sets size of the texture on screen in pixels. Streaming will not load the mips bigger than that
+	void								SetTextureStreamingSize(ITexture* pTexture, int screenSize);
+
+	// prints resident and streaming textures
+	void								PrintTextureStreamingInfo();
+
 //-------------------------------------------------------------
 // Texture operations
 //-------------------------------------------------------------
@@ -155,9 +185,33 @@ public:
 // Shaders and it's operations
 //-------------------------------------------------------------
 
+	// Search for existing shader program by it's name and permutation query
+	IShaderProgram*						FindShaderProgram(const char* pszName, const char* query = NULL);
+
+	// adds shader program to the list and name map. Must be used instead of m_ShaderList.append
+	void								AddShaderProgramToList(IShaderProgram* pProgram);
+
+	// removes shader program from the list and name map. Returns false if program wasn't there
+	bool								RemoveShaderProgramFromList(IShaderProgram* pProgram);
+
 	// Loads and compiles shaders from files
 	bool								LoadShadersFromFile(IShaderProgram* pShaderOutput, const char* pszFilePrefix, const char *extra = NULL);
 
+	// writes the shader permutations that were loaded to the variant list file
+	bool								SaveShaderVariants(const char* pszFileName);
+
+	// compiles the permutations from variant list file, fills the shader caches. Returns number of compiled programs
+	int									PrebuildShaderVariants(const char* pszFileName);
+
+	// drops shader sources and prebuilt programs, so they are loaded from disk again
+	void								ReloadShaderSources();
+
+	// Returns global shader constant handle, valid for any shader program
+	int									GetShaderConstantHandle(const char *pszName);
+
+	// Returns constant name of the handle
+	const char*							GetShaderConstantName(int handle);
+
 	// Shader constants setup
 	int									SetShaderConstantInt(const char *pszName, const int constant, int const_id = -1);
 	int									SetShaderConstantFloat(const char *pszName, const float constant, int const_id = -1);
@@ -190,7 +244,46 @@ protected:
 	
 	bool								RestoreTextureInternal(ITexture* pTexture);
 
-	virtual void						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sSamplingParams,int nFlags = 0) = 0;
+	// releases the texture data, CreateTextureInternal does it when it replaces the images of texture
+	virtual void						ReleaseTextureInternal(ITexture* pTexture) {}
+
+	// returns top mip level to be loaded first, zero if texture is not streamed
+	int									GetTextureStreamingBaseMip(const CImage* pImage, int nFlags) const;
+
+	// sends the request to load mips starting from firstMip. m_Mutex must be locked
+	void								RequestTextureMips(CTexture* pTexture, int firstMip);
+
+	// puts loaded mip levels to the textures
+	void								ApplyStreamedTextures();
+
+	// forces texture units holding the texture to be re-bound on the next ApplyTextures
+	void								InvalidateTextureBindings(ITexture* pTexture);
+
+	// loads the requested mip levels. Streamer thread only
+	void								ProcessStreamingRequests();
+
+	// sorts textures by streaming priority, most used first
+	static int							CompareTextureStreamUsage(CTexture* const& a, CTexture* const& b);
+
+	// marks texture as being loaded. Returns false if other thread is loading it already
+	bool								BeginTextureLoading(int nameHash);
+	void								EndTextureLoading(int nameHash);
+
+	ITexture*							FindLoadedTexture(const char* pszFileName, const EqString& texturePathExt, const EqString& textureAnimPathExt);
+
+	// creates texture or replaces images of existing one. Existing texture keeps it's images if that fails
+	virtual bool						CreateTextureInternal(ITexture** pTex, const DkList<CImage*>& pImages, const SamplerStateParam_t& sSamplingParams,int nFlags = 0) = 0;
+
+	// returns descriptor and preprocessed sources of the shader, loads them once.
+	// Must be released with ReleaseShaderSources
+	shaderSourceCache_t*				GetShaderSources(const char* pszFilePrefix);
+	void								ReleaseShaderSources(shaderSourceCache_t* sources);
+
+	// releases cached shader sources
+	void								ClearShaderSources();
+
+	// releases the programs which were kept loaded by PrebuildShaderVariants
+	void								ReleasePrebuiltShaders();
 
 //-------------------------------------------------------------
 // Useful data
@@ -202,6 +295,22 @@ protected:
 	// Shader list
 	DkList<IShaderProgram*>				m_ShaderList;
 
+	// shader programs by name and query hash
+	shaderProgramMap_t					m_shaderMap;
+	CEqReadWriteLock					m_shaderMapLock;
+
+	// shader descriptors and preprocessed sources by file prefix hash.
+	// They are shared by all permutations and kept until reload or shutdown
+	std::unordered_multimap<int, shaderSourceCache_t*>	m_shaderSources;
+	CEqReadWriteLock					m_shaderSourcesLock;
+
+	// successfully loaded permutations, for SaveShaderVariants
+	DkList<shaderVariant_t*>			m_shaderVariants;
+	CEqMutex							m_shaderVariantsMutex;
+
+	// programs compiled by PrebuildShaderVariants, referenced until reload
+	DkList<IShaderProgram*>				m_prebuiltShaders;
+
 	// List of dynamically added sampler states
 	DkList<IRenderState*>				m_SamplerStates;
 
@@ -214,9 +323,40 @@ protected:
 	// List of dynamically added rasterizer states
 	DkList<IRenderState*>				m_RasterizerStates;
 
-	// Loaded textures list
+	// Loaded textures list, guarded by m_Mutex
 	DkList<ITexture*>					m_TextureList;
 
+	// textures by name hash, lock allows FindTexture without m_Mutex
+	textureMap_t						m_textureMap;
+	CEqReadWriteLock					m_textureMapLock;
+
+	// name hashes of textures being loaded by other threads
+	DkList<int>							m_loadingTextures;
+	CEqSignal							m_textureLoadedSignal;
+
+	// texture streaming
+	struct texStreamRequest_t
+	{
+		CTexture*	texture;
+		CImage*		image;
+		EqString	fileName;
+		int			firstMip;
+	};
+
+	DkList<texStreamRequest_t*>			m_streamRequests;
+	DkList<texStreamRequest_t*>			m_streamCompleted;
+	CEqMutex							m_streamMutex;
+
+	uint								m_streamFrame;
+	int									m_streamNumUploads;
+	int									m_streamNumEvictions;
+
+	// shader constant handles. Handles are never released
+	std::unordered_multimap<int, int>	m_constHandleMap;		// name hash to handle
+	DkList<const char*>					m_constHandleNames;
+	CMemoryArena						m_constHandleNameArena;
+	CEqReadWriteLock					m_constHandleLock;
+
 	// occlusion queries
 	DkList<IOcclusionQuery*>			m_OcclusionQueryList;
 
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Shader constant handle to program constant index map
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHADERCONSTANTMAP_H
+#define SHADERCONSTANTMAP_H
+
+#include "core/ppmem.h"
+#include "core/dktypes.h"
+
+#define SHADERCONST_UNRESOLVED		(-2)
+
+//
+// Constant handles are global (see IShaderAPI::GetShaderConstantHandle),
+// each program resolves them to it's constant indices on first use.
+// Accessed only by the rendering thread, like the rest of program state
+//
+class CShaderConstantMap
+{
+public:
+			CShaderConstantMap() : m_indices(NULL), m_numIndices(0) {}
+			~CShaderConstantMap()	{ PPFree(m_indices); }
+
+	// returns constant index or SHADERCONST_UNRESOLVED if handle wasn't resolved yet. -1 if program has no such constant
+	int		Get(int handle) const	{ return handle < m_numIndices ? m_indices[handle] : SHADERCONST_UNRESOLVED; }
+
+	void	Set(int handle, int index)
+	{
+		if(handle >= m_numIndices)
+		{
+			int newNum = (handle + 32) & ~31;
+
+			m_indices = (short*)PPReAlloc(m_indices, newNum * sizeof(short));
+
+			for(int i = m_numIndices; i < newNum; i++)
+				m_indices[i] = SHADERCONST_UNRESOLVED;
+
+			m_numIndices = newNum;
+		}
+
+		m_indices[handle] = index;
+	}
+
+	// must be called when program constants are changed
+	void	Clear()
+	{
+		for(int i = 0; i < m_numIndices; i++)
+			m_indices[i] = SHADERCONST_UNRESOLVED;
+	}
+
+protected:
+	short*	m_indices;
+	int		m_numIndices;
+
+			CShaderConstantMap( const CShaderConstantMap& s ) {}
+	void	operator=( const CShaderConstantMap& s ) {}
+};
+
+#endif // SHADERCONSTANTMAP_H
@@ -0,0 +1,1329 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Deferred ShaderAPI. Records frame into command stream which is
+//				replayed by the render thread on the real ShaderAPI
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderAPIDeferred.h"
+
+#include "core/DebugInterface.h"
+#include "core/ConCommand.h"
+#include "core/ppmem.h"
+
+#include "utils/eqtimer.h"
+
+#include "Renderers/Shared/IRenderLibrary.h"
+
+using namespace Threading;
+
+#define COMMAND_STREAM_GRANULARITY	(64*1024)
+#define COMMAND_ALIGN(x)			(((x) + 7) & ~7)
+
+// command stream opcodes
+enum EDeferredCommand
+{
+	DCMD_RESET = 0,				// flags
+	DCMD_APPLY,
+	DCMD_APPLY_TEXTURES,
+	DCMD_APPLY_SAMPLERS,
+	DCMD_APPLY_BLENDSTATE,
+	DCMD_APPLY_DEPTHSTATE,
+	DCMD_APPLY_RASTERSTATE,
+	DCMD_APPLY_BUFFERS,
+	DCMD_APPLY_SHADER,
+	DCMD_APPLY_CONSTANTS,
+
+	DCMD_CLEAR,					// deferredClear_t
+	DCMD_FLUSH,
+	DCMD_RESET_COUNTERS,
+
+	DCMD_VIEWPORT,				// x, y, w, h
+	DCMD_SCISSOR,				// IRectangle
+	DCMD_DEPTHRANGE,			// near, far
+
+	DCMD_BLENDSTATE,			// state
+	DCMD_DEPTHSTATE,			// state
+	DCMD_RASTERSTATE,			// state
+
+	DCMD_TEXTURE,				// deferredTexture_t, name
+	DCMD_SHADER,				// program
+	DCMD_CONSTANT,				// handle, size, data
+
+	DCMD_VERTEXFORMAT,			// format, change
+	DCMD_VERTEXBUFFER,			// deferredVertexBuffer_t
+	DCMD_INDEXBUFFER,			// buffer, change
+
+	DCMD_MATRIX_MODE,			// mode
+	DCMD_MATRIX_PUSH,
+	DCMD_MATRIX_POP,
+	DCMD_MATRIX_IDENTITY,
+	DCMD_MATRIX_LOAD,			// matrix
+
+	DCMD_DRAW_INDEXED,			// type, firstIndex, numIndices, firstVertex, numVertices, baseVertex
+	DCMD_DRAW,					// type, firstVertex, numVertices
+
+	DCMD_RENDERTARGETS,			// deferredRenderTargets_t
+	DCMD_BACKBUFFER,
+
+	DCMD_COPY_FRAMEBUFFER,		// texture
+	DCMD_COPY_RENDERTARGET,		// deferredCopyRT_t
+	DCMD_SAVE_RENDERTARGET,		// texture, file name
+
+	DCMD_TEXTURE_STREAMING,
+
+	DCMD_BEGIN_FRAME,
+	DCMD_END_FRAME,				// swap chain
+
+	DCMD_VB_UPDATE,				// deferredBufferUpload_t, data
+	DCMD_IB_UPDATE,				// deferredBufferUpload_t, data
+	DCMD_VB_WRITE,				// deferredBufferUpload_t, data
+	DCMD_IB_WRITE,				// deferredBufferUpload_t, data
+};
+
+struct deferredCmdHdr_t
+{
+	int		cmd;
+	int		size;
+};
+
+struct deferredClear_t
+{
+	ColorRGBA	fillColor;
+	float		depth;
+	int			stencil;
+	bool		color;
+	bool		depthClear;
+	bool		stencilClear;
+};
+
+struct deferredTexture_t
+{
+	ITexture*	texture;
+	int			index;
+	int			nameLen;	// name follows. 0 if no name
+};
+
+struct deferredVertexBuffer_t
+{
+	IVertexBuffer*	buffer;
+	intptr			offset;
+	int				stream;
+	bool			change;
+};
+
+struct deferredRenderTargets_t
+{
+	ITexture*	renderTargets[MAX_MRTS];
+	int			cubeFaces[MAX_MRTS];
+	ITexture*	depthTarget;
+	int			numRTs;
+	int			depthSlice;
+	bool		hasFaces;
+};
+
+struct deferredCopyRT_t
+{
+	ITexture*	src;
+	ITexture*	dest;
+	IRectangle	srcRect;
+	IRectangle	destRect;
+	bool		hasSrcRect;
+	bool		hasDestRect;
+};
+
+struct deferredBufferUpload_t
+{
+	void*		buffer;		// real buffer
+	int			offset;		// in elements
+	int			size;		// in elements
+	int			byteSize;
+	bool		discard;
+};
+
+//--------------------------------------------------------------------------------
+
+CRenderCommandStream::CRenderCommandStream() : m_data(NULL), m_size(0), m_allocated(0), m_numCommands(0)
+{
+}
+
+CRenderCommandStream::~CRenderCommandStream()
+{
+	PPFree(m_data);
+}
+
+void* CRenderCommandStream::AllocCommand(int cmd, int size)
+{
+	int recordSize = sizeof(deferredCmdHdr_t) + COMMAND_ALIGN(size);
+
+	if(m_size + recordSize > m_allocated)
+	{
+		int newAllocated = m_allocated + max(recordSize, COMMAND_STREAM_GRANULARITY);
+		m_data = (ubyte*)PPReAlloc(m_data, newAllocated);
+		m_allocated = newAllocated;
+	}
+
+	deferredCmdHdr_t* hdr = (deferredCmdHdr_t*)(m_data + m_size);
+	hdr->cmd = cmd;
+	hdr->size = COMMAND_ALIGN(size);
+
+	m_size += recordSize;
+	m_numCommands++;
+
+	return hdr+1;
+}
+
+void CRenderCommandStream::Clear()
+{
+	m_size = 0;
+	m_numCommands = 0;
+	m_destroys.clear(false);
+}
+
+//--------------------------------------------------------------------------------
+
+CDeferredVertexBuffer::CDeferredVertexBuffer(ShaderAPIDeferred* owner, IVertexBuffer* target)
+	: m_owner(owner), m_target(target), m_lockData(NULL), m_lockAllocated(0), m_lockOfs(0), m_lockSize(0), m_lockDirect(false)
+{
+}
+
+CDeferredVertexBuffer::~CDeferredVertexBuffer()
+{
+	PPFree(m_lockData);
+}
+
+void CDeferredVertexBuffer::Update(void* data, int size, int offset, bool discard)
+{
+	m_owner->RecordBufferUpload(DCMD_VB_UPDATE, m_target, data, offset, size, size*m_target->GetStrideSize(), discard);
+}
+
+bool CDeferredVertexBuffer::Lock(int lockOfs, int sizeToLock, void** outdata, bool readOnly)
+{
+	// reading needs contents written by render thread. Writes to static buffers are staged too
+	if(readOnly)
+	{
+		m_owner->WaitForRenderThread();
+
+		m_lockDirect = true;
+		return m_target->Lock(lockOfs, sizeToLock, outdata, readOnly);
+	}
+
+	int byteSize = sizeToLock*m_target->GetStrideSize();
+
+	if(byteSize > m_lockAllocated)
+	{
+		m_lockData = (ubyte*)PPReAlloc(m_lockData, byteSize);
+		m_lockAllocated = byteSize;
+	}
+
+	m_lockOfs = lockOfs;
+	m_lockSize = sizeToLock;
+	m_lockDirect = false;
+
+	*outdata = m_lockData;
+
+	return true;
+}
+
+void CDeferredVertexBuffer::Unlock()
+{
+	if(m_lockDirect)
+	{
+		m_target->Unlock();
+		m_lockDirect = false;
+		return;
+	}
+
+	m_owner->RecordBufferUpload(DCMD_VB_WRITE, m_target, m_lockData, m_lockOfs, m_lockSize, m_lockSize*m_target->GetStrideSize(), true);
+}
+
+//--------------------------------------------------------------------------------
+
+CDeferredIndexBuffer::CDeferredIndexBuffer(ShaderAPIDeferred* owner, IIndexBuffer* target)
+	: m_owner(owner), m_target(target), m_lockData(NULL), m_lockAllocated(0), m_lockOfs(0), m_lockSize(0), m_lockDirect(false)
+{
+}
+
+CDeferredIndexBuffer::~CDeferredIndexBuffer()
+{
+	PPFree(m_lockData);
+}
+
+void CDeferredIndexBuffer::Update(void* data, int size, int offset, bool discard)
+{
+	m_owner->RecordBufferUpload(DCMD_IB_UPDATE, m_target, data, offset, size, size*m_target->GetIndexSize(), discard);
+}
+
+bool CDeferredIndexBuffer::Lock(int lockOfs, int sizeToLock, void** outdata, bool readOnly)
+{
+	if(readOnly)
+	{
+		m_owner->WaitForRenderThread();
+
+		m_lockDirect = true;
+		return m_target->Lock(lockOfs, sizeToLock, outdata, readOnly);
+	}
+
+	int byteSize = sizeToLock*m_target->GetIndexSize();
+
+	if(byteSize > m_lockAllocated)
+	{
+		m_lockData = (ubyte*)PPReAlloc(m_lockData, byteSize);
+		m_lockAllocated = byteSize;
+	}
+
+	m_lockOfs = lockOfs;
+	m_lockSize = sizeToLock;
+	m_lockDirect = false;
+
+	*outdata = m_lockData;
+
+	return true;
+}
+
+void CDeferredIndexBuffer::Unlock()
+{
+	if(m_lockDirect)
+	{
+		m_target->Unlock();
+		m_lockDirect = false;
+		return;
+	}
+
+	m_owner->RecordBufferUpload(DCMD_IB_WRITE, m_target, m_lockData, m_lockOfs, m_lockSize, m_lockSize*m_target->GetIndexSize(), true);
+}
+
+//--------------------------------------------------------------------------------
+
+int CRenderThread::Run()
+{
+	CEqTimer timer;
+
+	CRenderCommandStream* stream = m_api->m_executeStream;
+
+	if(stream)
+	{
+		m_api->ExecuteStream(*stream);
+		m_api->m_executeStream = NULL;
+	}
+
+	m_api->m_executeMs = timer.GetTime() * 1000.0f;
+
+	return 0;
+}
+
+//--------------------------------------------------------------------------------
+
+static ShaderAPIDeferred* s_deferredAPI = NULL;
+
+DECLARE_CMD(r_renderThreadInfo, "Prints render thread statistics of last frame", 0)
+{
+	ShaderAPIDeferred* api = s_deferredAPI;
+
+	if(!api)
+	{
+		MsgWarning("Render thread is not enabled\n");
+		return;
+	}
+
+	const renderThreadStats_t& stats = api->GetLastFrameStats();
+
+	MsgInfo("Render thread: %s\n", api->IsRenderThreadRunning() ? "running" : "stopped");
+	MsgInfo("  commands: %d (%.2f KB)\n", stats.commands, stats.streamBytes / 1024.0f);
+	MsgInfo("  main thread wait: %.2f ms\n", stats.recordWaitMs);
+	MsgInfo("  execution: %.2f ms\n", stats.executeMs);
+	MsgInfo("  draw calls: %d (%d indexed), triangles: %d\n", stats.drawCalls, stats.drawIndexedCalls, stats.triangles);
+}
+
+ShaderAPIDeferred::ShaderAPIDeferred(IShaderAPI* target, IRenderLibrary* renderLib)
+	: m_target(target), m_renderLib(renderLib), m_recordStream(0), m_executeStream(NULL), m_depthTarget(NULL), m_recordWaitMs(0.0f), m_executeMs(0.0f)
+{
+	m_renderThread.m_api = this;
+	m_mainThreadId = GetCurrentThreadID();
+
+	s_deferredAPI = this;
+
+	memset(m_viewport, 0, sizeof(m_viewport));
+	memset(m_textures, 0, sizeof(m_textures));
+	memset(m_vertexTextures, 0, sizeof(m_vertexTextures));
+	memset(m_renderTargets, 0, sizeof(m_renderTargets));
+	memset(m_renderTargetFaces, 0, sizeof(m_renderTargetFaces));
+	memset(&m_lastFrameStats, 0, sizeof(m_lastFrameStats));
+	m_numRTs = 0;
+}
+
+ShaderAPIDeferred::~ShaderAPIDeferred()
+{
+	StopRenderThread();
+
+	s_deferredAPI = NULL;
+}
+
+void ShaderAPIDeferred::StartRenderThread()
+{
+	if(m_renderThread.IsRunning())
+		return;
+
+	m_renderThread.StartWorkerThread("RenderThread", TP_ABOVE_NORMAL);
+}
+
+void ShaderAPIDeferred::StopRenderThread()
+{
+	if(!m_renderThread.IsRunning())
+		return;
+
+	WaitForRenderThread();
+	m_renderThread.StopThread(true);
+}
+
+void ShaderAPIDeferred::Shutdown()
+{
+	StopRenderThread();
+
+	// execute everything left
+	WaitForRenderThread();
+
+	m_target->Shutdown();
+}
+
+void ShaderAPIDeferred::SubmitFrame()
+{
+	CEqTimer timer;
+
+	// render thread is still busy with previous frame
+	if(m_renderThread.IsRunning())
+		m_renderThread.WaitForThread();
+
+	m_recordWaitMs = timer.GetTime() * 1000.0f;
+
+	CRenderCommandStream* stream;
+	{
+		CScopedMutex m(m_destroyMutex);
+
+		stream = &m_streams[m_recordStream];
+		m_recordStream = !m_recordStream;
+	}
+
+	m_lastFrameStats.commands = stream->GetNumCommands();
+	m_lastFrameStats.streamBytes = stream->GetSize();
+	m_lastFrameStats.recordWaitMs = m_recordWaitMs;
+	m_lastFrameStats.executeMs = m_executeMs;
+
+	// render thread is idle, previous frame counters are complete
+	m_lastFrameStats.drawCalls = m_target->GetDrawCallsCount();
+	m_lastFrameStats.drawIndexedCalls = m_target->GetDrawIndexedPrimitiveCallsCount();
+	m_lastFrameStats.triangles = m_target->GetTrianglesCount();
+
+	if(m_renderThread.IsRunning())
+	{
+		m_executeStream = stream;
+		m_renderThread.SignalWork();
+	}
+	else
+		ExecuteStream(*stream);
+}
+
+void ShaderAPIDeferred::WaitForRenderThread()
+{
+	// other threads (loaders) can only wait for the submitted frame
+	if(GetCurrentThreadID() != m_mainThreadId)
+	{
+		if(m_renderThread.IsRunning())
+			m_renderThread.WaitForThread();
+
+		return;
+	}
+
+	SubmitFrame();
+
+	if(m_renderThread.IsRunning())
+		m_renderThread.WaitForThread();
+}
+
+void* ShaderAPIDeferred::RecordCommand(int cmd, int size)
+{
+	return m_streams[m_recordStream].AllocCommand(cmd, size);
+}
+
+void ShaderAPIDeferred::RecordBufferUpload(int cmd, void* buffer, const void* data, int offset, int size, int byteSize, bool discard)
+{
+	if(!data || size <= 0)
+		return;
+
+	deferredBufferUpload_t* upload = (deferredBufferUpload_t*)RecordCommand(cmd, sizeof(deferredBufferUpload_t) + byteSize);
+	upload->buffer = buffer;
+	upload->offset = offset;
+	upload->size = size;
+	upload->byteSize = byteSize;
+	upload->discard = discard;
+
+	memcpy(upload+1, data, byteSize);
+}
+
+void ShaderAPIDeferred::DeferDestroy(void* object, int type, bool removeAllRefs)
+{
+	if(!object)
+		return;
+
+	CScopedMutex m(m_destroyMutex);
+
+	deferredDestroy_t destroy;
+	destroy.object = object;
+	destroy.type = type;
+	destroy.removeAllRefs = removeAllRefs;
+
+	m_streams[m_recordStream].m_destroys.append(destroy);
+}
+
+void ShaderAPIDeferred::ExecuteStream(CRenderCommandStream& stream)
+{
+	IShaderAPI* api = m_target;
+
+	const ubyte* data = stream.GetData();
+	const ubyte* dataEnd = data + stream.GetSize();
+
+	while(data < dataEnd)
+	{
+		const deferredCmdHdr_t* hdr = (const deferredCmdHdr_t*)data;
+		const ubyte* params = (const ubyte*)(hdr+1);
+
+		data = params + hdr->size;
+
+		switch(hdr->cmd)
+		{
+			case DCMD_RESET:
+				api->Reset(*(int*)params);
+				break;
+			case DCMD_APPLY:
+				api->Apply();
+				break;
+			case DCMD_APPLY_TEXTURES:
+				api->ApplyTextures();
+				break;
+			case DCMD_APPLY_SAMPLERS:
+				api->ApplySamplerState();
+				break;
+			case DCMD_APPLY_BLENDSTATE:
+				api->ApplyBlendState();
+				break;
+			case DCMD_APPLY_DEPTHSTATE:
+				api->ApplyDepthState();
+				break;
+			case DCMD_APPLY_RASTERSTATE:
+				api->ApplyRasterizerState();
+				break;
+			case DCMD_APPLY_BUFFERS:
+				api->ApplyBuffers();
+				break;
+			case DCMD_APPLY_SHADER:
+				api->ApplyShaderProgram();
+				break;
+			case DCMD_APPLY_CONSTANTS:
+				api->ApplyConstants();
+				break;
+			case DCMD_CLEAR:
+			{
+				const deferredClear_t* clr = (const deferredClear_t*)params;
+				api->Clear(clr->color, clr->depthClear, clr->stencilClear, clr->fillColor, clr->depth, clr->stencil);
+				break;
+			}
+			case DCMD_FLUSH:
+				api->Flush();
+				break;
+			case DCMD_RESET_COUNTERS:
+				api->ResetCounters();
+				break;
+			case DCMD_VIEWPORT:
+			{
+				const int* vp = (const int*)params;
+				api->SetViewport(vp[0], vp[1], vp[2], vp[3]);
+				break;
+			}
+			case DCMD_SCISSOR:
+				api->SetScissorRectangle(*(const IRectangle*)params);
+				break;
+			case DCMD_DEPTHRANGE:
+			{
+				const float* range = (const float*)params;
+				api->SetDepthRange(range[0], range[1]);
+				break;
+			}
+			case DCMD_BLENDSTATE:
+				api->SetBlendingState(*(IRenderState**)params);
+				break;
+			case DCMD_DEPTHSTATE:
+				api->SetDepthStencilState(*(IRenderState**)params);
+				break;
+			case DCMD_RASTERSTATE:
+				api->SetRasterizerState(*(IRenderState**)params);
+				break;
+			case DCMD_TEXTURE:
+			{
+				const deferredTexture_t* tex = (const deferredTexture_t*)params;
+				api->SetTexture(tex->texture, tex->nameLen ? (const char*)(tex+1) : NULL, tex->index);
+				break;
+			}
+			case DCMD_SHADER:
+				api->SetShader(*(IShaderProgram**)params);
+				break;
+			case DCMD_CONSTANT:
+			{
+				const int* cnst = (const int*)params;
+				api->SetShaderConstantRaw(NULL, cnst+2, cnst[1], cnst[0]);
+				break;
+			}
+			case DCMD_VERTEXFORMAT:
+			{
+				IVertexFormat* fmt = *(IVertexFormat**)params;
+
+				if(*(bool*)(params + sizeof(IVertexFormat*)))
+					api->ChangeVertexFormat(fmt);
+				else
+					api->SetVertexFormat(fmt);
+				break;
+			}
+			case DCMD_VERTEXBUFFER:
+			{
+				const deferredVertexBuffer_t* vb = (const deferredVertexBuffer_t*)params;
+
+				if(vb->change)
+					api->ChangeVertexBuffer(vb->buffer, vb->stream, vb->offset);
+				else
+					api->SetVertexBuffer(vb->buffer, vb->stream, vb->offset);
+				break;
+			}
+			case DCMD_INDEXBUFFER:
+			{
+				IIndexBuffer* ib = *(IIndexBuffer**)params;
+
+				if(*(bool*)(params + sizeof(IIndexBuffer*)))
+					api->ChangeIndexBuffer(ib);
+				else
+					api->SetIndexBuffer(ib);
+				break;
+			}
+			case DCMD_MATRIX_MODE:
+				api->SetMatrixMode((ER_MatrixMode)*(int*)params);
+				break;
+			case DCMD_MATRIX_PUSH:
+				api->PushMatrix();
+				break;
+			case DCMD_MATRIX_POP:
+				api->PopMatrix();
+				break;
+			case DCMD_MATRIX_IDENTITY:
+				api->LoadIdentityMatrix();
+				break;
+			case DCMD_MATRIX_LOAD:
+			{
+				Matrix4x4 mat;
+				memcpy(&mat, params, sizeof(Matrix4x4));
+				api->LoadMatrix(mat);
+				break;
+			}
+			case DCMD_DRAW_INDEXED:
+			{
+				const int* p = (const int*)params;
+				api->DrawIndexedPrimitives((ER_PrimitiveType)p[0], p[1], p[2], p[3], p[4], p[5]);
+				break;
+			}
+			case DCMD_DRAW:
+			{
+				const int* p = (const int*)params;
+				api->DrawNonIndexedPrimitives((ER_PrimitiveType)p[0], p[1], p[2]);
+				break;
+			}
+			case DCMD_RENDERTARGETS:
+			{
+				deferredRenderTargets_t rt;
+				memcpy(&rt, params, sizeof(rt));
+				api->ChangeRenderTargets(rt.renderTargets, rt.numRTs, rt.hasFaces ? rt.cubeFaces : NULL, rt.depthTarget, rt.depthSlice);
+				break;
+			}
+			case DCMD_BACKBUFFER:
+				api->ChangeRenderTargetToBackBuffer();
+				break;
+			case DCMD_COPY_FRAMEBUFFER:
+				api->CopyFramebufferToTexture(*(ITexture**)params);
+				break;
+			case DCMD_COPY_RENDERTARGET:
+			{
+				deferredCopyRT_t cp;
+				memcpy(&cp, params, sizeof(cp));
+				api->CopyRendertargetToTexture(cp.src, cp.dest, cp.hasSrcRect ? &cp.srcRect : NULL, cp.hasDestRect ? &cp.destRect : NULL);
+				break;
+			}
+			case DCMD_SAVE_RENDERTARGET:
+				api->SaveRenderTarget(*(ITexture**)params, (const char*)(params + sizeof(ITexture*)));
+				break;
+			case DCMD_TEXTURE_STREAMING:
+				api->UpdateTextureStreaming();
+				break;
+			case DCMD_BEGIN_FRAME:
+				m_renderLib->BeginFrame();
+				break;
+			case DCMD_END_FRAME:
+				m_renderLib->EndFrame(*(IEqSwapChain**)params);
+				break;
+			case DCMD_VB_UPDATE:
+			case DCMD_IB_UPDATE:
+			case DCMD_VB_WRITE:
+			case DCMD_IB_WRITE:
+			{
+				const deferredBufferUpload_t* upload = (const deferredBufferUpload_t*)params;
+				void* uploadData = (void*)(upload+1);
+
+				if(hdr->cmd == DCMD_VB_UPDATE)
+				{
+					((IVertexBuffer*)upload->buffer)->Update(uploadData, upload->size, upload->offset, upload->discard);
+				}
+				else if(hdr->cmd == DCMD_IB_UPDATE)
+				{
+					((IIndexBuffer*)upload->buffer)->Update(uploadData, upload->size, upload->offset, upload->discard);
+				}
+				else if(hdr->cmd == DCMD_VB_WRITE)
+				{
+					IVertexBuffer* vb = (IVertexBuffer*)upload->buffer;
+					void* dest = NULL;
+
+					if(vb->Lock(upload->offset, upload->size, &dest, false))
+					{
+						memcpy(dest, uploadData, upload->byteSize);
+						vb->Unlock();
+					}
+				}
+				else
+				{
+					IIndexBuffer* ib = (IIndexBuffer*)upload->buffer;
+					void* dest = NULL;
+
+					if(ib->Lock(upload->offset, upload->size, &dest, false))
+					{
+						memcpy(dest, uploadData, upload->byteSize);
+						ib->Unlock();
+					}
+				}
+				break;
+			}
+			default:
+				ASSERTMSG(false, "ShaderAPIDeferred::ExecuteStream - invalid command");
+				data = dataEnd;
+				break;
+		}
+	}
+
+	// objects released in this frame aren't used anymore
+	for(int i = 0; i < stream.m_destroys.numElem(); i++)
+	{
+		const deferredDestroy_t& destroy = stream.m_destroys[i];
+
+		switch(destroy.type)
+		{
+			case DEFERRED_DESTROY_TEXTURE:
+				api->FreeTexture((ITexture*)destroy.object);
+				break;
+			case DEFERRED_DESTROY_RENDERSTATE:
+				api->DestroyRenderState((IRenderState*)destroy.object, destroy.removeAllRefs);
+				break;
+			case DEFERRED_DESTROY_SHADERPROGRAM:
+				api->DestroyShaderProgram((IShaderProgram*)destroy.object);
+				break;
+			case DEFERRED_DESTROY_VERTEXFORMAT:
+				api->DestroyVertexFormat((IVertexFormat*)destroy.object);
+				break;
+			case DEFERRED_DESTROY_VERTEXBUFFER:
+				api->DestroyVertexBuffer((IVertexBuffer*)destroy.object);
+				break;
+			case DEFERRED_DESTROY_INDEXBUFFER:
+				api->DestroyIndexBuffer((IIndexBuffer*)destroy.object);
+				break;
+			case DEFERRED_DESTROY_OCCLUSIONQUERY:
+				api->DestroyOcclusionQuery((IOcclusionQuery*)destroy.object);
+				break;
+		}
+	}
+
+	stream.Clear();
+}
+
+//-------------------------------------------------------------
+// Frame
+//-------------------------------------------------------------
+
+void ShaderAPIDeferred::BeginFrame()
+{
+	RecordCommand(DCMD_BEGIN_FRAME);
+}
+
+void ShaderAPIDeferred::EndFrame(IEqSwapChain* swapChain)
+{
+	IEqSwapChain** p = (IEqSwapChain**)RecordCommand(DCMD_END_FRAME, sizeof(IEqSwapChain*));
+	*p = swapChain;
+}
+
+//-------------------------------------------------------------
+// Rendering's applies
+//-------------------------------------------------------------
+
+void ShaderAPIDeferred::Reset(int nResetTypeFlags)
+{
+	*(int*)RecordCommand(DCMD_RESET, sizeof(int)) = nResetTypeFlags;
+
+	if(nResetTypeFlags & STATE_RESET_TEX)
+	{
+		memset(m_textures, 0, sizeof(m_textures));
+		memset(m_vertexTextures, 0, sizeof(m_vertexTextures));
+	}
+}
+
+void ShaderAPIDeferred::Apply()					{RecordCommand(DCMD_APPLY);}
+void ShaderAPIDeferred::ApplyTextures()			{RecordCommand(DCMD_APPLY_TEXTURES);}
+void ShaderAPIDeferred::ApplySamplerState()		{RecordCommand(DCMD_APPLY_SAMPLERS);}
+void ShaderAPIDeferred::ApplyBlendState()		{RecordCommand(DCMD_APPLY_BLENDSTATE);}
+void ShaderAPIDeferred::ApplyDepthState()		{RecordCommand(DCMD_APPLY_DEPTHSTATE);}
+void ShaderAPIDeferred::ApplyRasterizerState()	{RecordCommand(DCMD_APPLY_RASTERSTATE);}
+void ShaderAPIDeferred::ApplyBuffers()			{RecordCommand(DCMD_APPLY_BUFFERS);}
+void ShaderAPIDeferred::ApplyShaderProgram()	{RecordCommand(DCMD_APPLY_SHADER);}
+void ShaderAPIDeferred::ApplyConstants()		{RecordCommand(DCMD_APPLY_CONSTANTS);}
+
+void ShaderAPIDeferred::Clear(bool bClearColor, bool bClearDepth, bool bClearStencil, const ColorRGBA &fillColor, float fDepth, int nStencil)
+{
+	deferredClear_t* clr = (deferredClear_t*)RecordCommand(DCMD_CLEAR, sizeof(deferredClear_t));
+	clr->fillColor = fillColor;
+	clr->depth = fDepth;
+	clr->stencil = nStencil;
+	clr->color = bClearColor;
+	clr->depthClear = bClearDepth;
+	clr->stencilClear = bClearStencil;
+}
+
+void ShaderAPIDeferred::ResetCounters()
+{
+	RecordCommand(DCMD_RESET_COUNTERS);
+}
+
+void ShaderAPIDeferred::Flush()
+{
+	RecordCommand(DCMD_FLUSH);
+}
+
+void ShaderAPIDeferred::Finish()
+{
+	WaitForRenderThread();
+	m_target->Finish();
+}
+
+//-------------------------------------------------------------
+// Destruction is deferred until render thread completes the frame
+//-------------------------------------------------------------
+
+void ShaderAPIDeferred::DestroyOcclusionQuery(IOcclusionQuery* pQuery)
+{
+	DeferDestroy(pQuery, DEFERRED_DESTROY_OCCLUSIONQUERY);
+}
+
+void ShaderAPIDeferred::FreeTexture(ITexture* pTexture)
+{
+	DeferDestroy(pTexture, DEFERRED_DESTROY_TEXTURE);
+}
+
+void ShaderAPIDeferred::DestroyRenderState(IRenderState* pState, bool removeAllRefs)
+{
+	DeferDestroy(pState, DEFERRED_DESTROY_RENDERSTATE, removeAllRefs);
+}
+
+void ShaderAPIDeferred::DestroyShaderProgram(IShaderProgram* pShaderProgram)
+{
+	DeferDestroy(pShaderProgram, DEFERRED_DESTROY_SHADERPROGRAM);
+}
+
+void ShaderAPIDeferred::DestroyVertexFormat(IVertexFormat* pFormat)
+{
+	DeferDestroy(pFormat, DEFERRED_DESTROY_VERTEXFORMAT);
+}
+
+void ShaderAPIDeferred::DestroyVertexBuffer(IVertexBuffer* pVertexBuffer)
+{
+	if(!pVertexBuffer)
+		return;
+
+	CDeferredVertexBuffer* buffer = (CDeferredVertexBuffer*)pVertexBuffer;
+
+	DeferDestroy(buffer->m_target, DEFERRED_DESTROY_VERTEXBUFFER);
+	delete buffer;
+}
+
+void ShaderAPIDeferred::DestroyIndexBuffer(IIndexBuffer* pIndexBuffer)
+{
+	if(!pIndexBuffer)
+		return;
+
+	CDeferredIndexBuffer* buffer = (CDeferredIndexBuffer*)pIndexBuffer;
+
+	DeferDestroy(buffer->m_target, DEFERRED_DESTROY_INDEXBUFFER);
+	delete buffer;
+}
+
+//-------------------------------------------------------------
+// Textures
+//-------------------------------------------------------------
+
+ITexture* ShaderAPIDeferred::CreateTexture(const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler, int nFlags)
+{
+	return m_target->CreateTexture(pImages, sampler, nFlags);
+}
+
+ITexture* ShaderAPIDeferred::LoadTexture(const char* pszFileName, ER_TextureFilterMode textureFilterType, ER_TextureAddressMode textureAddress, int nFlags)
+{
+	return m_target->LoadTexture(pszFileName, textureFilterType, textureAddress, nFlags);
+}
+
+ITexture* ShaderAPIDeferred::CreateProceduralTexture(const char* pszName, ETextureFormat nFormat, int width, int height, int depth, int arraySize,
+														ER_TextureFilterMode texFilter, ER_TextureAddressMode textureAddress,
+														int nFlags, int nDataSize, const unsigned char* pData)
+{
+	return m_target->CreateProceduralTexture(pszName, nFormat, width, height, depth, arraySize, texFilter, textureAddress, nFlags, nDataSize, pData);
+}
+
+ITexture* ShaderAPIDeferred::CreateRenderTarget(int width, int height, ETextureFormat nRTFormat, ER_TextureFilterMode textureFilterType,
+												ER_TextureAddressMode textureAddress, ER_CompareFunc comparison, int nFlags)
+{
+	return m_target->CreateRenderTarget(width, height, nRTFormat, textureFilterType, textureAddress, comparison, nFlags);
+}
+
+ITexture* ShaderAPIDeferred::CreateNamedRenderTarget(const char* pszName, int width, int height, ETextureFormat nRTFormat, ER_TextureFilterMode textureFilterType,
+													ER_TextureAddressMode textureAddress, ER_CompareFunc comparison, int nFlags)
+{
+	return m_target->CreateNamedRenderTarget(pszName, width, height, nRTFormat, textureFilterType, textureAddress, comparison, nFlags);
+}
+
+void ShaderAPIDeferred::UpdateTextureStreaming()
+{
+	RecordCommand(DCMD_TEXTURE_STREAMING);
+}
+
+//-------------------------------------------------------------
+// Texture operations
+//-------------------------------------------------------------
+
+void ShaderAPIDeferred::SaveRenderTarget(ITexture* pTargetTexture, const char* pFileName)
+{
+	int nameLen = strlen(pFileName);
+
+	ubyte* params = (ubyte*)RecordCommand(DCMD_SAVE_RENDERTARGET, sizeof(ITexture*) + nameLen + 1);
+	*(ITexture**)params = pTargetTexture;
+	memcpy(params + sizeof(ITexture*), pFileName, nameLen + 1);
+}
+
+void ShaderAPIDeferred::CopyFramebufferToTexture(ITexture* pTargetTexture)
+{
+	*(ITexture**)RecordCommand(DCMD_COPY_FRAMEBUFFER, sizeof(ITexture*)) = pTargetTexture;
+}
+
+void ShaderAPIDeferred::CopyRendertargetToTexture(ITexture* srcTarget, ITexture* destTex, IRectangle* srcRect, IRectangle* destRect)
+{
+	deferredCopyRT_t cp = deferredCopyRT_t();
+
+	cp.src = srcTarget;
+	cp.dest = destTex;
+	cp.hasSrcRect = (srcRect != NULL);
+	cp.hasDestRect = (destRect != NULL);
+
+	if(srcRect)
+		cp.srcRect = *srcRect;
+
+	if(destRect)
+		cp.destRect = *destRect;
+
+	memcpy(RecordCommand(DCMD_COPY_RENDERTARGET, sizeof(cp)), &cp, sizeof(cp));
+}
+
+void ShaderAPIDeferred::ChangeRenderTarget(ITexture* pRenderTarget, int nCubemapFace, ITexture* pDepthTarget, int nDepthSlice)
+{
+	ChangeRenderTargets(&pRenderTarget, 1, &nCubemapFace, pDepthTarget, nDepthSlice);
+}
+
+void ShaderAPIDeferred::ChangeRenderTargets(ITexture** pRenderTargets, int nNumRTs, int* nCubemapFaces, ITexture* pDepthTarget, int nDepthSlice)
+{
+	deferredRenderTargets_t rt;
+	memset(&rt, 0, sizeof(rt));
+
+	nNumRTs = min(nNumRTs, MAX_MRTS);
+
+	for(int i = 0; i < nNumRTs; i++)
+	{
+		rt.renderTargets[i] = pRenderTargets[i];
+		rt.cubeFaces[i] = nCubemapFaces ? nCubemapFaces[i] : 0;
+	}
+
+	rt.numRTs = nNumRTs;
+	rt.depthTarget = pDepthTarget;
+	rt.depthSlice = nDepthSlice;
+	rt.hasFaces = (nCubemapFaces != NULL);
+
+	memcpy(RecordCommand(DCMD_RENDERTARGETS, sizeof(rt)), &rt, sizeof(rt));
+
+	// keep for GetCurrentRenderTargets
+	memcpy(m_renderTargets, rt.renderTargets, sizeof(m_renderTargets));
+	memcpy(m_renderTargetFaces, rt.cubeFaces, sizeof(m_renderTargetFaces));
+	m_numRTs = nNumRTs;
+	m_depthTarget = pDepthTarget;
+}
+
+void ShaderAPIDeferred::ChangeRenderTargetToBackBuffer()
+{
+	RecordCommand(DCMD_BACKBUFFER);
+
+	memset(m_renderTargets, 0, sizeof(m_renderTargets));
+	memset(m_renderTargetFaces, 0, sizeof(m_renderTargetFaces));
+	m_numRTs = 0;
+	m_depthTarget = NULL;
+}
+
+void ShaderAPIDeferred::ResizeRenderTarget(ITexture* pRT, int newWide, int newTall)
+{
+	WaitForRenderThread();
+	m_target->ResizeRenderTarget(pRT, newWide, newTall);
+}
+
+void ShaderAPIDeferred::GetCurrentRenderTargets(ITexture* pRenderTargets[MAX_MRTS], int *nNumRTs, ITexture** pDepthTarget, int cubeNumbers[MAX_MRTS])
+{
+	if(pRenderTargets)
+		memcpy(pRenderTargets, m_renderTargets, sizeof(m_renderTargets));
+
+	if(cubeNumbers)
+		memcpy(cubeNumbers, m_renderTargetFaces, sizeof(m_renderTargetFaces));
+
+	if(nNumRTs)
+		*nNumRTs = m_numRTs;
+
+	if(pDepthTarget)
+		*pDepthTarget = m_depthTarget;
+}
+
+//-------------------------------------------------------------
+// Matrix for rendering - FFP-likeness
+//-------------------------------------------------------------
+
+void ShaderAPIDeferred::SetMatrixMode(ER_MatrixMode nMatrixMode)
+{
+	*(int*)RecordCommand(DCMD_MATRIX_MODE, sizeof(int)) = nMatrixMode;
+}
+
+void ShaderAPIDeferred::LoadIdentityMatrix()	{RecordCommand(DCMD_MATRIX_IDENTITY);}
+void ShaderAPIDeferred::PushMatrix()			{RecordCommand(DCMD_MATRIX_PUSH);}
+void ShaderAPIDeferred::PopMatrix()				{RecordCommand(DCMD_MATRIX_POP);}
+
+void ShaderAPIDeferred::LoadMatrix(const Matrix4x4 &matrix)
+{
+	memcpy(RecordCommand(DCMD_MATRIX_LOAD, sizeof(Matrix4x4)), &matrix, sizeof(Matrix4x4));
+}
+
+//-------------------------------------------------------------
+// State manipulation
+//-------------------------------------------------------------
+
+SamplerStateParam_t ShaderAPIDeferred::MakeSamplerState(ER_TextureFilterMode textureFilterType,ER_TextureAddressMode addressS, ER_TextureAddressMode addressT, ER_TextureAddressMode addressR)
+{
+	return m_target->MakeSamplerState(textureFilterType, addressS, addressT, addressR);
+}
+
+void ShaderAPIDeferred::SetDepthRange(float fZNear, float fZFar)
+{
+	float* range = (float*)RecordCommand(DCMD_DEPTHRANGE, sizeof(float)*2);
+	range[0] = fZNear;
+	range[1] = fZFar;
+}
+
+void ShaderAPIDeferred::SetViewport(int x, int y, int w, int h)
+{
+	m_viewport[0] = x;
+	m_viewport[1] = y;
+	m_viewport[2] = w;
+	m_viewport[3] = h;
+
+	memcpy(RecordCommand(DCMD_VIEWPORT, sizeof(m_viewport)), m_viewport, sizeof(m_viewport));
+}
+
+void ShaderAPIDeferred::GetViewport(int &x, int &y, int &w, int &h)
+{
+	x = m_viewport[0];
+	y = m_viewport[1];
+	w = m_viewport[2];
+	h = m_viewport[3];
+}
+
+void ShaderAPIDeferred::GetViewportDimensions(int &wide, int &tall)
+{
+	wide = m_viewport[2];
+	tall = m_viewport[3];
+}
+
+void ShaderAPIDeferred::SetScissorRectangle(const IRectangle &rect)
+{
+	memcpy(RecordCommand(DCMD_SCISSOR, sizeof(IRectangle)), &rect, sizeof(IRectangle));
+}
+
+void ShaderAPIDeferred::SetBlendingState(IRenderState* pBlending)
+{
+	*(IRenderState**)RecordCommand(DCMD_BLENDSTATE, sizeof(IRenderState*)) = pBlending;
+}
+
+void ShaderAPIDeferred::SetDepthStencilState(IRenderState *pDepthStencilState)
+{
+	*(IRenderState**)RecordCommand(DCMD_DEPTHSTATE, sizeof(IRenderState*)) = pDepthStencilState;
+}
+
+void ShaderAPIDeferred::SetRasterizerState(IRenderState* pState)
+{
+	*(IRenderState**)RecordCommand(DCMD_RASTERSTATE, sizeof(IRenderState*)) = pState;
+}
+
+void ShaderAPIDeferred::SetTexture(ITexture* pTexture, const char* pszName, int index)
+{
+	int nameLen = pszName ? strlen(pszName) + 1 : 0;
+
+	deferredTexture_t* tex = (deferredTexture_t*)RecordCommand(DCMD_TEXTURE, sizeof(deferredTexture_t) + nameLen);
+	tex->texture = pTexture;
+	tex->index = index;
+	tex->nameLen = nameLen;
+
+	if(nameLen)
+	{
+		memcpy(tex+1, pszName, nameLen);
+		return;
+	}
+
+	// sampler name is resolved by the shader program, only indexed textures can be queried back
+	if(index < 0)
+	{
+		int vLevel = index+(MAX_VERTEXTEXTURES+1);
+
+		if(vLevel >= 0 && vLevel < MAX_VERTEXTEXTURES)
+			m_vertexTextures[vLevel] = pTexture;
+	}
+	else if(index < MAX_TEXTUREUNIT)
+		m_textures[index] = pTexture;
+}
+
+ITexture* ShaderAPIDeferred::GetTextureAt(int level) const
+{
+	if(level < 0)
+	{
+		int vLevel = level+(MAX_VERTEXTEXTURES+1);
+		return (vLevel >= 0 && vLevel < MAX_VERTEXTEXTURES) ? m_vertexTextures[vLevel] : NULL;
+	}
+
+	return level < MAX_TEXTUREUNIT ? m_textures[level] : NULL;
+}
+
+//-------------------------------------------------------------
+// Vertex buffer object handling
+//-------------------------------------------------------------
+
+void ShaderAPIDeferred::SetVertexFormat(IVertexFormat* pVertexFormat)
+{
+	ubyte* params = (ubyte*)RecordCommand(DCMD_VERTEXFORMAT, sizeof(IVertexFormat*) + sizeof(bool));
+	*(IVertexFormat**)params = pVertexFormat;
+	*(bool*)(params + sizeof(IVertexFormat*)) = false;
+}
+
+void ShaderAPIDeferred::ChangeVertexFormat(IVertexFormat* pVertexFormat)
+{
+	ubyte* params = (ubyte*)RecordCommand(DCMD_VERTEXFORMAT, sizeof(IVertexFormat*) + sizeof(bool));
+	*(IVertexFormat**)params = pVertexFormat;
+	*(bool*)(params + sizeof(IVertexFormat*)) = true;
+}
+
+void ShaderAPIDeferred::SetVertexBuffer(IVertexBuffer* pVertexBuffer, int nStream, const intptr offset)
+{
+	deferredVertexBuffer_t* vb = (deferredVertexBuffer_t*)RecordCommand(DCMD_VERTEXBUFFER, sizeof(deferredVertexBuffer_t));
+	vb->buffer = pVertexBuffer ? ((CDeferredVertexBuffer*)pVertexBuffer)->m_target : NULL;
+	vb->stream = nStream;
+	vb->offset = offset;
+	vb->change = false;
+}
+
+void ShaderAPIDeferred::ChangeVertexBuffer(IVertexBuffer* pVertexBuffer, int nStream, const intptr offset)
+{
+	deferredVertexBuffer_t* vb = (deferredVertexBuffer_t*)RecordCommand(DCMD_VERTEXBUFFER, sizeof(deferredVertexBuffer_t));
+	vb->buffer = pVertexBuffer ? ((CDeferredVertexBuffer*)pVertexBuffer)->m_target : NULL;
+	vb->stream = nStream;
+	vb->offset = offset;
+	vb->change = true;
+}
+
+// client memory may be changed or freed before render thread draws from it and it's size is unknown
+void ShaderAPIDeferred::SetVertexBuffer(int nStream, const void* base)
+{
+	static bool s_reported = false;
+
+	if(!s_reported)
+	{
+		MsgError("ShaderAPIDeferred::SetVertexBuffer - client memory vertex buffers are not supported by render thread, use IVertexBuffer\n");
+		s_reported = true;
+	}
+}
+
+void ShaderAPIDeferred::SetIndexBuffer(IIndexBuffer *pIndexBuffer)
+{
+	ubyte* params = (ubyte*)RecordCommand(DCMD_INDEXBUFFER, sizeof(IIndexBuffer*) + sizeof(bool));
+	*(IIndexBuffer**)params = pIndexBuffer ? ((CDeferredIndexBuffer*)pIndexBuffer)->m_target : NULL;
+	*(bool*)(params + sizeof(IIndexBuffer*)) = false;
+}
+
+void ShaderAPIDeferred::ChangeIndexBuffer(IIndexBuffer *pIndexBuffer)
+{
+	ubyte* params = (ubyte*)RecordCommand(DCMD_INDEXBUFFER, sizeof(IIndexBuffer*) + sizeof(bool));
+	*(IIndexBuffer**)params = pIndexBuffer ? ((CDeferredIndexBuffer*)pIndexBuffer)->m_target : NULL;
+	*(bool*)(params + sizeof(IIndexBuffer*)) = true;
+}
+
+//-------------------------------------------------------------
+// Shaders and it's operations
+//-------------------------------------------------------------
+
+bool ShaderAPIDeferred::LoadShadersFromFile(IShaderProgram* pShaderOutput, const char* pszFileNamePrefix, const char* extra)
+{
+	return m_target->LoadShadersFromFile(pShaderOutput, pszFileNamePrefix, extra);
+}
+
+bool ShaderAPIDeferred::CompileShadersFromStream(IShaderProgram* pShaderOutput, const shaderProgramCompileInfo_t& info, const char* extra)
+{
+	return m_target->CompileShadersFromStream(pShaderOutput, info, extra);
+}
+
+void ShaderAPIDeferred::ReloadShaderSources()
+{
+	// prebuilt programs are destroyed immediately, render thread must not use them
+	WaitForRenderThread();
+	m_target->ReloadShaderSources();
+}
+
+void ShaderAPIDeferred::SetShader(IShaderProgram* pShader)
+{
+	*(IShaderProgram**)RecordCommand(DCMD_SHADER, sizeof(IShaderProgram*)) = pShader;
+}
+
+int ShaderAPIDeferred::SetShaderConstantInt(const char *pszName, const int constant, int const_id)
+{
+	return SetShaderConstantRaw(pszName, &constant, sizeof(constant), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantFloat(const char *pszName, const float constant, int const_id)
+{
+	return SetShaderConstantRaw(pszName, &constant, sizeof(constant), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantVector2D(const char *pszName, const Vector2D &constant, int const_id)
+{
+	return SetShaderConstantRaw(pszName, &constant, sizeof(constant), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantVector3D(const char *pszName, const Vector3D &constant, int const_id)
+{
+	return SetShaderConstantRaw(pszName, &constant, sizeof(constant), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantVector4D(const char *pszName, const Vector4D &constant, int const_id)
+{
+	return SetShaderConstantRaw(pszName, &constant, sizeof(constant), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantMatrix4(const char *pszName, const Matrix4x4 &constant, int const_id)
+{
+	return SetShaderConstantRaw(pszName, &constant, sizeof(constant), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantArrayFloat(const char *pszName, const float *constant, int count, int const_id)
+{
+	return SetShaderConstantRaw(pszName, constant, count * sizeof(float), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantArrayVector2D(const char *pszName, const Vector2D *constant, int count, int const_id)
+{
+	return SetShaderConstantRaw(pszName, constant, count * sizeof(Vector2D), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantArrayVector3D(const char *pszName, const Vector3D *constant, int count, int const_id)
+{
+	return SetShaderConstantRaw(pszName, constant, count * sizeof(Vector3D), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantArrayVector4D(const char *pszName, const Vector4D *constant, int count, int const_id)
+{
+	return SetShaderConstantRaw(pszName, constant, count * sizeof(Vector4D), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantArrayMatrix4(const char *pszName, const Matrix4x4 *constant, int count, int const_id)
+{
+	return SetShaderConstantRaw(pszName, constant, count * sizeof(Matrix4x4), const_id);
+}
+
+int ShaderAPIDeferred::SetShaderConstantRaw(const char *pszName, const void *data, int nSize, int const_id)
+{
+	if(data == NULL || nSize <= 0)
+		return const_id;
+
+	// handles are global so they are resolved here, program constant is looked up by render thread
+	if(const_id < 0)
+		const_id = m_target->GetShaderConstantHandle(pszName);
+
+	if(const_id < 0)
+		return -1;
+
+	int* params = (int*)RecordCommand(DCMD_CONSTANT, sizeof(int)*2 + nSize);
+	params[0] = const_id;
+	params[1] = nSize;
+	memcpy(params+2, data, nSize);
+
+	return const_id;
+}
+
+//-------------------------------------------------------------
+// Vertex buffer objects creation/destroying
+//-------------------------------------------------------------
+
+IVertexBuffer* ShaderAPIDeferred::CreateVertexBuffer(ER_BufferAccess nBufAccess, int nNumVerts, int strideSize, void *pData)
+{
+	IVertexBuffer* target = m_target->CreateVertexBuffer(nBufAccess, nNumVerts, strideSize, pData);
+
+	if(!target)
+		return NULL;
+
+	return new CDeferredVertexBuffer(this, target);
+}
+
+IIndexBuffer* ShaderAPIDeferred::CreateIndexBuffer(int nIndices, int nIndexSize, ER_BufferAccess nBufAccess, void *pData)
+{
+	IIndexBuffer* target = m_target->CreateIndexBuffer(nIndices, nIndexSize, nBufAccess, pData);
+
+	if(!target)
+		return NULL;
+
+	return new CDeferredIndexBuffer(this, target);
+}
+
+//-------------------------------------------------------------
+// Primitive drawing
+//-------------------------------------------------------------
+
+void ShaderAPIDeferred::DrawIndexedPrimitives(ER_PrimitiveType nType, int nFirstIndex, int nIndices, int nFirstVertex, int nVertices, int nBaseVertex)
+{
+	int* p = (int*)RecordCommand(DCMD_DRAW_INDEXED, sizeof(int)*6);
+	p[0] = nType;
+	p[1] = nFirstIndex;
+	p[2] = nIndices;
+	p[3] = nFirstVertex;
+	p[4] = nVertices;
+	p[5] = nBaseVertex;
+}
+
+void ShaderAPIDeferred::DrawNonIndexedPrimitives(ER_PrimitiveType nType, int nFirstVertex, int nVertices)
+{
+	int* p = (int*)RecordCommand(DCMD_DRAW, sizeof(int)*3);
+	p[0] = nType;
+	p[1] = nFirstVertex;
+	p[2] = nVertices;
+}
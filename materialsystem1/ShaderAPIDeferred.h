@@ -0,0 +1,429 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Deferred ShaderAPI. Records frame into command stream which is
+//				replayed by the render thread on the real ShaderAPI
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHADERAPIDEFERRED_H
+#define SHADERAPIDEFERRED_H
+
+#include "materialsystem1/renderers/IShaderAPI.h"
+#include "utils/eqthread.h"
+#include "utils/DkList.h"
+
+class IRenderLibrary;
+class IEqSwapChain;
+class ShaderAPIDeferred;
+
+enum EDeferredDestroyType
+{
+	DEFERRED_DESTROY_TEXTURE = 0,
+	DEFERRED_DESTROY_RENDERSTATE,
+	DEFERRED_DESTROY_SHADERPROGRAM,
+	DEFERRED_DESTROY_VERTEXFORMAT,
+	DEFERRED_DESTROY_VERTEXBUFFER,
+	DEFERRED_DESTROY_INDEXBUFFER,
+	DEFERRED_DESTROY_OCCLUSIONQUERY,
+};
+
+struct deferredDestroy_t
+{
+	void*	object;
+	int		type;		// EDeferredDestroyType
+	bool	removeAllRefs;
+};
+
+//--------------------------------------------------------------------------------
+// Commands of one frame. Every command has it's own copy of the data it uses
+//--------------------------------------------------------------------------------
+
+class CRenderCommandStream
+{
+public:
+						CRenderCommandStream();
+						~CRenderCommandStream();
+
+	// returns memory for the command with size bytes of parameters
+	void*				AllocCommand(int cmd, int size);
+
+	void				Clear();
+
+	const ubyte*		GetData() const		{return m_data;}
+	int					GetSize() const		{return m_size;}
+	int					GetNumCommands() const {return m_numCommands;}
+
+	// objects destroyed in the frame, they are released after all commands
+	DkList<deferredDestroy_t>	m_destroys;
+
+protected:
+	ubyte*				m_data;
+	int					m_size;
+	int					m_allocated;
+	int					m_numCommands;
+};
+
+//--------------------------------------------------------------------------------
+// Buffers are wrapped because they're updated by the main thread while the
+// render thread may still draw previous frame from them.
+// Write locks are staged and uploaded by the render thread, so the whole locked
+// range must be written. Only read locks wait for the render thread
+//--------------------------------------------------------------------------------
+
+class CDeferredVertexBuffer : public IVertexBuffer
+{
+	friend class ShaderAPIDeferred;
+public:
+						CDeferredVertexBuffer(ShaderAPIDeferred* owner, IVertexBuffer* target);
+						~CDeferredVertexBuffer();
+
+	long				GetSizeInBytes()	{return m_target->GetSizeInBytes();}
+	int					GetVertexCount()	{return m_target->GetVertexCount();}
+	int					GetStrideSize()		{return m_target->GetStrideSize();}
+
+	void				Update(void* data, int size, int offset, bool discard = true);
+
+	bool				Lock(int lockOfs, int sizeToLock, void** outdata, bool readOnly);
+	void				Unlock();
+
+	void				SetFlags( int flags )	{m_target->SetFlags(flags);}
+	int					GetFlags()				{return m_target->GetFlags();}
+
+protected:
+	ShaderAPIDeferred*	m_owner;
+	IVertexBuffer*		m_target;
+
+	ubyte*				m_lockData;
+	int					m_lockAllocated;
+	int					m_lockOfs;
+	int					m_lockSize;
+	bool				m_lockDirect;		// locked on real buffer
+};
+
+class CDeferredIndexBuffer : public IIndexBuffer
+{
+	friend class ShaderAPIDeferred;
+public:
+						CDeferredIndexBuffer(ShaderAPIDeferred* owner, IIndexBuffer* target);
+						~CDeferredIndexBuffer();
+
+	int8				GetIndexSize()		{return m_target->GetIndexSize();}
+	int					GetIndicesCount()	{return m_target->GetIndicesCount();}
+
+	void				Update(void* data, int size, int offset, bool discard = true);
+
+	bool				Lock(int lockOfs, int sizeToLock, void** outdata, bool readOnly);
+	void				Unlock();
+
+protected:
+	ShaderAPIDeferred*	m_owner;
+	IIndexBuffer*		m_target;
+
+	ubyte*				m_lockData;
+	int					m_lockAllocated;
+	int					m_lockOfs;
+	int					m_lockSize;
+	bool				m_lockDirect;
+};
+
+//--------------------------------------------------------------------------------
+
+class CRenderThread : public Threading::CEqThread
+{
+public:
+	ShaderAPIDeferred*	m_api;
+
+protected:
+	int					Run();
+};
+
+struct renderThreadStats_t
+{
+	int					commands;
+	int					streamBytes;
+	float				recordWaitMs;		// main thread was waiting for render thread
+	float				executeMs;			// render thread execution time
+
+	// ShaderAPI counters of the frame
+	int					drawCalls;
+	int					drawIndexedCalls;
+	int					triangles;
+};
+
+//--------------------------------------------------------------------------------
+// The main thread records frame N+1 while render thread submits frame N.
+// Resources are created right away on the real ShaderAPI, releasing is deferred
+// until the render thread has finished the frame which is being recorded.
+// State and draw calls must be made from the main thread only.
+// Not used with OpenGL, it's context stays on the main thread which creates resources
+//--------------------------------------------------------------------------------
+
+class ShaderAPIDeferred : public IShaderAPI
+{
+	friend class CDeferredVertexBuffer;
+	friend class CDeferredIndexBuffer;
+	friend class CRenderThread;
+public:
+								ShaderAPIDeferred(IShaderAPI* target, IRenderLibrary* renderLib);
+								~ShaderAPIDeferred();
+
+	IShaderAPI*					GetTarget() const	{return m_target;}
+
+	void						StartRenderThread();
+
+	// completes all recorded commands, after that they are executed right away
+	void						StopRenderThread();
+
+	bool						IsRenderThreadRunning() const {return m_renderThread.IsRunning();}
+
+	// recorded calls to render library
+	void						BeginFrame();
+	void						EndFrame(IEqSwapChain* swapChain);
+
+	// sends recorded commands to render thread. Waits if it's still busy with previous frame
+	void						SubmitFrame();
+
+	// sends recorded commands and waits for their completion. Only waits if called not from main thread
+	void						WaitForRenderThread();
+
+	const renderThreadStats_t&	GetLastFrameStats() const {return m_lastFrameStats;}
+
+	void						Init( shaderAPIParams_t &params ) {}
+	void						Shutdown();
+
+	ETextureFormat				GetScreenFormat()		{return m_target->GetScreenFormat();}
+	void						PrintAPIInfo()			{m_target->PrintAPIInfo();}
+	bool						IsDeviceActive()		{return m_target->IsDeviceActive();}
+
+//-------------------------------------------------------------
+// Rendering's applies
+//-------------------------------------------------------------
+
+	void						Reset(int nResetTypeFlags = STATE_RESET_ALL);
+
+	void						Apply();
+	void						ApplyTextures();
+	void						ApplySamplerState();
+	void						ApplyBlendState();
+	void						ApplyDepthState();
+	void						ApplyRasterizerState();
+	void						ApplyBuffers();
+	void						ApplyShaderProgram();
+	void						ApplyConstants();
+
+	void						Clear(bool bClearColor, bool bClearDepth = true, bool bClearStencil = true, const ColorRGBA &fillColor = ColorRGBA(0), float fDepth = 1.0f, int nStencil = 0);
+
+//-------------------------------------------------------------
+// Renderer information
+//-------------------------------------------------------------
+
+	const ShaderAPICaps_t&		GetCaps() const						{return m_target->GetCaps();}
+	ER_ShaderAPIType			GetShaderAPIClass() const			{return m_target->GetShaderAPIClass();}
+	const char*					GetRendererName() const				{return m_target->GetRendererName();}
+	const char*					GetDeviceNameString() const			{return m_target->GetDeviceNameString();}
+
+	// counters of the last frame completed by render thread, taken by SubmitFrame while it's idle
+	int							GetDrawCallsCount() const			{return m_lastFrameStats.drawCalls;}
+	int							GetDrawIndexedPrimitiveCallsCount() const {return m_lastFrameStats.drawIndexedCalls;}
+	int							GetTrianglesCount() const			{return m_lastFrameStats.triangles;}
+	void						ResetCounters();
+
+	void						Flush();
+	void						Finish();
+
+//-------------------------------------------------------------
+// Occlusion query
+//-------------------------------------------------------------
+
+	IOcclusionQuery*			CreateOcclusionQuery()				{return m_target->CreateOcclusionQuery();}
+	void						DestroyOcclusionQuery(IOcclusionQuery* pQuery);
+
+//-------------------------------------------------------------
+// Textures
+//-------------------------------------------------------------
+
+	ITexture*					GetErrorTexture()					{return m_target->GetErrorTexture();}
+	ITexture*					FindTexture( const char* pszName )	{return m_target->FindTexture(pszName);}
+	void						FreeTexture(ITexture* pTexture);
+
+	ITexture*					CreateTexture(const DkList<CImage*>& pImages, const SamplerStateParam_t& sampler, int nFlags = 0);
+
+	ITexture*					LoadTexture(const char* pszFileName, ER_TextureFilterMode textureFilterType, ER_TextureAddressMode textureAddress = TEXADDRESS_WRAP, int nFlags = 0);
+
+	ITexture*					CreateProceduralTexture(const char* pszName, ETextureFormat nFormat, int width, int height, int depth = 1, int arraySize = 1,
+														ER_TextureFilterMode texFilter = TEXFILTER_NEAREST, ER_TextureAddressMode textureAddress = TEXADDRESS_WRAP,
+														int nFlags = 0, int nDataSize = 0, const unsigned char* pData = NULL);
+
+	ITexture*					CreateRenderTarget(int width, int height, ETextureFormat nRTFormat, ER_TextureFilterMode textureFilterType = TEXFILTER_LINEAR,
+													ER_TextureAddressMode textureAddress = TEXADDRESS_WRAP, ER_CompareFunc comparison = COMP_NEVER, int nFlags = 0);
+
+	ITexture*					CreateNamedRenderTarget(const char* pszName, int width, int height, ETextureFormat nRTFormat, ER_TextureFilterMode textureFilterType = TEXFILTER_LINEAR,
+														ER_TextureAddressMode textureAddress = TEXADDRESS_WRAP, ER_CompareFunc comparison = COMP_NEVER, int nFlags = 0);
+
+	ITexture*					GenerateErrorTexture(int nFlags = 0)	{return m_target->GenerateErrorTexture(nFlags);}
+
+	void						UpdateTextureStreaming();
+	void						SetTextureStreamingSize(ITexture* pTexture, int screenSize) {m_target->SetTextureStreamingSize(pTexture, screenSize);}
+
+//-------------------------------------------------------------
+// Texture operations
+//-------------------------------------------------------------
+
+	void						SaveRenderTarget(ITexture* pTargetTexture, const char* pFileName);
+	void						CopyFramebufferToTexture(ITexture* pTargetTexture);
+	void						CopyRendertargetToTexture(ITexture* srcTarget, ITexture* destTex, IRectangle* srcRect = NULL, IRectangle* destRect = NULL);
+
+	void						ChangeRenderTarget( ITexture* pRenderTarget, int nCubemapFace = 0, ITexture* pDepthTarget = NULL, int nDepthSlice = 0 );
+	void						ChangeRenderTargets( ITexture** pRenderTargets, int nNumRTs, int* nCubemapFaces = NULL, ITexture* pDepthTarget = NULL, int nDepthSlice = 0);
+	void						ChangeRenderTargetToBackBuffer();
+
+	void						ResizeRenderTarget( ITexture* pRT, int newWide, int newTall );
+
+	void						GetCurrentRenderTargets( ITexture* pRenderTargets[MAX_MRTS], int *nNumRTs, ITexture** pDepthTarget, int cubeNumbers[MAX_MRTS]);
+
+//-------------------------------------------------------------
+// Matrix for rendering - FFP-likeness
+//-------------------------------------------------------------
+
+	void						SetMatrixMode( ER_MatrixMode nMatrixMode );
+	void						LoadIdentityMatrix();
+	void						LoadMatrix( const Matrix4x4 &matrix );
+	void						PushMatrix();
+	void						PopMatrix();
+
+//-------------------------------------------------------------
+// State manipulation
+//-------------------------------------------------------------
+
+	SamplerStateParam_t			MakeSamplerState(ER_TextureFilterMode textureFilterType,ER_TextureAddressMode addressS, ER_TextureAddressMode addressT, ER_TextureAddressMode addressR);
+
+	IRenderState*				CreateBlendingState( const BlendStateParam_t &blendDesc )			{return m_target->CreateBlendingState(blendDesc);}
+	IRenderState*				CreateDepthStencilState( const DepthStencilStateParams_t &depthDesc ) {return m_target->CreateDepthStencilState(depthDesc);}
+	IRenderState*				CreateRasterizerState( const RasterizerStateParams_t &rasterDesc )	{return m_target->CreateRasterizerState(rasterDesc);}
+
+	void						DestroyRenderState( IRenderState* pState, bool removeAllRefs = false);
+
+//-------------------------------------------------------------
+// State setup functions for drawing
+//-------------------------------------------------------------
+
+	void						SetDepthRange( float fZNear,float fZFar );
+
+	void						SetViewport( int x, int y, int w, int h );
+	void						GetViewport( int &x, int &y, int &w, int &h );
+	void						GetViewportDimensions( int &wide, int &tall );
+
+	void						SetScissorRectangle( const IRectangle &rect );
+
+	void						SetBlendingState( IRenderState* pBlending );
+	void						SetDepthStencilState( IRenderState *pDepthStencilState );
+	void						SetRasterizerState( IRenderState* pState );
+
+	void						SetTexture( ITexture* pTexture, const char* pszName = NULL, int index = 0);
+	ITexture*					GetTextureAt( int level ) const;
+
+//-------------------------------------------------------------
+// Vertex buffer object handling
+//-------------------------------------------------------------
+
+	void						SetVertexFormat( IVertexFormat* pVertexFormat );
+	void						SetVertexBuffer( IVertexBuffer* pVertexBuffer, int nStream, const intptr offset = 0 );
+	void						SetVertexBuffer( int nStream, const void* base );
+	void						SetIndexBuffer( IIndexBuffer *pIndexBuffer );
+
+	void						ChangeVertexFormat( IVertexFormat* pVertexFormat );
+	void						ChangeVertexBuffer( IVertexBuffer* pVertexBuffer,int nStream, const intptr offset = 0 );
+	void						ChangeIndexBuffer( IIndexBuffer *pIndexBuffer );
+
+//-------------------------------------------------------------
+// Shaders and it's operations
+//-------------------------------------------------------------
+
+	IShaderProgram*				FindShaderProgram( const char* pszName, const char* query = NULL )		{return m_target->FindShaderProgram(pszName, query);}
+	IShaderProgram*				CreateNewShaderProgram( const char* pszName, const char* query = NULL )	{return m_target->CreateNewShaderProgram(pszName, query);}
+	void						DestroyShaderProgram( IShaderProgram* pShaderProgram );
+
+	bool						LoadShadersFromFile(IShaderProgram* pShaderOutput, const char* pszFileNamePrefix, const char* extra = NULL);
+	bool						CompileShadersFromStream(IShaderProgram* pShaderOutput, const shaderProgramCompileInfo_t& info, const char* extra = NULL);
+
+	void						SetShader(IShaderProgram* pShader);
+
+	void						ReloadShaderSources();
+
+	int							GetShaderConstantHandle(const char *pszName) {return m_target->GetShaderConstantHandle(pszName);}
+
+	int							SetShaderConstantInt(const char *pszName, const int constant, int const_id = -1);
+	int							SetShaderConstantFloat(const char *pszName, const float constant, int const_id = -1);
+	int							SetShaderConstantVector2D(const char *pszName, const Vector2D &constant, int const_id = -1);
+	int							SetShaderConstantVector3D(const char *pszName, const Vector3D &constant, int const_id = -1);
+	int							SetShaderConstantVector4D(const char *pszName, const Vector4D &constant, int const_id = -1);
+	int							SetShaderConstantMatrix4(const char *pszName, const Matrix4x4 &constant, int const_id = -1);
+	int							SetShaderConstantArrayFloat(const char *pszName, const float *constant, int count, int const_id = -1);
+	int							SetShaderConstantArrayVector2D(const char *pszName, const Vector2D *constant, int count, int const_id = -1);
+	int							SetShaderConstantArrayVector3D(const char *pszName, const Vector3D *constant, int count, int const_id = -1);
+	int							SetShaderConstantArrayVector4D(const char *pszName, const Vector4D *constant, int count, int const_id = -1);
+	int							SetShaderConstantArrayMatrix4(const char *pszName, const Matrix4x4 *constant, int count, int const_id = -1);
+
+	int							SetShaderConstantRaw(const char *pszName, const void *data, int nSize, int const_id = -1);
+
+//-------------------------------------------------------------
+// Vertex buffer objects creation/destroying
+//-------------------------------------------------------------
+
+	IVertexFormat*				CreateVertexFormat(VertexFormatDesc_s *formatDesc, int nAttribs)	{return m_target->CreateVertexFormat(formatDesc, nAttribs);}
+	IVertexBuffer*				CreateVertexBuffer(ER_BufferAccess nBufAccess, int nNumVerts, int strideSize, void *pData = NULL);
+	IIndexBuffer*				CreateIndexBuffer(int nIndices, int nIndexSize, ER_BufferAccess nBufAccess, void *pData = NULL);
+
+	void						DestroyVertexFormat(IVertexFormat* pFormat);
+	void						DestroyVertexBuffer(IVertexBuffer* pVertexBuffer);
+	void						DestroyIndexBuffer(IIndexBuffer* pIndexBuffer);
+
+//-------------------------------------------------------------
+// Primitive drawing
+//-------------------------------------------------------------
+
+	void						DrawIndexedPrimitives(ER_PrimitiveType nType, int nFirstIndex, int nIndices, int nFirstVertex, int nVertices, int nBaseVertex = 0);
+	void						DrawNonIndexedPrimitives(ER_PrimitiveType nType, int nFirstVertex, int nVertices);
+
+protected:
+	// writes command to the recorded stream
+	void*						RecordCommand(int cmd, int size);
+	void						RecordCommand(int cmd) {RecordCommand(cmd, 0);}
+
+	void						RecordBufferUpload(int cmd, void* buffer, const void* data, int offset, int size, int byteSize, bool discard);
+
+	// adds object to be destroyed after the frame. Can be called from any thread
+	void						DeferDestroy(void* object, int type, bool removeAllRefs = false);
+
+	// runs the commands on real ShaderAPI
+	void						ExecuteStream(CRenderCommandStream& stream);
+
+	IShaderAPI*					m_target;
+	IRenderLibrary*				m_renderLib;
+
+	CRenderCommandStream		m_streams[2];
+	int							m_recordStream;
+	CRenderCommandStream*		m_executeStream;		// given to render thread
+
+	Threading::CEqMutex			m_destroyMutex;
+	uintptr_t					m_mainThreadId;
+
+	CRenderThread				m_renderThread;
+
+	// main thread copies of state that can be queried back
+	int							m_viewport[4];
+	ITexture*					m_textures[MAX_TEXTUREUNIT];
+	ITexture*					m_vertexTextures[MAX_VERTEXTEXTURES];
+	ITexture*					m_renderTargets[MAX_MRTS];
+	int							m_renderTargetFaces[MAX_MRTS];
+	int							m_numRTs;
+	ITexture*					m_depthTarget;
+
+	// stats
+	renderThreadStats_t			m_lastFrameStats;
+	float						m_recordWaitMs;
+	float						m_executeMs;
+};
+
+#endif // SHADERAPIDEFERRED_H
@@ -100,13 +100,15 @@ BEGIN_SHADER_CLASS(BaseParticle)
 	void SetColorModulation()
 	{
 		ColorRGBA setColor = materials->GetAmbientColor();
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor);
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor, s_constAmbientColor);
 	}
 
 	void SetAdditiveColorModulation()
 	{
 		ColorRGBA setColor = materials->GetAmbientColor();
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor);
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor, s_constAmbientColor);
 	}
 
 	ITexture*	GetBaseTexture(int stage) {return m_pBaseTexture;}
@@ -76,7 +76,8 @@ BEGIN_SHADER_CLASS(BaseUnlit)
 	{
 		ColorRGBA setColor = m_pColorVar->GetVector4()*materials->GetAmbientColor();
 
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor);
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor, s_constAmbientColor);
 	}
 
 	void SetupBaseTexture0()
@@ -100,12 +100,14 @@ BEGIN_SHADER_CLASS(BlurFilter)
 		SetupDefaultParameter(SHADERPARAM_RASTERSETUP);
 		SetupDefaultParameter(SHADERPARAM_COLOR);
 
-		g_pShaderAPI->SetShaderConstantVector4D("TEXSIZE", m_texSize);
+		static int s_constTEXSIZE = -1;
+		s_constTEXSIZE = g_pShaderAPI->SetShaderConstantVector4D("TEXSIZE", m_texSize, s_constTEXSIZE);
 	}
 
 	void SetColorModulation()
 	{
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", materials->GetAmbientColor());
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", materials->GetAmbientColor(), s_constAmbientColor);
 	}
 
 	void SetupBaseTexture0()
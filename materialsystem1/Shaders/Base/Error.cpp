@@ -57,7 +57,8 @@ BEGIN_SHADER_CLASS(Error)
 
 	void SetColorModulation()
 	{
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", materials->GetAmbientColor());
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", materials->GetAmbientColor(), s_constAmbientColor);
 	}
 
 	void SetupBaseTexture0()
@@ -50,13 +50,15 @@ BEGIN_SHADER_CLASS(SDFFont)
 
 		SetupDefaultParameter(SHADERPARAM_COLOR);
 
-		g_pShaderAPI->SetShaderConstantVector2D("SDFRange", m_rangeVar->GetVector2());
+		static int s_constSDFRange = -1;
+		s_constSDFRange = g_pShaderAPI->SetShaderConstantVector2D("SDFRange", m_rangeVar->GetVector2(), s_constSDFRange);
 	}
 
 	void SetColorModulation()
 	{
 		ColorRGBA setColor = materials->GetAmbientColor();
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor);
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", setColor, s_constAmbientColor);
 	}
 
 	ITexture*	GetBaseTexture(int stage) {return NULL;}
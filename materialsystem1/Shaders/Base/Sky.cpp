@@ -63,9 +63,11 @@ BEGIN_SHADER_CLASS(Skybox)
 		Vector3D camPos(wvp.rows[0].w, wvp.rows[1].w, wvp.rows[2].w);
 
 		// camera direction
-		g_pShaderAPI->SetShaderConstantVector3D("camPos", camPos*2.0f);
+		static int s_constCamPos = -1;
+		s_constCamPos = g_pShaderAPI->SetShaderConstantVector3D("camPos", camPos*2.0f, s_constCamPos);
 
-		g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", materials->GetAmbientColor());
+		static int s_constAmbientColor = -1;
+		s_constAmbientColor = g_pShaderAPI->SetShaderConstantVector4D("AmbientColor", materials->GetAmbientColor(), s_constAmbientColor);
 
 		// setup base texture
 		g_pShaderAPI->SetTexture(m_nBaseTexture, "BaseTextureSampler", 0);
@@ -26,7 +26,7 @@
 #define ATLAS_FILE_EXTENSION		".atlas"
 
 CMaterial::CMaterial(Threading::CEqMutex& mutex) 
-	: m_state(MATERIAL_LOAD_ERROR), m_shader(nullptr), m_proxyIsDirty(true), m_loadFromDisk(true), m_frameBound(0), m_atlas(nullptr), m_Mutex(mutex)
+	: m_state(MATERIAL_LOAD_ERROR), m_shader(nullptr), m_proxyIsDirty(true), m_loadFromDisk(true), m_frameBound(0), m_frameProxyUpdate(0), m_atlas(nullptr), m_Mutex(mutex)
 {
 }
 
@@ -61,6 +61,8 @@ void CMaterial::Init(const char* materialPath)
 
 	// load atlas file
 	kvkeybase_t root;
+	root.InitArena();
+
 	if (KV_LoadFromFile(atlasKVSFileName.ToCString(), (SP_DATA | SP_MOD), &root))
 	{
 		kvkeybase_t* atlasSec = root.FindKeyBase("atlasgroup");
@@ -75,6 +75,7 @@ protected:
 	int						m_state;	// FIXME: may be interlocked?
 
 	uint					m_frameBound;
+	uint					m_frameProxyUpdate;
 	bool					m_proxyIsDirty;
 	bool					m_loadFromDisk;
 
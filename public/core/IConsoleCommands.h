@@ -18,7 +18,28 @@
 
 typedef bool (*cmdFilterFn_t)(ConCommandBase* pCmd, DkList<EqString>& args);
 
-#define CONSOLE_INTERFACE_VERSION		"CORE_ConsoleCommands_004"
+// command with resolved console command/variable and split arguments
+struct compiledCmd_t
+{
+	compiledCmd_t() : base(nullptr) {}
+
+	EqString			cmdString;	// full command text
+	EqString			name;
+	DkList<EqString>	args;		// arguments after the name
+
+	ConCommandBase*		base;
+};
+
+// command buffer which is parsed once and can be executed many times
+struct compiledCmdBuffer_t
+{
+	compiledCmdBuffer_t() : registryVersion(-1) {}
+
+	DkList<compiledCmd_t>	commands;
+	int						registryVersion;	// commands are resolved again when it differs from registry
+};
+
+#define CONSOLE_INTERFACE_VERSION		"CORE_ConsoleCommands_005"
 
 class IConsoleCommands : public IEqCoreModule
 {
@@ -52,6 +73,12 @@ public:
     // Executes command buffer
     virtual bool								ExecuteCommandBuffer(cmdFilterFn_t filterFn = nullptr, bool quiet = false) = 0;
 
+	// Splits the commands on arguments and resolves them once
+	virtual void								CompileCommandBuffer(const char* pszBuffer, compiledCmdBuffer_t& compiled) = 0;
+
+	// Executes compiled commands without parsing
+	virtual bool								ExecuteCompiledCommands(compiledCmdBuffer_t& compiled, cmdFilterFn_t filterFn = nullptr, bool quiet = false) = 0;
+
 	// returns failed commands
 	virtual DkList<EqString>&					GetFailedCommands() = 0;	
 };
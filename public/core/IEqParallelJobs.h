@@ -4,8 +4,9 @@
 #include "utils/eqthread.h"
 #include "utils/DkList.h"
 #include "core/InterfaceManager.h"
+#include "core/IEqProfiler.h"
 
-#define PARALLELJOBS_INTERFACE_VERSION		"CORE_ParallelJobs_002"
+#define PARALLELJOBS_INTERFACE_VERSION		"CORE_ParallelJobs_003"
 
 typedef void(*jobFunction_t)(void*, int i);
 typedef void(*jobComplete_t)(struct eqParallelJob_t*);
@@ -84,6 +85,9 @@ public:
 	// returns state if all jobs has been done
 	virtual bool							AllJobsCompleted() const = 0;
 
+	// returns the number of running job threads
+	virtual int								GetJobThreadsCount() const = 0;
+
 	// wait for specific job
 	virtual void							WaitForJob(eqParallelJob_t* job) = 0;
 
@@ -94,4 +98,123 @@ public:
 
 INTERFACE_SINGLETON(IEqParallelJobThreads, CEqParallelJobThreads, PARALLELJOBS_INTERFACE_VERSION, g_parallelJobs)
 
+//---------------------------------------------------------------------
+// Items split into chunks which are taken by the calling thread and job threads.
+// Must be allocated with new: jobs which are started after all chunks were taken
+// do nothing, and the last owner of the work deletes it
+//---------------------------------------------------------------------
+class CEqParallelWork
+{
+public:
+					CEqParallelWork() : m_numItems(0), m_numChunks(0), m_chunkSize(1), m_numJobs(0) {}
+	virtual			~CEqParallelWork() {}
+
+	// processes count items starting from first. Called on the calling thread and job threads
+	virtual void	ProcessChunk(int chunk, int first, int count) = 0;
+
+	// processes the items, calling thread takes part in it and waits for the jobs that are still processing taken chunks.
+	// No jobs are added if parallel is false. The work must not be used after this call
+	void			Run(int numItems, int chunkSize, int jobTypeId, bool parallel);
+
+	// number of jobs which were added by Run
+	int				GetNumJobs() const		{return m_numJobs;}
+
+protected:
+	void			ProcessChunks();
+	void			Release();
+
+	static void		Job(void* data, int i);
+
+	int				m_numItems;
+	int				m_numChunks;
+	int				m_chunkSize;
+	int				m_numJobs;
+
+	Threading::CEqInterlockedInteger	m_nextChunk;
+	Threading::CEqInterlockedInteger	m_numDone;
+	Threading::CEqInterlockedInteger	m_numRefs;
+
+	Threading::CEqSignal				m_completed;		// raised by the thread which finishes the last chunk
+};
+
+inline void CEqParallelWork::ProcessChunks()
+{
+	while(true)
+	{
+		int chunk = m_nextChunk.Increment() - 1;
+		int first = chunk * m_chunkSize;
+
+		if(first >= m_numItems)
+			break;
+
+		int count = m_numItems - first;
+
+		if(count > m_chunkSize)
+			count = m_chunkSize;
+
+		ProcessChunk(chunk, first, count);
+
+		if(m_numDone.Increment() == m_numChunks)
+			m_completed.Raise();
+	}
+}
+
+inline void CEqParallelWork::Release()
+{
+	if(m_numRefs.Decrement() == 0)
+		delete this;
+}
+
+inline void CEqParallelWork::Job(void* data, int i)
+{
+	PROF_EVENT("Parallel Work Job");
+
+	CEqParallelWork* work = (CEqParallelWork*)data;
+
+	// jobs which are started after all chunks were taken do nothing
+	work->ProcessChunks();
+	work->Release();
+}
+
+inline void CEqParallelWork::Run(int numItems, int chunkSize, int jobTypeId, bool parallel)
+{
+	m_numItems = numItems;
+	m_chunkSize = chunkSize;
+	m_numChunks = (numItems + chunkSize - 1) / chunkSize;
+
+	int numChunks = m_numChunks;
+	int numJobs = 0;
+
+	// calling thread takes one of the chunks
+	if(parallel)
+	{
+		numJobs = g_parallelJobs->GetJobThreadsCount();
+
+		if(numJobs > numChunks - 1)
+			numJobs = numChunks - 1;
+
+		if(numJobs < 0)
+			numJobs = 0;
+	}
+
+	m_numJobs = numJobs;
+	m_numRefs.SetValue(numJobs + 1);
+
+	if(numJobs)
+	{
+		for(int i = 0; i < numJobs; i++)
+			g_parallelJobs->AddJob(jobTypeId, Job, this);
+
+		g_parallelJobs->Submit();
+	}
+
+	ProcessChunks();
+
+	// wait for jobs which are still processing taken chunks
+	if(numJobs)
+		m_completed.Wait();
+
+	Release();
+}
+
 #endif // IEQPARALLELJOBS_H
\ No newline at end of file
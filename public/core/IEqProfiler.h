@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Eq Engine hierarchical CPU profiler
+//
+//				Usage:
+//					void CSomething::Update()
+//					{
+//						PROF_EVENT("Something Update");
+//						...
+//					}
+//
+//				Scopes are collected per thread and nested by the call order.
+//				When profiler is disabled, the scope costs single flag check.
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef IEQPROFILER_H
+#define IEQPROFILER_H
+
+#include "core/InterfaceManager.h"
+#include "core/dktypes.h"
+
+#define PROFILER_INTERFACE_VERSION		"CORE_Profiler_001"
+
+// profiler scope marker, registered once per PROF_EVENT site
+struct eqProfMarker_t
+{
+	const char*		name;
+	int				id;
+	volatile bool	enabled;		// mirrors profiler state to avoid calls when it's off
+};
+
+// scope statistics of the last frame
+struct eqProfNodeStats_t
+{
+	const char*		name;
+	int				depth;			// nesting level of the scope, starting from 0
+
+	int				calls;
+	float			timeMs;			// inclusive time, ms
+	float			avgTimeMs;		// smoothed inclusive time, ms
+	float			maxTimeMs;		// peak inclusive time since the stats reset, ms
+};
+
+class IEqProfiler : public IEqCoreModule
+{
+public:
+	virtual void				SetEnabled(bool enable) = 0;
+	virtual bool				IsEnabled() const = 0;
+
+	// registers named marker. Same names share the marker
+	virtual eqProfMarker_t*		RegisterMarker(const char* name) = 0;
+
+	// scope markers. Use PROF_EVENT instead
+	virtual void				BeginScope(eqProfMarker_t* marker) = 0;
+	virtual void				EndScope(eqProfMarker_t* marker) = 0;
+
+	// closes the frame statistics and capture frame. Call it from the main loop
+	virtual void				EndFrame() = 0;
+
+//----------------------------------------------------------
+// live statistics
+
+	virtual int					GetThreadCount() const = 0;
+	virtual const char*			GetThreadName(int thread) const = 0;
+
+	// fills stats of the thread scopes in depth-first order, returns the count
+	virtual int					GetFrameStats(int thread, eqProfNodeStats_t* stats, int maxStats) const = 0;
+
+	virtual void				ResetStats() = 0;
+
+//----------------------------------------------------------
+// capture
+
+	// records all scopes during the numFrames and saves them to the file
+	// as Chrome trace event JSON (chrome://tracing, Perfetto)
+	virtual bool				StartCapture(const char* fileName, int numFrames) = 0;
+	virtual bool				IsCapturing() const = 0;
+};
+
+INTERFACE_SINGLETON( IEqProfiler, CEqProfiler, PROFILER_INTERFACE_VERSION, g_profiler )
+
+//----------------------------------------------------------
+
+class CEqProfileScope
+{
+public:
+	CEqProfileScope(eqProfMarker_t* marker) : m_marker(nullptr)
+	{
+		if(!marker->enabled)
+			return;
+
+		m_marker = marker;
+		g_profiler->BeginScope(marker);
+	}
+
+	~CEqProfileScope()
+	{
+		if(m_marker)
+			g_profiler->EndScope(m_marker);
+	}
+
+protected:
+	eqProfMarker_t*		m_marker;
+};
+
+#define PROF_JOIN2(a, b)		a##b
+#define PROF_JOIN(a, b)			PROF_JOIN2(a, b)
+
+#define PROF_EVENT(name)	\
+	static eqProfMarker_t* PROF_JOIN(_profMarker, __LINE__) = g_profiler->RegisterMarker(name);	\
+	CEqProfileScope PROF_JOIN(_profScope, __LINE__)(PROF_JOIN(_profMarker, __LINE__))
+
+#endif // IEQPROFILER_H
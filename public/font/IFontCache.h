@@ -11,7 +11,7 @@
 #include "IFont.h"
 #include "core/InterfaceManager.h"
 
-#define FONTCACHE_INTERFACE_VERSION		"ENGINE_FontCache_002"
+#define FONTCACHE_INTERFACE_VERSION		"ENGINE_FontCache_003"
 
 struct eqFontFamily_t;
 
@@ -32,6 +32,11 @@ public:
 	// finds font
 	virtual IEqFont*			GetFont(const char* name, int bestSize, int styleFlags = TEXT_STYLE_REGULAR, bool defaultIfNotFound = true) const = 0;
 	virtual eqFontFamily_t*		GetFamily(const char* name) const = 0;
+
+	// text batching. Text rendered between Begin and End is drawn at End with as few draws as possible,
+	// grouped by font and style. Scissored text is not batched and rendered immediately
+	virtual void				BeginTextBatch() = 0;
+	virtual void				EndTextBatch() = 0;
 };
 
 extern IEqFontCache* g_fontCache;
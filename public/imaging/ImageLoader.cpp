@@ -410,6 +410,16 @@ bool CImage::LoadDDS(const char *fileName, uint flags)
 	return LoadDDSfromHandle(file,flags);
 }
 
+bool CImage::LoadDDSMipMaps(const char *fileName, int firstMipMap)
+{
+	IFile *file;
+	if ((file = g_fileSystem->Open(fileName, "rb")) == NULL) return false;
+
+	SetName(fileName);
+
+	return LoadDDSfromHandle(file, 0, firstMipMap);
+}
+
 #ifndef NO_JPEG
 bool CImage::LoadJPEG(const char *fileName)
 {
@@ -434,7 +444,7 @@ bool CImage::LoadTGA(const char *fileName)
 }
 #endif
 
-bool CImage::LoadDDSfromHandle(IFile *fileHandle, uint flags)
+bool CImage::LoadDDSfromHandle(IFile *fileHandle, uint flags, int firstMipMap)
 {
 	DDSHeader header;
 
@@ -545,6 +555,23 @@ bool CImage::LoadDDSfromHandle(IFile *fileHandle, uint flags)
 		}
 	}
 
+	if (firstMipMap > 0)
+	{
+		if (!Is2D() || firstMipMap >= m_nMipMaps)
+		{
+			MsgError("Image %s has no mip level %d to load\n", GetName(), firstMipMap);
+			g_fileSystem->Close(file);
+			return false;
+		}
+
+		// skip bigger mip levels, smaller ones are stored after them
+		file->Seek(GetMipMappedSize(0, firstMipMap), VS_SEEK_CUR);
+
+		m_nWidth = GetWidth(firstMipMap);
+		m_nHeight = GetHeight(firstMipMap);
+		m_nMipMaps -= firstMipMap;
+	}
+
 	int size = GetMipMappedSize(0, m_nMipMaps);
 	m_pPixels = new ubyte[size];
 	if (IsCube())
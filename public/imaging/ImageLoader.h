@@ -77,6 +77,9 @@ public:
 	}
 
 	bool			LoadDDS(const char *fileName, uint flags = 0);
+
+	// reads only mip levels starting from firstMipMap, for 2D images only
+	bool			LoadDDSMipMaps(const char *fileName, int firstMipMap);
 #ifndef NO_JPEG
 	bool			LoadJPEG(const char *fileName);
 #endif // NO_JPEG
@@ -84,7 +87,7 @@ public:
 	bool			LoadTGA(const char *fileName);
 #endif // NO_TGA
 
-	bool			LoadDDSfromHandle(IVirtualStream *fileHandle, uint flags = 0);
+	bool			LoadDDSfromHandle(IVirtualStream *fileHandle, uint flags = 0, int firstMipMap = 0);
 #ifndef NO_JPEG
 	bool			LoadJPEGfromHandle(IVirtualStream*fileHandle);
 #endif // NO_JPEG
@@ -300,6 +300,14 @@ void CBaseShader::ParamSetup_RasterState()
 }
 
 
+// constant handles of the default parameters, resolved by name on first use
+static int s_constWVP = -1;
+static int s_constWorld = -1;
+static int s_constBaseTextureTransform = -1;
+static int s_constViewPos = -1;
+static int s_constFogParams = -1;
+static int s_constFogColor = -1;
+
 void CBaseShader::ParamSetup_Transform()
 {
 	Matrix4x4 wvp_matrix = identity4();
@@ -308,11 +316,11 @@ void CBaseShader::ParamSetup_Transform()
 	Matrix4x4 worldtransform = identity4();
 	materials->GetMatrix(MATRIXMODE_WORLD, worldtransform);
 
-	g_pShaderAPI->SetShaderConstantMatrix4("WVP", wvp_matrix);
-	g_pShaderAPI->SetShaderConstantMatrix4("World", worldtransform);
+	s_constWVP = g_pShaderAPI->SetShaderConstantMatrix4("WVP", wvp_matrix, s_constWVP);
+	s_constWorld = g_pShaderAPI->SetShaderConstantMatrix4("World", worldtransform, s_constWorld);
 
 	// setup texture transform
-	SetupVertexShaderTextureTransform(m_pBaseTextureTransformVar, m_pBaseTextureScaleVar, "BaseTextureTransform");
+	s_constBaseTextureTransform = SetupVertexShaderTextureTransform(m_pBaseTextureTransformVar, m_pBaseTextureScaleVar, "BaseTextureTransform", s_constBaseTextureTransform);
 }
 
 void CBaseShader::ParamSetup_TextureFrames()
@@ -327,18 +335,13 @@ void CBaseShader::ParamSetup_DepthSetup()
 
 void CBaseShader::ParamSetup_Fog()
 {
-	FogInfo_t fog;
-	materials->GetFogInfo(fog);
-
-	// setup shader fog
-	float fogScale = 1.0 / (fog.fogfar - fog.fognear);
-
-	Vector4D VectorFOGParams(fog.fognear,fog.fogfar, fogScale, 1.0f);
+	// fog parameters are prepared by material system once they are changed
+	const matsystem_shared_constants_t& shared = materials->GetSharedConstants();
 
-	g_pShaderAPI->SetShaderConstantVector3D("ViewPos", fog.viewPos);
+	s_constViewPos = g_pShaderAPI->SetShaderConstantVector3D("ViewPos", shared.viewPos, s_constViewPos);
 
-	g_pShaderAPI->SetShaderConstantVector4D("FogParams", VectorFOGParams);
-	g_pShaderAPI->SetShaderConstantVector3D("FogColor", fog.fogColor);
+	s_constFogParams = g_pShaderAPI->SetShaderConstantVector4D("FogParams", shared.fogParams, s_constFogParams);
+	s_constFogColor = g_pShaderAPI->SetShaderConstantVector3D("FogColor", shared.fogColor, s_constFogColor);
 }
 
 // get texture transformation from vars
@@ -351,11 +354,11 @@ Vector4D CBaseShader::GetTextureTransform(IMatVar* pTransformVar, IMatVar* pScal
 }
 
 // sends texture transformation to shader
-void CBaseShader::SetupVertexShaderTextureTransform(IMatVar* pTransformVar, IMatVar* pScaleVar, const char* pszConstName)
+int CBaseShader::SetupVertexShaderTextureTransform(IMatVar* pTransformVar, IMatVar* pScaleVar, const char* pszConstName, int const_id)
 {
 	Vector4D trans = GetTextureTransform(pTransformVar, pScaleVar);
 
-	g_pShaderAPI->SetShaderConstantVector4D(pszConstName, trans);
+	return g_pShaderAPI->SetShaderConstantVector4D(pszConstName, trans, const_id);
 }
 
 IMaterial* CBaseShader::GetAssignedMaterial()
@@ -240,7 +240,7 @@ public:
 
 	Vector4D					GetTextureTransform(IMatVar* pTransformVar, IMatVar* pScaleVar);	// get texture transformation from vars
 
-	void						SetupVertexShaderTextureTransform(IMatVar* pTransformVar, IMatVar* pScaleVar, const char* pszConstName);	// sends texture transformation to shader
+	int							SetupVertexShaderTextureTransform(IMatVar* pTransformVar, IMatVar* pScaleVar, const char* pszConstName, int const_id = -1);	// sends texture transformation to shader, returns constant handle
 
 
 	int							GetBaseTextureStageCount()	{return 1;}
@@ -45,8 +45,14 @@ public:
 	// uploads buffers and renders the mesh. Note that you has been set material and adjusted RTs
 	virtual void			Render() = 0;
 
+	// renders the range of indices (or vertices if there are no indices). Geometry is uploaded once for multiple draws
+	virtual void			Render( int firstIndex, int numIndices ) = 0;
+
 	// resets the dynamic mesh
 	virtual void			Reset() = 0;
+
+	// returns byte count uploaded during last frame
+	virtual int				GetUploadedBytes() const = 0;
 };
 
 #endif // IDYNAMICMESH_H
\ No newline at end of file
@@ -32,7 +32,7 @@ struct dlight_t;
 class CViewParams;
 
 // interface version for Shaders_*** dlls
-#define MATSYSTEM_INTERFACE_VERSION "MaterialSystem_008"
+#define MATSYSTEM_INTERFACE_VERSION "MaterialSystem_014"
 
 // begin/end resource loading for timer purposes
 typedef void (*RESOURCELOADCALLBACK)( void );
@@ -61,6 +61,15 @@ enum EMaterialBindFlags
 	MATERIAL_BIND_KEEPOVERRIDE = (1 << 1),
 };
 
+// material loader queue priorities. Greater values are loaded first
+enum EMaterialLoadPriority
+{
+	MATERIAL_LOAD_PRIORITY_LOW = 0,		// preloading
+	MATERIAL_LOAD_PRIORITY_NORMAL,		// requested by the code
+	MATERIAL_LOAD_PRIORITY_NEAR,		// visible near the camera
+	MATERIAL_LOAD_PRIORITY_BOUND,		// bound for rendering in this frame
+};
+
 struct shaderfactory_t
 {
 	DISPATCH_CREATE_SHADER dispatcher;
@@ -147,6 +156,7 @@ struct matsystem_render_config_t
 		lowShaderQuality = false;
 		editormode = false;
 		threadedloader = true;
+		threadedRenderer = false;
 		flushThresh = 1000;
 		enableShadows = true;
 		enableSpecular = true;
@@ -172,6 +182,7 @@ struct matsystem_render_config_t
 	bool	lowShaderQuality;
 	bool	editormode;					// enable editor mode
 	bool	threadedloader;
+	bool	threadedRenderer;			// submit frames to the device from separate render thread. Not supported by OpenGL renderer
 	int		flushThresh;				// flush (unload) threshold in frames
 
 	// options that can be changed in real time
@@ -183,6 +194,21 @@ struct matsystem_render_config_t
 	bool	overdrawMode;				// matsystem overdraw mode
 };
 
+//-----------------------------------------------------
+// shader constants shared by all materials.
+// Recomputed only when view, projection or fog changes
+//-----------------------------------------------------
+
+struct matsystem_shared_constants_t
+{
+	Matrix4x4	viewProj;				// projection * view
+
+	Vector3D	viewPos;
+	Vector4D	fogParams;				// near, far, 1 / (far - near), 1
+	Vector3D	fogColor;
+	bool		fogEnable;
+};
+
 //------------------------------------------------------------------------
 // Material system render parameters
 //------------------------------------------------------------------------
@@ -252,6 +278,9 @@ public:
 	// Finds or loads material (if findExisting is false then it will be loaded as new material instance)
 	virtual IMaterial*						GetMaterial(const char* szMaterialName) = 0;
 
+	// Finds or loads the bunch of materials at once. Empty or NULL names are giving NULL materials
+	virtual void							GetMaterials(const char** materialNames, IMaterial** outMaterials, int count) = 0;
+
 	// checks material for existence
 	virtual bool							IsMaterialExist(const char* szMaterialName) = 0;
 
@@ -270,8 +299,8 @@ public:
 	// waits for material loader thread is finished
 	virtual void							Wait() = 0;
 
-	// loads material or sends it to loader thread
-	virtual void							PutMaterialToLoadingQueue(IMaterial* pMaterial) = 0;
+	// loads material or sends it to loader threads. Queued material can be raised to higher priority
+	virtual void							PutMaterialToLoadingQueue(IMaterial* pMaterial, int priority = MATERIAL_LOAD_PRIORITY_NORMAL) = 0;
 
 	// returns material count which is currently loading or awaiting for load
 	virtual int								GetLoadingQueue() const = 0;
@@ -408,6 +437,9 @@ public:
 	// retunrs multiplied matrix
 	virtual void							GetWorldViewProjection(Matrix4x4 &matrix) = 0;
 
+	// returns view, projection and fog constants shared by all materials
+	virtual const matsystem_shared_constants_t&	GetSharedConstants() = 0;
+
 	//-----------------------------
 	// Swap chains
 	//-----------------------------
@@ -415,6 +447,9 @@ public:
 	// tells device to begin frame
 	virtual bool							BeginFrame() = 0;
 
+	// updates proxies of materials that were bound last frame on job threads. Call it before rendering
+	virtual void							UpdateMaterialProxies(float fDt) = 0;
+
 	// tells device to end and present frame. Also swapchain can be overriden.
 	virtual bool							EndFrame(IEqSwapChain* swapChain) = 0;
 
@@ -435,6 +470,10 @@ public:
 	// captures screenshot to CImage data
 	virtual bool							CaptureScreenshot( CImage &img ) = 0;
 
+	// waits until render thread completes all recorded commands.
+	// Must be called before accessing device resources directly (e.g. ITexture::Lock)
+	virtual void							WaitForRenderThread() = 0;
+
 	//-----------------------------
 	// Internal operations
 	//-----------------------------
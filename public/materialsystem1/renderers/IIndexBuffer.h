@@ -26,6 +26,7 @@ public:
 	virtual int				GetIndicesCount() = 0;
 
 	// updates buffer without map/unmap operations which are slower
+	// dynamic buffers are appended with no-overwrite semantics if discard is false, range must not be used by pending draws
 	virtual void			Update(void* data, int size, int offset, bool discard = true) = 0;
 
 	// locks index buffer and gives to programmer buffer data
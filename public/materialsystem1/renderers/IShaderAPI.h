@@ -266,6 +266,12 @@ public:
 
 	// END CUT HERE
 
+	// updates texture mip streaming. Called by material system at the end of frame
+	virtual void				UpdateTextureStreaming() = 0;
+
+	// sets size of the texture on screen in pixels. Streaming will not load the mips bigger than that
+	virtual void				SetTextureStreamingSize(ITexture* pTexture, int screenSize) = 0;
+
 //-------------------------------------------------------------
 // Texture operations
 //-------------------------------------------------------------
@@ -430,7 +436,14 @@ public:
 	// Sets current shader for rendering
 	virtual void				SetShader(IShaderProgram* pShader) = 0;
 
-	// Shader constants setup
+	// drops cached shader sources and prebuilt programs, so they are loaded from disk again
+	virtual void				ReloadShaderSources() = 0;
+
+	// Returns global shader constant handle, valid for any shader program.
+	// Pass it as const_id to the constant setup to skip the name lookup
+	virtual int					GetShaderConstantHandle(const char *pszName) = 0;
+
+	// Shader constants setup. Returns constant handle which can be passed as const_id next time
 	virtual int					SetShaderConstantInt(const char *pszName, const int constant, int const_id = -1) = 0;
 	virtual int					SetShaderConstantFloat(const char *pszName, const float constant, int const_id = -1) = 0;
 	virtual int					SetShaderConstantVector2D(const char *pszName, const Vector2D &constant, int const_id = -1) = 0;
@@ -35,6 +35,7 @@ public:
 	virtual int			GetStrideSize() = 0;
 
 	// updates buffer without map/unmap operations which are slower
+	// dynamic buffers are appended with no-overwrite semantics if discard is false, range must not be used by pending draws
 	virtual void		Update(void* data, int size, int offset, bool discard = true) = 0;
 
 	// locks vertex buffer and gives to programmer buffer data
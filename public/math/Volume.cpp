@@ -7,6 +7,18 @@
 
 #include "Volume.h"
 
+#if defined(__AVX__)
+#	include <immintrin.h>
+#	define VOLUME_BATCH_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	include <xmmintrin.h>
+#	define VOLUME_BATCH_SSE
+#endif
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
 void Volume::LoadAsFrustum(const Matrix4x4 &mvp)
 {
 	m_planes[VOLUME_PLANE_LEFT  ] = Plane(mvp[12] - mvp[0], mvp[13] - mvp[1], mvp[14] - mvp[2],  mvp[15] - mvp[3]);
@@ -122,6 +134,281 @@ bool Volume::IsBoxInside(const float minX, const float maxX, const float minY, c
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// Batch tests
+//
+// Box is outside if the corner which is the farthest along the plane normal is behind the plane,
+// so that's only min/max selection per axis instead of eight corner distances
+//-----------------------------------------------------------------------------
+
+#if defined(VOLUME_BATCH_AVX)
+#	define VOLUME_BATCH_WIDTH	8
+#elif defined(VOLUME_BATCH_SSE)
+#	define VOLUME_BATCH_WIDTH	4
+#else
+#	define VOLUME_BATCH_WIDTH	1
+#endif
+
+static inline bool Volume_TestBox(const Plane* planes, float minX, float minY, float minZ, float maxX, float maxY, float maxZ, float eps)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const Plane& pl = planes[i];
+
+		float dist = max(pl.normal.x*minX, pl.normal.x*maxX) +
+					 max(pl.normal.y*minY, pl.normal.y*maxY) +
+					 max(pl.normal.z*minZ, pl.normal.z*maxZ) + pl.offset;
+
+		if(dist <= -eps)
+			return false;
+	}
+
+	return true;
+}
+
+static inline bool Volume_TestSphere(const Plane* planes, float x, float y, float z, float radius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const Plane& pl = planes[i];
+
+		if(pl.normal.x*x + pl.normal.y*y + pl.normal.z*z + pl.offset <= -radius)
+			return false;
+	}
+
+	return true;
+}
+
+#if defined(VOLUME_BATCH_AVX)
+
+// returns bit mask of boxes [i, i+8) inside
+static inline uint Volume_TestBoxesSIMD(const Plane* planes, const volumeBoxesSoA_t& boxes, int i, float eps)
+{
+	__m256 minX = _mm256_loadu_ps(boxes.minX + i);
+	__m256 minY = _mm256_loadu_ps(boxes.minY + i);
+	__m256 minZ = _mm256_loadu_ps(boxes.minZ + i);
+	__m256 maxX = _mm256_loadu_ps(boxes.maxX + i);
+	__m256 maxY = _mm256_loadu_ps(boxes.maxY + i);
+	__m256 maxZ = _mm256_loadu_ps(boxes.maxZ + i);
+
+	__m256 negEps = _mm256_set1_ps(-eps);
+	__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+	for (int p = 0; p < 6; p++)
+	{
+		const Plane& pl = planes[p];
+
+		__m256 nx = _mm256_set1_ps(pl.normal.x);
+		__m256 ny = _mm256_set1_ps(pl.normal.y);
+		__m256 nz = _mm256_set1_ps(pl.normal.z);
+
+		__m256 dist = _mm256_add_ps(_mm256_max_ps(_mm256_mul_ps(nx, minX), _mm256_mul_ps(nx, maxX)),
+								   _mm256_max_ps(_mm256_mul_ps(ny, minY), _mm256_mul_ps(ny, maxY)));
+		dist = _mm256_add_ps(dist, _mm256_max_ps(_mm256_mul_ps(nz, minZ), _mm256_mul_ps(nz, maxZ)));
+		dist = _mm256_add_ps(dist, _mm256_set1_ps(pl.offset));
+
+		inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negEps, _CMP_GT_OQ));
+	}
+
+	return (uint)_mm256_movemask_ps(inside);
+}
+
+static inline uint Volume_TestSpheresSIMD(const Plane* planes, const volumeSpheresSoA_t& spheres, int i)
+{
+	__m256 x = _mm256_loadu_ps(spheres.x + i);
+	__m256 y = _mm256_loadu_ps(spheres.y + i);
+	__m256 z = _mm256_loadu_ps(spheres.z + i);
+	__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+
+	__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+	for (int p = 0; p < 6; p++)
+	{
+		const Plane& pl = planes[p];
+
+		__m256 dist = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl.normal.x), x), _mm256_mul_ps(_mm256_set1_ps(pl.normal.y), y));
+		dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(pl.normal.z), z));
+		dist = _mm256_add_ps(dist, _mm256_set1_ps(pl.offset));
+
+		inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negRadius, _CMP_GT_OQ));
+	}
+
+	return (uint)_mm256_movemask_ps(inside);
+}
+
+#elif defined(VOLUME_BATCH_SSE)
+
+// returns bit mask of boxes [i, i+4) inside
+static inline uint Volume_TestBoxesSIMD(const Plane* planes, const volumeBoxesSoA_t& boxes, int i, float eps)
+{
+	__m128 minX = _mm_loadu_ps(boxes.minX + i);
+	__m128 minY = _mm_loadu_ps(boxes.minY + i);
+	__m128 minZ = _mm_loadu_ps(boxes.minZ + i);
+	__m128 maxX = _mm_loadu_ps(boxes.maxX + i);
+	__m128 maxY = _mm_loadu_ps(boxes.maxY + i);
+	__m128 maxZ = _mm_loadu_ps(boxes.maxZ + i);
+
+	__m128 negEps = _mm_set1_ps(-eps);
+	__m128 inside = _mm_cmpeq_ps(negEps, negEps);
+
+	for (int p = 0; p < 6; p++)
+	{
+		const Plane& pl = planes[p];
+
+		__m128 nx = _mm_set1_ps(pl.normal.x);
+		__m128 ny = _mm_set1_ps(pl.normal.y);
+		__m128 nz = _mm_set1_ps(pl.normal.z);
+
+		__m128 dist = _mm_add_ps(_mm_max_ps(_mm_mul_ps(nx, minX), _mm_mul_ps(nx, maxX)),
+								_mm_max_ps(_mm_mul_ps(ny, minY), _mm_mul_ps(ny, maxY)));
+		dist = _mm_add_ps(dist, _mm_max_ps(_mm_mul_ps(nz, minZ), _mm_mul_ps(nz, maxZ)));
+		dist = _mm_add_ps(dist, _mm_set1_ps(pl.offset));
+
+		inside = _mm_and_ps(inside, _mm_cmpgt_ps(dist, negEps));
+	}
+
+	return (uint)_mm_movemask_ps(inside);
+}
+
+static inline uint Volume_TestSpheresSIMD(const Plane* planes, const volumeSpheresSoA_t& spheres, int i)
+{
+	__m128 x = _mm_loadu_ps(spheres.x + i);
+	__m128 y = _mm_loadu_ps(spheres.y + i);
+	__m128 z = _mm_loadu_ps(spheres.z + i);
+	__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+
+	__m128 inside = _mm_cmpeq_ps(x, x);
+
+	for (int p = 0; p < 6; p++)
+	{
+		const Plane& pl = planes[p];
+
+		__m128 dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.normal.x), x), _mm_mul_ps(_mm_set1_ps(pl.normal.y), y));
+		dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(pl.normal.z), z));
+		dist = _mm_add_ps(dist, _mm_set1_ps(pl.offset));
+
+		inside = _mm_and_ps(inside, _mm_cmpgt_ps(dist, negRadius));
+	}
+
+	return (uint)_mm_movemask_ps(inside);
+}
+
+#else
+
+static inline uint Volume_TestBoxesSIMD(const Plane* planes, const volumeBoxesSoA_t& boxes, int i, float eps)
+{
+	return Volume_TestBox(planes, boxes.minX[i], boxes.minY[i], boxes.minZ[i], boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i], eps) ? 1 : 0;
+}
+
+static inline uint Volume_TestSpheresSIMD(const Plane* planes, const volumeSpheresSoA_t& spheres, int i)
+{
+	return Volume_TestSphere(planes, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]) ? 1 : 0;
+}
+
+#endif
+
+void Volume::TestBoxes(const volumeBoxesSoA_t& boxes, int first, int count, uint* visibleMask, const float eps) const
+{
+	uint* mask = visibleMask + first / 32;
+
+	// SIMD groups never cross the mask word because the range starts at word
+	int numGroups = count / VOLUME_BATCH_WIDTH * VOLUME_BATCH_WIDTH;
+	uint bits = 0;
+
+	int i = 0;
+	for (; i < numGroups; i += VOLUME_BATCH_WIDTH)
+	{
+		bits |= Volume_TestBoxesSIMD(m_planes, boxes, first + i, eps) << (i & 31);
+
+		if(((i + VOLUME_BATCH_WIDTH) & 31) == 0)
+		{
+			mask[i / 32] = bits;
+			bits = 0;
+		}
+	}
+
+	for (; i < count; i++)
+	{
+		int b = first + i;
+
+		if(Volume_TestBox(m_planes, boxes.minX[b], boxes.minY[b], boxes.minZ[b], boxes.maxX[b], boxes.maxY[b], boxes.maxZ[b], eps))
+			bits |= 1 << (i & 31);
+	}
+
+	if(count & 31)
+		mask[count / 32] = bits;
+}
+
+void Volume::TestSpheres(const volumeSpheresSoA_t& spheres, int first, int count, uint* visibleMask) const
+{
+	uint* mask = visibleMask + first / 32;
+
+	int numGroups = count / VOLUME_BATCH_WIDTH * VOLUME_BATCH_WIDTH;
+	uint bits = 0;
+
+	int i = 0;
+	for (; i < numGroups; i += VOLUME_BATCH_WIDTH)
+	{
+		bits |= Volume_TestSpheresSIMD(m_planes, spheres, first + i) << (i & 31);
+
+		if(((i + VOLUME_BATCH_WIDTH) & 31) == 0)
+		{
+			mask[i / 32] = bits;
+			bits = 0;
+		}
+	}
+
+	for (; i < count; i++)
+	{
+		int s = first + i;
+
+		if(Volume_TestSphere(m_planes, spheres.x[s], spheres.y[s], spheres.z[s], spheres.radius[s]))
+			bits |= 1 << (i & 31);
+	}
+
+	if(count & 31)
+		mask[count / 32] = bits;
+}
+
+static inline int Volume_LowestBit(uint bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return (int)index;
+#elif defined(__GNUC__)
+	return __builtin_ctz(bits);
+#else
+	int bit = 0;
+	while(!(bits & (1u << bit)))
+		bit++;
+	return bit;
+#endif
+}
+
+int Volume::GetVisibleIndices(const uint* visibleMask, int first, int count, int* outIndices)
+{
+	const uint* mask = visibleMask + first / 32;
+	int numWords = VOLUME_VISIBLE_MASK_WORDS(count);
+	int numVisible = 0;
+
+	for (int w = 0; w < numWords; w++)
+	{
+		uint bits = mask[w];
+
+		// last word has bits past the range cleared
+		int base = first + w*32;
+
+		while(bits)
+		{
+			outIndices[numVisible++] = base + Volume_LowestBit(bits);
+			bits &= bits - 1;
+		}
+	}
+
+	return numVisible;
+}
+
 bool Volume::IsIntersectsRay(const Vector3D &start,const Vector3D &dir, Vector3D &intersectionPos, float eps) const
 {
 	bool isinstersects = false;
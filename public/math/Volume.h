@@ -23,6 +23,31 @@ enum EVolumePlane
 	VOLUME_PLANE_NEAR,   //= 5
 };
 
+// bounding boxes as coordinate arrays for batch tests
+struct volumeBoxesSoA_t
+{
+	const float*	minX;
+	const float*	minY;
+	const float*	minZ;
+	const float*	maxX;
+	const float*	maxY;
+	const float*	maxZ;
+	int				numBoxes;
+};
+
+// spheres as coordinate arrays for batch tests
+struct volumeSpheresSoA_t
+{
+	const float*	x;
+	const float*	y;
+	const float*	z;
+	const float*	radius;
+	int				numSpheres;
+};
+
+// visibility mask size for batch tests, one bit per item
+#define VOLUME_VISIBLE_MASK_WORDS(count)	(((count) + 31) / 32)
+
 class Volume
 {
 public:
@@ -45,6 +70,15 @@ public:
 	bool			IsTriangleInside(const Vector3D& v0, const Vector3D& v1, const Vector3D& v2) const;
 	bool			IsSphereInside(const Vector3D &pos, const float radius) const;
 
+	// Batch tests, four or eight items at once when SSE or AVX is available.
+	// Bit of each item of the range is set in visibleMask if it's inside, other bits are cleared.
+	// first must be a multiple of 32, so ranges can be tested by different threads
+	void			TestBoxes(const volumeBoxesSoA_t& boxes, int first, int count, uint* visibleMask, const float eps = 0.0f) const;
+	void			TestSpheres(const volumeSpheresSoA_t& spheres, int first, int count, uint* visibleMask) const;
+
+	// writes indices of items which have their mask bit set, returns their count
+	static int		GetVisibleIndices(const uint* visibleMask, int first, int count, int* outIndices);
+
 	bool			IsIntersectsRay(const Vector3D &start,const Vector3D &dir, Vector3D &intersectionPos, float eps = 0.0f) const;
 
 	const Plane&	GetPlane(const int plane) const { return m_planes[plane]; }
@@ -9,6 +9,7 @@
 // Core interface helper
 #include <stdarg.h>
 #include <stdio.h>
+#include <limits.h>
 
 #ifdef LINUX
 #include <ctype.h>
@@ -18,11 +19,22 @@
 
 #include "core/DebugInterface.h"
 #include "core/IFileSystem.h"
+#include "core/ICommandLine.h"
 
 #include "KeyValues.h"
 
 #include "utils/VirtualStream.h"
 #include "utils/strtools.h"
+#include "utils/CRC32.h"
+#include "utils/eqthread.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define KV_SCAN_SSE2
+#	include <emmintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#endif
 
 static const char* s_szkKVValueTypes[KVPAIR_TYPES] =
 {
@@ -143,11 +155,171 @@ enum EParserMode
 };
 
 //------------------------------------------------------
+// Bulk character scanning for the parsers
+// Skips the runs of characters which aren't changing the parser state
+//------------------------------------------------------
+
+enum EKVCharClass
+{
+	KVCHAR_SPACE			= (1 << 0),		// isspace
+	KVCHAR_STRING_END		= (1 << 1),		// ends unquoted string in KV_ParseSection
+	KVCHAR_STRING_END_V3	= (1 << 2),		// ends unquoted string in KV_ParseSectionV3
+	KVCHAR_SKIP_V3			= (1 << 3),		// skipped between tokens in KV_ParseSectionV3
+};
+
+static ubyte s_kvCharClass[256];
+
+static bool KV_InitCharClasses()
+{
+	for(int i = 0; i < 256; i++)
+	{
+		char c = (char)i;
+		ubyte flags = 0;
+
+		if(isspace(c))
+			flags |= KVCHAR_SPACE | KVCHAR_SKIP_V3;
+
+		if(isspace((ubyte)c) || c == KV_BREAK || c == KV_COMMENT_SYMBOL || c == KV_SECTION_BEGIN || c == '\0')
+			flags |= KVCHAR_STRING_END;
+
+		if(IsKVWhitespace(c) || IsKVArrayEndOrSeparator(c) || c == KV_BREAK || c == KV_COMMENT_SYMBOL || c == KV_TYPE_VALUESYMBOL || c == '\\')
+			flags |= KVCHAR_STRING_END_V3;
+
+		if(c == KV_BREAK)
+			flags |= KVCHAR_SKIP_V3;
+
+		s_kvCharClass[i] = flags;
+	}
+
+	return true;
+}
+
+static bool s_kvCharClassInit = KV_InitCharClasses();
+
+inline bool KV_CharIs(char c, int flags)
+{
+	return (s_kvCharClass[(ubyte)c] & flags) != 0;
+}
+
+#ifdef KV_SCAN_SSE2
+inline int KV_FirstBit(uint mask)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return idx;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+inline int KV_BitCount(uint mask)
+{
+	int count = 0;
+
+	for(; mask; count++)
+		mask &= mask - 1;
+
+	return count;
+}
+#endif // KV_SCAN_SSE2
+
+//
+// Returns the first occurence of a, b, c or '\0' in the [pStr, pEnd) range or pEnd
+// Counts the new lines which were skipped
+//
+static const char* KV_ScanTo(const char* pStr, const char* pEnd, char a, char b, char c, int& nLine)
+{
+#ifdef KV_SCAN_SSE2
+	const __m128i va = _mm_set1_epi8(a);
+	const __m128i vb = _mm_set1_epi8(b);
+	const __m128i vc = _mm_set1_epi8(c);
+	const __m128i vzero = _mm_setzero_si128();
+	const __m128i vnewline = _mm_set1_epi8(KV_STRING_NEWLINE);
+
+	while(pEnd - pStr >= 16)
+	{
+		__m128i chars = _mm_loadu_si128((const __m128i*)pStr);
+
+		__m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, va), _mm_cmpeq_epi8(chars, vb)),
+									_mm_or_si128(_mm_cmpeq_epi8(chars, vc), _mm_cmpeq_epi8(chars, vzero)));
+
+		uint stopMask = _mm_movemask_epi8(stop);
+		uint lineMask = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, vnewline));
+
+		if(stopMask)
+		{
+			int idx = KV_FirstBit(stopMask);
+			nLine += KV_BitCount(lineMask & ((1 << idx) - 1));
+
+			return pStr + idx;
+		}
+
+		nLine += KV_BitCount(lineMask);
+		pStr += 16;
+	}
+#endif // KV_SCAN_SSE2
+
+	for(; pStr < pEnd; pStr++)
+	{
+		char chr = *pStr;
+
+		if(chr == a || chr == b || chr == c || chr == '\0')
+			break;
+
+		if(chr == KV_STRING_NEWLINE)
+			nLine++;
+	}
+
+	return pStr;
+}
+
+// returns the first character in the [pStr, pEnd) range which has any of flags or pEnd
+inline const char* KV_ScanToClass(const char* pStr, const char* pEnd, int flags)
+{
+	while(pStr < pEnd && !KV_CharIs(*pStr, flags))
+		pStr++;
+
+	return pStr;
+}
+
+// returns the first character in the [pStr, pEnd) range which has none of flags or pEnd
+// Counts the new lines which were skipped
+inline const char* KV_SkipClass(const char* pStr, const char* pEnd, int flags, int& nLine)
+{
+	for(; pStr < pEnd && KV_CharIs(*pStr, flags); pStr++)
+	{
+		if(*pStr == KV_STRING_NEWLINE)
+			nLine++;
+	}
+
+	return pStr;
+}
+
+//------------------------------------------------------
+
+static char s_kvUnnamedName[] = "unnamed";
+static int s_kvUnnamedHash = StringToHash(s_kvUnnamedName, true);
+
+static kvpairvalue_t* KV_NewPairValue(CMemoryArena* arena)
+{
+	kvpairvalue_t* val = arena ? new(arena->Alloc(sizeof(kvpairvalue_t))) kvpairvalue_t() : new kvpairvalue_t();
+	val->arena = arena;
+
+	return val;
+}
+
+static void KV_DeletePairValue(kvpairvalue_t* val)
+{
+	// arena memory is released by root
+	if(!val->arena)
+		delete val;
+}
 
 kvpairvalue_t::~kvpairvalue_t()
 {
 	PPFree(value);
-	delete section;
+	kvkeybase_t::DeleteKeyBase(section);
 }
 
 void kvpairvalue_t::SetValueFrom(kvpairvalue_t* from)
@@ -179,13 +351,20 @@ void kvpairvalue_t::SetValueFrom(kvpairvalue_t* from)
 // sets string value
 void kvpairvalue_t::SetStringValue( const char* pszValue )
 {
+	size_t len = strlen(pszValue);
+
+	if(arena)
+	{
+		value = arena->AllocString(pszValue, len);
+		return;
+	}
+
 	if(value)
 	{
 		PPFree(value);
 		value = NULL;
 	}
 
-	size_t len = strlen(pszValue);
 	value = (char*)PPAlloc(len+1);
 
 	strcpy(value, pszValue);
@@ -197,7 +376,7 @@ void kvpairvalue_t::SetValueFromString( const char* pszValue )
 
 	SetStringValue( pszValue );
 
-	delete section;
+	kvkeybase_t::DeleteKeyBase(section);
 	section = NULL;
 
 	if(type == KVPAIR_INT)
@@ -218,6 +397,7 @@ void kvpairvalue_t::SetValueFromString( const char* pszValue )
 
 KeyValues::KeyValues()
 {
+	m_pKeyBase.InitArena();
 }
 
 KeyValues::~KeyValues()
@@ -267,44 +447,287 @@ void KeyValues::SaveToFile(const char* pszFileName, int nSearchFlags)
 // KEY (PAIR) BASE
 //----------------------------------------------------------------------------------------------
 
+//------------------------------------------------------
+// Key name index
+//------------------------------------------------------
+
+// sections with less keys are searched linearly
+#define KV_KEYINDEX_MIN_KEYS	16
+
+struct kvkeyindex_t
+{
+	int		numBuckets;		// power of two
+	int		capacity;		// keys that can be appended without rebuild
+	int		numKeys;
+
+	// bucket chains are in the same order as keys
+	int*	heads()	{ return (int*)(this + 1); }
+	int*	tails()	{ return heads() + numBuckets; }
+	int*	next()	{ return tails() + numBuckets; }
+};
+
+static Threading::CEqMutex s_kvKeyIndexMutex;
+
+// index is built lazily by readers, so it is published with release/acquire ordering:
+// a reader which sees the pointer must also see the filled index
+static kvkeyindex_t* KV_LoadKeyIndex(const kvkeybase_t* section)
+{
+#ifdef _MSC_VER
+	// volatile reads have acquire semantics in MSVC
+	return *(kvkeyindex_t* volatile*)&section->keyIndex;
+#else
+	return __atomic_load_n(&section->keyIndex, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void KV_PublishKeyIndex(const kvkeybase_t* section, kvkeyindex_t* index)
+{
+#ifdef _MSC_VER
+	*(kvkeyindex_t* volatile*)&section->keyIndex = index;
+#else
+	__atomic_store_n(&section->keyIndex, index, __ATOMIC_RELEASE);
+#endif
+}
+
+static bool KV_IsKeyIndexInArena(const kvkeybase_t* section)
+{
+	return section->arena && !section->ownsArena;
+}
+
+static void KV_LinkKeyIndex(kvkeyindex_t* index, int nameHash, int keyIdx)
+{
+	int bucket = nameHash & (index->numBuckets-1);
+
+	int* heads = index->heads();
+	int* tails = index->tails();
+	int* next = index->next();
+
+	next[keyIdx] = -1;
+
+	if(tails[bucket] == -1)
+		heads[bucket] = keyIdx;
+	else
+		next[tails[bucket]] = keyIdx;
+
+	tails[bucket] = keyIdx;
+	index->numKeys++;
+}
+
+static kvkeyindex_t* KV_BuildKeyIndex(const kvkeybase_t* section)
+{
+	// multiple threads may search the same section
+	Threading::CScopedMutex m(s_kvKeyIndexMutex);
+
+	kvkeyindex_t* built = KV_LoadKeyIndex(section);
+	if(built)
+		return built;
+
+	int numKeys = section->keys.numElem();
+
+	// leave some space for the keys added later
+	int capacity = numKeys + numKeys / 2;
+
+	int numBuckets = KV_KEYINDEX_MIN_KEYS;
+	while(numBuckets < capacity)
+		numBuckets <<= 1;
+
+	size_t indexSize = sizeof(kvkeyindex_t) + (numBuckets*2 + capacity) * sizeof(int);
+
+	kvkeyindex_t* index;
+	if(KV_IsKeyIndexInArena(section))
+		index = (kvkeyindex_t*)section->arena->Alloc(indexSize);
+	else
+		index = (kvkeyindex_t*)PPAllocTAG(indexSize, "KeyValues");
+
+	index->numBuckets = numBuckets;
+	index->capacity = capacity;
+	index->numKeys = 0;
+
+	memset(index->heads(), 0xFF, numBuckets*2*sizeof(int));
+
+	for(int i = 0; i < numKeys; i++)
+		KV_LinkKeyIndex(index, section->keys[i]->nameHash, i);
+
+	KV_PublishKeyIndex(section, index);
+
+	return index;
+}
+
+static void KV_InvalidateKeyIndex(kvkeybase_t* section)
+{
+	if(!section->keyIndex)
+		return;
+
+	// arena memory is released by root
+	if(!KV_IsKeyIndexInArena(section))
+		PPFree(section->keyIndex);
+
+	section->keyIndex = NULL;
+}
+
+// adds key to the section and keeps the index up to date
+static void KV_AppendKey(kvkeybase_t* section, kvkeybase_t* key)
+{
+	key->parent = section;
+	section->keys.append(key, section->arena);
+
+	kvkeyindex_t* index = section->keyIndex;
+
+	if(!index)
+		return;
+
+	int keyIdx = section->keys.numElem()-1;
+
+	if(keyIdx == index->numKeys && keyIdx < index->capacity)
+		KV_LinkKeyIndex(index, key->nameHash, keyIdx);
+	else
+		KV_InvalidateKeyIndex(section);
+}
+
+static void KV_AppendUniqueKey(kvkeybase_t* section, kvkeybase_t* key)
+{
+	// parent is only set by KV_AppendKey
+	if(key->parent != section)
+		KV_AppendKey(section, key);
+}
+
+//------------------------------------------------------
+
 kvkeybase_t::kvkeybase_t()
 {
 	line = 0;
 	unicode = false;
-	type = KVPAIR_STRING,
-	strcpy(name, "unnamed");
+	type = KVPAIR_STRING;
+	name = s_kvUnnamedName;
+	nameHash = s_kvUnnamedHash;
+	ownsArena = false;
+	arena = NULL;
+	parent = NULL;
+	keyIndex = NULL;
 }
 
 kvkeybase_t::~kvkeybase_t()
 {
 	Cleanup();
+
+	if(name != s_kvUnnamedName)
+		PPFree(name);
+
+	if(ownsArena)
+		delete arena;
+}
+
+void kvkeybase_t::InitArena(int pageSize)
+{
+	ASSERT(keys.numElem() == 0 && values.numElem() == 0);
+
+	if(arena)
+		return;
+
+	arena = new CMemoryArena(pageSize);
+	ownsArena = true;
+}
+
+kvkeybase_t* kvkeybase_t::NewKeyBase() const
+{
+	if(!arena)
+		return new kvkeybase_t();
+
+	kvkeybase_t* newBase = new(arena->Alloc(sizeof(kvkeybase_t))) kvkeybase_t();
+	newBase->arena = arena;
+
+	return newBase;
+}
+
+void kvkeybase_t::DeleteKeyBase(kvkeybase_t* base)
+{
+	if(!base)
+		return;
+
+	// arena memory is released by root
+	if(base->arena && !base->ownsArena)
+		return;
+
+	delete base;
+}
+
+// checks that the keybase memory can be released by the 'owner'.
+// Keybases of other storage are not moved, the caller may still hold them
+static bool KV_CanAdoptKeyBase(kvkeybase_t* owner, kvkeybase_t* base)
+{
+	bool sameStorage;
+
+	if(owner->arena)
+		sameStorage = (base->arena == owner->arena) && !base->ownsArena;
+	else
+		sameStorage = !base->arena || base->ownsArena;
+
+	if(!sameStorage)
+	{
+		MsgError("KeyValues: '%s' is not allocated by '%s' storage, use NewKeyBase() or CopyTo()\n", base->name, owner->name);
+		ASSERT(!"kvkeybase_t storage mismatch");
+	}
+
+	return sameStorage;
 }
 
 void kvkeybase_t::Cleanup()
 {
+	KV_InvalidateKeyIndex(this);
+
+	// everything nested is in the arena, release it at once
+	if(ownsArena)
+	{
+		values.clear(arena);
+		keys.clear(arena);
+		arena->Clear();
+		return;
+	}
+
 	ClearValues();
 
 	for(int i = 0; i < keys.numElem(); i++)
-		delete keys[i];
+		DeleteKeyBase(keys[i]);
 
-	keys.clear();
+	keys.clear(arena);
 }
 
 void kvkeybase_t::ClearValues()
 {
 	for(int i = 0; i < values.numElem(); i++)
-		delete values[i];
+		KV_DeletePairValue(values[i]);
 
-	values.clear();
+	values.clear(arena);
 }
 
 // sets keybase name
 void kvkeybase_t::SetName(const char* pszName)
 {
-	strncpy( name, pszName, sizeof(name));
-	name[sizeof(name) - 1] = 0;
+	int len = strlen(pszName);
+	if(len > KV_MAX_NAME_LENGTH-1)
+		len = KV_MAX_NAME_LENGTH-1;
+
+	char* oldName = name;
+
+	// root name is never allocated from it's own arena as it gets cleared
+	if(arena && !ownsArena)
+	{
+		name = arena->AllocString(pszName, len);
+	}
+	else
+	{
+		name = (char*)PPAlloc(len+1);
+		memcpy(name, pszName, len);
+		name[len] = 0;
+
+		if(oldName != s_kvUnnamedName)
+			PPFree(oldName);
+	}
 
 	nameHash = StringToHash(name, true);
+
+	if(parent)
+		KV_InvalidateKeyIndex(parent);
 }
 
 const char*	kvkeybase_t::GetName() const
@@ -316,11 +739,11 @@ const char*	kvkeybase_t::GetName() const
 
 kvpairvalue_t* kvkeybase_t::CreateValue()
 {
-	kvpairvalue_t* val = new kvpairvalue_t();
+	kvpairvalue_t* val = KV_NewPairValue(arena);
 
 	val->type = type;
 
-	values.append(val);
+	values.append(val, arena);
 
 	return val;
 }
@@ -330,13 +753,13 @@ kvkeybase_t* kvkeybase_t::CreateSectionValue()
 	if(type != KVPAIR_SECTION)
 		return NULL;
 
-	kvpairvalue_t* val = new kvpairvalue_t();
+	kvpairvalue_t* val = KV_NewPairValue(arena);
 
 	val->type = type;
 
-	values.append(val);
+	values.append(val, arena);
 
-	val->section = new kvkeybase_t();
+	val->section = NewKeyBase();
 	return val->section;
 }
 
@@ -354,7 +777,10 @@ void kvkeybase_t::CopyTo(kvkeybase_t* dest) const
 	CopyValuesTo(dest);
 
 	for(int i = 0; i < keys.numElem(); i++)
-		dest->AddKey(keys[i]->GetName(), keys[i]->Clone());
+	{
+		kvkeybase_t* newKey = dest->AddKeyBase(keys[i]->GetName(), NULL, keys[i]->type);
+		keys[i]->CopyTo(newKey);
+	}
 }
 
 void kvkeybase_t::CopyValuesTo(kvkeybase_t* dest) const
@@ -423,6 +849,9 @@ void kvkeybase_t::AddValue(const Vector4D& vecValue)
 
 void kvkeybase_t::AddValue(kvkeybase_t* keybase)
 {
+	if(!KV_CanAdoptKeyBase(this, keybase))
+		return;
+
 	int numVal = values.numElem();
 
 	kvpairvalue_t* val = CreateValue();
@@ -833,24 +1262,49 @@ kvkeybase_t& kvkeybase_t::AddKey(const char* name, kvkeybase_t* pair)
 
 //-------------------------------------------------------------------------------
 
+static bool KV_KeyMatches(const kvkeybase_t* key, const char* pszName, int hash, int nFlags)
+{
+	if(key->nameHash != hash)
+		return false;
+
+	if((nFlags & KV_FLAG_SECTION) && key->keys.numElem() == 0)
+		return false;
+
+	if((nFlags & KV_FLAG_NOVALUE) && key->values.numElem() > 0)
+		return false;
+
+	if((nFlags & KV_FLAG_ARRAY) && key->values.numElem() <= 1)
+		return false;
+
+	return !stricmp(key->name, pszName);
+}
+
 // searches for keybase
 kvkeybase_t* kvkeybase_t::FindKeyBase(const char* pszName, int nFlags) const
 {
-	int hash = StringToHash(pszName);
+	int hash = StringToHash(pszName, true);
 
-	for(int i = 0; i < keys.numElem(); i++)
+	kvkeyindex_t* index = KV_LoadKeyIndex(this);
+
+	if(!index && keys.numElem() >= KV_KEYINDEX_MIN_KEYS)
+		index = KV_BuildKeyIndex(this);
+
+	if(index)
 	{
-		if((nFlags & KV_FLAG_SECTION) && keys[i]->keys.numElem() == 0)
-			continue;
+		int* next = index->next();
 
-		if((nFlags & KV_FLAG_NOVALUE) && keys[i]->values.numElem() > 0)
-			continue;
+		for(int i = index->heads()[hash & (index->numBuckets-1)]; i != -1; i = next[i])
+		{
+			if(KV_KeyMatches(keys[i], pszName, hash, nFlags))
+				return keys[i];
+		}
 
-		if((nFlags & KV_FLAG_ARRAY) && keys[i]->values.numElem() <= 1)
-			continue;
+		return NULL;
+	}
 
-		//if(keys[i]->nameHash == hash)
-		if(!stricmp(keys[i]->name, pszName))
+	for(int i = 0; i < keys.numElem(); i++)
+	{
+		if(KV_KeyMatches(keys[i], pszName, hash, nFlags))
 			return keys[i];
 	}
 
@@ -860,11 +1314,11 @@ kvkeybase_t* kvkeybase_t::FindKeyBase(const char* pszName, int nFlags) const
 // adds new keybase
 kvkeybase_t* kvkeybase_t::AddKeyBase( const char* pszName, const char* pszValue, EKVPairType pairType)
 {
-	kvkeybase_t* pKeyBase = new kvkeybase_t;
+	kvkeybase_t* pKeyBase = NewKeyBase();
 	pKeyBase->SetName(pszName);
 	pKeyBase->type = pairType;
 
-	keys.append( pKeyBase );
+	KV_AppendKey(this, pKeyBase);
 
 	if(pszValue != NULL)
 	{
@@ -878,8 +1332,8 @@ kvkeybase_t* kvkeybase_t::AddKeyBase( const char* pszName, const char* pszValue,
 // adds existing keybase. You should set it's name manually. It should not be allocated by other keybase
 void kvkeybase_t::AddExistingKeyBase(kvkeybase_t* keyBase)
 {
-	if(keyBase != nullptr)
-		keys.append( keyBase );
+	if(keyBase != nullptr && KV_CanAdoptKeyBase(this, keyBase))
+		KV_AppendKey(this, keyBase);
 }
 
 // removes key base by name
@@ -892,8 +1346,9 @@ void kvkeybase_t::RemoveKeyBaseByName( const char* name, bool removeAll )
 		//if(keys[i]->nameHash == strHash)
 		if(!stricmp(keys[i]->name, name))
 		{
-			delete keys[i];
+			DeleteKeyBase(keys[i]);
 			keys.removeIndex(i);
+			KV_InvalidateKeyIndex(this);
 
 			if(removeAll)
 				i--;
@@ -909,8 +1364,9 @@ void kvkeybase_t::RemoveKeyBase(kvkeybase_t* base)
 	{
 		if(keys[i] == base)
 		{
-			delete keys[i];
+			DeleteKeyBase(keys[i]);
 			keys.removeIndex(i);
+			KV_InvalidateKeyIndex(this);
 			return;
 		}
 	}
@@ -1026,8 +1482,34 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 
 	kvkeybase_t* curpair = NULL;
 
+	// the last character is processed by the loop as it's EOF
+	const char* pEnd = pszBuffer + bufferSize;
+
 	do
 	{
+		// skip the characters which can't change the parser state
+		switch(quoteMode)
+		{
+			case QM_NONE:
+				pData = KV_SkipClass(pData, pEnd, KVCHAR_SKIP_V3, nLine);
+				break;
+			case QM_COMMENT_LINE:
+				pData = KV_ScanTo(pData, pEnd, KV_STRING_NEWLINE, KV_STRING_NEWLINE, KV_STRING_NEWLINE, nLine);
+				break;
+			case QM_COMMENT_RANGE:
+				pData = KV_ScanTo(pData, pEnd, KV_RANGECOMMENT_BEGIN_END, KV_RANGECOMMENT_BEGIN_END, KV_RANGECOMMENT_BEGIN_END, nLine);
+				break;
+			case QM_STRING:
+				pData = KV_ScanToClass(pData, pEnd, KVCHAR_STRING_END_V3);
+				break;
+			case QM_STRING_QUOTED:
+				pData = KV_ScanTo(pData, pEnd, KV_STRING_BEGIN_END, '\\', '\\', nLine);
+				break;
+			case QM_SECTION:
+				pData = KV_ScanTo(pData, pEnd, KV_SECTION_BEGIN, KV_SECTION_END, KV_SECTION_END, nLine);
+				break;
+		}
+
 		c = *pData;
 
 		pLast = pData;
@@ -1152,7 +1634,8 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 					if(nValCounter == 1)
 					{
 						// set key name
-						strncpy(key, pFirstLetter, min(KV_MAX_NAME_LENGTH, nLen));
+						nLen = min(KV_MAX_NAME_LENGTH, nLen);
+						strncpy(key, pFirstLetter, nLen);
 						key[nLen] = '\0';
 
 						if(c == KV_BREAK)
@@ -1191,7 +1674,7 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 						free(valueString);
 
 						curpair->SetName(key);
-						pParseTo->keys.addUnique(curpair);
+						KV_AppendUniqueKey(pKeyBase, curpair);
 					}
 				}
 
@@ -1281,7 +1764,7 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 
 				if(nValCounter == 0)
 				{
-					curpair = new kvkeybase_t();
+					curpair = pKeyBase->NewKeyBase();
 					curpair->line = nModeStartLine;
 					parserMode = PM_KEY;
 				}
@@ -1311,7 +1794,7 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 
 					if( valueArray )
 					{
-						kvkeybase_t* newsec = new kvkeybase_t();
+						kvkeybase_t* newsec = pKeyBase->NewKeyBase();
 						bool success = KV_ParseSectionV3(pFirstLetter, nLen, pszFileName, newsec, nModeStartLine-1) != NULL;
 
 						bool typeIsOk = ((curpair->values.numElem() == 0) || curpair->type == KVPAIR_SECTION);
@@ -1323,11 +1806,11 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 							curpair->AddValue(newsec);
 
 							curpair->SetName(key);
-							pParseTo->keys.addUnique(curpair);
+							KV_AppendUniqueKey(pKeyBase, curpair);
 						}
 						else
 						{
-							delete newsec;
+							kvkeybase_t::DeleteKeyBase(newsec);
 
 							if(!typeIsOk)
 							{
@@ -1344,7 +1827,7 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 						if(success)
 						{
 							curpair->SetName(key);
-							pParseTo->keys.addUnique(curpair);
+							KV_AppendUniqueKey(pKeyBase, curpair);
 
 							curpair = NULL; // i'ts finally done
 							*key = 0;
@@ -1366,6 +1849,10 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 	}
 	while(*pData++ && (pData - pszBuffer) <= bufferSize);
 
+	// incomplete key was never added
+	if(curpair && curpair->parent != pKeyBase)
+		kvkeybase_t::DeleteKeyBase(curpair);
+
 	// check for errors
 	bool isError = false;
 
@@ -1407,6 +1894,238 @@ kvkeybase_t* KV_ParseSectionV3( const char* pszBuffer, int bufferSize, const cha
 
 #define KV_IDENT_BINARY				MCHAR4('B','K','V','S')
 
+//-----------------------------------------------------------------------------------------------------
+// Binary cache of the text files
+// Stored in KV_CACHE_PATH and validated by size and CRC32 of the text source.
+// Can be disabled with -nokvcache command line argument
+//-----------------------------------------------------------------------------------------------------
+
+#define KV_IDENT_CACHE				MCHAR4('K','V','C','H')
+#define KV_CACHE_VERSION			2
+#define KV_CACHE_PATH				"cache/kv"
+
+struct kvcachehdr_s
+{
+	int		ident;			// it must be identified by KV_IDENT_CACHE
+	int		version;		// KV_CACHE_VERSION
+
+	int		sourceSize;		// text file size
+	uint32	sourceCRC;		// text file checksum
+
+	int		dataSize;		// binary keybase and key infos size
+	uint32	dataCRC;		// binary keybase and key infos checksum
+	int		treeSize;		// binary keybase size
+
+	int		nameLen;		// text file name length
+
+	// next after cache header:
+	// - text file name
+	// - binary keybase
+	// - key infos
+};
+
+// binary keybase doesn't store these, they follow it in the same order as keys are written
+struct kvcachekey_s
+{
+	int		line;
+	int		unicode;
+};
+
+static int s_kvCacheState = -1;		// -1 is not initialized yet, 0 - disabled, 1 - enabled, 2 - enabled and folder created
+
+static bool KV_IsBinaryCacheEnabled()
+{
+	if(s_kvCacheState == -1)
+		s_kvCacheState = (g_cmdLine->FindArgument("-nokvcache") == -1) ? 1 : 0;
+
+	return s_kvCacheState > 0;
+}
+
+static void KV_GetBinaryCacheFileName(const char* pszFileName, int nSearchFlags, EqString& cacheFileName, EqString& sourceName)
+{
+	sourceName = _Es(pszFileName).LowerCase();
+	sourceName.Path_FixSlashes();
+
+	uint32 nameCRC = CRC32_BlockChecksum(sourceName.ToCString(), sourceName.Length());
+	cacheFileName = varargs(KV_CACHE_PATH "/%08x_%x.kvc", nameCRC, nSearchFlags & 0xff);
+}
+
+// binary keybase stores value count and name length as ushort
+static bool KV_CanCacheKeyBase(kvkeybase_t* base)
+{
+	if(base->values.numElem() > USHRT_MAX || strlen(base->name) > USHRT_MAX)
+		return false;
+
+	for(int i = 0; i < base->values.numElem(); i++)
+	{
+		kvpairvalue_t* value = base->values[i];
+
+		if(value->type == KVPAIR_SECTION && !KV_CanCacheKeyBase(value->section))
+			return false;
+	}
+
+	for(int i = 0; i < base->keys.numElem(); i++)
+	{
+		if(!KV_CanCacheKeyBase(base->keys[i]))
+			return false;
+	}
+
+	return true;
+}
+
+// walks keybases in KV_WriteToStreamBinary order
+static void KV_WriteCacheKeyInfo(IVirtualStream* stream, kvkeybase_t* base)
+{
+	kvcachekey_s info;
+	info.line = base->line;
+	info.unicode = base->unicode;
+
+	stream->Write(&info, 1, sizeof(info));
+
+	for(int i = 0; i < base->values.numElem(); i++)
+	{
+		kvpairvalue_t* value = base->values[i];
+
+		if(value->type == KVPAIR_SECTION)
+			KV_WriteCacheKeyInfo(stream, value->section);
+	}
+
+	for(int i = 0; i < base->keys.numElem(); i++)
+		KV_WriteCacheKeyInfo(stream, base->keys[i]);
+}
+
+static bool KV_ReadCacheKeyInfo(kvcachekey_s*& info, kvcachekey_s* infoEnd, kvkeybase_t* base)
+{
+	if(info >= infoEnd)
+		return false;
+
+	base->line = info->line;
+	base->unicode = info->unicode != 0;
+	info++;
+
+	for(int i = 0; i < base->values.numElem(); i++)
+	{
+		kvpairvalue_t* value = base->values[i];
+
+		if(value->type == KVPAIR_SECTION && !KV_ReadCacheKeyInfo(info, infoEnd, value->section))
+			return false;
+	}
+
+	for(int i = 0; i < base->keys.numElem(); i++)
+	{
+		if(!KV_ReadCacheKeyInfo(info, infoEnd, base->keys[i]))
+			return false;
+	}
+
+	return true;
+}
+
+//
+// Reads the binary cache if it's still valid for text source
+//
+static kvkeybase_t* KV_ReadBinaryCache(const char* pszCacheFileName, const char* pszSourceName, int sourceSize, uint32 sourceCRC, kvkeybase_t* pParseTo)
+{
+	IFile* pFile = g_fileSystem->Open(pszCacheFileName, "rb", SP_MOD);
+
+	if(!pFile)
+		return NULL;
+
+	kvcachehdr_s hdr;
+	bool isValid = pFile->Read(&hdr, 1, sizeof(hdr)) == sizeof(hdr);
+
+	isValid = isValid && hdr.ident == KV_IDENT_CACHE && hdr.version == KV_CACHE_VERSION;
+	isValid = isValid && hdr.sourceSize == sourceSize && hdr.sourceCRC == sourceCRC;
+	isValid = isValid && hdr.nameLen == strlen(pszSourceName) && hdr.treeSize > 0 && hdr.treeSize <= hdr.dataSize;
+	isValid = isValid && (hdr.dataSize - hdr.treeSize) % sizeof(kvcachekey_s) == 0;
+	isValid = isValid && pFile->GetSize() == sizeof(hdr) + hdr.nameLen + hdr.dataSize;
+
+	char* pData = NULL;
+
+	if(isValid)
+	{
+		pData = (char*)PPAlloc(hdr.nameLen + hdr.dataSize);
+		isValid = pFile->Read(pData, 1, hdr.nameLen + hdr.dataSize) == hdr.nameLen + hdr.dataSize;
+
+		// file name hash collision or broken data
+		isValid = isValid && !strncmp(pData, pszSourceName, hdr.nameLen);
+		isValid = isValid && CRC32_BlockChecksum(pData + hdr.nameLen, hdr.dataSize) == hdr.dataCRC;
+	}
+
+	g_fileSystem->Close(pFile);
+
+	kvkeybase_t* pBase = NULL;
+
+	if(isValid)
+		pBase = KV_ParseBinary(pData + hdr.nameLen, hdr.treeSize, pParseTo);
+
+	if(pBase)
+	{
+		kvcachekey_s* info = (kvcachekey_s*)(pData + hdr.nameLen + hdr.treeSize);
+		kvcachekey_s* infoEnd = (kvcachekey_s*)(pData + hdr.nameLen + hdr.dataSize);
+
+		// every key must have it's info
+		if(!KV_ReadCacheKeyInfo(info, infoEnd, pBase) || info != infoEnd)
+		{
+			if(pBase == pParseTo)
+				pParseTo->Cleanup();
+			else
+				delete pBase;
+
+			pBase = NULL;
+		}
+	}
+
+	PPFree(pData);
+
+	return pBase;
+}
+
+//
+// Writes the binary cache of parsed text source
+//
+static void KV_WriteBinaryCache(const char* pszCacheFileName, const char* pszSourceName, int sourceSize, uint32 sourceCRC, kvkeybase_t* pBase)
+{
+	if(s_kvCacheState == 1)
+	{
+		g_fileSystem->MakeDir("cache", SP_MOD);
+		g_fileSystem->MakeDir(KV_CACHE_PATH, SP_MOD);
+		s_kvCacheState = 2;
+	}
+
+	// too big to be stored, text will be parsed each time
+	if(!KV_CanCacheKeyBase(pBase))
+		return;
+
+	CMemoryStream dataStream;
+	dataStream.Open(NULL, VS_OPEN_WRITE, 2048);
+
+	KV_WriteToStreamBinary(&dataStream, pBase);
+	int treeSize = dataStream.Tell();
+
+	KV_WriteCacheKeyInfo(&dataStream, pBase);
+
+	kvcachehdr_s hdr;
+	hdr.ident = KV_IDENT_CACHE;
+	hdr.version = KV_CACHE_VERSION;
+	hdr.sourceSize = sourceSize;
+	hdr.sourceCRC = sourceCRC;
+	hdr.dataSize = dataStream.Tell();
+	hdr.dataCRC = dataStream.GetCRC32();
+	hdr.treeSize = treeSize;
+	hdr.nameLen = strlen(pszSourceName);
+
+	IFile* pFile = g_fileSystem->Open(pszCacheFileName, "wb", SP_MOD);
+
+	if(!pFile)
+		return;
+
+	pFile->Write(&hdr, 1, sizeof(hdr));
+	pFile->Write(pszSourceName, 1, hdr.nameLen);
+	dataStream.WriteToFileStream(pFile);
+
+	g_fileSystem->Close(pFile);
+}
+
 //
 // Loads file and parses it as KeyValues into the 'pParseTo'
 //
@@ -1451,11 +2170,43 @@ kvkeybase_t* KV_LoadFromFile( const char* pszFileName, int nSearchFlags, kvkeyba
 		}
 	}
 
+	// new trees are allocated from the arena
+	kvkeybase_t* pNewRoot = NULL;
+
+	if(!pParseTo)
+	{
+		pNewRoot = new kvkeybase_t();
+		pNewRoot->InitArena();
+
+		pParseTo = pNewRoot;
+	}
+
 	// load as stream
 	kvkeybase_t* pBase = NULL;
 	
 	if(isBinary)
 		pBase = KV_ParseBinary(_buffer, lSize, pParseTo);
+	else if(KV_IsBinaryCacheEnabled())
+	{
+		EqString cacheFileName, sourceName;
+		KV_GetBinaryCacheFileName(pszFileName, nSearchFlags, cacheFileName, sourceName);
+
+		uint32 sourceCRC = CRC32_BlockChecksum(pBuffer, lSize);
+
+		// can't cache when merging into the existing keybase
+		bool canCache = pParseTo->keys.numElem() == 0 && pParseTo->values.numElem() == 0;
+
+		if(canCache)
+			pBase = KV_ReadBinaryCache(cacheFileName.ToCString(), sourceName.ToCString(), lSize, sourceCRC, pParseTo);
+
+		if(!pBase)
+		{
+			pBase = KV_ParseSection(_buffer, pszFileName, pParseTo, 0);
+
+			if(pBase && canCache)
+				KV_WriteBinaryCache(cacheFileName.ToCString(), sourceName.ToCString(), lSize, sourceCRC, pBase);
+		}
+	}
 	else
 		pBase = KV_ParseSection(_buffer, pszFileName, pParseTo, 0);
 
@@ -1464,6 +2215,8 @@ kvkeybase_t* KV_LoadFromFile( const char* pszFileName, int nSearchFlags, kvkeyba
 		pBase->SetName(_Es(pszFileName).Path_Strip_Path().ToCString());
         pBase->unicode = isUTF8;
 	}
+	else
+		delete pNewRoot;
 
 	// required to clean memory after reading
 	PPFree( pBuffer );
@@ -1529,6 +2282,8 @@ void KV_ReadBinaryValue(IVirtualStream* stream, kvkeybase_t* addTo)
 		strVal[binValue.nValue] = '\0';
 
 		addTo->AddValue(strVal);
+
+		free(strVal);
 	}
 	else if(binValue.type == KVPAIR_INT)
 	{
@@ -1544,10 +2299,12 @@ void KV_ReadBinaryValue(IVirtualStream* stream, kvkeybase_t* addTo)
 	}
 	else if(binValue.type == KVPAIR_SECTION)
 	{
-		kvkeybase_t* parsed = KV_ReadBinaryBase(stream, NULL);
+		kvkeybase_t* parsed = addTo->NewKeyBase();
 
-		if(parsed)
+		if(KV_ReadBinaryBase(stream, parsed))
 			addTo->AddValue(parsed);
+		else
+			kvkeybase_t::DeleteKeyBase(parsed);
 	}
 }
 
@@ -1585,8 +2342,12 @@ kvkeybase_t* KV_ReadBinaryBase(IVirtualStream* stream, kvkeybase_t* pParseTo)
 	// read nested keybases as well
 	for(int i = 0; i < binBase.keyCount; i++)
 	{
-		kvkeybase_t* parsed = KV_ReadBinaryBase(stream, NULL);
-		pParseTo->AddExistingKeyBase(parsed);
+		kvkeybase_t* parsed = pParseTo->NewKeyBase();
+
+		if(KV_ReadBinaryBase(stream, parsed))
+			pParseTo->AddExistingKeyBase(parsed);
+		else
+			kvkeybase_t::DeleteKeyBase(parsed);
 	}
 
 	return pParseTo;
@@ -1706,10 +2467,24 @@ kvkeybase_t* KV_ParseSection( const char* pszBuffer, const char* pszFileName, kv
 
 	int nLine = nStartLine;
 
-	EqString tempName;
+	const char* pEnd = pszBuffer + strlen(pszBuffer);
 
 	for ( ; ; ++pData )
 	{
+		// skip the characters which can't change the parser state
+		if(bCommentaryMode == LINECOMMENT)
+			pData = KV_ScanTo(pData, pEnd, KV_STRING_NEWLINE, KV_STRING_NEWLINE, KV_STRING_NEWLINE, nLine);
+		else if(bCommentaryMode == RANGECOMMENT)
+			pData = KV_ScanTo(pData, pEnd, KV_RANGECOMMENT_BEGIN_END, KV_RANGECOMMENT_BEGIN_END, KV_RANGECOMMENT_BEGIN_END, nLine);
+		else if(pFirstLetter && bInSection)
+			pData = KV_ScanTo(pData, pEnd, KV_SECTION_BEGIN, KV_SECTION_END, KV_COMMENT_SYMBOL, nLine);
+		else if(bInQuotes)
+			pData = KV_ScanTo(pData, pEnd, KV_STRING_BEGIN_END, KV_STRING_BEGIN_END, KV_STRING_BEGIN_END, nLine);
+		else if(pFirstLetter)
+			pData = KV_ScanToClass(pData, pEnd, KVCHAR_STRING_END);
+		else
+			pData = KV_SkipClass(pData, pEnd, KVCHAR_SPACE, nLine);
+
 		c = *pData;
 
 		if(c == '\0')
@@ -1845,29 +2620,27 @@ kvkeybase_t* KV_ParseSection( const char* pszBuffer, const char* pszFileName, kv
 
 			int nLen = (int)(pLast - pFirstLetter);
 
+			char* endChar = (char*)pFirstLetter+nLen;
+
+			char oldChr = *endChar;
+			*endChar = '\0';
+
 			// close token
 			if(nValueCounter <= 0)
 			{
-				tempName.Assign( pFirstLetter, nLen );
-
-				pCurrentKeyBase->SetName(tempName.ToCString());
+				pCurrentKeyBase->SetName(pFirstLetter);
 			}
 			else
 			{
-				char* endChar = (char*)pFirstLetter+nLen;
-
-				char oldChr = *endChar;
-				*endChar = '\0';
-
 				char* processedValue = KV_ReadProcessString(pFirstLetter);
 
 				pCurrentKeyBase->AddValue(processedValue);
 
 				free(processedValue);
-
-				*endChar = oldChr;
 			}
 
+			*endChar = oldChr;
+
 			pFirstLetter = NULL;
 			bInQuotes = false;
 
@@ -1905,9 +2678,9 @@ kvkeybase_t* KV_ParseSection( const char* pszBuffer, const char* pszFileName, kv
 				}
 				else
 				{
-					pCurrentKeyBase = new kvkeybase_t;
+					pCurrentKeyBase = pKeyBase->NewKeyBase();
 					pCurrentKeyBase->line = nLine;
-					pKeyBase->keys.append( pCurrentKeyBase );
+					KV_AppendKey(pKeyBase, pCurrentKeyBase);
 				}
 
 				if( c == KV_STRING_BEGIN_END )
@@ -1922,19 +2695,19 @@ kvkeybase_t* KV_ParseSection( const char* pszBuffer, const char* pszFileName, kv
 		}
 	}
 
-	if( bInQuotes )
+	if( pCurrentKeyBase )
 	{
-		MsgError("'%s' (%d): unexcepted end of file, you forgot to close quotes\n", pszFileName ? pszFileName : "buffer", nQuoteLetterLine+1);
-
-
+		MsgError("'%s' (%d): EOF passed, excepted ';'\n", pszFileName ? pszFileName : "buffer", pCurrentKeyBase->line+1);
 		if(pParseTo != pKeyBase)
 			delete pKeyBase;
 		pKeyBase = NULL;
 	}
 
-	if( pCurrentKeyBase )
+	if( bInQuotes )
 	{
-		MsgError("'%s' (%d): EOF passed, excepted ';'\n", pszFileName ? pszFileName : "buffer", pCurrentKeyBase->line+1);
+		MsgError("'%s' (%d): unexcepted end of file, you forgot to close quotes\n", pszFileName ? pszFileName : "buffer", nQuoteLetterLine+1);
+
+
 		if(pParseTo != pKeyBase)
 			delete pKeyBase;
 		pKeyBase = NULL;
@@ -30,11 +30,13 @@ key_section
 #define KEYVALUES_H
 
 class IVirtualStream;
+struct kvkeyindex_t;
 
 #include "core/platform/Platform.h"
 #include "core/ppmem.h"
 
 #include "utils/DkList.h"
+#include "utils/MemoryArena.h"
 #include "math/DkMath.h"
 
 //
@@ -60,6 +62,113 @@ enum KVSearchFlags_e
 	KV_FLAG_ARRAY	= (1 << 2)
 };
 
+//
+// KeyValues array of children
+// The memory is taken either from heap or from the arena of root keybase
+//
+template< class T >
+class kvarray_t
+{
+public:
+	kvarray_t() : m_pListPtr(NULL), m_nNumElem(0), m_nSize(0) {}
+
+	int				numElem() const					{ return m_nNumElem; }
+	bool			inRange( int index ) const		{ return index >= 0 && index < m_nNumElem; }
+
+	const T&		operator[]( int index ) const	{ ASSERT(inRange(index)); return m_pListPtr[index]; }
+	T&				operator[]( int index )			{ ASSERT(inRange(index)); return m_pListPtr[index]; }
+
+	int				append( const T& obj, CMemoryArena* arena );
+	int				addUnique( const T& obj, CMemoryArena* arena );
+	int				findIndex( const T& obj ) const;
+	bool			removeIndex( int index );
+
+	// must be called by owner, there is no destructor
+	void			clear( CMemoryArena* arena );
+
+protected:
+	void			resize( int newSize, CMemoryArena* arena );
+
+	T*				m_pListPtr;
+	int				m_nNumElem;
+	int				m_nSize;
+};
+
+template< class T >
+inline int kvarray_t<T>::append( const T& obj, CMemoryArena* arena )
+{
+	if( m_nNumElem == m_nSize )
+		resize( m_nSize ? m_nSize*2 : 4, arena );
+
+	m_pListPtr[m_nNumElem] = obj;
+	return m_nNumElem++;
+}
+
+template< class T >
+inline int kvarray_t<T>::addUnique( const T& obj, CMemoryArena* arena )
+{
+	int index = findIndex( obj );
+
+	if( index == -1 )
+		index = append( obj, arena );
+
+	return index;
+}
+
+template< class T >
+inline int kvarray_t<T>::findIndex( const T& obj ) const
+{
+	for( int i = 0; i < m_nNumElem; i++ )
+	{
+		if( m_pListPtr[i] == obj )
+			return i;
+	}
+
+	return -1;
+}
+
+template< class T >
+inline bool kvarray_t<T>::removeIndex( int index )
+{
+	if( !inRange(index) )
+		return false;
+
+	m_nNumElem--;
+
+	for( int i = index; i < m_nNumElem; i++ )
+		m_pListPtr[i] = m_pListPtr[i+1];
+
+	return true;
+}
+
+template< class T >
+inline void kvarray_t<T>::clear( CMemoryArena* arena )
+{
+	// arena memory is released by root
+	if( !arena )
+		PPFree( m_pListPtr );
+
+	m_pListPtr = NULL;
+	m_nNumElem = 0;
+	m_nSize = 0;
+}
+
+template< class T >
+inline void kvarray_t<T>::resize( int newSize, CMemoryArena* arena )
+{
+	T* newList = (T*)(arena ? arena->Alloc(newSize*sizeof(T)) : PPAllocTAG(newSize*sizeof(T), "KeyValues"));
+
+	if( m_pListPtr )
+		memcpy( newList, m_pListPtr, m_nNumElem*sizeof(T) );
+
+	// old arena memory is just abandoned
+	if( !arena )
+		PPFree( m_pListPtr );
+
+	m_pListPtr = newList;
+	m_nSize = newSize;
+}
+
 //
 // KeyValues typed value holder
 //
@@ -67,10 +176,15 @@ struct kvpairvalue_t
 {
 	PPMEM_MANAGED_OBJECT()
 
+	// construction in the arena memory
+	static void* operator new (size_t size, void* where) { return where; }
+	static void operator delete (void* p, void* where) {}
+
 	kvpairvalue_t()
 	{
 		value = NULL;
 		section = NULL;
+		arena = NULL;
 		type = KVPAIR_STRING;
 	}
 
@@ -88,6 +202,7 @@ struct kvpairvalue_t
 	struct kvkeybase_t*	section;
 
 	char*				value;
+	CMemoryArena*		arena;		// if not NULL, value string is allocated there
 
 	void				SetValueFrom(kvpairvalue_t* from);
 
@@ -103,9 +218,24 @@ struct kvkeybase_t
 {
 	PPMEM_MANAGED_OBJECT()
 
+	// construction in the arena memory
+	static void* operator new (size_t size, void* where) { return where; }
+	static void operator delete (void* p, void* where) {}
+
 	kvkeybase_t();
 	~kvkeybase_t();
 
+	// makes this keybase own the memory arena, all nested keys, values and strings
+	// will be allocated there and released all at once by Cleanup or destructor.
+	// Must be called while keybase is empty.
+	void					InitArena(int pageSize = MEMORY_ARENA_PAGE_SIZE);
+
+	// allocates new keybase from the same memory as this keybase (heap or arena)
+	kvkeybase_t*			NewKeyBase() const;
+
+	// frees keybase allocated by NewKeyBase
+	static void				DeleteKeyBase(kvkeybase_t* base);
+
 	void					Cleanup();
 	void					ClearValues();
 
@@ -123,7 +253,8 @@ struct kvkeybase_t
 	// adds new keybase
 	kvkeybase_t*			AddKeyBase(const char* pszName, const char* pszValue = NULL, EKVPairType pairType = KVPAIR_STRING);
 
-	// adds existing keybase. You should set it's name manually. It should not be allocated by other keybase
+	// adds existing keybase. You should set it's name manually. It should not be allocated by other keybase.
+	// It must be created by NewKeyBase() of this tree (or with new if this tree has no arena), else it's not added
 	void					AddExistingKeyBase(kvkeybase_t* keyBase);
 
 	// removes key base by name
@@ -174,7 +305,7 @@ struct kvkeybase_t
 	void					AddValue(const Vector2D& vecValue);
 	void					AddValue(const Vector3D& vecValue);
 	void					AddValue(const Vector4D& vecValue);
-	void					AddValue(kvkeybase_t* keybase);
+	void					AddValue(kvkeybase_t* keybase);	// same storage rules as AddExistingKeyBase
 	void					AddValue(kvpairvalue_t* value);
 
 	// adds unique value to key
@@ -215,15 +346,21 @@ struct kvkeybase_t
 	// the line that the key is on
 	int						line;
 
-	char					name[KV_MAX_NAME_LENGTH];
+	char*					name;
 	int						nameHash;
 
-	DkList<kvpairvalue_t*>	values;
+	kvarray_t<kvpairvalue_t*>	values;
 	EKVPairType				type;		// default type of values
 
 	// the nested keys
-	DkList<kvkeybase_t*>	keys;
+	kvarray_t<kvkeybase_t*>	keys;
 	bool					unicode;
+
+	bool					ownsArena;
+	CMemoryArena*			arena;		// if not NULL, everything nested is allocated there
+
+	kvkeybase_t*			parent;		// section which has this key in 'keys'
+	mutable kvkeyindex_t*	keyIndex;	// hash index of the key names, built by FindKeyBase on big sections
 };
 
 // special wrapper class
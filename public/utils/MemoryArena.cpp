@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Linear memory arena
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "MemoryArena.h"
+#include "core/ppmem.h"
+
+#include <string.h>
+
+CMemoryArena::CMemoryArena( int pageSize ) : m_page(NULL), m_pageSize(pageSize)
+{
+}
+
+CMemoryArena::~CMemoryArena()
+{
+	Free();
+}
+
+void* CMemoryArena::Alloc( size_t size )
+{
+	size = (size + MEMORY_ARENA_ALIGNMENT-1) & ~(size_t)(MEMORY_ARENA_ALIGNMENT-1);
+
+	if( !m_page || m_page->used + size > m_page->size )
+	{
+		// big allocations are getting their own page
+		size_t pageSize = size > (size_t)m_pageSize ? size : (size_t)m_pageSize;
+
+		page_t* newPage = (page_t*)PPAllocTAG(sizeof(page_t) + pageSize, "MemoryArena");
+		newPage->prev = m_page;
+		newPage->size = pageSize;
+		newPage->used = 0;
+
+		m_page = newPage;
+	}
+
+	void* mem = m_page->data() + m_page->used;
+	m_page->used += size;
+
+	return mem;
+}
+
+char* CMemoryArena::AllocString( const char* str, int len )
+{
+	if(len < 0)
+		len = strlen(str);
+
+	char* newStr = (char*)Alloc(len + 1);
+	memcpy(newStr, str, len);
+	newStr[len] = 0;
+
+	return newStr;
+}
+
+void CMemoryArena::Clear()
+{
+	if(!m_page)
+		return;
+
+	page_t* page = m_page->prev;
+
+	while(page)
+	{
+		page_t* prev = page->prev;
+		PPFree(page);
+		page = prev;
+	}
+
+	m_page->prev = NULL;
+	m_page->used = 0;
+}
+
+void CMemoryArena::Free()
+{
+	Clear();
+
+	PPFree(m_page);
+	m_page = NULL;
+}
+
+size_t CMemoryArena::GetUsedSize() const
+{
+	size_t usedSize = 0;
+
+	for(page_t* page = m_page; page; page = page->prev)
+		usedSize += page->used;
+
+	return usedSize;
+}
+
+size_t CMemoryArena::GetAllocatedSize() const
+{
+	size_t allocSize = 0;
+
+	for(page_t* page = m_page; page; page = page->prev)
+		allocSize += page->size;
+
+	return allocSize;
+}
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Linear memory arena
+//				Allocations are only bumping the pointer in the current page,
+//				all the memory is released at once.
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MEMORYARENA_H
+#define MEMORYARENA_H
+
+#include "core/dktypes.h"
+#include <stddef.h>
+
+#define MEMORY_ARENA_PAGE_SIZE		(16*1024)
+#define MEMORY_ARENA_ALIGNMENT		8
+
+class CMemoryArena
+{
+public:
+					CMemoryArena( int pageSize = MEMORY_ARENA_PAGE_SIZE );
+					~CMemoryArena();
+
+	// allocates aligned memory block. It's never freed separately
+	void*			Alloc( size_t size );
+
+	// copies string into the arena. If len is -1, strlen is used
+	char*			AllocString( const char* str, int len = -1 );
+
+	// releases all allocations. The last page is kept for reuse
+	void			Clear();
+
+	// releases all pages
+	void			Free();
+
+	size_t			GetUsedSize() const;
+	size_t			GetAllocatedSize() const;
+
+private:
+	struct page_t
+	{
+		page_t*		prev;
+		size_t		size;
+		size_t		used;
+
+		ubyte*		data() { return (ubyte*)(this + 1); }
+	};
+
+	page_t*			m_page;		// current page
+	int				m_pageSize;
+
+					CMemoryArena( const CMemoryArena& s ) {}
+	void			operator=( const CMemoryArena& s ) {}
+};
+
+#endif // MEMORYARENA_H
@@ -189,6 +189,52 @@ void MutexUnlock( MutexHandle_t& handle )
 	LeaveCriticalSection( &handle );
 }
 
+void RWLockCreate( RWLockHandle_t& handle )
+{
+	InitializeSRWLock( &handle );
+}
+
+void RWLockDestroy( RWLockHandle_t& handle )
+{
+	// SRW locks does not need to be destroyed
+}
+
+bool RWLockLockRead( RWLockHandle_t& handle, bool bBlocking )
+{
+	if ( TryAcquireSRWLockShared( &handle ) == 0 )
+	{
+		if ( !bBlocking )
+			return false;
+
+		AcquireSRWLockShared( &handle );
+	}
+
+	return true;
+}
+
+void RWLockUnlockRead( RWLockHandle_t& handle )
+{
+	ReleaseSRWLockShared( &handle );
+}
+
+bool RWLockLockWrite( RWLockHandle_t& handle, bool bBlocking )
+{
+	if ( TryAcquireSRWLockExclusive( &handle ) == 0 )
+	{
+		if ( !bBlocking )
+			return false;
+
+		AcquireSRWLockExclusive( &handle );
+	}
+
+	return true;
+}
+
+void RWLockUnlockWrite( RWLockHandle_t& handle )
+{
+	ReleaseSRWLockExclusive( &handle );
+}
+
 InterlockedInt_t IncrementInterlocked( InterlockedInt_t& value )
 {
 	return InterlockedIncrementAcquire( &value );
@@ -223,6 +269,13 @@ InterlockedInt_t CompareExchangeInterlocked( InterlockedInt_t& value, Interlocke
 
 #ifdef PLAT_POSIX
 
+#ifdef __linux__
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif // __linux__
+
 #else // APPLE / BSD / DROID?
 // TODO:
 #endif
@@ -306,6 +359,117 @@ void Yield()
 #endif
 }
 
+#ifdef __linux__
+
+static int FutexWait( volatile int* addr, int expected, const timespec* timeout )
+{
+	return syscall( SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0 );
+}
+
+static int FutexWake( volatile int* addr, int count )
+{
+	return syscall( SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0 );
+}
+
+void SignalCreate( SignalHandle_t& handle, bool bManualReset )
+{
+	// if this is true, the signal is only set to nonsignaled when Clear() is called,
+	// else it's "auto-reset" and the state is set to !signaled after a single waiting
+	// thread has been released
+	handle.manualReset = bManualReset;
+
+	// the inital state is always "not signaled"
+	handle.signaled = 0;
+	handle.waiting = 0;
+}
+
+void SignalDestroy( SignalHandle_t& handle )
+{
+	handle.signaled = 0;
+	handle.waiting = 0;
+}
+
+void SignalRaise( SignalHandle_t& handle )
+{
+	// already signaled, nothing to wake.
+	// Full barrier: the store must be visible before reading waiting, else a waiter which
+	// has just incremented it could sleep on the old value and never be woken
+	if( __atomic_exchange_n( &handle.signaled, 1, __ATOMIC_SEQ_CST ) == 1 )
+		return;
+
+	// manual reset wakes *all* threads, automode releases only one
+	if( __atomic_load_n( &handle.waiting, __ATOMIC_SEQ_CST ) > 0 )
+		FutexWake( &handle.signaled, handle.manualReset ? INT_MAX : 1 );
+}
+
+void SignalClear( SignalHandle_t& handle )
+{
+	__sync_lock_release( &handle.signaled );
+}
+
+bool SignalWait( SignalHandle_t& handle, int nTimeout )
+{
+	timespec deadline;
+
+	if( nTimeout != WAIT_INFINITE )
+	{
+		clock_gettime( CLOCK_MONOTONIC, &deadline );
+
+		deadline.tv_nsec += ( nTimeout % 1000 ) * 1000000; // millisec to nanosec
+		deadline.tv_sec  += nTimeout / 1000;
+		if( deadline.tv_nsec >= 1000000000 )
+		{
+			deadline.tv_nsec -= 1000000000;
+			deadline.tv_sec += 1;
+		}
+	}
+
+	for( ; ; )
+	{
+		// for auto-mode only one thread may be released - the one who took the signal
+		if( handle.manualReset )
+		{
+			if( handle.signaled )
+				return true;
+		}
+		else if( __sync_bool_compare_and_swap( &handle.signaled, 1, 0 ) )
+			return true;
+
+		timespec remaining;
+		timespec* timeout = NULL;
+
+		if( nTimeout != WAIT_INFINITE )
+		{
+			timespec now;
+			clock_gettime( CLOCK_MONOTONIC, &now );
+
+			remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+			remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+			if( remaining.tv_nsec < 0 )
+			{
+				remaining.tv_nsec += 1000000000;
+				remaining.tv_sec -= 1;
+			}
+
+			if( remaining.tv_sec < 0 )
+				return false;
+
+			timeout = &remaining;
+		}
+
+		__sync_add_and_fetch( &handle.waiting, 1 );
+
+		// returns immediately if signal was raised since the check above
+		int status = FutexWait( &handle.signaled, 0, timeout );
+
+		__sync_sub_and_fetch( &handle.waiting, 1 );
+
+		ASSERT( status == 0 || errno == EAGAIN || errno == EINTR || ( timeout && errno == ETIMEDOUT ) );
+	}
+}
+
+#else
+
 void SignalCreate( SignalHandle_t& handle, bool bManualReset )
 {
 	handle.manualReset = bManualReset;
@@ -422,6 +586,8 @@ bool SignalWait( SignalHandle_t& handle, int nTimeout )
 	return ( status == 0 );
 }
 
+#endif // __linux__
+
 void MutexCreate( MutexHandle_t& handle )
 {
 	pthread_mutexattr_t attr;
@@ -457,6 +623,61 @@ void MutexUnlock( MutexHandle_t& handle )
 	pthread_mutex_unlock( & handle );
 }
 
+void RWLockCreate( RWLockHandle_t& handle )
+{
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init( &attr );
+
+#ifdef __GLIBC__
+	// don't let the constant stream of readers starve the writer
+	pthread_rwlockattr_setkind_np( &attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP );
+#endif // __GLIBC__
+
+	pthread_rwlock_init( &handle, &attr );
+	pthread_rwlockattr_destroy( &attr );
+}
+
+void RWLockDestroy( RWLockHandle_t& handle )
+{
+	pthread_rwlock_destroy( &handle );
+}
+
+bool RWLockLockRead( RWLockHandle_t& handle, bool bBlocking )
+{
+	if( pthread_rwlock_tryrdlock( &handle ) != 0 )
+	{
+		if( !bBlocking )
+			return false;
+
+		pthread_rwlock_rdlock( &handle );
+	}
+
+	return true;
+}
+
+void RWLockUnlockRead( RWLockHandle_t& handle )
+{
+	pthread_rwlock_unlock( &handle );
+}
+
+bool RWLockLockWrite( RWLockHandle_t& handle, bool bBlocking )
+{
+	if( pthread_rwlock_trywrlock( &handle ) != 0 )
+	{
+		if( !bBlocking )
+			return false;
+
+		pthread_rwlock_wrlock( &handle );
+	}
+
+	return true;
+}
+
+void RWLockUnlockWrite( RWLockHandle_t& handle )
+{
+	pthread_rwlock_unlock( &handle );
+}
+
 InterlockedInt_t IncrementInterlocked( InterlockedInt_t& value )
 {
 	return __sync_add_and_fetch( &value, 1 );
@@ -474,12 +695,12 @@ InterlockedInt_t AddInterlocked( InterlockedInt_t& value, InterlockedInt_t i )
 
 InterlockedInt_t SubtractInterlocked( InterlockedInt_t& value, InterlockedInt_t i )
 {
-	return __sync_sub_and_fetch( &value, - i );
+	return __sync_sub_and_fetch( &value, i );
 }
 
 InterlockedInt_t ExchangeInterlocked( InterlockedInt_t& value, InterlockedInt_t exchange )
 {
-	return __sync_val_compare_and_swap( &value, value, exchange );
+	return __atomic_exchange_n( &value, exchange, __ATOMIC_ACQ_REL );
 }
 
 InterlockedInt_t CompareExchangeInterlocked( InterlockedInt_t& value, InterlockedInt_t comparand, InterlockedInt_t exchange )
@@ -491,6 +712,84 @@ InterlockedInt_t CompareExchangeInterlocked( InterlockedInt_t& value, Interlocke
 
 //-------------------------------------------------------------------------------------------------------------------------
 
+static inline void CPUPause()
+{
+#if defined(_MSC_VER)
+	YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+	__asm__ __volatile__( "yield" );
+#endif
+}
+
+CEqFastMutex::CEqFastMutex( int spinCount ) : m_state(0), m_spinCount(spinCount), m_lockCount(0)
+{
+#ifndef __linux__
+	SignalCreate( m_wakeSignal, false );
+#endif // __linux__
+}
+
+CEqFastMutex::~CEqFastMutex()
+{
+#ifndef __linux__
+	SignalDestroy( m_wakeSignal );
+#endif // __linux__
+}
+
+void CEqFastMutex::ResetStats()
+{
+	m_lockCount = 0;
+	m_contendedCount.SetValue(0);
+	m_sleepCount.SetValue(0);
+}
+
+bool CEqFastMutex::LockContended( bool blocking )
+{
+	if( !blocking )
+		return false;
+
+	m_contendedCount.Increment();
+
+	// owner usually holds it for a short time, so spin before going to sleep
+	for( int i = 0; i < m_spinCount; i++ )
+	{
+		CPUPause();
+
+		if( m_state == 0 && CompareExchangeInterlocked( m_state, 0, 1 ) == 0 )
+		{
+			m_lockCount++;
+			return true;
+		}
+	}
+
+	// mark as having waiters, so the owner will wake us up on unlock
+	while( ExchangeInterlocked( m_state, 2 ) != 0 )
+	{
+		m_sleepCount.Increment();
+
+#ifdef __linux__
+		FutexWait( &m_state, 2, NULL );
+#else
+		SignalWait( m_wakeSignal, WAIT_INFINITE );
+#endif // __linux__
+	}
+
+	m_lockCount++;
+	return true;
+}
+
+void CEqFastMutex::WakeWaiter()
+{
+#ifdef __linux__
+	FutexWake( &m_state, 1 );
+#else
+	SignalRaise( m_wakeSignal );
+#endif // __linux__
+}
+
+//-------------------------------------------------------------------------------------------------------------------------
+
 CEqThread::CEqThread() : m_SignalWorkerDone(true)
 {
 	m_nThreadHandle = 0;
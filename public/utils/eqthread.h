@@ -43,8 +43,19 @@ typedef unsigned int (*threadfunc_t)(void *);
 #ifdef _WIN32
 typedef HANDLE				SignalHandle_t;
 typedef CRITICAL_SECTION	MutexHandle_t;
+typedef SRWLOCK				RWLockHandle_t;
 typedef LONG				InterlockedInt_t;
 #else
+
+#ifdef __linux__
+// futex-based signal, no kernel calls are made while nobody waits
+struct SignalHandle_t
+{
+	volatile int	signaled;	// futex word
+	volatile int	waiting;	// number of threads waiting for a signal
+	bool			manualReset;
+};
+#else
 struct SignalHandle_t
 {
 	// DG: all this stuff is needed to emulate Window's Event API
@@ -55,7 +66,10 @@ struct SignalHandle_t
 	bool 	manualReset;
 	bool 	signaled; // is it signaled right now?
 };
+#endif // __linux__
+
 typedef pthread_mutex_t		MutexHandle_t;
+typedef pthread_rwlock_t	RWLockHandle_t;
 typedef int					InterlockedInt_t;
 const int WAIT_INFINITE 	= -1;
 #endif // _WIN32
@@ -100,6 +114,17 @@ void				MutexDestroy( MutexHandle_t& handle );
 bool				MutexLock( MutexHandle_t& handle, bool bBlocking );
 void				MutexUnlock( MutexHandle_t& handle );
 
+//
+// Shared/exclusive lock creation/destroying and locking/unlocking
+//
+
+void				RWLockCreate( RWLockHandle_t& handle );
+void				RWLockDestroy( RWLockHandle_t& handle );
+bool				RWLockLockRead( RWLockHandle_t& handle, bool bBlocking );
+void				RWLockUnlockRead( RWLockHandle_t& handle );
+bool				RWLockLockWrite( RWLockHandle_t& handle, bool bBlocking );
+void				RWLockUnlockWrite( RWLockHandle_t& handle );
+
 //
 // Atomic pointers and integers
 //
@@ -217,6 +242,161 @@ private:
 	InterlockedInt_t	m_nValue;
 };
 
+//----------------------------------------------------------------------------------------
+//	CEqFastMutex is an adaptive mutex. Uncontended lock and unlock are a single atomic
+//	operation, contended lock spins for a while and then sleeps (on futex on Linux).
+//	It is not recursive. Also it counts the contention which can be shown in reports.
+//----------------------------------------------------------------------------------------
+class CEqFastMutex
+{
+public:
+	static const int	DEFAULT_SPIN_COUNT = 256;
+
+					CEqFastMutex( int spinCount = DEFAULT_SPIN_COUNT );
+					~CEqFastMutex();
+
+	bool			Lock( bool blocking = true )
+	{
+		if( CompareExchangeInterlocked( m_state, 0, 1 ) == 0 )
+		{
+			m_lockCount++;
+			return true;
+		}
+
+		return LockContended( blocking );
+	}
+
+	void			Unlock()
+	{
+		if( ExchangeInterlocked( m_state, 0 ) == 2 )
+			WakeWaiter();
+	}
+
+	// contention statistics
+	int				GetLockCount() const		{ return m_lockCount; }
+	int				GetContendedCount() const	{ return m_contendedCount.GetValue(); }
+	int				GetSleepCount() const		{ return m_sleepCount.GetValue(); }
+	void			ResetStats();
+
+private:
+	bool			LockContended( bool blocking );
+	void			WakeWaiter();
+
+	InterlockedInt_t		m_state;		// 0 - unlocked, 1 - locked, 2 - locked and has waiters
+	int						m_spinCount;
+	int						m_lockCount;	// modified only by owner
+
+	CEqInterlockedInteger	m_contendedCount;
+	CEqInterlockedInteger	m_sleepCount;
+
+#ifndef __linux__
+	SignalHandle_t			m_wakeSignal;
+#endif // __linux__
+
+					CEqFastMutex( const CEqFastMutex& s ) {}
+	void			operator=( const CEqFastMutex& s ) {}
+};
+
+//----------------------------------------------------------------------------------------
+//	CScopedFastMutex - same as CScopedMutex for CEqFastMutex
+//----------------------------------------------------------------------------------------
+class CScopedFastMutex
+{
+public:
+	CScopedFastMutex( CEqFastMutex &m ) : m_pMutex(&m) 
+	{ m_pMutex->Lock(); }
+
+	~CScopedFastMutex()								
+	{ m_pMutex->Unlock(); }
+
+private:
+	CEqFastMutex*	m_pMutex;
+};
+
+//----------------------------------------------------------------------------------------
+//	CEqReadWriteLock is a shared/exclusive lock. Any number of threads can hold it
+//	for reading at the same time, writer gets exclusive access.
+//	Use it for the read-mostly data like registries and caches.
+//----------------------------------------------------------------------------------------
+class CEqReadWriteLock
+{
+public:
+					CEqReadWriteLock() : m_writeCount(0)	{ RWLockCreate( m_nHandle ); }
+					~CEqReadWriteLock()				{ RWLockDestroy( m_nHandle ); }
+
+	bool			LockRead( bool blocking = true )
+	{
+		if( RWLockLockRead( m_nHandle, false ) )
+			return true;
+
+		m_contendedReads.Increment();
+		return blocking ? RWLockLockRead( m_nHandle, true ) : false;
+	}
+
+	void			UnlockRead()					{ RWLockUnlockRead( m_nHandle ); }
+
+	bool			LockWrite( bool blocking = true )
+	{
+		if( !RWLockLockWrite( m_nHandle, false ) )
+		{
+			m_contendedWrites.Increment();
+
+			if( !blocking || !RWLockLockWrite( m_nHandle, true ) )
+				return false;
+		}
+
+		m_writeCount++;
+		return true;
+	}
+
+	void			UnlockWrite()					{ RWLockUnlockWrite( m_nHandle ); }
+
+	// contention statistics
+	int				GetWriteCount() const			{ return m_writeCount; }
+	int				GetContendedReads() const		{ return m_contendedReads.GetValue(); }
+	int				GetContendedWrites() const		{ return m_contendedWrites.GetValue(); }
+	void			ResetStats()					{ m_writeCount = 0; m_contendedReads.SetValue(0); m_contendedWrites.SetValue(0); }
+
+private:
+	RWLockHandle_t			m_nHandle;
+
+	int						m_writeCount;	// modified only by writer
+	CEqInterlockedInteger	m_contendedReads;
+	CEqInterlockedInteger	m_contendedWrites;
+
+					CEqReadWriteLock( const CEqReadWriteLock& s ) {}
+	void			operator=( const CEqReadWriteLock& s ) {}
+};
+
+//----------------------------------------------------------------------------------------
+//	CScopedReadLock and CScopedWriteLock are the scoped helpers for CEqReadWriteLock
+//----------------------------------------------------------------------------------------
+class CScopedReadLock
+{
+public:
+	CScopedReadLock( CEqReadWriteLock &l ) : m_pLock(&l)
+	{ m_pLock->LockRead(); }
+
+	~CScopedReadLock()
+	{ m_pLock->UnlockRead(); }
+
+private:
+	CEqReadWriteLock*	m_pLock;
+};
+
+class CScopedWriteLock
+{
+public:
+	CScopedWriteLock( CEqReadWriteLock &l ) : m_pLock(&l)
+	{ m_pLock->LockWrite(); }
+
+	~CScopedWriteLock()
+	{ m_pLock->UnlockWrite(); }
+
+private:
+	CEqReadWriteLock*	m_pLock;
+};
+
 /*----------------------------------------------------------------------------------------
 CEqThread is an abstract base class, to be extended by classes implementing the
 CEqThread::Run() method.
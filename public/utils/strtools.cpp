@@ -168,6 +168,56 @@ int StringToHash( const char *str, bool caseIns )
 	return hash;
 }
 
+static inline int NameHash_Char(char c)
+{
+	return (c == '\\') ? '/' : tolower(c);
+}
+
+int NameToHash( const char* name, const char* suffix )
+{
+	if(*name == '/' || *name == '\\')
+		name++;
+
+	int hash = 0;
+
+	for(; *name; name++)
+		hash = (((hash << 5) | (hash >> 19)) + NameHash_Char(*name)) & 0xFFFFFF;
+
+	if(suffix)
+	{
+		for(; *suffix; suffix++)
+			hash = (((hash << 5) | (hash >> 19)) + NameHash_Char(*suffix)) & 0xFFFFFF;
+	}
+
+	return hash;
+}
+
+bool NameIsEqual( const char* a, const char* b, const char* suffixB )
+{
+	if(*a == '/' || *a == '\\')
+		a++;
+
+	if(*b == '/' || *b == '\\')
+		b++;
+
+	for(; *b; a++, b++)
+	{
+		if(NameHash_Char(*a) != NameHash_Char(*b))
+			return false;
+	}
+
+	if(suffixB)
+	{
+		for(; *suffixB; a++, suffixB++)
+		{
+			if(NameHash_Char(*a) != NameHash_Char(*suffixB))
+				return false;
+		}
+	}
+
+	return (*a == 0);
+}
+
 char* xstreatwhite(char* str)
 {
 	char c = 0;
@@ -89,6 +89,40 @@ void		ExtractFileBase(const char* path, char* dest);
 // generates string hash
 int			StringToHash( const char *str, bool caseIns = false );
 
+// generates hash of resource name. Ignores case, slash direction and leading slash.
+// suffix is hashed as continuation of the name
+int			NameToHash( const char* name, const char* suffix = nullptr );
+
+// compares resource names the way NameToHash hashes them. suffixB continues the name b
+bool		NameIsEqual( const char* a, const char* b, const char* suffixB = nullptr );
+
+// removes value from the multimap keyed by NameToHash.
+// Falls back to full search when value was renamed after it was added
+template <typename MAP, typename T>
+bool		NameHashMap_Remove( MAP& map, int nameHash, const T* value )
+{
+	// elements with equal keys are adjacent
+	for(typename MAP::iterator it = map.find(nameHash); it != map.end() && it->first == nameHash; ++it)
+	{
+		if(it->second == value)
+		{
+			map.erase(it);
+			return true;
+		}
+	}
+
+	for(typename MAP::iterator it = map.begin(); it != map.end(); ++it)
+	{
+		if(it->second == value)
+		{
+			map.erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 // Do formatted arguments for string
 char*		varargs(const char* fmt,...);
 
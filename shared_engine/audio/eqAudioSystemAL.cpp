@@ -15,6 +15,7 @@
 #include "core/ConVar.h"
 #include "core/DebugInterface.h"
 #include "core/IDkCore.h"
+#include "core/IEqProfiler.h"
 
 #include "utils/KeyValues.h"
 #include "utils/global_mutex.h"
@@ -473,6 +474,8 @@ void CEqAudioSystemAL::SuspendSourcesWithSample(ISoundSource* sample)
 // updates all channels
 void CEqAudioSystemAL::Update()
 {
+	PROF_EVENT("Audio Update");
+
 	for (int i = 0; i < m_sources.numElem(); i++)
 	{
 		CEqAudioSourceAL* src = (CEqAudioSourceAL*)m_sources[i].p();
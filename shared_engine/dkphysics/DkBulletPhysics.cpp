@@ -8,6 +8,7 @@
 #include "core/DebugInterface.h"
 #include "core/ConVar.h"
 #include "core/IFileSystem.h"
+#include "core/IEqProfiler.h"
 
 #include "utils/KeyValues.h"
 
@@ -783,6 +784,8 @@ ConVar ph_debug_serializeworld("ph_debug_serializeworld", "0");
 // Update funciton
 void DkPhysics::Simulate(float dt, int substeps)
 {
+	PROF_EVENT("Physics Simulate");
+
 #ifndef EQLC
 	if(m_dynamicsWorld)
 	{
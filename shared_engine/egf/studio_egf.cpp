@@ -9,6 +9,7 @@
 
 #include "core/DebugInterface.h"
 #include "core/IEqParallelJobs.h"
+#include "core/IEqProfiler.h"
 #include "core/ConVar.h"
 
 
@@ -182,7 +183,8 @@ bool CEngineStudioEGF::PrepareForSkinning(Matrix4x4* jointMatrices)
 		}
 
 		//g_pShaderAPI->SetVertexShaderConstantVector4DArray(100, (Vector4D*)&bquats[0].quat, m_hwdata->studio->numBones*2);
-		g_pShaderAPI->SetShaderConstantArrayVector4D("Bones", (Vector4D*)&bquats[0].quat, m_hwdata->studio->numBones * 2);
+		static int s_constBones = -1;
+		s_constBones = g_pShaderAPI->SetShaderConstantArrayVector4D("Bones", (Vector4D*)&bquats[0].quat, m_hwdata->studio->numBones * 2, s_constBones);
 
 		return true;
 	}
@@ -665,8 +667,13 @@ void CEngineStudioEGF::LoadMaterials()
 
 	// try load materials properly
 	// this is a source engine - like material loading using material paths
+	EqString materialPaths[MAX_STUDIOMATERIALS];
+	const char* materialNames[MAX_STUDIOMATERIALS];
+
 	for (int i = 0; i < m_numMaterials; i++)
 	{
+		materialNames[i] = nullptr;
+
 		EqString fpath(pHdr->pMaterial(i)->materialname);
 		fpath.Path_FixSlashes();
 
@@ -675,29 +682,37 @@ void CEngineStudioEGF::LoadMaterials()
 
 		for (int j = 0; j < pHdr->numMaterialSearchPaths; j++)
 		{
-			if (!m_materials[i])
-			{
-				EqString spath(pHdr->pMaterialSearchPath(j)->searchPath);
-				spath.Path_FixSlashes();
+			EqString spath(pHdr->pMaterialSearchPath(j)->searchPath);
+			spath.Path_FixSlashes();
 
-				if (spath.ToCString()[spath.Length() - 1] == CORRECT_PATH_SEPARATOR)
-					spath = spath.Left(spath.Length() - 1);
+			if (spath.ToCString()[spath.Length() - 1] == CORRECT_PATH_SEPARATOR)
+				spath = spath.Left(spath.Length() - 1);
 
-				EqString extend_path = spath + CORRECT_PATH_SEPARATOR + fpath;
+			EqString extend_path = spath + CORRECT_PATH_SEPARATOR + fpath;
 
-				if (materials->IsMaterialExist(extend_path.GetData()))
-				{
-					m_materials[i] = materials->GetMaterial(extend_path.GetData());
-
-					if (!m_materials[i]->IsError() && !(m_materials[i]->GetFlags() & MATERIAL_FLAG_SKINNED))
-						MsgWarning("Warning! Material '%s' shader '%s' for model '%s' is invalid\n", m_materials[i]->GetName(), m_materials[i]->GetShaderName(), m_szPath.ToCString());
-
-					m_materials[i]->Ref_Grab();
-				}
+			if (materials->IsMaterialExist(extend_path.GetData()))
+			{
+				materialPaths[i] = extend_path;
+				materialNames[i] = materialPaths[i].ToCString();
+				break;
 			}
 		}
 	}
 
+	// resolve all materials at once
+	materials->GetMaterials(materialNames, m_materials, m_numMaterials);
+
+	for (int i = 0; i < m_numMaterials; i++)
+	{
+		if (!m_materials[i])
+			continue;
+
+		if (!m_materials[i]->IsError() && !(m_materials[i]->GetFlags() & MATERIAL_FLAG_SKINNED))
+			MsgWarning("Warning! Material '%s' shader '%s' for model '%s' is invalid\n", m_materials[i]->GetName(), m_materials[i]->GetShaderName(), m_szPath.ToCString());
+
+		m_materials[i]->Ref_Grab();
+	}
+
 	bool bError = false;
 
 	// false-initialization of non-loaded materials
@@ -816,6 +831,13 @@ int CEngineStudioEGF::SelectLod(float dist_to_camera)
 			idealLOD = i;
 	}
 
+	// model is close to the camera, get it's materials loaded before the rest of queue
+	if (idealLOD == 0)
+	{
+		for (int i = 0; i < m_numMaterials; i++)
+			materials->PutMaterialToLoadingQueue(m_materials[i], MATERIAL_LOAD_PRIORITY_NEAR);
+	}
+
 	return idealLOD;
 }
 
@@ -832,6 +854,8 @@ void CEngineStudioEGF::DrawGroup(int nModel, int nGroup, bool preSetVBO)
 	if (m_numVertices == 0)
 		return;
 
+	PROF_EVENT("EGF DrawGroup");
+
 	if (preSetVBO)
 	{
 		g_pShaderAPI->SetVertexFormat(g_studioModelCache->GetEGFVertexFormat());
@@ -1192,11 +1216,16 @@ int CStudioModelCache::PrecacheModel(const char* modelName)
 		DevMsg(DEVMSG_CORE, "Loading model '%s'\n", modelName);
 
 		CEngineStudioEGF* pModel = new CEngineStudioEGF;
+
+		m_cacheLock.LockWrite();
 		pModel->m_cacheIdx = m_cachedList.append(pModel);
+		m_cacheLock.UnlockWrite();
 
 		if (!pModel->LoadModel(modelName, job_modelLoader.GetBool()))
 		{
+			m_cacheLock.LockWrite();
 			m_cachedList[pModel->m_cacheIdx] = NULL;
+			m_cacheLock.UnlockWrite();
 
 			delete pModel;
 			pModel = NULL;
@@ -1219,6 +1248,8 @@ int	CStudioModelCache::GetCachedModelCount() const
 
 IEqModel* CStudioModelCache::GetModel(int index) const
 {
+	Threading::CScopedReadLock m(m_cacheLock);
+
 	IEqModel* model = NULL;
 
 	if (index == CACHE_INVALID_MODEL)
@@ -1244,6 +1275,8 @@ int CStudioModelCache::GetModelIndex(const char* modelName) const
 	strcpy(str, modelName);
 	FixSlashes(str);
 
+	Threading::CScopedReadLock m(m_cacheLock);
+
 	for (int i = 0; i < m_cachedList.numElem(); i++)
 	{
 		if (m_cachedList[i] == NULL)
@@ -1258,6 +1291,8 @@ int CStudioModelCache::GetModelIndex(const char* modelName) const
 
 int CStudioModelCache::GetModelIndex(IEqModel* pModel) const
 {
+	Threading::CScopedReadLock m(m_cacheLock);
+
 	for (int i = 0; i < m_cachedList.numElem(); i++)
 	{
 		if (m_cachedList[i] == pModel)
@@ -1275,6 +1310,8 @@ void CStudioModelCache::FreeCachedModel(IEqModel* pModel)
 
 void CStudioModelCache::ReleaseCache()
 {
+	m_cacheLock.LockWrite();
+
 	for (int i = 0; i < m_cachedList.numElem(); i++)
 	{
 		if (m_cachedList[i])
@@ -1285,6 +1322,8 @@ void CStudioModelCache::ReleaseCache()
 
 	m_cachedList.clear();
 
+	m_cacheLock.UnlockWrite();
+
 	g_pShaderAPI->DestroyVertexFormat(m_egfFormat);
 	m_egfFormat = NULL;
 }
@@ -157,6 +157,8 @@ private:
 
 	DkList<IEqModel*>		m_cachedList;
 	IVertexFormat*			m_egfFormat;	// vertex format for streams
+
+	mutable Threading::CEqReadWriteLock	m_cacheLock;
 };
 
 #endif // CENGINEMODEL_H
\ No newline at end of file
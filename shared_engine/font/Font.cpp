@@ -136,12 +136,44 @@ CFont::CFont()
 	m_lineHeight = 0.0f;
 
 	memset(&m_flags, 1, sizeof(m_flags));
+
+	memset(m_glyphPages, 0, sizeof(m_glyphPages));
+	m_layoutCache = nullptr;
+	m_widthCache = nullptr;
 }
 
 CFont::~CFont()
 {
 	//if( m_vertexBuffer )
 	//	free( m_vertexBuffer );
+
+	for(int i = 0; i < FONT_GLYPH_PAGES; i++)
+		delete [] m_glyphPages[i];
+
+	delete [] m_layoutCache;
+	delete [] m_widthCache;
+}
+
+eqTextLayout_t::~eqTextLayout_t()
+{
+	PPFree(text);
+}
+
+eqTextWidth_t::~eqTextWidth_t()
+{
+	PPFree(text);
+}
+
+// FNV-1a of string characters
+template <typename CHAR_T>
+static uint Font_HashText(const CHAR_T* str, int charCount)
+{
+	uint hash = 2166136261u;
+
+	for(int i = 0; i < charCount; i++)
+		hash = (hash ^ (uint)str[i]) * 16777619u;
+
+	return hash;
 }
 
 const char*	CFont::GetName() const
@@ -181,9 +213,35 @@ float CFont::GetBaselineOffs( const eqFontStyleParam_t& params ) const
 	return m_baseline;
 }
 
+ConVar r_font_layoutCache("r_font_layoutCache", "1", "Cache layout and width of unchanged text", CV_CHEAT);
+
 template <typename CHAR_T>
 float CFont::_GetStringWidth( const CHAR_T* str, const eqFontStyleParam_t& params, int charCount, int breakOnChar) const
 {
+	eqTextWidth_t* cached = nullptr;
+	int textSize = charCount * sizeof(CHAR_T);
+
+	if(r_font_layoutCache.GetBool())
+	{
+		uint hash = Font_HashText(str, charCount);
+		hash = (hash ^ (uint)(params.styleFlag + breakOnChar * 31 + sizeof(CHAR_T))) * 16777619u;
+
+		if(!m_widthCache)
+			m_widthCache = new eqTextWidth_t[FONT_WIDTH_CACHE_SIZE];
+
+		cached = &m_widthCache[hash % FONT_WIDTH_CACHE_SIZE];
+
+		if( cached->text && cached->textSize == textSize &&
+			cached->charSize == sizeof(CHAR_T) &&
+			cached->styleFlag == params.styleFlag &&
+			cached->breakOnChar == breakOnChar &&
+			cached->scale == params.scale &&
+			!memcmp(cached->text, str, textSize))
+		{
+			return cached->width;
+		}
+	}
+
     float totalWidth = 0.0f;
 
 	// parse
@@ -225,14 +283,110 @@ float CFont::_GetStringWidth( const CHAR_T* str, const eqFontStyleParam_t& param
 			totalWidth += chr.advX + m_spacing; // chr.x1-chr.x0;
 	}
 
+	// replace cached width
+	if(cached)
+	{
+		cached->text = PPReAlloc(cached->text, textSize + 1);
+		memcpy(cached->text, str, textSize);
+
+		cached->textSize = textSize;
+		cached->charSize = sizeof(CHAR_T);
+		cached->styleFlag = params.styleFlag;
+		cached->breakOnChar = breakOnChar;
+		cached->scale = params.scale;
+		cached->width = totalWidth;
+	}
+
     return totalWidth;
 }
 
+//
+// Builds glyph quads, reuses layout of the same text rendered before
+//
+template <typename CHAR_T>
+void CFont::LayoutText(DkList<eqTextQuad_t>& quads, const CHAR_T* str, const Vector2D& textPos, const eqFontStyleParam_t& params)
+{
+	// custom layout builders may depend on their own state
+	if(params.layoutBuilder != NULL || !r_font_layoutCache.GetBool())
+	{
+		BuildTextQuads(quads, str, textPos, params);
+		return;
+	}
+
+	int length = 0;
+
+	while(str[length])
+		length++;
+
+	uint hash = Font_HashText(str, length);
+	hash = (hash ^ (uint)(params.styleFlag + params.align * 31 + sizeof(CHAR_T))) * 16777619u;
+
+	int textSize = length * sizeof(CHAR_T);
+
+	if(!m_layoutCache)
+		m_layoutCache = new eqTextLayout_t[FONT_LAYOUT_CACHE_SIZE];
+
+	eqTextLayout_t& layout = m_layoutCache[hash % FONT_LAYOUT_CACHE_SIZE];
+
+	if( layout.text && layout.textSize == textSize &&
+		layout.charSize == sizeof(CHAR_T) &&
+		layout.align == params.align &&
+		layout.styleFlag == params.styleFlag &&
+		layout.scale == params.scale &&
+		layout.textColor == params.textColor &&
+		!memcmp(layout.text, str, textSize))
+	{
+		Vector2D offset = textPos - layout.start;
+
+		// aligned lines start at whole pixels, keep them snapped
+		if(params.align & (TEXT_ALIGN_HCENTER | TEXT_ALIGN_RIGHT))
+			offset.x = floor(offset.x + 0.5f);
+
+		for(int i = 0; i < layout.quads.numElem(); i++)
+		{
+			eqTextQuad_t quad = layout.quads[i];
+			quad.rect.vleftTop += offset;
+			quad.rect.vrightBottom += offset;
+
+			quads.append(quad);
+		}
+
+		return;
+	}
+
+	int firstQuad = quads.numElem();
+
+	BuildTextQuads(quads, str, textPos, params);
+
+	// replace cached layout
+	layout.text = PPReAlloc(layout.text, textSize + 1);
+	memcpy(layout.text, str, textSize);
+
+	layout.textSize = textSize;
+	layout.charSize = sizeof(CHAR_T);
+	layout.align = params.align;
+	layout.styleFlag = params.styleFlag;
+	layout.scale = params.scale;
+	layout.textColor = params.textColor;
+	layout.start = textPos;
+
+	layout.quads.setNum(0, false);
+
+	for(int i = firstQuad; i < quads.numElem(); i++)
+	{
+		eqTextQuad_t quad = quads[i];
+		quad.rect.vleftTop -= textPos;
+		quad.rect.vrightBottom -= textPos;
+
+		layout.quads.append(quad);
+	}
+}
+
 //
 // Fills text buffer and processes tags
 //
 template <typename CHAR_T>
-void CFont::BuildCharVertexBuffer(CMeshBuilder& builder, const CHAR_T* str, const Vector2D& textPos, const eqFontStyleParam_t& params)
+void CFont::BuildTextQuads(DkList<eqTextQuad_t>& quads, const CHAR_T* str, const Vector2D& textPos, const eqFontStyleParam_t& params)
 {
 	const bool isWideChar = std::is_same<CHAR_T,wchar_t>::value;
 
@@ -369,15 +523,12 @@ void CFont::BuildCharVertexBuffer(CMeshBuilder& builder, const CHAR_T* str, cons
 		if(stateParams.styleFlag & TEXT_STYLE_FROM_CAP)
 			cPos.y = startPos.y - (cSize.y-baseLine) + chr.ofsY;
 
-		Rectangle_t charRect(cPos, cPos+cSize);
-		Rectangle_t charTexCoord(chr.x0*m_invTexSize.x, chr.y0*m_invTexSize.y,chr.x1*m_invTexSize.x, chr.y1*m_invTexSize.y);
-
-		// set character color
-		builder.Color4fv(stateParams.textColor);
+		eqTextQuad_t quad;
+		quad.rect = Rectangle_t(cPos, cPos+cSize);
+		quad.texCoord = Rectangle_t(chr.x0*m_invTexSize.x, chr.y0*m_invTexSize.y,chr.x1*m_invTexSize.x, chr.y1*m_invTexSize.y);
+		quad.color = stateParams.textColor;
 
-		// use meshbuilder's index buffer optimization feature
-		builder.TexturedQuad2(	charRect.GetLeftTop(), charRect.GetRightTop(), charRect.GetLeftBottom(), charRect.GetRightBottom(),
-								charTexCoord.GetLeftTop(), charTexCoord.GetRightTop(), charTexCoord.GetLeftBottom(), charTexCoord.GetRightBottom());
+		quads.append(quad);
 
 		str++;
 	
@@ -388,20 +539,36 @@ ConVar r_font_sdf_start("r_font_sdf_start", "0.94");
 ConVar r_font_sdf_range("r_font_sdf_range", "0.06");
 ConVar r_font_debug("r_font_debug", "0", nullptr, CV_CHEAT);
 
+#define FONT_MAX_QUADS_PER_DRAW		4096	// strip quad takes 4 vertices and 6 indices of dynamic mesh
+
 //
 // Renders new styled tagged text - wide chars only
 //
 void CFont::RenderText(const wchar_t* pszText, const Vector2D& start, const eqFontStyleParam_t& params)
 {
-	int vertCount = GetTextQuadsCount(pszText, params) * 6;
-	if (vertCount == 0)
-		return;
+	_RenderText(pszText, start, params);
+}
 
-	IDynamicMesh* dynMesh = materials->GetDynamicMesh();
-	CMeshBuilder meshBuilder(dynMesh);
+//
+// Renders new styled tagged text - ASCII
+//
+void CFont::RenderText(const char* pszText, const Vector2D& start, const eqFontStyleParam_t& params)
+{
+	_RenderText(pszText, start, params);
+}
+
+//
+// Builds glyph quads and queues them to the text batch or draws them immediately
+//
+template <typename CHAR_T>
+void CFont::_RenderText(const CHAR_T* pszText, const Vector2D& start, const eqFontStyleParam_t& params)
+{
+	CEqFontCache* fontCache = ((CEqFontCache*)g_fontCache);
 
 	if (r_font_debug.GetBool())
 	{
+		CMeshBuilder meshBuilder(materials->GetDynamicMesh());
+
 		RasterizerStateParams_t raster;
 		raster.scissor = (params.styleFlag & TEXT_STYLE_SCISSOR) > 0;
 		BlendStateParam_t blending;
@@ -428,80 +595,46 @@ void CFont::RenderText(const wchar_t* pszText, const Vector2D& start, const eqFo
 		meshBuilder.End();
 	}
 
-	// first we building vertex buffer
-	meshBuilder.Begin( PRIM_TRIANGLE_STRIP );
-	BuildCharVertexBuffer(meshBuilder, pszText, start, params);
-	meshBuilder.End(false);
+	eqTextBatch_t* batch = fontCache->GetTextBatch(this, params);
 
-	//
-	// render
-	//
-	RasterizerStateParams_t raster;
-	raster.scissor = (params.styleFlag & TEXT_STYLE_SCISSOR) > 0;
-	BlendStateParam_t blending;
+	DkList<eqTextQuad_t>& quads = batch ? batch->quads : fontCache->m_immediateQuads;
 
-	blending.srcFactor = BLENDFACTOR_SRC_ALPHA;
-	blending.dstFactor = BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
-
-	materials->SetDepthStates(false,false);
-	materials->SetBlendingStates(blending);
-	materials->SetRasterizerStates(raster);
+	if(!batch)
+		quads.setNum(0, false);
 
-	g_pShaderAPI->SetTexture(m_fontTexture, nullptr, 0);
+	int firstQuad = quads.numElem();
 
-	CEqFontCache* fontCache = ((CEqFontCache*)g_fontCache);
-
-	IMaterial* fontMaterial = m_flags.sdf ? fontCache->m_sdfMaterial : materials->GetDefaultMaterial();
-
-	IMatVar* sdfRange = fontCache->m_sdfRange;
+	LayoutText(quads, pszText, start, params);
 
-	// draw shadow
-	if(params.styleFlag & TEXT_STYLE_SHADOW)
-	{
-		materials->SetMatrix(MATRIXMODE_WORLD, translate(params.shadowOffset,params.shadowOffset,0.0f));
-		materials->SetAmbientColor(ColorRGBA(0,0,0,params.shadowAlpha));
-
-		// shadow width
-		float sdfEndClamped = clamp(r_font_sdf_range.GetFloat()+params.shadowWidth, 0.0f, 1.0f - r_font_sdf_start.GetFloat());
-		sdfRange->SetVector2(Vector2D(r_font_sdf_start.GetFloat()-params.shadowWidth, sdfEndClamped));
-
-		materials->BindMaterial(fontMaterial);
-
-		dynMesh->Render();
-	}
-
-	float sdfEndClamped = clamp(r_font_sdf_range.GetFloat(), 0.0f, 1.0f - r_font_sdf_start.GetFloat());
-	sdfRange->SetVector2(Vector2D(r_font_sdf_start.GetFloat(), sdfEndClamped));
+	if(quads.numElem() == firstQuad)
+		return;
 
-	materials->SetAmbientColor(color4_white);
-	materials->SetMatrix(MATRIXMODE_WORLD, identity4());
+	eqTextBatchStats_t& stats = fontCache->GetBatchStats();
+	stats.textCalls++;
+	stats.unbatchedDraws += (params.styleFlag & TEXT_STYLE_SHADOW) ? 2 : 1;
 
-	materials->BindMaterial(fontMaterial);
+	// drawn by EndTextBatch
+	if(batch)
+		return;
 
-	dynMesh->Render();
+	RenderQuads(quads.ptr(), quads.numElem(), params);
 }
 
 //
-// Renders new styled tagged text - wide chars only
+// Draws glyph quads, shadow pass is drawn first if TEXT_STYLE_SHADOW is set
 //
-void CFont::RenderText(const char* pszText, const Vector2D& start, const eqFontStyleParam_t& params)
+void CFont::RenderQuads(const eqTextQuad_t* quads, int numQuads, const eqFontStyleParam_t& params)
 {
-	int vertCount = GetTextQuadsCount(pszText, params) * 6;
-	if (vertCount == 0)
+	if (numQuads == 0)
 		return;
 
 	IDynamicMesh* dynMesh = materials->GetDynamicMesh();
-	CMeshBuilder meshBuilder(dynMesh);
 
-	// first we building vertex buffer
-	meshBuilder.Begin( PRIM_TRIANGLE_STRIP );
-	BuildCharVertexBuffer(meshBuilder, pszText, start, params);
-	meshBuilder.End(false);
+	CEqFontCache* fontCache = ((CEqFontCache*)g_fontCache);
+	eqTextBatchStats_t& stats = fontCache->GetBatchStats();
 
-	//
-	// render
-	//
 	RasterizerStateParams_t raster;
+	raster.scissor = (params.styleFlag & TEXT_STYLE_SCISSOR) > 0;
 	BlendStateParam_t blending;
 
 	blending.srcFactor = BLENDFACTOR_SRC_ALPHA;
@@ -511,38 +644,66 @@ void CFont::RenderText(const char* pszText, const Vector2D& start, const eqFontS
 	materials->SetBlendingStates(blending);
 	materials->SetRasterizerStates(raster);
 
-	g_pShaderAPI->SetTexture(m_fontTexture, NULL, 0);
-
-	CEqFontCache* fontCache = ((CEqFontCache*)g_fontCache);
+	g_pShaderAPI->SetTexture(m_fontTexture, nullptr, 0);
 
 	IMaterial* fontMaterial = m_flags.sdf ? fontCache->m_sdfMaterial : materials->GetDefaultMaterial();
-	
+
 	IMatVar* sdfRange = fontCache->m_sdfRange;
 
-	// draw shadow
-	if(params.styleFlag & TEXT_STYLE_SHADOW)
+	for(int firstQuad = 0; firstQuad < numQuads; firstQuad += FONT_MAX_QUADS_PER_DRAW)
 	{
-		materials->SetMatrix(MATRIXMODE_WORLD, translate(params.shadowOffset,params.shadowOffset,0.0f));
-		materials->SetAmbientColor(ColorRGBA(0,0,0,params.shadowAlpha));
+		int quadCount = min(numQuads - firstQuad, FONT_MAX_QUADS_PER_DRAW);
 
-		// shadow width
-		float sdfEndClamped = clamp(r_font_sdf_range.GetFloat()+params.shadowWidth, 0.0f, 1.0f - r_font_sdf_start.GetFloat());
-		sdfRange->SetVector2(Vector2D(r_font_sdf_start.GetFloat()-params.shadowWidth, sdfEndClamped));
+		// first we building vertex buffer
+		CMeshBuilder meshBuilder(dynMesh);
+		meshBuilder.Begin( PRIM_TRIANGLE_STRIP );
 
-		materials->BindMaterial(fontMaterial);
+		for(int i = firstQuad; i < firstQuad + quadCount; i++)
+		{
+			const Rectangle_t& charRect = quads[i].rect;
+			const Rectangle_t& charTexCoord = quads[i].texCoord;
 
-		dynMesh->Render();
-	}
+			// set character color
+			meshBuilder.Color4fv(quads[i].color);
 
-	float sdfEndClamped = clamp(r_font_sdf_range.GetFloat(), 0.0f, 1.0f - r_font_sdf_start.GetFloat());
-	sdfRange->SetVector2(Vector2D(r_font_sdf_start.GetFloat(), sdfEndClamped));
+			// use meshbuilder's index buffer optimization feature
+			meshBuilder.TexturedQuad2(	charRect.GetLeftTop(), charRect.GetRightTop(), charRect.GetLeftBottom(), charRect.GetRightBottom(),
+										charTexCoord.GetLeftTop(), charTexCoord.GetRightTop(), charTexCoord.GetLeftBottom(), charTexCoord.GetRightBottom());
+		}
 
-	materials->SetAmbientColor(color4_white);
-	materials->SetMatrix(MATRIXMODE_WORLD, identity4());
+		meshBuilder.End(false);
 
-	materials->BindMaterial(fontMaterial);
+		//
+		// render
+		//
+
+		// draw shadow
+		if(params.styleFlag & TEXT_STYLE_SHADOW)
+		{
+			materials->SetMatrix(MATRIXMODE_WORLD, translate(params.shadowOffset,params.shadowOffset,0.0f));
+			materials->SetAmbientColor(ColorRGBA(0,0,0,params.shadowAlpha));
+
+			// shadow width
+			float sdfEndClamped = clamp(r_font_sdf_range.GetFloat()+params.shadowWidth, 0.0f, 1.0f - r_font_sdf_start.GetFloat());
+			sdfRange->SetVector2(Vector2D(r_font_sdf_start.GetFloat()-params.shadowWidth, sdfEndClamped));
+
+			materials->BindMaterial(fontMaterial);
+
+			dynMesh->Render();
+			stats.draws++;
+		}
+
+		float sdfEndClamped = clamp(r_font_sdf_range.GetFloat(), 0.0f, 1.0f - r_font_sdf_start.GetFloat());
+		sdfRange->SetVector2(Vector2D(r_font_sdf_start.GetFloat(), sdfEndClamped));
+
+		materials->SetAmbientColor(color4_white);
+		materials->SetMatrix(MATRIXMODE_WORLD, identity4());
 
-	dynMesh->Render();
+		materials->BindMaterial(fontMaterial);
+
+		dynMesh->Render();
+		stats.draws++;
+	}
 }
 
 //
@@ -552,67 +713,55 @@ const eqFontChar_t&	CFont::GetFontCharById( const int chrId ) const
 {
 	static eqFontChar_t null_default;
 
-	if(!m_charMap.count(chrId))
+	if(chrId >= 0 && chrId < FONT_GLYPH_PAGE_SIZE*FONT_GLYPH_PAGES)
+	{
+		const eqFontChar_t* page = m_glyphPages[chrId / FONT_GLYPH_PAGE_SIZE];
+
+		if(!page)
+			return null_default;
+
+		return page[chrId % FONT_GLYPH_PAGE_SIZE];
+	}
+
+	auto it = m_rareChars.find(chrId);
+
+	if(it == m_rareChars.end())
 		return null_default;
-	
-	return m_charMap.at(chrId);
+
+	return it->second;
 }
 
 //
-// returns the scaled character
+// returns character for filling, allocates glyph page if needed
 //
-void CFont::GetScaledCharacter( eqFontChar_t& chr, const int chrId, const Vector2D& scale) const
+eqFontChar_t& CFont::AddFontChar( const int chrId )
 {
-	chr = GetFontCharById(chrId);
-
-	if(m_flags.sdf) // only scale SDF characters
+	if(chrId >= 0 && chrId < FONT_GLYPH_PAGE_SIZE*FONT_GLYPH_PAGES)
 	{
-		chr.advX = chr.advX*scale.x;
-		chr.ofsX = chr.ofsX*scale.x;
-		chr.ofsY = chr.ofsY*scale.y;
+		eqFontChar_t*& page = m_glyphPages[chrId / FONT_GLYPH_PAGE_SIZE];
+
+		if(!page)
+			page = new eqFontChar_t[FONT_GLYPH_PAGE_SIZE];
+
+		return page[chrId % FONT_GLYPH_PAGE_SIZE];
 	}
+
+	return m_rareChars[chrId];
 }
 
 //
-// returns maximum of possible quads to be allocated
+// returns the scaled character
 //
-template <typename CHAR_T>
-int CFont::GetTextQuadsCount(const CHAR_T* str, const eqFontStyleParam_t& params) const
+void CFont::GetScaledCharacter( eqFontChar_t& chr, const int chrId, const Vector2D& scale) const
 {
-	int n = 0;
+	chr = GetFontCharById(chrId);
 
-	int charMode = CHARMODE_NORMAL;
-	while (*str)
+	if(m_flags.sdf) // only scale SDF characters
 	{
-		int charIdx = *str;
-
-		// skip fasttags
-		if( (params.styleFlag & TEXT_STYLE_USE_TAGS) &&
-			charMode == CHARMODE_NORMAL &&
-			charIdx == '&')
-		{
-			charMode = CHARMODE_TAG;
-			str++;
-			continue;
-		}
-
-		if(charMode == CHARMODE_TAG)
-		{
-			if(charIdx == ';')
-				charMode = CHARMODE_NORMAL;
-
-			str++;
-
-			continue;
-		}
-
-		if(IsVisibleChar(charIdx))
-			n++;
-
-		str++;
+		chr.advX = chr.advX*scale.x;
+		chr.ofsX = chr.ofsX*scale.x;
+		chr.ofsY = chr.ofsY*scale.y;
 	}
-
-	return n;
 }
 
 bool CFont::LoadFont( const char* filenamePrefix )
@@ -692,7 +841,7 @@ bool CFont::LoadFont( const char* filenamePrefix )
 					fontChar.y1 = fontChar.y1 - 0.5f;
 				}
 
-				m_charMap[charIdx] = fontChar;
+				AddFontChar(charIdx) = fontChar;
 			}
 		}
 		else
@@ -744,9 +893,7 @@ bool CFont::LoadFont( const char* filenamePrefix )
 						lChars = 0;
 					}
 
-					m_charMap[i] = eqFontChar_t();
-
-					eqFontChar_t& chr = m_charMap[i];
+					eqFontChar_t& chr = AddFontChar(i);
 
 					float CurCharPos_x = lChars * tall;
 					float CurCharPos_y = line * tall;
@@ -10,15 +10,66 @@
 #define FONT_H
 
 #include "font/IFont.h"
+#include "math/Rectangle.h"
+#include "utils/DkList.h"
 #include <map>
 
-class CMeshBuilder;
+#define FONT_GLYPH_PAGE_SIZE	256
+#define FONT_GLYPH_PAGES		256		// pages are covering the BMP, other code points are in the map
+
+#define FONT_LAYOUT_CACHE_SIZE	64
+#define FONT_WIDTH_CACHE_SIZE	128
+
+// single glyph quad
+struct eqTextQuad_t
+{
+	Rectangle_t		rect;
+	Rectangle_t		texCoord;
+	ColorRGBA		color;
+};
+
+// text layout with quads relative to text start
+struct eqTextLayout_t
+{
+	eqTextLayout_t() : text(nullptr), textSize(0), charSize(0) {}
+	~eqTextLayout_t();
+
+	void*					text;		// copy of the string
+	int						textSize;	// in bytes
+	int						charSize;
+
+	int						align;
+	int						styleFlag;
+	Vector2D				scale;
+	ColorRGBA				textColor;
+	Vector2D				start;		// quads are relative to it
+
+	DkList<eqTextQuad_t>	quads;
+};
+
+// cached string width
+struct eqTextWidth_t
+{
+	eqTextWidth_t() : text(nullptr), textSize(0), charSize(0) {}
+	~eqTextWidth_t();
+
+	void*					text;		// copy of the measured characters
+	int						textSize;	// in bytes
+	int						charSize;
+
+	int						styleFlag;
+	int						breakOnChar;
+	Vector2D				scale;
+
+	float					width;
+};
 
 class CFont : public IEqFont
 {
 	friend class			CEngineHost;
 	friend class			CEqConsoleInput;
 	friend class			CPlainTextLayoutBuilder;
+	friend class			CEqFontCache;
 
 public:
 							CFont();
@@ -52,21 +103,38 @@ protected:
 	// returns the scaled character
 	void					GetScaledCharacter( eqFontChar_t& chr, const int chrId, const Vector2D& scale = 1.0f ) const;
 
-	// builds vertex buffer for characters
+	// builds glyph quads using layout cache
 	template <typename CHAR_T>
-	void					BuildCharVertexBuffer(	CMeshBuilder& builder, 
-													const CHAR_T* str, 
-													const Vector2D& startPos, 
-													const eqFontStyleParam_t& params);
+	void					LayoutText(	DkList<eqTextQuad_t>& quads,
+										const CHAR_T* str,
+										const Vector2D& startPos,
+										const eqFontStyleParam_t& params);
 
+	// builds glyph quads for characters
 	template <typename CHAR_T>
-	float					_GetStringWidth( const CHAR_T* str, const eqFontStyleParam_t& params, int charCount = 0, int breakOnChar = -1) const;
+	void					BuildTextQuads(	DkList<eqTextQuad_t>& quads,
+											const CHAR_T* str,
+											const Vector2D& startPos,
+											const eqFontStyleParam_t& params);
 
 	template <typename CHAR_T>
-	int						GetTextQuadsCount(const CHAR_T *str, const eqFontStyleParam_t& params) const;
+	void					_RenderText( const CHAR_T* pszText, const Vector2D& start, const eqFontStyleParam_t& params);
+
+	// draws glyph quads, shadow pass is drawn first if TEXT_STYLE_SHADOW is set
+	void					RenderQuads( const eqTextQuad_t* quads, int numQuads, const eqFontStyleParam_t& params );
+
+	template <typename CHAR_T>
+	float					_GetStringWidth( const CHAR_T* str, const eqFontStyleParam_t& params, int charCount = 0, int breakOnChar = -1) const;
+
+	// returns character for filling, allocates glyph page if needed
+	eqFontChar_t&			AddFontChar( const int chrId );
+
+	// chars are directly indexed by pages, rare ones are in the map
+	eqFontChar_t*					m_glyphPages[FONT_GLYPH_PAGES];
+	std::map<int, eqFontChar_t>		m_rareChars;
 
-	// map of chars
-	std::map<ushort, eqFontChar_t>	m_charMap;
+	eqTextLayout_t*					m_layoutCache;
+	mutable eqTextWidth_t*			m_widthCache;
 
 	float							m_spacing;
 	float							m_baseline;
@@ -7,6 +7,7 @@
 
 #include "core/IDkCore.h"
 #include "core/DebugInterface.h"
+#include "core/ConCommand.h"
 #include "utils/DkList.h"
 #include "utils/EqString.h"
 #include "utils/KeyValues.h"
@@ -24,6 +25,11 @@ using namespace eqFontsInternal;
 static CEqFontCache s_fontCache;
 IEqFontCache* g_fontCache = &s_fontCache;
 
+DECLARE_CMD(r_font_batchStats, "Prints text batching statistics", 0)
+{
+	s_fontCache.PrintBatchStats();
+}
+
 #define FONT_DEFAULT_LIST_FILENAME "resources/fonts.res"
 
 #define FONT_LOADSTYLE(v, name)		\
@@ -54,8 +60,14 @@ eqFontStyleInfo_t::~eqFontStyleInfo_t()
 CEqFontCache::CEqFontCache() : 
 	m_defaultFont(nullptr),
 	m_sdfMaterial(nullptr),
-	m_sdfRange(nullptr)
+	m_sdfRange(nullptr),
+	m_numActiveBatches(0),
+	m_batchDepth(0)
 {
+	memset(&m_batchStats, 0, sizeof(m_batchStats));
+	memset(&m_lastBatchStats, 0, sizeof(m_lastBatchStats));
+	memset(&m_totalStats, 0, sizeof(m_totalStats));
+
 	GetCore()->RegisterInterface(FONTCACHE_INTERFACE_VERSION, this);
 }
 
@@ -205,6 +217,15 @@ void CEqFontCache::Shutdown()
 	m_fonts.clear();
 	m_defaultFont = nullptr;
 
+	for(int i = 0; i < m_textBatches.numElem(); i++)
+		delete m_textBatches[i];
+
+	m_textBatches.clear();
+	m_numActiveBatches = 0;
+	m_batchDepth = 0;
+
+	m_immediateQuads.clear();
+
 	materials->FreeMaterial( m_sdfMaterial );
 	m_sdfMaterial = nullptr;
 	m_sdfRange = nullptr;
@@ -215,6 +236,134 @@ void CEqFontCache::ReloadFonts()
 	ASSERTMSG(false, "Please implement CEqFontCache::ReloadFonts() !!!");
 }
 
+//---------------------------------------------------------------------
+// Text batching
+//---------------------------------------------------------------------
+
+void CEqFontCache::BeginTextBatch()
+{
+	m_batchDepth++;
+
+	if(m_batchDepth == 1)
+		memset(&m_batchStats, 0, sizeof(m_batchStats));
+}
+
+void CEqFontCache::EndTextBatch()
+{
+	ASSERTMSG(m_batchDepth > 0, "EndTextBatch without BeginTextBatch");
+
+	if(m_batchDepth <= 0)
+		return;
+
+	m_batchDepth--;
+
+	// nested batches are flushed by outer one
+	if(m_batchDepth > 0)
+		return;
+
+	FlushTextBatches();
+
+	m_lastBatchStats = m_batchStats;
+
+	m_totalStats.textCalls += m_batchStats.textCalls;
+	m_totalStats.draws += m_batchStats.draws;
+	m_totalStats.unbatchedDraws += m_batchStats.unbatchedDraws;
+}
+
+// returns batch for text or NULL if batching is not active or text can't be batched
+// only consecutive texts with same font, style and transform are merged to keep draw order
+eqTextBatch_t* CEqFontCache::GetTextBatch(CFont* font, const eqFontStyleParam_t& params)
+{
+	// scissor rectangle may change between texts
+	if(m_batchDepth == 0 || (params.styleFlag & TEXT_STYLE_SCISSOR))
+		return nullptr;
+
+	int styleFlag = params.styleFlag & TEXT_STYLE_SHADOW;
+
+	Matrix4x4 view, projection;
+	materials->GetMatrix(MATRIXMODE_VIEW, view);
+	materials->GetMatrix(MATRIXMODE_PROJECTION, projection);
+
+	if(m_numActiveBatches > 0)
+	{
+		eqTextBatch_t* batch = m_textBatches[m_numActiveBatches-1];
+
+		bool sameStyle = batch->font == font && batch->styleFlag == styleFlag;
+
+		if(sameStyle && styleFlag)
+		{
+			sameStyle = batch->shadowOffset == params.shadowOffset &&
+						batch->shadowWidth == params.shadowWidth &&
+						batch->shadowAlpha == params.shadowAlpha;
+		}
+
+		if(sameStyle &&
+			!memcmp(&batch->view, &view, sizeof(Matrix4x4)) &&
+			!memcmp(&batch->projection, &projection, sizeof(Matrix4x4)))
+			return batch;
+	}
+
+	if(m_numActiveBatches == m_textBatches.numElem())
+		m_textBatches.append(new eqTextBatch_t);
+
+	eqTextBatch_t* batch = m_textBatches[m_numActiveBatches++];
+
+	batch->font = font;
+	batch->styleFlag = styleFlag;
+	batch->shadowOffset = params.shadowOffset;
+	batch->shadowWidth = params.shadowWidth;
+	batch->shadowAlpha = params.shadowAlpha;
+	batch->view = view;
+	batch->projection = projection;
+	batch->quads.setNum(0, false);
+
+	return batch;
+}
+
+// draws batches in order they were queued with the transform they were queued with
+void CEqFontCache::FlushTextBatches()
+{
+	if(m_numActiveBatches == 0)
+		return;
+
+	Matrix4x4 view, projection;
+	materials->GetMatrix(MATRIXMODE_VIEW, view);
+	materials->GetMatrix(MATRIXMODE_PROJECTION, projection);
+
+	for(int i = 0; i < m_numActiveBatches; i++)
+	{
+		eqTextBatch_t* batch = m_textBatches[i];
+
+		eqFontStyleParam_t params;
+		params.styleFlag = batch->styleFlag;
+		params.shadowOffset = batch->shadowOffset;
+		params.shadowWidth = batch->shadowWidth;
+		params.shadowAlpha = batch->shadowAlpha;
+
+		materials->SetMatrix(MATRIXMODE_VIEW, batch->view);
+		materials->SetMatrix(MATRIXMODE_PROJECTION, batch->projection);
+
+		batch->font->RenderQuads(batch->quads.ptr(), batch->quads.numElem(), params);
+		batch->quads.setNum(0, false);
+	}
+
+	m_numActiveBatches = 0;
+
+	materials->SetMatrix(MATRIXMODE_VIEW, view);
+	materials->SetMatrix(MATRIXMODE_PROJECTION, projection);
+}
+
+void CEqFontCache::PrintBatchStats()
+{
+	Msg("Text batching, last batch: %d texts in %d draws (%d without batching)\n",
+		m_lastBatchStats.textCalls, m_lastBatchStats.draws, m_lastBatchStats.unbatchedDraws);
+
+	Msg("Text batching, total: %d texts in %d draws (%d without batching)\n",
+		m_totalStats.textCalls, m_totalStats.draws, m_totalStats.unbatchedDraws);
+}
+
+//---------------------------------------------------------------------
+
 IEqFont* eqFontFamily_t::FindBestSize( int bestSize, int styleFlags )
 {
 	eqFontStyleInfo_t* bestSizeStyleInfo = nullptr;
@@ -9,6 +9,7 @@
 #define FONTCACHE_H
 
 #include "font/IFontCache.h"
+#include "Font.h"
 
 class IMatVar;
 class IMaterial;
@@ -35,6 +36,29 @@ struct eqFontStyleInfo_t
 };
 }
 
+// glyph quads of the same font and style
+struct eqTextBatch_t
+{
+	CFont*					font;
+
+	int						styleFlag;		// only TEXT_STYLE_SHADOW is used
+	float					shadowOffset;
+	float					shadowWidth;
+	float					shadowAlpha;
+
+	Matrix4x4				view;			// transform at the time text was queued
+	Matrix4x4				projection;
+
+	DkList<eqTextQuad_t>	quads;
+};
+
+struct eqTextBatchStats_t
+{
+	int		textCalls;
+	int		draws;
+	int		unbatchedDraws;		// draws it would take to render each text separately
+};
+
 struct eqFontFamily_t
 {
 	EqString										name;		// TODO: use string hashes
@@ -64,8 +88,22 @@ public:
 	IEqFont*				GetFont(const char* name, int bestSize, int styleFlags = TEXT_STYLE_REGULAR, bool defaultIfNotFound = true) const;
 	eqFontFamily_t*			GetFamily(const char* name) const;
 
+	// text batching
+	void					BeginTextBatch();
+	void					EndTextBatch();
+
+	void					PrintBatchStats();
+
 protected:
 
+	// returns batch for text or NULL if batching is not active or text can't be batched
+	eqTextBatch_t*			GetTextBatch(CFont* font, const eqFontStyleParam_t& params);
+
+	void					FlushTextBatches();
+
+	// statistics of current batch or total if not batching
+	eqTextBatchStats_t&		GetBatchStats() { return m_batchDepth > 0 ? m_batchStats : m_totalStats; }
+
 	bool					LoadFontDescriptionFile( const char* filename );
 
 	DkList<eqFontFamily_t*>	m_fonts;
@@ -73,6 +111,16 @@ protected:
 
 	IMaterial*				m_sdfMaterial;
 	IMatVar*				m_sdfRange;
+
+	DkList<eqTextBatch_t*>	m_textBatches;			// batches are kept between frames for their quad storage
+	int						m_numActiveBatches;
+	int						m_batchDepth;
+
+	DkList<eqTextQuad_t>	m_immediateQuads;
+
+	eqTextBatchStats_t		m_batchStats;
+	eqTextBatchStats_t		m_lastBatchStats;
+	eqTextBatchStats_t		m_totalStats;
 };
 
 #endif // FONTCACHE_H
\ No newline at end of file
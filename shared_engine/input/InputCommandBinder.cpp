@@ -179,6 +179,7 @@ void CInputCommandBinder::InitTouchZones()
 
 		newZone.commandString = KV_GetValueString(zoneCmd, 0, "zone_no_bind");
 		newZone.argumentString = KV_GetValueString(zoneCmd, 1, "");
+		xstrsplit( newZone.argumentString.GetData(), " ", newZone.argumentList);
 
 		newZone.position = KV_GetVector2D(zoneDef->FindKeyBase("position"));
 		newZone.size = KV_GetVector2D(zoneDef->FindKeyBase("size"));
@@ -201,6 +202,7 @@ void CInputCommandBinder::InitTouchZones()
 		// if anly command found
 		if(newZone.cmd_act || newZone.cmd_deact)
 		{
+			CompileBoundCommand(&newZone);
 			m_touchZones.append( newZone );
 		}
 		else
@@ -283,7 +285,10 @@ in_binding_t* CInputCommandBinder::AddBinding( const char* pszKeyStr, const char
 	newBind->commandString = pszCommand;
 
 	if(pszArgs)
+	{
 		newBind->argumentString = pszArgs;
+		xstrsplit( newBind->argumentString.GetData(), " ", newBind->argumentList);
+	}
 
 	m_bindings.append( newBind );
 
@@ -314,7 +319,8 @@ bool CInputCommandBinder::ResolveCommandBinding(in_binding_t* binding)
 	if(	binding->cmd_act || binding->cmd_deact ||
 		binding->boundAction)
 	{
-
+		if(!binding->boundAction)
+			CompileBoundCommand(binding);
 	}
 	else
 	{
@@ -686,10 +692,6 @@ void CInputCommandBinder::ExecuteTouchZone( in_touchzone_t* zone, bool bState )
 template <typename T>
 void CInputCommandBinder::ExecuteBoundCommands(T* zone, bool bState)
 {
-	DkList<EqString> args;
-
-	xstrsplit( zone->argumentString.GetData(), " ", args);
-
 	ConCommand *cmd = bState ? zone->cmd_act : zone->cmd_deact;
 
 	// dispatch command
@@ -698,10 +700,37 @@ void CInputCommandBinder::ExecuteBoundCommands(T* zone, bool bState)
 		if(in_keys_debug.GetBool())
 			MsgWarning("dispatch %s\n", cmd->GetName());
 
+		if(zone->compiled.commands.numElem())
+		{
+			g_consoleCommands->ExecuteCompiledCommands(zone->compiled);
+			return;
+		}
+
+		// command may modify arguments
+		DkList<EqString> args;
+		args.append(zone->argumentList);
+
 		cmd->DispatchFunc( args );
 	}
 }
 
+// plain commands are executed like typed in console, so they could be 'exec' or have quoted arguments
+template <typename T>
+void CInputCommandBinder::CompileBoundCommand(T* zone)
+{
+	zone->compiled.commands.clear();
+
+	if(!zone->cmd_act || zone->cmd_deact)
+		return;
+
+	EqString cmdStr(zone->commandString);
+
+	if(zone->argumentString.Length())
+		cmdStr.Append(varargs(" %s", zone->argumentString.ToCString()));
+
+	g_consoleCommands->CompileCommandBuffer(cmdStr.ToCString(), zone->compiled);
+}
+
 #ifndef DLL_EXPORT
 
 void con_key_list(const ConCommandBase* base, DkList<EqString>& list, const char* query)
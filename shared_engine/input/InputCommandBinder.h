@@ -11,6 +11,7 @@
 
 
 #include "core/ConCommand.h"
+#include "core/IConsoleCommands.h"
 
 #include "utils/DkList.h"
 
@@ -38,8 +39,11 @@ public:
 		boundAction = nullptr;
 	}
 
-	EqString		argumentString;
-	EqString		commandString;	// safe for writing
+	EqString			argumentString;
+	DkList<EqString>	argumentList;	// split argumentString
+	EqString			commandString;	// safe for writing
+
+	compiledCmdBuffer_t	compiled;		// command without 'plus' and 'minus' variants, with arguments
 
 	ConCommand*		cmd_act;	// 'plus' command
 	ConCommand*		cmd_deact;	// 'minus' command
@@ -66,8 +70,11 @@ struct in_touchzone_t
 
 	EqString	name;
 
-	EqString	argumentString;
-	EqString	commandString;	// safe for writing
+	EqString			argumentString;
+	DkList<EqString>	argumentList;	// split argumentString
+	EqString			commandString;	// safe for writing
+
+	compiledCmdBuffer_t	compiled;		// command without 'plus' and 'minus' variants, with arguments
 
 	int			finger;
 };
@@ -142,6 +149,9 @@ public:
 	template <typename T>
 	void					ExecuteBoundCommands(T* zone, bool bState);
 
+	template <typename T>
+	void					CompileBoundCommand(T* zone);
+
 	bool					CheckModifiersAndDepress(in_binding_t* binding, int keyIdent, bool bPressed);
 
 protected:
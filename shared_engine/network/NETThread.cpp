@@ -8,6 +8,7 @@
 #include "NETThread.h"
 
 #include "core/ConVar.h"
+#include "core/IEqProfiler.h"
 #include "utils/strtools.h"
 #include "utils/global_mutex.h"
 #include "math/Random.h"
@@ -479,6 +480,8 @@ int CNetworkThread::UpdateDispatchEvents()
 
 int CNetworkThread::DispatchEvents()
 {
+	PROF_EVENT("Network DispatchEvents");
+
 	int numPendingMessages = 0;
 
 	// Try to send our events/datas
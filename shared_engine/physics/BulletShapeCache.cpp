@@ -15,8 +15,6 @@
 #include "core/ConVar.h"
 #include "core/DebugInterface.h"
 
-#include "utils/global_mutex.h"
-
 using namespace EqBulletUtils;
 using namespace Threading;
 
@@ -80,7 +78,7 @@ btCollisionShape* InternalGenerateShape(int numVertices, Vector3D* vertices, int
 	return NULL;
 }
 
-CBulletStudioShapeCache::CBulletStudioShapeCache() : m_mutex(GetGlobalMutex(MUTEXPURPOSE_PHYSICS))
+CBulletStudioShapeCache::CBulletStudioShapeCache()
 {
 
 }
@@ -88,7 +86,7 @@ CBulletStudioShapeCache::CBulletStudioShapeCache() : m_mutex(GetGlobalMutex(MUTE
 // checks the shape is initialized for the cache
 bool CBulletStudioShapeCache::IsShapeCachePresent( studioPhysShapeCache_t* shapeInfo )
 {
-	CScopedMutex m( m_mutex );
+	CScopedReadLock m( m_shapeLock );
 
 	for(int i = 0; i < m_collisionShapes.numElem(); i++)
 	{
@@ -119,9 +117,9 @@ void CBulletStudioShapeCache::InitStudioCache( studioPhysData_t* studioData )
 			// cast physics POD index to index in physics engine
 			studioData->objects[i].shapeCache[j] = shape;
 
-			m_mutex.Lock();
+			m_shapeLock.LockWrite();
 			m_collisionShapes.append(shape);
-			m_mutex.Unlock();
+			m_shapeLock.UnlockWrite();
 
 			studioData->shapes[nShape].cachedata = shape;
 		}
@@ -130,6 +128,8 @@ void CBulletStudioShapeCache::InitStudioCache( studioPhysData_t* studioData )
 
 void CBulletStudioShapeCache::DestroyStudioCache( studioPhysData_t* studioData )
 {
+	CScopedWriteLock m( m_shapeLock );
+
 	for(int i = 0; i < studioData->numShapes; i++)
 	{
 		int nShape = m_collisionShapes.findIndex((btCollisionShape*)studioData->shapes[i].cachedata);
@@ -142,16 +142,15 @@ void CBulletStudioShapeCache::DestroyStudioCache( studioPhysData_t* studioData )
 		}
 
 		delete m_collisionShapes[nShape];
-
-		m_mutex.Lock();
 		m_collisionShapes.fastRemoveIndex( nShape );
-		m_mutex.Unlock();
 	}
 }
 
 // does all shape cleanup
 void CBulletStudioShapeCache::Cleanup_Invalidate()
 {
+	CScopedWriteLock m( m_shapeLock );
+
 	for(int i = 0; i < m_collisionShapes.numElem(); i++)
 	{
 		if( m_collisionShapes[i]->getUserPointer() )
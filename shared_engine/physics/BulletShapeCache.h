@@ -32,7 +32,7 @@ public:
 
 protected:
 
-	Threading::CEqMutex&		m_mutex;
+	Threading::CEqReadWriteLock	m_shapeLock;
 
 	// cached shapes
 	DkList<btCollisionShape*>	m_collisionShapes;
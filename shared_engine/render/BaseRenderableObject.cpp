@@ -6,6 +6,7 @@
 //////////////////////////////////////////////////////////////////////////////////
 
 #include "BaseRenderableObject.h"
+#include "RenderList.h"
 
 /*
 // returns world transformation of this object
@@ -14,6 +15,19 @@ Matrix4x4 CBaseRenderableObject::GetRenderWorldTransform()
 	return identity4();
 }*/
 
+// renders the part of object added to the render queue
+void CBaseRenderableObject::RenderQueueItem(const renderQueueItem_t& item, int nViewRenderFlags, void* userdata)
+{
+	Render(nViewRenderFlags, userdata);
+}
+
+// renders the render queue items gathered for instancing
+void CBaseRenderableObject::RenderQueueInstances(const renderQueueItem_t* items, int numItems, int nViewRenderFlags, void* userdata)
+{
+	for(int i = 0; i < numItems; i++)
+		items[i].object->RenderQueueItem(items[i], nViewRenderFlags, userdata);
+}
+
 // adds a render flags
 void CBaseRenderableObject::SetRenderFlags(int nFlags)
 {
@@ -30,6 +30,8 @@ enum RenderableFlags_e
 	RF_SKIPVISIBILITYTEST	= (1 << 4),		// skips visibility test, and means that it's visible.
 };
 
+struct renderQueueItem_t;
+
 // renderable object
 class CBaseRenderableObject
 {
@@ -49,6 +51,13 @@ public:
 	// renders this object with current transformations
 	virtual void			Render(int nViewRenderFlags, void* userdata) = 0;
 
+	// renders the part of object added to the render queue. Renders whole object by default
+	virtual void			RenderQueueItem(const renderQueueItem_t& item, int nViewRenderFlags, void* userdata);
+
+	// renders the render queue items gathered for instancing, called on the first item object.
+	// Items have the same instance key, material and user parameter. Renders them one by one by default
+	virtual void			RenderQueueInstances(const renderQueueItem_t* items, int numItems, int nViewRenderFlags, void* userdata);
+
 	// min bbox dimensions
 	virtual void			GetBoundingBox(BoundingBox& outBox) = 0;
 
@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Batch frustum culling of big object sets on job threads
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "BatchCulling.h"
+
+#include "core/DebugInterface.h"
+#include "core/ppmem.h"
+#include "core/ConVar.h"
+#include "core/ConCommand.h"
+#include "core/IEqProfiler.h"
+#include "core/IEqParallelJobs.h"
+
+#include "math/DkMath.h"
+#include "math/Random.h"
+#include "utils/eqtimer.h"
+
+using namespace Threading;
+
+ConVar r_parallelCulling("r_parallelCulling", "1", "Test big object sets against frustum on job threads");
+
+// Shared by the calling thread and culling jobs
+struct batchCullWork_t : public CEqParallelWork
+{
+	Volume					volume;
+	volumeBoxesSoA_t		boxes;
+	volumeSpheresSoA_t		spheres;
+	uint*					visibleMask;
+	float					eps;
+
+	int						numItems;
+	bool					isSpheres;
+
+	void ProcessChunk(int chunk, int first, int count)
+	{
+		if(isSpheres)
+			volume.TestSpheres(spheres, first, count, visibleMask);
+		else
+			volume.TestBoxes(boxes, first, count, visibleMask, eps);
+	}
+};
+
+static void BatchCull_Run(batchCullWork_t* work)
+{
+	bool parallel = r_parallelCulling.GetBool() && work->numItems >= BATCHCULL_MIN_PARALLEL;
+
+	work->Run(work->numItems, BATCHCULL_CHUNK_SIZE, JOB_TYPE_ANY, parallel);
+}
+
+void BatchCull_Boxes(const Volume& volume, const volumeBoxesSoA_t& boxes, uint* visibleMask, float eps)
+{
+	PROF_EVENT("BatchCull_Boxes");
+
+	batchCullWork_t* work = new batchCullWork_t;
+	work->volume = volume;
+	work->boxes = boxes;
+	work->visibleMask = visibleMask;
+	work->eps = eps;
+	work->numItems = boxes.numBoxes;
+	work->isSpheres = false;
+
+	BatchCull_Run(work);
+}
+
+void BatchCull_Spheres(const Volume& volume, const volumeSpheresSoA_t& spheres, uint* visibleMask)
+{
+	PROF_EVENT("BatchCull_Spheres");
+
+	batchCullWork_t* work = new batchCullWork_t;
+	work->volume = volume;
+	work->spheres = spheres;
+	work->visibleMask = visibleMask;
+	work->eps = 0.0f;
+	work->numItems = spheres.numSpheres;
+	work->isSpheres = true;
+
+	BatchCull_Run(work);
+}
+
+//-------------------------------------------------------------------------
+// benchmark against the scalar Volume path
+//-------------------------------------------------------------------------
+
+DECLARE_CMD(r_cullBenchmark, "Compares batch and scalar frustum culling. Arguments: [number of boxes] [repeats]", 0)
+{
+	int numBoxes = 65536;
+	int numRepeats = 50;
+
+	if(CMD_ARGC > 0)
+		numBoxes = max(atoi(CMD_ARGV(0).ToCString()), 1);
+
+	if(CMD_ARGC > 1)
+		numRepeats = max(atoi(CMD_ARGV(1).ToCString()), 1);
+
+	Volume frustum;
+	frustum.LoadAsFrustum(perspectiveMatrixY(DEG2RAD(70.0f), 1280, 720, 1.0f, 1000.0f) * rotateXY4(DEG2RAD(15.0f), DEG2RAD(30.0f)));
+
+	float* coords = (float*)PPAlloc(numBoxes * 6 * sizeof(float));
+	uint* visibleMask = (uint*)PPAlloc(VOLUME_VISIBLE_MASK_WORDS(numBoxes) * sizeof(uint));
+
+	volumeBoxesSoA_t boxes;
+	boxes.minX = coords;
+	boxes.minY = coords + numBoxes;
+	boxes.minZ = coords + numBoxes*2;
+	boxes.maxX = coords + numBoxes*3;
+	boxes.maxY = coords + numBoxes*4;
+	boxes.maxZ = coords + numBoxes*5;
+	boxes.numBoxes = numBoxes;
+
+	for(int i = 0; i < numBoxes; i++)
+	{
+		Vector3D center(RandomFloat(-1000.0f, 1000.0f), RandomFloat(-1000.0f, 1000.0f), RandomFloat(-1000.0f, 1000.0f));
+		float size = RandomFloat(0.5f, 20.0f);
+
+		coords[i]				= center.x - size;
+		coords[numBoxes + i]	= center.y - size;
+		coords[numBoxes*2 + i]	= center.z - size;
+		coords[numBoxes*3 + i]	= center.x + size;
+		coords[numBoxes*4 + i]	= center.y + size;
+		coords[numBoxes*5 + i]	= center.z + size;
+	}
+
+	CEqTimer timer;
+	int numVisibleScalar = 0;
+
+	timer.GetTime(true);
+	for(int r = 0; r < numRepeats; r++)
+	{
+		numVisibleScalar = 0;
+
+		for(int i = 0; i < numBoxes; i++)
+		{
+			if(frustum.IsBoxInside(boxes.minX[i], boxes.maxX[i], boxes.minY[i], boxes.maxY[i], boxes.minZ[i], boxes.maxZ[i]))
+				numVisibleScalar++;
+		}
+	}
+	double scalarTime = timer.GetTime(true);
+
+	for(int r = 0; r < numRepeats; r++)
+		frustum.TestBoxes(boxes, 0, numBoxes, visibleMask);
+
+	double batchTime = timer.GetTime(true);
+
+	for(int r = 0; r < numRepeats; r++)
+		BatchCull_Boxes(frustum, boxes, visibleMask);
+
+	double parallelTime = timer.GetTime(true);
+
+	int* indices = (int*)PPAlloc(numBoxes * sizeof(int));
+	int numVisibleBatch = Volume::GetVisibleIndices(visibleMask, 0, numBoxes, indices);
+
+	MsgInfo("Culling %d boxes, %d visible (scalar %d):\n", numBoxes, numVisibleBatch, numVisibleScalar);
+	MsgInfo("  scalar:   %.3f ms\n", scalarTime * 1000.0 / numRepeats);
+	MsgInfo("  batch:    %.3f ms\n", batchTime * 1000.0 / numRepeats);
+	MsgInfo("  parallel: %.3f ms (%d job threads)\n", parallelTime * 1000.0 / numRepeats, g_parallelJobs->GetJobThreadsCount());
+
+	if(numVisibleBatch != numVisibleScalar)
+		MsgWarning("Batch culling result differs from scalar!\n");
+
+	PPFree(indices);
+	PPFree(visibleMask);
+	PPFree(coords);
+}
@@ -0,0 +1,23 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Batch frustum culling of big object sets on job threads
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BATCHCULLING_H
+#define BATCHCULLING_H
+
+#include "math/Volume.h"
+
+#define BATCHCULL_CHUNK_SIZE		1024	// items tested by job at once, multiple of 32
+#define BATCHCULL_MIN_PARALLEL		4096	// less items are tested on the calling thread
+
+//
+// Tests items against the volume, splitting them between job threads and calling thread.
+// visibleMask must have VOLUME_VISIBLE_MASK_WORDS(count) words. Returns when all items are tested
+//
+void	BatchCull_Boxes(const Volume& volume, const volumeBoxesSoA_t& boxes, uint* visibleMask, float eps = 0.0f);
+void	BatchCull_Spheres(const Volume& volume, const volumeSpheresSoA_t& spheres, uint* visibleMask);
+
+#endif // BATCHCULLING_H
@@ -836,6 +836,9 @@ void CDebugOverlay::Draw(int winWide, int winTall)
 	// now rendering 2D stuff
 	materials->Setup2D(winWide, winTall);
 
+	// text goes on top of 2D stuff
+	g_fontCache->BeginTextBatch();
+
 #ifdef EDITOR
 	const Vector2D drawFadedTextBoxPosition = Vector2D(5,5);
 	const Vector2D drawTextBoxPosition = Vector2D(5,5);
@@ -959,6 +962,8 @@ void CDebugOverlay::Draw(int winWide, int winTall)
 		m_graphbuckets.clear();
 	}
 
+	g_fontCache->EndTextBatch();
+
 	CleanOverlays();
 
 	// more universal thing
@@ -10,11 +10,31 @@
 
 #include "egf/IEqModel.h"
 #include "materialsystem1/IMaterialSystem.h"
+#include "utils/DkList.h"
 
-#define MAX_EGF_INSTANCES			256
+#include "RenderList.h"
+
+#define MAX_EGF_INSTANCES			256		// initial size of instance buffer
+#define MAX_EGF_INSTANCE_BUFFER		4096	// instance buffer grows up to this size. Bigger buckets are drawn in chunks
 #define MAX_INSTANCE_BODYGROUPS		16		// only 4 groups can be instanced
 #define MAX_INSTANCE_LODS			4		// only 4 lods can be instanced
 
+// render queue item user parameter for automatic instancing
+#define EGF_INSTANCE_PARAM(bodyGroup, lod, materialGroup)	(((materialGroup) << 16) | ((lod) << 8) | (bodyGroup))
+#define EGF_INSTANCE_PARAM_BODYGROUP(param)		((param) & 0xFF)
+#define EGF_INSTANCE_PARAM_LOD(param)			(((param) >> 8) & 0xFF)
+#define EGF_INSTANCE_PARAM_GROUP(param)			(((param) >> 16) & 0xFFFF)
+
+struct egfInstancerStats_t
+{
+	int		numInstances;
+	int		numDraws;				// instanced draw calls, one per chunk of each bucket
+	int		maxInstancesPerDraw;
+
+	void	Reset()						{memset(this, 0, sizeof(egfInstancerStats_t));}
+	float	GetInstancesPerDraw() const	{return numDraws ? (float)numInstances / (float)numDraws : 0.0f;}
+};
+
 //---------------------------------------------------------------------
 
 // for each bodygroup
@@ -38,13 +58,31 @@ public:
 
 	virtual void	Draw( int renderFlags, IEqModel* model );
 
+	// render queue instances. They are kept apart from the buckets filled by NewInstance
+	IT*				AllocQueueInstances( int numInstances );
+	void			DrawQueueInstances( IEqModel* model, int bodyGroup, int lod, int materialGroup, IMaterial* material );
+
+	const egfInstancerStats_t&	GetStats() const	{return m_stats;}
+	void						ResetStats()		{m_stats.Reset();}
+
 protected:
 
+	int				GetModelDescId( studiohdr_t* pHdr, int bodyGroup, int lod ) const;
+
+	// recreates own instance buffer to fit the instances, returns instances per draw
+	int				GrowInstanceBuffer( int numInst );
+
+	// draws instances by chunks of instance buffer. All groups of the model are drawn if materialGroup is -1
+	void			DrawInstances( IEqModel* model, int nModDescId, int materialGroup, IMaterial* material, const IT* instances, int numInst );
+
 	IVertexFormat*		m_vertFormat;
 	IVertexBuffer*		m_instanceBuf;
 
-	IT*					m_instances[MAX_INSTANCE_BODYGROUPS][MAX_INSTANCE_LODS];
-	ushort				m_numInstances[MAX_INSTANCE_BODYGROUPS][MAX_INSTANCE_LODS];
+	// buckets are only emptied after drawing, so the memory is reused next frames
+	DkList<IT>			m_instances[MAX_INSTANCE_BODYGROUPS][MAX_INSTANCE_LODS];
+	DkList<IT>			m_queueInstances;
+
+	egfInstancerStats_t	m_stats;
 
 	bool				m_hasInstances;
 	bool				m_preallocatedHWBuffer;
@@ -56,13 +94,18 @@ template <class IT>
 inline CEGFInstancer<IT>::CEGFInstancer() :
 	m_vertFormat(NULL),
 	m_instanceBuf(NULL),
+	m_hasInstances(false),
 	m_preallocatedHWBuffer(false)
 {
 	for(int i = 0; i < MAX_INSTANCE_BODYGROUPS; i++)
 	{
-		memset(m_numInstances[i], 0, sizeof(m_numInstances[i]));
-		memset(m_instances[i], 0, sizeof(m_instances[i]));
+		for(int j = 0; j < MAX_INSTANCE_LODS; j++)
+			m_instances[i][j].setGranularity(MAX_EGF_INSTANCES / 4);
 	}
+
+	m_queueInstances.setGranularity(MAX_EGF_INSTANCES / 4);
+
+	m_stats.Reset();
 }
 
 template <class IT>
@@ -86,12 +129,6 @@ inline void CEGFInstancer<IT>::Init( VertexFormatDesc_t* instVertexFormat, int n
 	m_instanceBuf = g_pShaderAPI->CreateVertexBuffer(BUFFER_DYNAMIC, MAX_EGF_INSTANCES, sizeof(IT));
 	m_instanceBuf->SetFlags( VERTBUFFER_FLAG_INSTANCEDATA );
 
-	for(int i = 0; i < MAX_INSTANCE_BODYGROUPS; i++)
-	{
-		memset(m_numInstances[i], 0, sizeof(m_numInstances[i]));
-		memset(m_instances[i], 0, sizeof(m_instances[i]));
-	}
-
 	m_hasInstances = false;
 }
 
@@ -105,12 +142,6 @@ inline void CEGFInstancer<IT>::Init( IVertexFormat* instVertexFormat, IVertexBuf
 	m_vertFormat = instVertexFormat;
 	m_instanceBuf = instBuffer;
 
-	for(int i = 0; i < MAX_INSTANCE_BODYGROUPS; i++)
-	{
-		memset(m_numInstances[i], 0, sizeof(m_numInstances[i]));
-		memset(m_instances[i], 0, sizeof(m_instances[i]));
-	}
-
 	m_hasInstances = false;
 }
 
@@ -132,13 +163,11 @@ inline void CEGFInstancer<IT>::Cleanup()
 	for(int i = 0; i < MAX_INSTANCE_BODYGROUPS; i++)
 	{
 		for(int j = 0; j < MAX_INSTANCE_LODS; j++)
-		{
-			delete [] m_instances[i][j];
-			m_instances[i][j] = NULL;
-			m_numInstances[i][j] = 0;
-		}
+			m_instances[i][j].clear();
 	}
 
+	m_queueInstances.clear();
+
 	m_hasInstances = false;
 	m_preallocatedHWBuffer = false;
 }
@@ -151,23 +180,17 @@ inline IT& CEGFInstancer<IT>::NewInstance( ubyte bodyGroup, int lod )
 	if(bodyGroup == 0xFF)
 		return dummy;
 
-	int numInst = m_numInstances[bodyGroup][lod];
-
-	if(numInst >= MAX_EGF_INSTANCES)
-		return dummy; // overflow
-
-	if(!m_instances[bodyGroup][lod])
-		m_instances[bodyGroup][lod] = new IT[MAX_EGF_INSTANCES];
+	ASSERT(bodyGroup < MAX_INSTANCE_BODYGROUPS && lod >= 0 && lod < MAX_INSTANCE_LODS);
 
 	m_hasInstances = true;
 
 	// assign instance
-	IT& theInst = m_instances[bodyGroup][lod][numInst];
+	DkList<IT>& bucket = m_instances[bodyGroup][lod];
 
-	numInst++;
-	m_numInstances[bodyGroup][lod] = numInst;
+	int numInst = bucket.numElem();
+	bucket.setNum(numInst+1, false);
 
-	return theInst;
+	return bucket[numInst];
 }
 
 template <class IT>
@@ -176,6 +199,105 @@ inline bool CEGFInstancer<IT>::HasInstances() const
 	return m_hasInstances;
 }
 
+template <class IT>
+inline int CEGFInstancer<IT>::GetModelDescId( studiohdr_t* pHdr, int bodyGroup, int lod ) const
+{
+	int nLodModelIdx = pHdr->pBodyGroups(bodyGroup)->lodModelIndex;
+	studiolodmodel_t* lodModel = pHdr->pLodModel(nLodModelIdx);
+
+	int nModDescId = lodModel->modelsIndexes[ lod ];
+
+	// get the right LOD model number
+	while(nModDescId == -1 && lod > 0)
+	{
+		lod--;
+		nModDescId = lodModel->modelsIndexes[ lod ];
+	}
+
+	return nModDescId;
+}
+
+template <class IT>
+inline int CEGFInstancer<IT>::GrowInstanceBuffer( int numInst )
+{
+	int bufferSize = m_instanceBuf->GetVertexCount();
+
+	// preallocated buffer is not owned by instancer
+	if(m_preallocatedHWBuffer || numInst <= bufferSize || bufferSize >= MAX_EGF_INSTANCE_BUFFER)
+		return bufferSize;
+
+	while(bufferSize < numInst && bufferSize < MAX_EGF_INSTANCE_BUFFER)
+		bufferSize *= 2;
+
+	bufferSize = min(bufferSize, MAX_EGF_INSTANCE_BUFFER);
+
+	g_pShaderAPI->Reset(STATE_RESET_VBO);
+	g_pShaderAPI->ApplyBuffers();
+
+	g_pShaderAPI->DestroyVertexBuffer(m_instanceBuf);
+
+	m_instanceBuf = g_pShaderAPI->CreateVertexBuffer(BUFFER_DYNAMIC, bufferSize, sizeof(IT));
+	m_instanceBuf->SetFlags( VERTBUFFER_FLAG_INSTANCEDATA );
+
+	// restore format dropped by the reset
+	g_pShaderAPI->SetVertexFormat(m_vertFormat);
+
+	return bufferSize;
+}
+
+template <class IT>
+inline void CEGFInstancer<IT>::DrawInstances( IEqModel* model, int nModDescId, int materialGroup, IMaterial* material, const IT* instances, int numInst )
+{
+	studiomodeldesc_t* modDesc = model->GetHWData()->studio->pModelDesc(nModDescId);
+
+	int firstGroup = 0;
+	int lastGroup = modDesc->numGroups;
+
+	if(materialGroup != -1)
+	{
+		if(materialGroup >= modDesc->numGroups)
+			return;
+
+		firstGroup = materialGroup;
+		lastGroup = materialGroup+1;
+	}
+
+	int maxChunkInst = GrowInstanceBuffer(numInst);
+	IVertexBuffer* instBuffer = m_instanceBuf;
+
+	// draw bucket by chunks if it doesn't fit instance buffer
+	for(int firstInst = 0; firstInst < numInst; firstInst += maxChunkInst)
+	{
+		int numChunkInst = min(numInst - firstInst, maxChunkInst);
+
+		// upload instance buffer
+		instBuffer->Update((void*)(instances + firstInst), numChunkInst, 0, true);
+
+		// render model groups that in this body group
+		for(int j = firstGroup; j < lastGroup; j++)
+		{
+			//materials->SetSkinningEnabled(true);
+
+			if(material)
+				materials->BindMaterial(material, 0);
+			else
+				materials->BindMaterial( model->GetMaterial(modDesc->pGroup(j)->materialIndex), 0);
+
+			//m_pModel->PrepareForSkinning( m_boneTransforms );
+			model->SetupVBOStream(0);
+			g_pShaderAPI->SetVertexBuffer(instBuffer, 2);
+
+			model->DrawGroup( nModDescId, j, false );
+
+			//materials->SetSkinningEnabled(false);
+		}
+
+		m_stats.numInstances += numChunkInst;
+		m_stats.numDraws++;
+		m_stats.maxInstancesPerDraw = max(m_stats.maxInstancesPerDraw, numChunkInst);
+	}
+}
+
 template <class IT>
 inline void CEGFInstancer<IT>::Draw( int renderFlags, IEqModel* model )
 {
@@ -191,64 +313,119 @@ inline void CEGFInstancer<IT>::Draw( int renderFlags, IEqModel* model )
 	// proceed to render
 	materials->SetInstancingEnabled(true);
 
-	IVertexBuffer* instBuffer = m_instanceBuf;
 	g_pShaderAPI->SetVertexFormat(m_vertFormat);
 
 	for(int lod = 0; lod < MAX_INSTANCE_LODS; lod++)
 	{
 		for(int i = 0; i < pHdr->numBodyGroups; i++)
 		{
-			int numInst = m_numInstances[i][lod];
+			DkList<IT>& bucket = m_instances[i][lod];
+			int numInst = bucket.numElem();
 
 			// don't do empty instances
 			if(numInst == 0)
 				continue;
 
-			m_numInstances[i][lod] = 0;
-
-			int bodyGroupLOD = lod;
-			int nLodModelIdx = pHdr->pBodyGroups(i)->lodModelIndex;
-			studiolodmodel_t* lodModel = pHdr->pLodModel(nLodModelIdx);
+			// keep memory for the next frame
+			bucket.setNum(0, false);
 
-			int nModDescId = lodModel->modelsIndexes[ bodyGroupLOD ];
-
-			// get the right LOD model number
-			while(nModDescId == -1 && bodyGroupLOD > 0)
-			{
-				bodyGroupLOD--;
-				nModDescId = lodModel->modelsIndexes[ bodyGroupLOD ];
-			}
+			int nModDescId = GetModelDescId(pHdr, i, lod);
 
 			if(nModDescId == -1)
 				continue;
-	
-			studiomodeldesc_t* modDesc = pHdr->pModelDesc(nModDescId);
 
-			// upload instance buffer
-			instBuffer->Update(m_instances[i][lod], numInst, 0, true);
+			DrawInstances(model, nModDescId, -1, NULL, bucket.ptr(), numInst);
+		}
+	}
+
+	g_pShaderAPI->SetVertexBuffer(NULL, 2);
+	materials->SetInstancingEnabled(false);
+	m_hasInstances = false;
+}
+
+template <class IT>
+inline IT* CEGFInstancer<IT>::AllocQueueInstances( int numInstances )
+{
+	m_queueInstances.setNum(numInstances, false);
+	return m_queueInstances.ptr();
+}
 
-			// render model groups that in this body group
-			for(int j = 0; j < modDesc->numGroups; j++)
-			{
-				//materials->SetSkinningEnabled(true);
+template <class IT>
+inline void CEGFInstancer<IT>::DrawQueueInstances( IEqModel* model, int bodyGroup, int lod, int materialGroup, IMaterial* material )
+{
+	int numInst = m_queueInstances.numElem();
+
+	if(!model || numInst == 0)
+		return;
 
-				int materialIndex = modDesc->pGroup(j)->materialIndex;
-				materials->BindMaterial( model->GetMaterial(materialIndex), 0);
+	studiohdr_t* pHdr = model->GetHWData()->studio;
 
-				//m_pModel->PrepareForSkinning( m_boneTransforms );
-				model->SetupVBOStream(0);
-				g_pShaderAPI->SetVertexBuffer(instBuffer, 2);
+	if(bodyGroup >= pHdr->numBodyGroups || lod >= MAX_INSTANCE_LODS)
+		return;
 
-				model->DrawGroup( nModDescId, j, false );
+	int nModDescId = GetModelDescId(pHdr, bodyGroup, lod);
 
-				//materials->SetSkinningEnabled(false);
-			}
-		}
-	}
+	if(nModDescId == -1)
+		return;
+
+	materials->SetMatrix(MATRIXMODE_WORLD, identity4());
+	materials->SetInstancingEnabled(true);
+
+	g_pShaderAPI->SetVertexFormat(m_vertFormat);
+
+	DrawInstances(model, nModDescId, materialGroup, material, m_queueInstances.ptr(), numInst);
 
 	g_pShaderAPI->SetVertexBuffer(NULL, 2);
 	materials->SetInstancingEnabled(false);
-	m_hasInstances = false;
+
+	// keep memory for the next draw
+	m_queueInstances.setNum(0, false);
+}
+
+//---------------------------------------------------------------------
+// Renderable drawn by automatic instancing of the render queue.
+//
+// Add it's draw items with model as instance key and EGF_INSTANCE_PARAM(bodyGroup, lod, materialGroup)
+// as user parameter. Render queue gathers items of the same model, bodygroup, LOD, group and material
+// and they are drawn with model's instancer (see IEqModel::SetInstancer) which must be CEGFInstancer<IT>.
+// All renderables with the same model must be of the same instance type.
+//---------------------------------------------------------------------
+
+template <class IT>
+class CEGFInstancedRenderable : public CBaseRenderableObject
+{
+public:
+	// fills instance data of this object, e.g. transformation
+	virtual void	FillInstance(IT& instance) = 0;
+
+	void			RenderQueueInstances(const renderQueueItem_t* items, int numItems, int nViewRenderFlags, void* userdata);
+};
+
+template <class IT>
+inline void CEGFInstancedRenderable<IT>::RenderQueueInstances(const renderQueueItem_t* items, int numItems, int nViewRenderFlags, void* userdata)
+{
+	IEqModel* model = (IEqModel*)items[0].instanceKey;
+	CEGFInstancer<IT>* instancer = (CEGFInstancer<IT>*)model->GetInstancer();
+
+	if(!instancer)
+	{
+		CBaseRenderableObject::RenderQueueInstances(items, numItems, nViewRenderFlags, userdata);
+		return;
+	}
+
+	int bodyGroup = EGF_INSTANCE_PARAM_BODYGROUP(items[0].userParam);
+	int lod = EGF_INSTANCE_PARAM_LOD(items[0].userParam);
+	int materialGroup = EGF_INSTANCE_PARAM_GROUP(items[0].userParam);
+
+	IT* instances = instancer->AllocQueueInstances(numItems);
+
+	for(int i = 0; i < numItems; i++)
+	{
+		CEGFInstancedRenderable<IT>* renderable = (CEGFInstancedRenderable<IT>*)items[i].object;
+		renderable->FillInstance( instances[i] );
+	}
+
+	instancer->DrawQueueInstances(model, bodyGroup, lod, materialGroup, items[0].material);
 }
 
 #endif // EGFINSTANCER_H
@@ -10,28 +10,48 @@
 #include "core/DebugInterface.h"
 #include "core/ConVar.h"
 #include "core/IEqParallelJobs.h"
+#include "core/IEqProfiler.h"
 
 #include "utils/global_mutex.h"
 
 #include "render/IDebugOverlay.h"
 
+#include "SpriteBuilder.h"
+
+using namespace Threading;
+
 
 
 #pragma todo("non-indexed material group - use CPFXRenderGroup")
 
 ConVar r_sorteffects("r_sorteffects", "1", "Sorts effects. If you disable it, effects will not be sorted.", CV_ARCHIVE);
+ConVar r_parallelEffects("r_parallelEffects", "1", "Draw effects on particle job threads");
 
-
-int _SortParticles(IEffect* const &elem0, IEffect* const &elem1)
+// Shared by the calling thread and effect jobs
+struct effectDrawWork_t : public CEqParallelWork
 {
-	if(!elem0 || !elem1)
-		return 0;
+	IEffect**				effects;
+	bool*					alive;
+	float					dt;
 
-	IEffect* pEffect0 = elem0;
-	IEffect* pEffect1 = elem1;
+	void ProcessChunk(int chunk, int first, int count)
+	{
+		// geometry of chunks is put back in order before rendering
+		bool ordered = GetNumJobs() > 0;
 
-	return pEffect1->GetDistanceToCamera() > pEffect0->GetDistanceToCamera();
-}
+		if(ordered)
+			SpriteBuilder_SetEmitOrder(chunk);
+
+		for(int i = first; i < first+count; i++)
+		{
+			IEffect* effect = effects[i];
+			alive[i] = effect && effect->DrawEffect(dt);
+		}
+
+		if(ordered)
+			SpriteBuilder_SetEmitOrder(-1);
+	}
+};
 
 IEffect::IEffect() :	m_vOrigin(0.0f),
 						m_fStartLifeTime(0),
@@ -49,10 +69,12 @@ void IEffect::SetSortOrigin(const Vector3D &origin)
 
 //-------------------------------------------------------------------------------------
 
-CEffectRenderer::CEffectRenderer()
+CEffectRenderer::CEffectRenderer() : m_drawCompleted(true), m_drawInProgress(false)
 {
 	m_numEffects.SetValue(0);
 	memset(m_pEffectList, 0, sizeof(m_pEffectList));
+
+	m_drawCompleted.Raise();
 }
 
 void CEffectRenderer::RegisterEffectForRender(IEffect* pEffect)
@@ -76,30 +98,109 @@ void CEffectRenderer::RegisterEffectForRender(IEffect* pEffect)
 	m_numEffects.Increment();
 }
 
-void CEffectRenderer::DrawEffects(float dt)
+// LSD radix sort on distance bits. Distances are positive so their bits are ordered like integers
+void CEffectRenderer::SortEffects(int numEffects)
 {
-	Threading::CEqMutex& mutex = GetGlobalMutex(MUTEXPURPOSE_PARTICLES);
-	Threading::CScopedMutex m(mutex);
+	uint* keys = m_sortKeys[0];
+	uint* tempKeys = m_sortKeys[1];
+	IEffect** effects = m_pEffectList;
+	IEffect** tempEffects = m_sortEffects;
 
-	// sort particles
-	if(r_sorteffects.GetBool())
-		shellSort<IEffect*>(m_pEffectList, m_numEffects.GetValue(), _SortParticles);
+	for(int i = 0; i < numEffects; i++)
+	{
+		float dist = effects[i] ? effects[i]->GetDistanceToCamera() : 0.0f;
 
-	for(int i = 0; i < m_numEffects.GetValue(); i++)
+		// inverted to get far ones first
+		keys[i] = ~(*(uint*)&dist);
+	}
+
+	for(int shift = 0; shift < 32; shift += 8)
 	{
-        if(!m_pEffectList[i])
-        {
-			RemoveEffect(i);
-			i--;
+		int offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+
+		for(int i = 0; i < numEffects; i++)
+			offsets[(keys[i] >> shift) & 255]++;
+
+		// all keys have same byte
+		if(offsets[(keys[0] >> shift) & 255] == numEffects)
 			continue;
-        }
 
-		if(!m_pEffectList[i]->DrawEffect(dt))
+		int offset = 0;
+		for(int i = 0; i < 256; i++)
 		{
-			RemoveEffect(i);
-			i--;
+			int count = offsets[i];
+			offsets[i] = offset;
+			offset += count;
+		}
+
+		for(int i = 0; i < numEffects; i++)
+		{
+			int dest = offsets[(keys[i] >> shift) & 255]++;
+
+			tempKeys[dest] = keys[i];
+			tempEffects[dest] = effects[i];
 		}
+
+		QuickSwap(keys, tempKeys);
+		QuickSwap(effects, tempEffects);
 	}
+
+	if(effects != m_pEffectList)
+		memcpy(m_pEffectList, effects, numEffects*sizeof(IEffect*));
+}
+
+void CEffectRenderer::DrawEffects(float dt)
+{
+	PROF_EVENT("DrawEffects");
+
+	CEqMutex& mutex = GetGlobalMutex(MUTEXPURPOSE_PARTICLES);
+
+	// effects registered while drawing are left for the next frame
+	int numEffects;
+	{
+		CScopedMutex m(mutex);
+
+		if(m_drawInProgress)
+			return;
+
+		numEffects = m_numEffects.GetValue();
+
+		if(!numEffects)
+			return;
+
+		if(r_sorteffects.GetBool())
+			SortEffects(numEffects);
+
+		memcpy(m_drawEffects, m_pEffectList, numEffects*sizeof(IEffect*));
+
+		m_drawInProgress = true;
+		m_drawCompleted.Clear();
+	}
+
+	// effects are drawn without lock, render groups are allocating geometry lock-free
+	effectDrawWork_t* work = new effectDrawWork_t;
+	work->effects = m_drawEffects;
+	work->alive = m_effectAlive;
+	work->dt = dt;
+
+	// calling thread draws too
+	bool parallel = r_parallelEffects.GetBool() && numEffects >= EFFECTS_MIN_PARALLEL;
+
+	work->Run(numEffects, EFFECTS_JOB_CHUNK_SIZE, JOB_TYPE_PARTICLES, parallel);
+
+	CScopedMutex m(mutex);
+
+	// removed from the end, so entries before it are not moved.
+	// Effects registered while drawing are after the drawn ones
+	for(int i = numEffects-1; i >= 0; i--)
+	{
+		if(!m_effectAlive[i] && m_pEffectList[i] == m_drawEffects[i])
+			RemoveEffect(i);
+	}
+
+	m_drawInProgress = false;
+	m_drawCompleted.Raise();
 }
 
 void CEffectRenderer::RemoveAllEffects()
@@ -107,6 +208,14 @@ void CEffectRenderer::RemoveAllEffects()
 	Threading::CEqMutex& mutex = GetGlobalMutex(MUTEXPURPOSE_PARTICLES);
 	Threading::CScopedMutex m(mutex);
 
+	// effects can't be destroyed while they are drawn
+	while(m_drawInProgress)
+	{
+		mutex.Unlock();
+		m_drawCompleted.Wait();
+		mutex.Lock();
+	}
+
 	for(int i = 0; i < m_numEffects.GetValue(); i++)
 	{
 		m_pEffectList[i]->DestroyEffect();
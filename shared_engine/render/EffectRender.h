@@ -30,6 +30,8 @@ public:
 	virtual void	DestroyEffect() {};
 
 	// Draws effect. required for overriding
+	// Called from particle job threads, so it must only touch the effect itself
+	// and allocate geometry from render groups
 	virtual bool	DrawEffect(float dTime) = 0;
 
 	float			GetLifetime() const			{return m_fLifeTime;}
@@ -73,6 +75,9 @@ protected:
 
 #define MAX_VISIBLE_EFFECTS		4096
 
+#define EFFECTS_JOB_CHUNK_SIZE		32		// effects drawn by job at once
+#define EFFECTS_MIN_PARALLEL		128
+
 class CEffectRenderer
 {
 	friend class IEffect;
@@ -90,10 +95,25 @@ public:
 protected:
 	void		RemoveEffect(int index);
 
+	// sorts first numEffects by distance, far ones first
+	void		SortEffects(int numEffects);
+
 private:
 	IEffect*							m_pEffectList[MAX_VISIBLE_EFFECTS];
 	Threading::CEqInterlockedInteger	m_numEffects;
 
+	// radix sort buffers
+	uint								m_sortKeys[2][MAX_VISIBLE_EFFECTS];
+	IEffect*							m_sortEffects[MAX_VISIBLE_EFFECTS];
+
+	// effects being drawn without lock and their results
+	IEffect*							m_drawEffects[MAX_VISIBLE_EFFECTS];
+	bool								m_effectAlive[MAX_VISIBLE_EFFECTS];
+
+	// raised when DrawEffects is not running, RemoveAllEffects waits for it
+	Threading::CEqSignal				m_drawCompleted;
+	bool								m_drawInProgress;
+
 	Vector3D							m_viewPos;
 };
 
@@ -85,12 +85,14 @@ public:
 
 	void				SetCustomProjectionMatrix(const Matrix4x4& mat);
 
-	// allocates a fixed strip for further use.
+	// allocates a fixed strip for further use. Thread-safe
 	// returns vertex start index. Returns -1 if failed
-	// terminate with AddStripBreak();
 	// this provides less copy operations
 	int					AllocateGeom( int nVertices, int nIndices, PFXVertex_t** verts, uint16** indices, bool preSetIndices = false );
 
+	// allocates quads with indices set. Thread-safe
+	int					AllocateQuads( int nQuads, PFXVertex_t** verts );
+
 	void				AddParticleStrip(PFXVertex_t* verts, int nVertices);
 
 	void				SetCullInverted(bool invert) {m_invertCull = invert;}
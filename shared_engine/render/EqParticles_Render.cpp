@@ -66,23 +66,28 @@ void CParticleRenderGroup::SetCustomProjectionMatrix(const Matrix4x4& mat)
 	m_customProjMat = mat;
 }
 
+// allocations are lock-free and can be done from any thread
 int CParticleRenderGroup::AllocateGeom( int nVertices, int nIndices, PFXVertex_t** verts, uint16** indices, bool preSetIndices )
 {
 	if(!g_pPFXRenderer->IsInitialized())
 		return -1;
 
-	Threading::CScopedMutex m(g_pPFXRenderer->m_mutex);
-
 	return _AllocateGeom(nVertices, nIndices, verts, indices, preSetIndices);
 }
 
+int CParticleRenderGroup::AllocateQuads( int nQuads, PFXVertex_t** verts )
+{
+	if(!g_pPFXRenderer->IsInitialized())
+		return -1;
+
+	return _AllocateQuads(nQuads, verts);
+}
+
 void CParticleRenderGroup::AddParticleStrip(PFXVertex_t* verts, int nVertices)
 {
 	if(!g_pPFXRenderer->IsInitialized())
 		return;
 
-	Threading::CScopedMutex m(g_pPFXRenderer->m_mutex);
-
 	_AddParticleStrip(verts, nVertices);
 }
 
@@ -91,14 +96,19 @@ void CParticleRenderGroup::Render(int nViewRenderFlags, void* userdata)
 {
 	if(!m_initialized || !r_drawParticles.GetBool())
 	{
-		m_numIndices = 0;
-		m_numVertices = 0;
+		ClearBuffers();
 		return;
 	}
 
-	if(m_numVertices == 0 || (!m_triangleListMode && m_numIndices == 0))
+	int numVertices = GetVertexCount();
+	int numIndices = GetIndexCount();
+
+	if(numVertices == 0 || (!m_triangleListMode && numIndices == 0))
 		return;
 
+	// geometry from effect jobs goes back to sorted order
+	SortGeometry();
+
 	{
 		g_pShaderAPI->Reset(STATE_RESET_VBO);
 		g_pShaderAPI->ApplyBuffers();
@@ -110,7 +120,7 @@ void CParticleRenderGroup::Render(int nViewRenderFlags, void* userdata)
 		g_pShaderAPI->SetVertexFormat(g_pPFXRenderer->m_vertexFormat);
 		g_pShaderAPI->SetVertexBuffer(g_pPFXRenderer->m_vertexBuffer, 0);
 
-		if(m_numIndices)
+		if(numIndices)
 			g_pShaderAPI->SetIndexBuffer(g_pPFXRenderer->m_indexBuffer);
 	}
 
@@ -129,10 +139,10 @@ void CParticleRenderGroup::Render(int nViewRenderFlags, void* userdata)
 	//ASSERTMSG(!m_triangleListMode, "Shadow rederer, %d verts");
 
 	// draw
-	if(m_numIndices)
-		g_pShaderAPI->DrawIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, m_numIndices, 0, m_numVertices);
+	if(numIndices)
+		g_pShaderAPI->DrawIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, numIndices, 0, numVertices);
 	else
-		g_pShaderAPI->DrawNonIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, m_numVertices);
+		g_pShaderAPI->DrawNonIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, numVertices);
 
 	HOOK_TO_CVAR(r_wireframe)
 
@@ -148,16 +158,15 @@ void CParticleRenderGroup::Render(int nViewRenderFlags, void* userdata)
 		g_pShaderAPI->SetShader(flat);
 		g_pShaderAPI->Apply();
 
-		if(m_numIndices)
-			g_pShaderAPI->DrawIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, m_numIndices, 0, m_numVertices);
+		if(numIndices)
+			g_pShaderAPI->DrawIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, numIndices, 0, numVertices);
 		else
-			g_pShaderAPI->DrawNonIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, m_numVertices);
+			g_pShaderAPI->DrawNonIndexedPrimitives(m_triangleListMode ? PRIM_TRIANGLES : PRIM_TRIANGLE_STRIP, 0, numVertices);
 	}
 
 	if(!(nViewRenderFlags & EPRFLAG_DONT_FLUSHBUFFERS))
 	{
-		m_numVertices = 0;
-		m_numIndices = 0;
+		ClearBuffers();
 		m_useCustomProjMat = false;
 	}
 }
@@ -351,13 +360,13 @@ bool CParticleLowLevelRenderer::MakeVBOFrom(CSpriteBuilder<PFXVertex_t>* pGroup)
 	if(!m_initialized)
 		return false;
 
-	uint16 nVerts	= pGroup->m_numVertices;
-	uint16 nIndices	= pGroup->m_numIndices;
+	int nVerts		= pGroup->GetVertexCount();
+	int nIndices	= pGroup->GetIndexCount();
 
 	if(nVerts == 0)
 		return false;
 
-	if(nVerts > SVBO_MAX_SIZE(m_vbMaxQuads, PFXVertex_t))
+	if(nVerts > m_vbMaxQuads*4 || nIndices > m_vbMaxQuads*6)
 		return false;
 
 	m_vertexBuffer->Update((void*)pGroup->m_pVerts, nVerts, 0, true);
@@ -393,7 +402,7 @@ void Effects_DrawBillboard(PFXBillboard_t* effect, CViewParams* view, Volume* fr
 	}
 
 	PFXVertex_t* verts;
-	if(effect->group->AllocateGeom(4,4,&verts, NULL, true) < 0)
+	if(effect->group->AllocateQuads(1, &verts) < 0)
 		return;
 
 	Vector3D angles, vRight, vUp;
@@ -445,7 +454,7 @@ void Effects_DrawBillboard(PFXBillboard_t* effect, const Matrix4x4& viewMatrix,
 
 
 	PFXVertex_t* verts;
-	if(effect->group->AllocateGeom(4,4,&verts, NULL, true) < 0)
+	if(effect->group->AllocateQuads(1, &verts) < 0)
 		return;
 
 	Vector3D vRight, vUp;
@@ -0,0 +1,408 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Software occlusion buffer.
+//				Low resolution depth of big occluders rasterized on job threads,
+//				object bounds are tested against it before drawing
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionBuffer.h"
+
+#include "core/DebugInterface.h"
+#include "core/ppmem.h"
+#include "core/ConVar.h"
+#include "core/IEqProfiler.h"
+#include "core/IEqParallelJobs.h"
+
+using namespace Threading;
+
+#define OCCLUSION_NEAR_W			0.01f	// triangles are clipped there
+#define OCCLUSION_MIN_PARALLEL_TRIS	64		// less triangles are rasterized on calling thread
+
+ConVar r_parallelOcclusion("r_parallelOcclusion", "1", "Rasterize occluders on job threads");
+
+COcclusionBuffer::COcclusionBuffer() :
+	m_depth(NULL),
+	m_tileMinDepth(NULL),
+	m_width(0),
+	m_height(0),
+	m_tilesX(0),
+	m_tilesY(0),
+	m_rasterized(false)
+{
+}
+
+COcclusionBuffer::~COcclusionBuffer()
+{
+	Shutdown();
+}
+
+void COcclusionBuffer::Init(int width, int height)
+{
+	Shutdown();
+
+	m_tilesX = (width + OCCLUSION_TILE_SIZE-1) / OCCLUSION_TILE_SIZE;
+	m_tilesY = (height + OCCLUSION_TILE_SIZE-1) / OCCLUSION_TILE_SIZE;
+
+	m_width = m_tilesX * OCCLUSION_TILE_SIZE;
+	m_height = m_tilesY * OCCLUSION_TILE_SIZE;
+
+	m_depth = (float*)PPAlloc(m_width * m_height * sizeof(float));
+	m_tileMinDepth = (float*)PPAlloc(m_tilesX * m_tilesY * sizeof(float));
+
+	memset(m_depth, 0, m_width * m_height * sizeof(float));
+	memset(m_tileMinDepth, 0, m_tilesX * m_tilesY * sizeof(float));
+
+	m_rasterized = false;
+}
+
+void COcclusionBuffer::Shutdown()
+{
+	PPFree(m_depth);
+	PPFree(m_tileMinDepth);
+
+	m_depth = NULL;
+	m_tileMinDepth = NULL;
+
+	m_width = m_height = 0;
+	m_tilesX = m_tilesY = 0;
+
+	m_triangles.clear();
+	m_rasterized = false;
+}
+
+void COcclusionBuffer::BeginFrame(const Matrix4x4& viewProj)
+{
+	m_viewProj = viewProj;
+	m_triangles.setNum(0, false);
+	m_rasterized = false;
+}
+
+//-------------------------------------------------------------------------
+// occluder setup
+//-------------------------------------------------------------------------
+
+void COcclusionBuffer::AddOccluder(const Vector3D* verts, const int* indices, int numIndices)
+{
+	for(int i = 0; i+2 < numIndices; i += 3)
+	{
+		Vector4D v0 = m_viewProj * Vector4D(verts[indices[i]], 1.0f);
+		Vector4D v1 = m_viewProj * Vector4D(verts[indices[i+1]], 1.0f);
+		Vector4D v2 = m_viewProj * Vector4D(verts[indices[i+2]], 1.0f);
+
+		AddTriangle(v0, v1, v2);
+	}
+}
+
+void COcclusionBuffer::AddOccluderBox(const Vector3D& mins, const Vector3D& maxs)
+{
+	static const int boxIndices[36] = {
+		0,1,3, 0,3,2,	4,6,7, 4,7,5,	// -x +x
+		0,4,5, 0,5,1,	2,3,7, 2,7,6,	// -y +y
+		0,2,6, 0,6,4,	1,5,7, 1,7,3,	// -z +z
+	};
+
+	Vector3D verts[8];
+	for(int i = 0; i < 8; i++)
+	{
+		verts[i] = Vector3D((i & 4) ? maxs.x : mins.x,
+							(i & 2) ? maxs.y : mins.y,
+							(i & 1) ? maxs.z : mins.z);
+	}
+
+	AddOccluder(verts, boxIndices, 36);
+}
+
+// clips clip space triangle by near plane
+void COcclusionBuffer::AddTriangle(const Vector4D& v0, const Vector4D& v1, const Vector4D& v2)
+{
+	const Vector4D* in[3] = {&v0, &v1, &v2};
+
+	int numInside = 0;
+	for(int i = 0; i < 3; i++)
+		numInside += (in[i]->w >= OCCLUSION_NEAR_W);
+
+	if(numInside == 0)
+		return;
+
+	if(numInside == 3)
+	{
+		AddScreenTriangle(v0, v1, v2);
+		return;
+	}
+
+	// clipped polygon has up to four vertices
+	Vector4D poly[4];
+	int numPoly = 0;
+
+	for(int i = 0; i < 3; i++)
+	{
+		const Vector4D& a = *in[i];
+		const Vector4D& b = *in[(i+1) % 3];
+
+		bool aInside = a.w >= OCCLUSION_NEAR_W;
+		bool bInside = b.w >= OCCLUSION_NEAR_W;
+
+		if(aInside)
+			poly[numPoly++] = a;
+
+		if(aInside != bInside)
+		{
+			float t = (OCCLUSION_NEAR_W - a.w) / (b.w - a.w);
+			poly[numPoly++] = a + (b - a) * t;
+		}
+	}
+
+	for(int i = 2; i < numPoly; i++)
+		AddScreenTriangle(poly[0], poly[i-1], poly[i]);
+}
+
+void COcclusionBuffer::AddScreenTriangle(const Vector4D& v0, const Vector4D& v1, const Vector4D& v2)
+{
+	const Vector4D* clip[3] = {&v0, &v1, &v2};
+
+	float x[3], y[3], invW[3];
+	for(int i = 0; i < 3; i++)
+	{
+		invW[i] = 1.0f / clip[i]->w;
+		x[i] = (clip[i]->x * invW[i] * 0.5f + 0.5f) * m_width;
+		y[i] = (0.5f - clip[i]->y * invW[i] * 0.5f) * m_height;
+	}
+
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+
+	if(fabs(area) < 0.0001f)
+		return;
+
+	// occluders are drawn from both sides
+	if(area < 0.0f)
+	{
+		swap(x[1], x[2]);
+		swap(y[1], y[2]);
+		swap(invW[1], invW[2]);
+		area = -area;
+	}
+
+	occluderTri_t tri;
+
+	tri.minX = max((int)floor(min(x[0], min(x[1], x[2]))), 0);
+	tri.minY = max((int)floor(min(y[0], min(y[1], y[2]))), 0);
+	tri.maxX = min((int)ceil(max(x[0], max(x[1], x[2]))), m_width-1);
+	tri.maxY = min((int)ceil(max(y[0], max(y[1], y[2]))), m_height-1);
+
+	if(tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	// edge functions, positive inside
+	for(int i = 0; i < 3; i++)
+	{
+		int j = (i+1) % 3;
+
+		tri.edgeA[i] = y[i] - y[j];
+		tri.edgeB[i] = x[j] - x[i];
+		tri.edgeC[i] = x[i]*y[j] - x[j]*y[i];
+	}
+
+	// 1/w is linear in screen space
+	float invArea = 1.0f / area;
+	float d1 = invW[1] - invW[0];
+	float d2 = invW[2] - invW[0];
+
+	tri.depthA = (d1 * (y[2] - y[0]) - d2 * (y[1] - y[0])) * invArea;
+	tri.depthB = (d2 * (x[1] - x[0]) - d1 * (x[2] - x[0])) * invArea;
+	tri.depthC = invW[0] - tri.depthA * x[0] - tri.depthB * y[0];
+
+	m_triangles.append(tri);
+}
+
+//-------------------------------------------------------------------------
+// rasterization
+//-------------------------------------------------------------------------
+
+// draws all triangles touching row of tiles. Rows are independent so they are drawn by different threads
+void COcclusionBuffer::RasterizeTileRow(int tileY)
+{
+	float* rowTiles = m_depth + tileY * m_tilesX * OCCLUSION_TILE_PIXELS;
+	memset(rowTiles, 0, m_tilesX * OCCLUSION_TILE_PIXELS * sizeof(float));
+
+	int rowMinY = tileY * OCCLUSION_TILE_SIZE;
+	int rowMaxY = rowMinY + OCCLUSION_TILE_SIZE - 1;
+
+	for(int t = 0; t < m_triangles.numElem(); t++)
+	{
+		const occluderTri_t& tri = m_triangles[t];
+
+		if(tri.maxY < rowMinY || tri.minY > rowMaxY)
+			continue;
+
+		int minY = max(tri.minY, rowMinY);
+		int maxY = min(tri.maxY, rowMaxY);
+
+		int minTileX = tri.minX / OCCLUSION_TILE_SIZE;
+		int maxTileX = tri.maxX / OCCLUSION_TILE_SIZE;
+
+		for(int tileX = minTileX; tileX <= maxTileX; tileX++)
+		{
+			float* tile = rowTiles + tileX * OCCLUSION_TILE_PIXELS;
+			float tileStartX = (float)(tileX * OCCLUSION_TILE_SIZE) + 0.5f;
+
+			for(int y = minY; y <= maxY; y++)
+			{
+				float py = (float)y + 0.5f;
+				float* tileRow = tile + (y - rowMinY) * OCCLUSION_TILE_SIZE;
+
+				float e0 = tri.edgeB[0] * py + tri.edgeC[0];
+				float e1 = tri.edgeB[1] * py + tri.edgeC[1];
+				float e2 = tri.edgeB[2] * py + tri.edgeC[2];
+				float d = tri.depthB * py + tri.depthC;
+
+				// branchless so compiler vectorizes it
+				for(int i = 0; i < OCCLUSION_TILE_SIZE; i++)
+				{
+					float px = tileStartX + (float)i;
+
+					bool inside = (tri.edgeA[0] * px + e0 >= 0.0f) &
+								  (tri.edgeA[1] * px + e1 >= 0.0f) &
+								  (tri.edgeA[2] * px + e2 >= 0.0f);
+
+					float depth = tri.depthA * px + d;
+
+					tileRow[i] = (inside && depth > tileRow[i]) ? depth : tileRow[i];
+				}
+			}
+		}
+	}
+
+	// farthest depth of tiles for quick tests
+	for(int tileX = 0; tileX < m_tilesX; tileX++)
+	{
+		const float* tile = rowTiles + tileX * OCCLUSION_TILE_PIXELS;
+
+		float minDepth = tile[0];
+		for(int i = 1; i < OCCLUSION_TILE_PIXELS; i++)
+			minDepth = min(minDepth, tile[i]);
+
+		m_tileMinDepth[tileY * m_tilesX + tileX] = minDepth;
+	}
+}
+
+// Shared by the calling thread and raster jobs, chunk is a tile row
+struct occlusionRasterWork_t : public CEqParallelWork
+{
+	COcclusionBuffer*		buffer;
+
+	void ProcessChunk(int chunk, int first, int count)
+	{
+		buffer->RasterizeTileRow(first);
+	}
+};
+
+void COcclusionBuffer::Rasterize()
+{
+	PROF_EVENT("Occlusion Rasterize");
+
+	m_rasterized = m_triangles.numElem() > 0;
+
+	if(!m_rasterized)
+		return;
+
+	occlusionRasterWork_t* work = new occlusionRasterWork_t;
+	work->buffer = this;
+
+	bool parallel = r_parallelOcclusion.GetBool() && m_triangles.numElem() >= OCCLUSION_MIN_PARALLEL_TRIS;
+
+	work->Run(m_tilesY, 1, JOB_TYPE_ANY, parallel);
+}
+
+//-------------------------------------------------------------------------
+// tests
+//-------------------------------------------------------------------------
+
+bool COcclusionBuffer::IsBoxOccluded(const Vector3D& mins, const Vector3D& maxs) const
+{
+	if(!m_rasterized)
+		return false;
+
+	float minX = V_MAX_COORD, minY = V_MAX_COORD;
+	float maxX = -V_MAX_COORD, maxY = -V_MAX_COORD;
+	float nearestDepth = 0.0f;
+
+	for(int i = 0; i < 8; i++)
+	{
+		Vector3D corner((i & 4) ? maxs.x : mins.x,
+						(i & 2) ? maxs.y : mins.y,
+						(i & 1) ? maxs.z : mins.z);
+
+		Vector4D clip = m_viewProj * Vector4D(corner, 1.0f);
+
+		// box crosses near plane
+		if(clip.w < OCCLUSION_NEAR_W)
+			return false;
+
+		float invW = 1.0f / clip.w;
+
+		float x = (clip.x * invW * 0.5f + 0.5f) * m_width;
+		float y = (0.5f - clip.y * invW * 0.5f) * m_height;
+
+		minX = min(minX, x);
+		minY = min(minY, y);
+		maxX = max(maxX, x);
+		maxY = max(maxY, y);
+
+		nearestDepth = max(nearestDepth, invW);
+	}
+
+	// pixels which centers are covered by the box bounds
+	int x0 = max((int)floor(minX), 0);
+	int y0 = max((int)floor(minY), 0);
+	int x1 = min((int)ceil(maxX), m_width-1);
+	int y1 = min((int)ceil(maxY), m_height-1);
+
+	// off screen boxes are left to frustum culling
+	if(x0 > x1 || y0 > y1)
+		return false;
+
+	for(int tileY = y0 / OCCLUSION_TILE_SIZE; tileY <= y1 / OCCLUSION_TILE_SIZE; tileY++)
+	{
+		for(int tileX = x0 / OCCLUSION_TILE_SIZE; tileX <= x1 / OCCLUSION_TILE_SIZE; tileX++)
+		{
+			// whole tile is in front of the box
+			if(m_tileMinDepth[tileY * m_tilesX + tileX] > nearestDepth)
+				continue;
+
+			const float* tile = m_depth + (tileY * m_tilesX + tileX) * OCCLUSION_TILE_PIXELS;
+
+			int tx0 = max(x0 - tileX * OCCLUSION_TILE_SIZE, 0);
+			int ty0 = max(y0 - tileY * OCCLUSION_TILE_SIZE, 0);
+			int tx1 = min(x1 - tileX * OCCLUSION_TILE_SIZE, OCCLUSION_TILE_SIZE-1);
+			int ty1 = min(y1 - tileY * OCCLUSION_TILE_SIZE, OCCLUSION_TILE_SIZE-1);
+
+			for(int y = ty0; y <= ty1; y++)
+			{
+				const float* tileRow = tile + y * OCCLUSION_TILE_SIZE;
+
+				for(int x = tx0; x <= tx1; x++)
+				{
+					if(tileRow[x] <= nearestDepth)
+						return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+float COcclusionBuffer::GetDepth(int x, int y) const
+{
+	if(x < 0 || y < 0 || x >= m_width || y >= m_height)
+		return 0.0f;
+
+	int tileX = x / OCCLUSION_TILE_SIZE;
+	int tileY = y / OCCLUSION_TILE_SIZE;
+
+	const float* tile = m_depth + (tileY * m_tilesX + tileX) * OCCLUSION_TILE_PIXELS;
+
+	return tile[(y % OCCLUSION_TILE_SIZE) * OCCLUSION_TILE_SIZE + (x % OCCLUSION_TILE_SIZE)];
+}
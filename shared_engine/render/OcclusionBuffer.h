@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Software occlusion buffer.
+//				Low resolution depth of big occluders rasterized on job threads,
+//				object bounds are tested against it before drawing
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include "math/DkMath.h"
+#include "utils/DkList.h"
+
+// Pixels are stored by tiles, each tile row is contiguous so it's processed by SIMD-width loops
+#define OCCLUSION_TILE_SIZE			8
+#define OCCLUSION_TILE_PIXELS		(OCCLUSION_TILE_SIZE*OCCLUSION_TILE_SIZE)
+
+#define OCCLUSION_DEFAULT_WIDTH		256
+#define OCCLUSION_DEFAULT_HEIGHT	128
+
+// screen space occluder triangle with edge and depth equations
+struct occluderTri_t
+{
+	float		edgeA[3];
+	float		edgeB[3];
+	float		edgeC[3];
+
+	float		depthA, depthB, depthC;		// 1/w plane
+
+	int			minX, minY, maxX, maxY;		// pixel bounds, inclusive
+};
+
+//
+// Each frame the owning scene renderer calls BeginFrame, adds occluders,
+// calls Rasterize and then CRenderList::RemoveOccluded with it
+//
+class COcclusionBuffer
+{
+public:
+						COcclusionBuffer();
+						~COcclusionBuffer();
+
+	// size is rounded up to tile size
+	void				Init(int width = OCCLUSION_DEFAULT_WIDTH, int height = OCCLUSION_DEFAULT_HEIGHT);
+	void				Shutdown();
+
+	// removes occluders of previous frame
+	void				BeginFrame(const Matrix4x4& viewProj);
+
+	// adds indexed triangle list of occluder in world space. Occluders must be solid
+	void				AddOccluder(const Vector3D* verts, const int* indices, int numIndices);
+	void				AddOccluderBox(const Vector3D& mins, const Vector3D& maxs);
+
+	// rasterizes added occluders, on job threads if there are many of them
+	void				Rasterize();
+
+	// returns true if box is hidden behind occluders. Can be called from any thread after Rasterize
+	bool				IsBoxOccluded(const Vector3D& mins, const Vector3D& maxs) const;
+
+	int					GetOccluderTriangleCount() const	{return m_triangles.numElem();}
+
+	int					GetWidth() const					{return m_width;}
+	int					GetHeight() const					{return m_height;}
+
+	// returns inverse of view depth at pixel, 0 if no occluder was drawn there
+	float				GetDepth(int x, int y) const;
+
+protected:
+	friend struct occlusionRasterWork_t;
+
+	void				AddTriangle(const Vector4D& v0, const Vector4D& v1, const Vector4D& v2);
+	void				AddScreenTriangle(const Vector4D& v0, const Vector4D& v1, const Vector4D& v2);
+
+	void				RasterizeTileRow(int tileY);
+
+	Matrix4x4			m_viewProj;
+
+	float*				m_depth;			// 1/w, nearest is bigger
+	float*				m_tileMinDepth;		// farthest depth of each tile
+
+	int					m_width;
+	int					m_height;
+	int					m_tilesX;
+	int					m_tilesY;
+
+	DkList<occluderTri_t>	m_triangles;
+	bool				m_rasterized;
+};
+
+#endif // OCCLUSIONBUFFER_H
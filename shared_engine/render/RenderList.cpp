@@ -6,18 +6,27 @@
 //////////////////////////////////////////////////////////////////////////////////
 
 #include "core/DebugInterface.h"
+#include "core/ConVar.h"
 
 #include "RenderList.h"
+#include "OcclusionBuffer.h"
 #include "math/BoundingBox.h"
 #include "math/Utility.h"
 
+#include "materialsystem1/IMaterial.h"
+#include "utils/strtools.h"
+
 #include <stdlib.h> // for qsort
+#include <cstdint>
 
 #define MIN_OBJECT_RENDERLIST_MEMSIZE 48
 
-CRenderList::CRenderList() : m_ObjectList(MIN_OBJECT_RENDERLIST_MEMSIZE)
-{
+ConVar r_autoInstancing("r_autoInstancing", "1", "Draws render queue items with the same instance key together", CV_CHEAT);
+ConVar r_occlusionCulling("r_occlusionCulling", "1", "Removes objects hidden by occluders from render lists", CV_CHEAT);
 
+CRenderList::CRenderList() : m_ObjectList(MIN_OBJECT_RENDERLIST_MEMSIZE), m_drawItems(MIN_OBJECT_RENDERLIST_MEMSIZE), m_sortedItems(MIN_OBJECT_RENDERLIST_MEMSIZE)
+{
+	memset(&m_queueStats, 0, sizeof(m_queueStats));
 }
 
 CRenderList::~CRenderList()
@@ -46,6 +55,8 @@ void CRenderList::Append(CRenderList* pAnotherList)
 
 	for(int i = 0; i < num; i++)
 		m_ObjectList.append(pAnotherList->GetRenderable(i));
+
+	m_drawItems.append(pAnotherList->m_drawItems);
 }
 
 void CRenderList::Render(int nViewRenderFlags, void* userdata)
@@ -64,6 +75,7 @@ void CRenderList::Remove(int id)
 void CRenderList::Clear()
 {
 	m_ObjectList.clear(false);
+	m_drawItems.clear(false);
 }
 
 // compares floats (for array sort)
@@ -104,4 +116,404 @@ void CRenderList::SortByDistanceFrom(const Vector3D& origin)
 	}
 
 	m_ObjectList.sort(DistanceCompare);
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+// Render queue
+//------------------------------------------------------------------------------
+
+#define RENDERQUEUE_SHADER_BITS		11
+#define RENDERQUEUE_MATERIAL_BITS	16
+#define RENDERQUEUE_VB_BITS			12
+#define RENDERQUEUE_DEPTH_BITS		20
+
+#define RENDERQUEUE_TRANSLUCENT_FLAGS	(MATERIAL_FLAG_TRANSPARENT | MATERIAL_FLAG_ADDITIVE | MATERIAL_FLAG_MODULATE)
+#define RENDERQUEUE_TRANSLUCENT_BIT		(1ULL << 59)
+
+// spreads pointer bits so the key part of it differs for near addresses
+static uint RenderQueue_PointerHash(const void* ptr)
+{
+	uint64 v = (uint64)(uintptr_t)ptr;
+
+	v = (v ^ (v >> 33)) * 0xff51afd7ed558ccdULL;
+	v ^= v >> 33;
+
+	return (uint)v;
+}
+
+// positive float bits are ordered like the values
+static uint RenderQueue_DepthBits(float viewDistance)
+{
+	viewDistance = max(viewDistance, 0.0f);
+
+	uint bits = *(uint*)&viewDistance;
+
+	return bits >> (31 - RENDERQUEUE_DEPTH_BITS);
+}
+
+void CRenderList::AddDrawItem(CBaseRenderableObject* pObject, IMaterial* pMaterial, IVertexBuffer* pVertexBuffer, float viewDistance, int layer, int userParam, void* instanceKey)
+{
+	ASSERT(layer >= 0 && layer < RENDERQUEUE_MAX_LAYERS);
+
+	uint64 shaderId = 0;
+	bool translucent = false;
+
+	if(pMaterial)
+	{
+		const char* shaderName = pMaterial->GetShaderName();
+
+		if(shaderName)
+			shaderId = StringToHash(shaderName) & ((1 << RENDERQUEUE_SHADER_BITS)-1);
+
+		translucent = (pMaterial->GetFlags() & RENDERQUEUE_TRANSLUCENT_FLAGS) > 0;
+	}
+
+	uint64 materialId = RenderQueue_PointerHash(pMaterial) & ((1 << RENDERQUEUE_MATERIAL_BITS)-1);
+	uint64 vbId = RenderQueue_PointerHash(pVertexBuffer) & ((1 << RENDERQUEUE_VB_BITS)-1);
+	uint64 depth = RenderQueue_DepthBits(viewDistance);
+
+	uint64 stateKey = (shaderId << (RENDERQUEUE_MATERIAL_BITS + RENDERQUEUE_VB_BITS)) | (materialId << RENDERQUEUE_VB_BITS) | vbId;
+
+	uint64 key = (uint64)layer << 60;
+
+	if(translucent)
+	{
+		// back to front
+		depth = ((1 << RENDERQUEUE_DEPTH_BITS)-1) - depth;
+		key |= RENDERQUEUE_TRANSLUCENT_BIT | (depth << 39) | stateKey;
+	}
+	else
+		key |= (stateKey << RENDERQUEUE_DEPTH_BITS) | depth;
+
+	renderQueueItem_t item;
+	item.sortKey = key;
+	item.object = pObject;
+	item.material = pMaterial;
+	item.vertexBuffer = pVertexBuffer;
+	item.userParam = userParam;
+	item.instanceKey = instanceKey;
+
+	m_drawItems.append(item);
+}
+
+int CRenderList::GetDrawItemCount() const
+{
+	return m_drawItems.numElem();
+}
+
+const renderQueueItem_t& CRenderList::GetDrawItem(int id) const
+{
+	return m_drawItems[id];
+}
+
+void CRenderList::CountStateChanges(int& shaderChanges, int& materialChanges, int& vertexBufferChanges) const
+{
+	shaderChanges = 0;
+	materialChanges = 0;
+	vertexBufferChanges = 0;
+
+	const char* lastShader = NULL;
+	IMaterial* lastMaterial = NULL;
+	IVertexBuffer* lastVB = NULL;
+
+	for(int i = 0; i < m_drawItems.numElem(); i++)
+	{
+		const renderQueueItem_t& item = m_drawItems[i];
+
+		if(i == 0 || item.material != lastMaterial)
+		{
+			const char* shaderName = item.material ? item.material->GetShaderName() : NULL;
+
+			if(i == 0 || (shaderName != lastShader && (!shaderName || !lastShader || strcmp(shaderName, lastShader))))
+				shaderChanges++;
+
+			lastShader = shaderName;
+			lastMaterial = item.material;
+			materialChanges++;
+		}
+
+		if(i == 0 || item.vertexBuffer != lastVB)
+		{
+			lastVB = item.vertexBuffer;
+			vertexBufferChanges++;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Occlusion culling
+//------------------------------------------------------------------------------
+
+// objects are tested once per RemoveOccluded, both by object list and draw items
+bool CRenderList::IsObjectOccluded(const COcclusionBuffer* occlusion, CBaseRenderableObject* pObject)
+{
+	if(pObject->GetRenderFlags() & RF_SKIPVISIBILITYTEST)
+		return false;
+
+	std::unordered_map<CBaseRenderableObject*, bool>::iterator found = m_occlusionResults.find(pObject);
+
+	if(found != m_occlusionResults.end())
+		return found->second;
+
+	BoundingBox bbox;
+	pObject->GetBoundingBox(bbox);
+
+	bool occluded = occlusion->IsBoxOccluded(bbox.minPoint, bbox.maxPoint);
+
+	m_occlusionResults[pObject] = occluded;
+
+	m_queueStats.occlusionTested++;
+
+	if(occluded)
+		m_queueStats.occlusionCulled++;
+
+	return occluded;
+}
+
+void CRenderList::RemoveOccluded(const COcclusionBuffer* occlusion)
+{
+	m_queueStats.occlusionTested = 0;
+	m_queueStats.occlusionCulled = 0;
+
+	if(!occlusion || !r_occlusionCulling.GetBool())
+		return;
+
+	m_occlusionResults.clear();
+
+	int numObjects = 0;
+
+	for(int i = 0; i < m_ObjectList.numElem(); i++)
+	{
+		if(!IsObjectOccluded(occlusion, m_ObjectList[i]))
+			m_ObjectList[numObjects++] = m_ObjectList[i];
+	}
+
+	m_ObjectList.setNum(numObjects, false);
+
+	// items of the same object are mostly added one after another
+	CBaseRenderableObject* lastObject = NULL;
+	bool lastOccluded = false;
+
+	int numItems = 0;
+
+	for(int i = 0; i < m_drawItems.numElem(); i++)
+	{
+		const renderQueueItem_t& item = m_drawItems[i];
+
+		if(item.object != lastObject)
+		{
+			lastObject = item.object;
+			lastOccluded = IsObjectOccluded(occlusion, lastObject);
+		}
+
+		if(!lastOccluded)
+			m_drawItems[numItems++] = item;
+	}
+
+	m_drawItems.setNum(numItems, false);
+}
+
+// stable LSD radix sort of the keys by bytes, passes where all keys have the same byte are skipped
+void CRenderList::SortDrawItems()
+{
+	int numItems = m_drawItems.numElem();
+
+	int shaderChanges, materialChanges, vertexBufferChanges;
+	CountStateChanges(shaderChanges, materialChanges, vertexBufferChanges);
+
+	int unsortedChanges = shaderChanges + materialChanges + vertexBufferChanges;
+
+	if(numItems > 1)
+	{
+		m_sortEntries[0].setNum(numItems, false);
+		m_sortEntries[1].setNum(numItems, false);
+
+		sortEntry_t* src = m_sortEntries[0].ptr();
+		sortEntry_t* dst = m_sortEntries[1].ptr();
+
+		for(int i = 0; i < numItems; i++)
+		{
+			src[i].key = m_drawItems[i].sortKey;
+			src[i].index = i;
+		}
+
+		int counts[8][256];
+		memset(counts, 0, sizeof(counts));
+
+		for(int i = 0; i < numItems; i++)
+		{
+			uint64 key = src[i].key;
+
+			for(int pass = 0; pass < 8; pass++)
+				counts[pass][(key >> (pass*8)) & 0xFF]++;
+		}
+
+		for(int pass = 0; pass < 8; pass++)
+		{
+			int* passCounts = counts[pass];
+			int shift = pass*8;
+
+			if(passCounts[(src[0].key >> shift) & 0xFF] == numItems)
+				continue;
+
+			int offset = 0;
+			for(int i = 0; i < 256; i++)
+			{
+				int count = passCounts[i];
+				passCounts[i] = offset;
+				offset += count;
+			}
+
+			for(int i = 0; i < numItems; i++)
+				dst[passCounts[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+			sortEntry_t* tmp = src;
+			src = dst;
+			dst = tmp;
+		}
+
+		m_sortedItems.setNum(numItems, false);
+
+		for(int i = 0; i < numItems; i++)
+			m_sortedItems[i] = m_drawItems[src[i].index];
+
+		m_drawItems.swap(m_sortedItems);
+
+		CountStateChanges(shaderChanges, materialChanges, vertexBufferChanges);
+	}
+
+	m_queueStats.numItems = numItems;
+	m_queueStats.shaderChanges = shaderChanges;
+	m_queueStats.materialChanges = materialChanges;
+	m_queueStats.vertexBufferChanges = vertexBufferChanges;
+	m_queueStats.changesAvoided = unsortedChanges - (shaderChanges + materialChanges + vertexBufferChanges);
+}
+
+void CRenderList::RenderDrawItems(int nViewRenderFlags, void* userdata)
+{
+	m_queueStats.instancedDraws = 0;
+	m_queueStats.instancedItems = 0;
+
+	bool autoInstancing = r_autoInstancing.GetBool();
+
+	int numItems = m_drawItems.numElem();
+	int i = 0;
+
+	while(i < numItems)
+	{
+		const renderQueueItem_t& item = m_drawItems[i];
+
+		// translucent items must keep their order
+		if(!autoInstancing || !item.instanceKey || (item.sortKey & RENDERQUEUE_TRANSLUCENT_BIT))
+		{
+			item.object->RenderQueueItem(item, nViewRenderFlags, userdata);
+			i++;
+			continue;
+		}
+
+		// opaque items of the same state differ only by depth bits
+		uint64 stateKey = item.sortKey >> RENDERQUEUE_DEPTH_BITS;
+
+		int runEnd = i+1;
+		while(runEnd < numItems && (m_drawItems[runEnd].sortKey >> RENDERQUEUE_DEPTH_BITS) == stateKey)
+			runEnd++;
+
+		RenderInstancedItems(i, runEnd-i, nViewRenderFlags, userdata);
+		i = runEnd;
+	}
+}
+
+// orders instance entries by key, keeps the item order of the same key
+int CRenderList::InstanceEntryCompare(const sortEntry_t& a, const sortEntry_t& b)
+{
+	if(a.key != b.key)
+		return a.key < b.key ? -1 : 1;
+
+	return a.index - b.index;
+}
+
+// items with the same instance key, user parameter and material are drawn together
+static uint64 RenderQueue_InstanceKey(const renderQueueItem_t& item)
+{
+	uint64 key = (uint64)RenderQueue_PointerHash(item.instanceKey) << 32;
+
+	return key | (RenderQueue_PointerHash(item.material) ^ ((uint)item.userParam * 0x9E3779B1));
+}
+
+static bool RenderQueue_SameInstance(const renderQueueItem_t& a, const renderQueueItem_t& b)
+{
+	return a.instanceKey == b.instanceKey && a.userParam == b.userParam && a.material == b.material;
+}
+
+// gathers items of the same state by sorting them by instance key, then draws each group
+void CRenderList::RenderInstancedItems(int firstItem, int numItems, int nViewRenderFlags, void* userdata)
+{
+	const renderQueueItem_t* items = m_drawItems.ptr() + firstItem;
+
+	m_instanceEntries.setNum(0, false);
+
+	for(int i = 0; i < numItems; i++)
+	{
+		const renderQueueItem_t& item = items[i];
+
+		if(!item.instanceKey)
+		{
+			item.object->RenderQueueItem(item, nViewRenderFlags, userdata);
+			continue;
+		}
+
+		sortEntry_t entry;
+		entry.key = RenderQueue_InstanceKey(item);
+		entry.index = i;
+
+		m_instanceEntries.append(entry);
+	}
+
+	m_instanceEntries.sort(InstanceEntryCompare);
+
+	int numEntries = m_instanceEntries.numElem();
+	int i = 0;
+
+	while(i < numEntries)
+	{
+		uint64 key = m_instanceEntries[i].key;
+		const renderQueueItem_t& item = items[m_instanceEntries[i].index];
+
+		int groupEnd = i+1;
+		while(groupEnd < numEntries && m_instanceEntries[groupEnd].key == key)
+			groupEnd++;
+
+		m_instanceItems.setNum(0, false);
+
+		for(int j = i; j < groupEnd; j++)
+		{
+			const renderQueueItem_t& other = items[m_instanceEntries[j].index];
+
+			// key collision, not worth grouping
+			if(!RenderQueue_SameInstance(item, other))
+				other.object->RenderQueueItem(other, nViewRenderFlags, userdata);
+			else
+				m_instanceItems.append(other);
+		}
+
+		i = groupEnd;
+
+		int numInstances = m_instanceItems.numElem();
+
+		if(numInstances == 1)
+		{
+			item.object->RenderQueueItem(item, nViewRenderFlags, userdata);
+			continue;
+		}
+
+		item.object->RenderQueueInstances(m_instanceItems.ptr(), numInstances, nViewRenderFlags, userdata);
+
+		m_queueStats.instancedDraws++;
+		m_queueStats.instancedItems += numInstances;
+	}
+}
+
+const renderQueueStats_t& CRenderList::GetQueueStats() const
+{
+	return m_queueStats;
+}
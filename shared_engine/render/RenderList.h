@@ -11,6 +11,49 @@
 #include "BaseRenderableObject.h"
 #include "utils/DkList.h"
 
+#include <unordered_map>
+
+class IMaterial;
+class IVertexBuffer;
+class COcclusionBuffer;
+
+#define RENDERQUEUE_MAX_LAYERS		16
+
+//----------------------------------------------------
+// Render queue draw item
+//
+// Sort key bits, from the highest:
+//	opaque:			layer(4) | translucent(1) | shader(11) | material(16) | vertex buffer(12) | depth(20)
+//	translucent:	layer(4) | translucent(1) | inverted depth(20) | shader(11) | material(16) | vertex buffer(12)
+//----------------------------------------------------
+struct renderQueueItem_t
+{
+	uint64					sortKey;
+	CBaseRenderableObject*	object;
+	IMaterial*				material;
+	IVertexBuffer*			vertexBuffer;
+	int						userParam;		// passed to the object, e.g. index of the subset to draw
+	void*					instanceKey;	// opaque items with the same key, material and user parameter are drawn as instances, e.g. model
+};
+
+// state changes of the sorted render queue
+struct renderQueueStats_t
+{
+	int						numItems;
+	int						shaderChanges;
+	int						materialChanges;
+	int						vertexBufferChanges;
+	int						changesAvoided;		// compared to the order items were added in
+
+	// filled by RenderDrawItems
+	int						instancedDraws;		// RenderQueueInstances calls
+	int						instancedItems;		// items drawn by them
+
+	// filled by RemoveOccluded, each object is counted once
+	int						occlusionTested;	// objects tested
+	int						occlusionCulled;	// objects removed
+};
+
 //----------------------------------------------------
 // Base render list interface.
 //----------------------------------------------------
@@ -33,11 +76,58 @@ public:
 
 	void								Remove(int id);
 	void								Clear();										// clear it
+
+	//------------------------------------------
+	// render queue
+
+	// adds the draw item. Layers are drawn in ascending order, translucent materials are drawn back to front
+	void								AddDrawItem(CBaseRenderableObject* pObject, IMaterial* pMaterial, IVertexBuffer* pVertexBuffer, float viewDistance, int layer = 0, int userParam = 0, void* instanceKey = NULL);
+
+	int									GetDrawItemCount() const;
+	const renderQueueItem_t&			GetDrawItem(int id) const;
+
+	// removes objects and draw items hidden by occluders, so they never get to the rendering.
+	// Occlusion buffer is created, filled and rasterized by the scene renderer each frame
+	void								RemoveOccluded(const COcclusionBuffer* occlusion);
+
+	// sorts draw items by their keys to minimize state changes
+	void								SortDrawItems();
+
+	// draws items in sorted order. Opaque items with the same state and instance key are gathered and drawn together
+	void								RenderDrawItems(int nViewRenderFlags, void* userdata);
+
+	// state changes after last SortDrawItems
+	const renderQueueStats_t&			GetQueueStats() const;
+
 protected:
 
 	static int CRenderList::DistanceCompare(CBaseRenderableObject* const& a, CBaseRenderableObject* const& b);
 
+	struct sortEntry_t
+	{
+		uint64							key;
+		int								index;
+	};
+
+	static int							InstanceEntryCompare(const sortEntry_t& a, const sortEntry_t& b);
+
+	void								CountStateChanges(int& shaderChanges, int& materialChanges, int& vertexBufferChanges) const;
+	void								RenderInstancedItems(int firstItem, int numItems, int nViewRenderFlags, void* userdata);
+	bool								IsObjectOccluded(const COcclusionBuffer* occlusion, CBaseRenderableObject* pObject);
+
 	DkList<CBaseRenderableObject*>		m_ObjectList;
+
+	DkList<renderQueueItem_t>			m_drawItems;
+	DkList<renderQueueItem_t>			m_sortedItems;
+	DkList<sortEntry_t>					m_sortEntries[2];
+
+	DkList<renderQueueItem_t>			m_instanceItems;
+	DkList<sortEntry_t>					m_instanceEntries;
+
+	// occlusion results of objects tested by RemoveOccluded
+	std::unordered_map<CBaseRenderableObject*, bool>	m_occlusionResults;
+
+	renderQueueStats_t					m_queueStats;
 };
 
 
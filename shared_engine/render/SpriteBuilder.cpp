@@ -7,3 +7,16 @@
 
 #include "SpriteBuilder.h"
 
+
+// each particle job thread emits it's own range of effects
+static thread_local int s_spriteEmitOrder = -1;
+
+void SpriteBuilder_SetEmitOrder(int order)
+{
+	s_spriteEmitOrder = order;
+}
+
+int SpriteBuilder_GetEmitOrder()
+{
+	return s_spriteEmitOrder;
+}
@@ -9,10 +9,31 @@
 #define SPRITEBUILDER_H
 
 #include "materialsystem1/IMaterialSystem.h"
+#include "utils/eqthread.h"
+#include "utils/DkList.h"
 
 #define SVBO_MAX_SIZE(s, T)	((size_t)s*sizeof(T)*4)
 #define SIBO_MAX_SIZE(s)	((size_t)s*(sizeof(uint16)*6))
 
+// Emit order of geometry allocated by the calling thread.
+// Geometry allocated by parallel jobs is put back into emit order before rendering, -1 means unordered
+void SpriteBuilder_SetEmitOrder(int order);
+int  SpriteBuilder_GetEmitOrder();
+
+struct spriteGeomRecord_t
+{
+	int		firstIndex;
+	int		numIndices;
+	int		order;
+};
+
+//
+// Geometry ranges are reserved with atomic counters so any thread can allocate without locking.
+//
+// In triangle strip mode every allocation is a separate strip which begins and ends with
+// degenerate indices: [first, strip..., last, (last)]. Index buffer starts with one filler index
+// and every strip has even length, so winding of any strip doesn't depend on it's neighbours
+//
 template <class VTX_TYPE>
 class CSpriteBuilder
 {
@@ -24,42 +45,56 @@ public:
 	virtual void		Init( int maxQuads = 16384 );
 	virtual void		Shutdown();
 
-	void				SetTriangleListMode(bool enable) {m_triangleListMode = enable;}
+	void				SetTriangleListMode(bool enable) {m_triangleListMode = enable; ClearBuffers();}
 
 	void				ClearBuffers();
 
-	// adds triangle strip break indices
-	void				AddStripBreak();
+	// does nothing, strips are terminated by allocation. Left for compatibility
+	void				AddStripBreak() {}
 
 	// allocates a fixed strip for further use.
 	// returns vertex start index. Returns -1 if failed
-	// terminate with AddStripBreak();
+	// In strip mode user indices must begin with the first and end with the last allocated vertex
 	// this provides less copy operations
 	virtual int			AllocateGeom( int nVertices, int nIndices, VTX_TYPE** verts, uint16** indices, bool preSetIndices = false );
 
+	// allocates quads with the indices already set, vertex order in quad is same as for strip
+	// returns vertex start index. Returns -1 if failed
+	virtual int			AllocateQuads( int nQuads, VTX_TYPE** verts );
+
 	// adds strip
 	virtual void		AddParticleStrip(VTX_TYPE* verts, int nVertices);
 
+	// puts the geometry allocated by parallel jobs back in emit order
+	void				SortGeometry();
+
+	int					GetVertexCount() const;
+	int					GetIndexCount() const;
+
 protected:
 
-	// allocates a fixed strip for further use.
-	// returns vertex start index. Returns -1 if failed
-	// terminate with AddStripBreak();
-	// this provides less copy operations
 	int					_AllocateGeom( int nVertices, int nIndices, VTX_TYPE** verts, uint16** indices, bool preSetIndices = false );
+	int					_AllocateQuads( int nQuads, VTX_TYPE** verts );
 
 	// adds strip to list
 	void				_AddParticleStrip(VTX_TYPE* verts, int nVertices);
 
 	// internal use only
-	void				AddVertices(VTX_TYPE* verts, int nVerts);
-	void				AddIndices(uint16* indices, int nIndx);
+	int					ReserveVertices(int nVerts);
+	int					ReserveIndices(int nIndices);
+	void				AddGeomRecord(int firstIndex, int numIndices);
 
 	VTX_TYPE*			m_pVerts;
 	uint16*				m_pIndices;
 
-	uint16				m_numVertices;
-	uint16				m_numIndices;
+	Threading::InterlockedInt_t	m_numVertices;
+	Threading::InterlockedInt_t	m_numIndices;
+
+	spriteGeomRecord_t*	m_geomRecords;
+	uint16*				m_sortIndices;
+	Threading::InterlockedInt_t	m_numGeomRecords;
+	DkList<int>			m_sortOffsets;
+	bool				m_hasOrderedGeom;
 
 	uint				m_maxQuads;
 
@@ -73,6 +108,10 @@ CSpriteBuilder<VTX_TYPE>::CSpriteBuilder() :
 	m_pIndices(NULL),
 	m_numVertices(0),
 	m_numIndices(0),
+	m_geomRecords(NULL),
+	m_sortIndices(NULL),
+	m_numGeomRecords(0),
+	m_hasOrderedGeom(false),
 	m_initialized(false),
 	m_maxQuads(0),
 	m_triangleListMode(false)
@@ -97,16 +136,18 @@ void CSpriteBuilder<VTX_TYPE>::Init( int maxQuads )
 	m_pVerts	= (VTX_TYPE*)PPAlloc(SVBO_MAX_SIZE(m_maxQuads, VTX_TYPE));
 	m_pIndices	= (uint16*)PPAlloc(SIBO_MAX_SIZE(m_maxQuads));
 
+	m_geomRecords	= (spriteGeomRecord_t*)PPAlloc(m_maxQuads*sizeof(spriteGeomRecord_t));
+	m_sortIndices	= (uint16*)PPAlloc(SIBO_MAX_SIZE(m_maxQuads));
+
 	if(!m_pVerts)
 		ASSERT(!"FAILED TO ALLOCATE VERTICES!\n");
 
 	if(!m_pIndices)
 		ASSERT(!"FAILED TO ALLOCATE INDICES!\n");
 
-	m_numVertices = 0;
-	m_numIndices = 0;
-
 	m_initialized = true;
+
+	ClearBuffers();
 }
 
 template <class VTX_TYPE>
@@ -119,29 +160,89 @@ void CSpriteBuilder<VTX_TYPE>::Shutdown()
 
 	PPFree(m_pVerts);
 	PPFree(m_pIndices);
+	PPFree(m_geomRecords);
+	PPFree(m_sortIndices);
 
 	m_pIndices = NULL;
 	m_pVerts = NULL;
+	m_geomRecords = NULL;
+	m_sortIndices = NULL;
 }
 
 template <class VTX_TYPE>
-void CSpriteBuilder<VTX_TYPE>::AddVertices(VTX_TYPE* verts, int nVerts)
+int CSpriteBuilder<VTX_TYPE>::GetVertexCount() const
 {
-	if ((uint)(m_numVertices + nVerts) > m_maxQuads*4)
-		return;
+	return min((int)m_numVertices, (int)m_maxQuads*4);
+}
+
+template <class VTX_TYPE>
+int CSpriteBuilder<VTX_TYPE>::GetIndexCount() const
+{
+	// only filler index is there
+	if(!m_triangleListMode && m_numIndices <= 1)
+		return 0;
+
+	return min((int)m_numIndices, (int)m_maxQuads*6);
+}
+
+// returns first reserved vertex or -1 if buffer is full
+template <class VTX_TYPE>
+int CSpriteBuilder<VTX_TYPE>::ReserveVertices(int nVerts)
+{
+	int maxVerts = m_maxQuads*4;
+
+	// don't grow counter infinitely after overflow
+	if(m_numVertices + nVerts > maxVerts)
+		return -1;
+
+	int last = Threading::AddInterlocked(m_numVertices, nVerts);
+
+	if(last > maxVerts)
+		return -1;
 
-	memcpy(&m_pVerts[m_numVertices], verts, nVerts*sizeof(VTX_TYPE));
-	m_numVertices += nVerts;
+	return last - nVerts;
 }
 
+// returns first reserved index or -1 if buffer is full
 template <class VTX_TYPE>
-void CSpriteBuilder<VTX_TYPE>::AddIndices(uint16 *indices, int nIndx)
+int CSpriteBuilder<VTX_TYPE>::ReserveIndices(int nIndices)
 {
-	if ((uint)(m_numIndices + nIndx) > m_maxQuads*6)
+	int maxIndices = m_maxQuads*6;
+
+	if(m_numIndices + nIndices > maxIndices)
+		return -1;
+
+	int last = Threading::AddInterlocked(m_numIndices, nIndices);
+
+	if(last > maxIndices)
+	{
+		// make the part which fits degenerate as it's going to be drawn
+		for(int i = last - nIndices; i < maxIndices; i++)
+			m_pIndices[i] = 0;
+
+		return -1;
+	}
+
+	return last - nIndices;
+}
+
+template <class VTX_TYPE>
+void CSpriteBuilder<VTX_TYPE>::AddGeomRecord(int firstIndex, int numIndices)
+{
+	int order = SpriteBuilder_GetEmitOrder();
+
+	int recordIdx = Threading::AddInterlocked(m_numGeomRecords, 1) - 1;
+
+	if(recordIdx >= (int)m_maxQuads)
 		return;
 
-	memcpy(&m_pIndices[m_numIndices], indices, nIndx*sizeof(uint16));
-	m_numIndices += nIndx;
+	spriteGeomRecord_t& rec = m_geomRecords[recordIdx];
+	rec.firstIndex = firstIndex;
+	rec.numIndices = numIndices;
+	rec.order = order + 1;		// unordered geometry goes first
+
+	if(order >= 0)
+		m_hasOrderedGeom = true;
 }
 
 template <class VTX_TYPE>
@@ -150,6 +251,12 @@ int CSpriteBuilder<VTX_TYPE>::AllocateGeom( int nVertices, int nIndices, VTX_TYP
 	return _AllocateGeom(nVertices, nIndices, verts, indices, preSetIndices);
 }
 
+template <class VTX_TYPE>
+int CSpriteBuilder<VTX_TYPE>::AllocateQuads( int nQuads, VTX_TYPE** verts )
+{
+	return _AllocateQuads(nQuads, verts);
+}
+
 template <class VTX_TYPE>
 void CSpriteBuilder<VTX_TYPE>::AddParticleStrip(VTX_TYPE* verts, int nVertices)
 {
@@ -162,119 +269,200 @@ void CSpriteBuilder<VTX_TYPE>::AddParticleStrip(VTX_TYPE* verts, int nVertices)
 template <class VTX_TYPE>
 int CSpriteBuilder<VTX_TYPE>::_AllocateGeom( int nVertices, int nIndices, VTX_TYPE** verts, uint16** indices, bool preSetIndices )
 {
-	if((uint)(m_numVertices+nVertices) > m_maxQuads*4)
-	{
-		// don't warn me about overflow
-		m_numVertices = 0;
-		m_numIndices = 0;
-		return -1;
-	}
-
 	if(nVertices == 0)
 		return -1;
 
-	AddStripBreak();
+	int startVertex = ReserveVertices(nVertices);
 
-	int startVertex = m_numVertices;
-	int startIndex = m_numIndices;
+	if(startVertex < 0)
+		return -1;
 
 	// give the pointers
 	*verts = &m_pVerts[startVertex];
 
+	// non-indexed geometry
+	if(nIndices == 0 || (!indices && !preSetIndices))
+	{
+		if(indices)
+			*indices = NULL;
+
+		return startVertex;
+	}
+
+	// strip gets degenerate at the both ends and it's length is kept even
+	int numReserved = m_triangleListMode ? nIndices : (nIndices + 2 + (nIndices & 1));
+
+	int firstIndex = ReserveIndices(numReserved);
+
+	if(firstIndex < 0)
+		return -1;
+
+	uint16* stripIndices = &m_pIndices[firstIndex];
+
+	if(!m_triangleListMode)
+	{
+		int lastVertex = startVertex + (preSetIndices ? nIndices : nVertices) - 1;
+
+		stripIndices[0] = startVertex;
+
+		for(int i = nIndices+1; i < numReserved; i++)
+			stripIndices[i] = lastVertex;
+
+		stripIndices++;
+	}
+
 	// indices are optional
 	if(indices)
-		*indices = &m_pIndices[startIndex];
-
-	// apply offsets
-	m_numVertices += nVertices;
-	m_numIndices += nIndices;
+		*indices = stripIndices;
 
-	// make it linear and end with strip break
+	// make it linear
 	if(preSetIndices)
 	{
 		for(int i = 0; i < nIndices; i++)
-			m_pIndices[startIndex+i] = startVertex+i;
+			stripIndices[i] = startVertex+i;
 	}
 
+	AddGeomRecord(firstIndex, numReserved);
+
 	return startVertex;
 }
 
-// adds strip to list
 template <class VTX_TYPE>
-void CSpriteBuilder<VTX_TYPE>::_AddParticleStrip(VTX_TYPE* verts, int nVertices)
+int CSpriteBuilder<VTX_TYPE>::_AllocateQuads( int nQuads, VTX_TYPE** verts )
 {
-	if(m_triangleListMode)
-		return;
+	if(nQuads == 0)
+		return -1;
 
-	if(nVertices == 0)
-		return;
+	int startVertex = ReserveVertices(nQuads*4);
 
-	if((uint)(m_numVertices + nVertices) > m_maxQuads*4)
-	{
-		MsgWarning("ParticleRenderGroup overflow\n");
+	if(startVertex < 0)
+		return -1;
 
-		m_numVertices = 0;
-		m_numIndices = 0;
+	int firstIndex = ReserveIndices(nQuads*6);
 
-		return;
-	}
+	if(firstIndex < 0)
+		return -1;
 
-	int num_ind = m_numIndices;
+	*verts = &m_pVerts[startVertex];
 
-	uint16 nIndicesCurr = 0;
+	uint16* idx = &m_pIndices[firstIndex];
 
-	// if it's a second, first I'll add last index (3 if first, and add first one from fourIndices)
-	if( num_ind > 0 )
+	for(int i = 0; i < nQuads; i++)
 	{
-		uint16 lastIdx = m_pIndices[ num_ind-1 ];
+		uint16 v0 = startVertex + i*4;
+
+		if(m_triangleListMode)
+		{
+			idx[0] = v0;	idx[1] = v0+1;	idx[2] = v0+2;
+			idx[3] = v0+2;	idx[4] = v0+1;	idx[5] = v0+3;
+		}
+		else
+		{
+			idx[0] = v0;	idx[1] = v0;	idx[2] = v0+1;
+			idx[3] = v0+2;	idx[4] = v0+3;	idx[5] = v0+3;
+		}
+
+		idx += 6;
+	}
 
-		nIndicesCurr = lastIdx+1;
+	AddGeomRecord(firstIndex, nQuads*6);
 
-		// add two last indices to make degenerates
-		uint16 degenerate[2] = {lastIdx, nIndicesCurr};
+	return startVertex;
+}
 
-		AddIndices(degenerate, 2);
-	}
+// adds strip to list
+template <class VTX_TYPE>
+void CSpriteBuilder<VTX_TYPE>::_AddParticleStrip(VTX_TYPE* verts, int nVertices)
+{
+	if(m_triangleListMode)
+		return;
 
-	// add indices
+	VTX_TYPE* dest;
 
-	AddVertices(verts, nVertices);
+	if(_AllocateGeom(nVertices, nVertices, &dest, NULL, true) < 0)
+		return;
 
-	for(int i = 0; i < nVertices; i++)
-		m_pIndices[m_numIndices++] = nIndicesCurr+i;
+	memcpy(dest, verts, nVertices*sizeof(VTX_TYPE));
 }
 
+// must be called when there are no allocating threads
 template <class VTX_TYPE>
-void CSpriteBuilder<VTX_TYPE>::AddStripBreak()
+void CSpriteBuilder<VTX_TYPE>::SortGeometry()
 {
-	if(m_triangleListMode)
+	if(!m_hasOrderedGeom)
 		return;
 
-	int num_ind = m_numIndices;
+	m_hasOrderedGeom = false;
+
+	int numRecords = m_numGeomRecords;
+	int numIndices = GetIndexCount();
+	int firstIndex = m_triangleListMode ? 0 : 1;
+
+	if(numRecords > (int)m_maxQuads)
+		return;
 
-	uint16 nIndicesCurr = 0;
+	// records must cover all the indices or the geometry was allocated partially
+	int maxOrder = 0;
+	int numCovered = 0;
 
-	// if it's a second, first I'll add last index (3 if first, and add first one from fourIndices)
-	if( num_ind > 0 )
+	for(int i = 0; i < numRecords; i++)
 	{
-		uint16 lastIdx = m_pIndices[ num_ind-1 ];
+		maxOrder = max(maxOrder, m_geomRecords[i].order);
+		numCovered += m_geomRecords[i].numIndices;
+	}
+
+	if(numCovered != numIndices - firstIndex)
+		return;
 
-		nIndicesCurr = lastIdx+1;
+	// counting sort, records of same order are kept in allocation order
+	m_sortOffsets.setNum(maxOrder+1, false);
+	memset(m_sortOffsets.ptr(), 0, m_sortOffsets.numElem()*sizeof(int));
 
-		// add two last indices to make degenerates
-		uint16 degenerate[2] = {lastIdx, nIndicesCurr};
+	for(int i = 0; i < numRecords; i++)
+		m_sortOffsets[m_geomRecords[i].order] += m_geomRecords[i].numIndices;
 
-		AddIndices(degenerate, 2);
+	int offset = firstIndex;
+
+	for(int i = 0; i <= maxOrder; i++)
+	{
+		int count = m_sortOffsets[i];
+		m_sortOffsets[i] = offset;
+		offset += count;
+	}
+
+	for(int i = 0; i < numRecords; i++)
+	{
+		const spriteGeomRecord_t& rec = m_geomRecords[i];
+		int& dest = m_sortOffsets[rec.order];
+
+		memcpy(&m_sortIndices[dest], &m_pIndices[rec.firstIndex], rec.numIndices*sizeof(uint16));
+		dest += rec.numIndices;
 	}
 
-	//AddIndex( 0xFFFF );
+	memcpy(&m_pIndices[firstIndex], &m_sortIndices[firstIndex], (numIndices - firstIndex)*sizeof(uint16));
+
+	m_numGeomRecords = 0;
 }
 
 template <class VTX_TYPE>
 void CSpriteBuilder<VTX_TYPE>::ClearBuffers()
 {
-	m_numIndices = 0;
 	m_numVertices = 0;
+	m_numGeomRecords = 0;
+	m_hasOrderedGeom = false;
+
+	// filler index keeps every strip starting on odd index
+	if(m_triangleListMode)
+	{
+		m_numIndices = 0;
+	}
+	else
+	{
+		m_numIndices = 1;
+
+		if(m_pIndices)
+			m_pIndices[0] = 0;
+	}
 }
 
 #endif // SPRITEBUILDER_H
@@ -9,6 +9,7 @@
 #include "core/IConsoleCommands.h"
 #include "core/IEqCPUServices.h"
 #include "core/IEqParallelJobs.h"
+#include "core/IEqProfiler.h"
 #include "core/IFileSystem.h"
 
 #include "utils/strtools.h"
@@ -398,6 +399,9 @@ CGameHost::CGameHost() :
 	m_accumTime = 0.0;
 
 	m_fpsGraph.Init("Frames per sec", ColorRGB(1,1,0), 80.0f);
+
+	for(int i = 0; i < HOST_PROFILER_GRAPHS; i++)
+		m_profGraphs[i].Init("", ColorRGB(1,1,1), 16.0f);
 }
 
 void CGameHost::ShutdownSystems()
@@ -502,8 +506,82 @@ void CGameHost::SetCursorShow(bool bShow)
 ConVar r_showFPS("r_showFPS", "0", "Show the framerate", CV_ARCHIVE);
 ConVar r_showFPSGraph("r_showFPSGraph", "0", "Show the framerate graph", CV_ARCHIVE);
 
+void OnShowProfilerChanged(ConVar* pVar,char const* pszOldValue)
+{
+	g_profiler->SetEnabled(pVar->GetBool());
+	g_profiler->ResetStats();
+}
+
+ConVar sys_profiler("sys_profiler", "0", OnShowProfilerChanged, "Enables CPU profiler and shows it's scopes on the debug overlay", 0);
+
+DECLARE_CMD(sys_profiler_capture, "Captures CPU profiler scopes of the next frames into Chrome trace file. Usage: sys_profiler_capture <frames> [filename]", 0)
+{
+	if(CMD_ARGC == 0)
+	{
+		MsgWarning("Usage: sys_profiler_capture <frames> [filename]\n");
+		return;
+	}
+
+	int numFrames = atoi(CMD_ARGV(0).ToCString());
+	const char* fileName = CMD_ARGC > 1 ? CMD_ARGV(1).ToCString() : "logs/profile.json";
+
+	g_profiler->StartCapture(fileName, numFrames);
+}
+
+void CGameHost::DrawProfilerStats()
+{
+	static const ColorRGB graphColors[HOST_PROFILER_GRAPHS] = {
+		ColorRGB(1,0.5f,0), ColorRGB(0,0.75f,1), ColorRGB(1,0,1), ColorRGB(0.5f,1,0.5f)
+	};
+
+	eqProfNodeStats_t stats[128];
+	int numGraphs = 0;
+
+	debugoverlay->Text(Vector4D(1,1,0,1), "-----CPU PROFILER-----");
+
+	for(int i = 0; i < g_profiler->GetThreadCount(); i++)
+	{
+		int numStats = g_profiler->GetFrameStats(i, stats, 128);
+
+		if(!numStats)
+			continue;
+
+		debugoverlay->Text(Vector4D(0.5f,1,1,1), "%s:", g_profiler->GetThreadName(i));
+
+		for(int j = 0; j < numStats; j++)
+		{
+			eqProfNodeStats_t& stat = stats[j];
+
+			debugoverlay->Text(Vector4D(1), "%*s%s: %.2f ms (avg %.2f, max %.2f) x%d",
+				(stat.depth + 1) * 2, "", stat.name, stat.timeMs, stat.avgTimeMs, stat.maxTimeMs, stat.calls);
+
+			// graph the top scopes of the main thread
+			if(i > 0 || stat.depth > 1 || numGraphs >= HOST_PROFILER_GRAPHS)
+				continue;
+
+			debugGraphBucket_t& graph = m_profGraphs[numGraphs];
+
+			if(strcmp(graph.pszName, stat.name))
+			{
+				graph.Init(stat.name, graphColors[numGraphs], 16.0f, 0.0f, true);
+				graph.points.clear();
+			}
+
+			debugoverlay->Graph_DrawBucket(&graph);
+			debugoverlay->Graph_AddValue(&graph, stat.timeMs);
+
+			numGraphs++;
+		}
+	}
+}
+
 bool CGameHost::Frame()
 {
+	// previous frame is done
+	g_profiler->EndFrame();
+
+	PROF_EVENT("Host Frame");
+
 	double elapsedTime = m_timer.GetTime(true);
 
 	// Engine frames status
@@ -546,8 +624,12 @@ bool CGameHost::Frame()
 	g_pShaderAPI->Clear(r_clear.GetBool(),true,false, ColorRGBA(0.1f,0.1f,0.1f,1.0f));
 
 	double timescale = (EqStateMgr::GetCurrentState() ? EqStateMgr::GetCurrentState()->GetTimescale() : 1.0f);
+	double stateFrameTime = gameFrameTime * timescale * sys_timescale.GetFloat();
 
-	if(!EqStateMgr::UpdateStates(gameFrameTime * timescale * sys_timescale.GetFloat()))
+	// animate materials that are likely to be drawn before the game renders
+	materials->UpdateMaterialProxies(stateFrameTime);
+
+	if(!EqStateMgr::UpdateStates(stateFrameTime))
 	{
 		m_nQuitState = CGameHost::QUIT_TODESKTOP;
 		return false;
@@ -587,6 +669,9 @@ bool CGameHost::Frame()
 	debugoverlay->Text(Vector4D(1), "DPS/DIPS: %i/%i", g_pShaderAPI->GetDrawCallsCount(), g_pShaderAPI->GetDrawIndexedPrimitiveCallsCount());
 	debugoverlay->Text(Vector4D(1), "primitives: %i", g_pShaderAPI->GetTrianglesCount());
 
+	if(sys_profiler.GetBool())
+		DrawProfilerStats();
+
 	debugoverlay->Draw(m_winSize.x, m_winSize.y);
 
 	materials->Setup2D(m_winSize.x, m_winSize.y);
@@ -15,6 +15,8 @@
 
 #include "render/IDebugOverlay.h"
 
+#define HOST_PROFILER_GRAPHS		4
+
 #include "materialsystem1/IMaterialSystem.h"
 
 
@@ -100,7 +102,10 @@ protected:
 
 	bool				FilterTime( double fDt );
 
+	void				DrawProfilerStats();
+
 	debugGraphBucket_t m_fpsGraph;
+	debugGraphBucket_t m_profGraphs[HOST_PROFILER_GRAPHS];
 
 	IVector2D	m_winSize;
 	IVector2D	m_mousePos;
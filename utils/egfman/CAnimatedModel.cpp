@@ -9,11 +9,24 @@
 #include "materialsystem1/IMaterialSystem.h"
 #include "materialsystem1/MeshBuilder.h"
 
+#include "materialsystem1/VertexFormatBuilder.h"
+
+#include "core/ConVar.h"
 #include "render/IDebugOverlay.h"
 #include "physics/PhysicsCollisionGroup.h"
 
 #define INITIAL_TIME 0.0f
 
+#define MAX_MODEL_COPIES	4096
+
+ConVar egf_modelCopies("egf_modelCopies", "0", "Draws copies of the model in reference pose using render queue instancing");
+
+static VertexFormatDesc_t g_egfmanInstanceFormat[] = {
+	{ 2, 4, VERTEXATTRIB_TEXCOORD, ATTRIBUTEFORMAT_FLOAT, "instTransform0" },
+	{ 2, 4, VERTEXATTRIB_TEXCOORD, ATTRIBUTEFORMAT_FLOAT, "instTransform1" },
+	{ 2, 4, VERTEXATTRIB_TEXCOORD, ATTRIBUTEFORMAT_FLOAT, "instTransform2" },
+};
+
 CAnimatedModel::CAnimatedModel()
 {
 	m_pModel = nullptr;
@@ -22,6 +35,10 @@ CAnimatedModel::CAnimatedModel()
 	m_bPhysicsEnable = false;
 
 	m_bodyGroupFlags = 0xFFFFFFF;
+	m_renderTransform = identity4();
+
+	// viewed model is the occluder
+	SetRenderFlags(RF_SKIPVISIBILITYTEST);
 }
 
 // sets model for this entity
@@ -47,6 +64,22 @@ void CAnimatedModel::SetModel(IEqModel* pModel)
 	// initialize that shit to use it in future
 	InitAnimating(m_pModel);
 
+	// model frees it's instancer
+	if(!m_pModel->GetInstancer())
+	{
+		CVertexFormatBuilder fmtBuilder;
+		fmtBuilder.SetStream(0, g_EGFHwVertexFormat, elementsOf(g_EGFHwVertexFormat), "EGFVertex");
+		fmtBuilder.SetStream(2, g_egfmanInstanceFormat, elementsOf(g_egfmanInstanceFormat), "Instance");
+
+		VertexFormatDesc_t* instFormat = nullptr;
+		int numAttrib = fmtBuilder.Build(&instFormat);
+
+		CEGFInstancer<egfmanInstance_t>* instancer = new CEGFInstancer<egfmanInstance_t>();
+		instancer->Init(instFormat, numAttrib);
+
+		m_pModel->SetInstancer(instancer);
+	}
+
 	if(m_pModel->GetHWData()->physModel.modeltype == PHYSMODEL_USAGE_RAGDOLL)
 	{
 		m_pRagdoll = CreateRagdoll( m_pModel );
@@ -404,10 +437,12 @@ void CAnimatedModel::Render(int nViewRenderFlags, float fDist, int startLod, boo
 			posMatrix = m_physObj->GetTransformMatrix();
 	}
 
-	materials->SetMatrix(MATRIXMODE_WORLD, posMatrix);
+	m_renderTransform = posMatrix;
 
 	studiohdr_t* pHdr = m_pModel->GetHWData()->studio;
 
+	UpdateCopies( clamp(egf_modelCopies.GetInt(), 0, MAX_MODEL_COPIES) );
+
 	/*
 	Vector3D view_vec = g_pViewEntity->GetEyeOrigin() - m_matWorldTransform.getTranslationComponent();
 
@@ -435,38 +470,35 @@ void CAnimatedModel::Render(int nViewRenderFlags, float fDist, int startLod, boo
 		if(!(m_bodyGroupFlags & (1 << i)))
 			continue;
 
-		int bodyGroupLOD = nStartLOD;
-		int nLodModelIdx = pHdr->pBodyGroups(i)->lodModelIndex;
-		studiolodmodel_t* lodModel = pHdr->pLodModel(nLodModelIdx);
-
-		int nModDescId = lodModel->modelsIndexes[ bodyGroupLOD ];
-
-		// get the right LOD model number
-		while(nModDescId == -1 && bodyGroupLOD > 0)
-		{
-			bodyGroupLOD--;
-			nModDescId = lodModel->modelsIndexes[ bodyGroupLOD ];
-		}
+		int nModDescId = GetModelDescId(i, nStartLOD);
 
 		if(nModDescId == -1)
 			continue;
 	
 		studiomodeldesc_t* modDesc = pHdr->pModelDesc(nModDescId);
 
-		// render model groups that in this body group
+		// queue model groups that in this body group, they get sorted by material
 		for(int j = 0; j < modDesc->numGroups; j++)
 		{
-			materials->SetSkinningEnabled(true);
+			IMaterial* pMaterial = m_pModel->GetMaterial( modDesc->pGroup(j)->materialIndex );
 
-			materials->BindMaterial( m_pModel->GetMaterial( modDesc->pGroup(j)->materialIndex ), 0);
+			m_renderList.AddDrawItem(this, pMaterial, NULL, fDist, 0, (nModDescId << 16) | j);
 
-			m_pModel->PrepareForSkinning(m_boneTransforms);
-			m_pModel->DrawGroup( nModDescId, j );
+			// copies with the same model, bodygroup, LOD and material are drawn as instances
+			if(i >= MAX_INSTANCE_BODYGROUPS || nStartLOD >= MAX_INSTANCE_LODS)
+				continue;
 
-			materials->SetSkinningEnabled(false);
+			for(int k = 0; k < m_copies.numElem(); k++)
+				m_renderList.AddDrawItem(&m_copies[k], pMaterial, NULL, fDist, 0, EGF_INSTANCE_PARAM(i, nStartLOD, j), m_pModel);
 		}
 	}
 
+	CullOccludedCopies();
+
+	m_renderList.SortDrawItems();
+	m_renderList.RenderDrawItems(nViewRenderFlags, NULL);
+	m_renderList.Clear();
+
 	if(nViewRenderFlags & RFLAG_PHYSICS)
 		RenderPhysModel();
 
@@ -474,6 +506,167 @@ void CAnimatedModel::Render(int nViewRenderFlags, float fDist, int startLod, boo
 		VisualizeBones();
 }
 
+// renders whole model at the selected LOD
+void CAnimatedModel::Render(int nViewRenderFlags, void* userdata)
+{
+	Render(nViewRenderFlags, 0.0f, 0, false, 0.0f);
+}
+
+// renders model group queued by Render
+void CAnimatedModel::RenderQueueItem(const renderQueueItem_t& item, int nViewRenderFlags, void* userdata)
+{
+	materials->SetMatrix(MATRIXMODE_WORLD, m_renderTransform);
+	materials->SetAmbientColor( color4_white );
+
+	materials->SetSkinningEnabled(true);
+
+	materials->BindMaterial(item.material, 0);
+
+	m_pModel->PrepareForSkinning(m_boneTransforms);
+	m_pModel->DrawGroup( item.userParam >> 16, item.userParam & 0xFFFF );
+
+	materials->SetSkinningEnabled(false);
+}
+
+void CAnimatedModel::GetBoundingBox(BoundingBox& outBox)
+{
+	if(m_pModel)
+		outBox = m_pModel->GetAABB();
+	else
+		outBox.Reset();
+}
+
+int CAnimatedModel::GetModelDescId(int bodyGroup, int lod) const
+{
+	studiohdr_t* pHdr = m_pModel->GetHWData()->studio;
+
+	int nLodModelIdx = pHdr->pBodyGroups(bodyGroup)->lodModelIndex;
+	studiolodmodel_t* lodModel = pHdr->pLodModel(nLodModelIdx);
+
+	lod = clamp(lod, 0, MAX_MODELLODS-1);
+
+	int nModDescId = lodModel->modelsIndexes[ lod ];
+
+	// get the right LOD model number
+	while(nModDescId == -1 && lod > 0)
+	{
+		lod--;
+		nModDescId = lodModel->modelsIndexes[ lod ];
+	}
+
+	return nModDescId;
+}
+
+// places copies in rows next to the model
+void CAnimatedModel::UpdateCopies(int numCopies)
+{
+	m_copies.setNum(numCopies, false);
+
+	if(!numCopies)
+		return;
+
+	Vector3D spacing = m_pModel->GetAABB().GetSize() * 1.5f;
+
+	int rowSize = (int)ceil(sqrt((float)numCopies));
+
+	for(int i = 0; i < numCopies; i++)
+	{
+		Vector3D offset((i % rowSize + 1) * spacing.x, 0.0f, (i / rowSize) * spacing.z);
+
+		m_copies[i].m_owner = this;
+		m_copies[i].m_transform = translate(offset);
+	}
+}
+
+void CAnimatedModel::CullOccludedCopies()
+{
+	studioPhysData_t& physModel = m_pModel->GetHWData()->physModel;
+
+	// ragdoll geometry is in bone space
+	if(!m_copies.numElem() || !physModel.numIndices || physModel.modeltype == PHYSMODEL_USAGE_RAGDOLL)
+		return;
+
+	if(!m_occlusion.GetWidth())
+		m_occlusion.Init();
+
+	Matrix4x4 view, proj;
+	materials->GetMatrix(MATRIXMODE_VIEW, view);
+	materials->GetMatrix(MATRIXMODE_PROJECTION, proj);
+
+	m_occlusion.BeginFrame(proj*view);
+
+	m_occluderVerts.setNum(physModel.numVertices, false);
+
+	for(int i = 0; i < physModel.numVertices; i++)
+		m_occluderVerts[i] = (m_renderTransform*Vector4D(physModel.vertices[i], 1.0f)).xyz();
+
+	m_occlusion.AddOccluder(m_occluderVerts.ptr(), physModel.indices, physModel.numIndices);
+	m_occlusion.Rasterize();
+
+	m_renderList.RemoveOccluded(&m_occlusion);
+}
+
+//-------------------------------------------------------
+
+void CAnimatedModelCopy::Render(int nViewRenderFlags, void* userdata)
+{
+	IEqModel* model = m_owner->m_pModel;
+	studiohdr_t* pHdr = model->GetHWData()->studio;
+
+	materials->SetMatrix(MATRIXMODE_WORLD, m_transform);
+	materials->SetAmbientColor( color4_white );
+
+	for(int i = 0; i < pHdr->numBodyGroups; i++)
+	{
+		if(!(m_owner->m_bodyGroupFlags & (1 << i)))
+			continue;
+
+		int nModDescId = m_owner->GetModelDescId(i, 0);
+
+		if(nModDescId == -1)
+			continue;
+
+		studiomodeldesc_t* modDesc = pHdr->pModelDesc(nModDescId);
+
+		for(int j = 0; j < modDesc->numGroups; j++)
+		{
+			materials->BindMaterial(model->GetMaterial(modDesc->pGroup(j)->materialIndex), 0);
+			model->DrawGroup(nModDescId, j);
+		}
+	}
+}
+
+// draws single copy when render queue instancing is disabled
+void CAnimatedModelCopy::RenderQueueItem(const renderQueueItem_t& item, int nViewRenderFlags, void* userdata)
+{
+	int nModDescId = m_owner->GetModelDescId(EGF_INSTANCE_PARAM_BODYGROUP(item.userParam), EGF_INSTANCE_PARAM_LOD(item.userParam));
+
+	if(nModDescId == -1)
+		return;
+
+	materials->SetMatrix(MATRIXMODE_WORLD, m_transform);
+	materials->SetAmbientColor( color4_white );
+
+	materials->BindMaterial(item.material, 0);
+	m_owner->m_pModel->DrawGroup(nModDescId, EGF_INSTANCE_PARAM_GROUP(item.userParam));
+}
+
+void CAnimatedModelCopy::GetBoundingBox(BoundingBox& outBox)
+{
+	m_owner->GetBoundingBox(outBox);
+
+	Vector3D offset = m_transform.getTranslationComponentTransposed();
+	outBox.minPoint += offset;
+	outBox.maxPoint += offset;
+}
+
+void CAnimatedModelCopy::FillInstance(egfmanInstance_t& instance)
+{
+	instance.transform[0] = m_transform.rows[0];
+	instance.transform[1] = m_transform.rows[1];
+	instance.transform[2] = m_transform.rows[2];
+}
+
 void CAnimatedModel::VisualizeBones()
 {
 	Matrix4x4 posMatrix = identity4();
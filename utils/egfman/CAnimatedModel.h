@@ -9,6 +9,9 @@
 #include "egf/studio_egf.h"
 #include "animating/Animating.h"
 #include "dkphysics/ragdoll.h"
+#include "render/RenderList.h"
+#include "render/EGFInstancer.h"
+#include "render/OcclusionBuffer.h"
 
 enum ViewerRenderFlags
 {
@@ -17,15 +20,40 @@ enum ViewerRenderFlags
 	RFLAG_WIREFRAME	= (1 << 2),
 };
 
+class CAnimatedModel;
+
+// instance data of model copies
+struct egfmanInstance_t
+{
+	Vector4D					transform[3];	// first three rows of world matrix
+};
+
+// copy of viewed model in reference pose, drawn by render queue instancing
+class CAnimatedModelCopy : public CEGFInstancedRenderable<egfmanInstance_t>
+{
+public:
+	virtual void				Render(int nViewRenderFlags, void* userdata);
+	virtual void				RenderQueueItem(const renderQueueItem_t& item, int nViewRenderFlags, void* userdata);
+	virtual void				GetBoundingBox(BoundingBox& outBox);
+
+	virtual void				FillInstance(egfmanInstance_t& instance);
+
+	CAnimatedModel*				m_owner;
+	Matrix4x4					m_transform;
+};
+
 // basic animating class
 // for ragdoll use baseragdollanimating
-class CAnimatedModel : public CAnimatingEGF
+class CAnimatedModel : public CAnimatingEGF, public CBaseRenderableObject
 {
 public:
 								CAnimatedModel();
 
 	// renders model
 	virtual void				Render(int nViewRenderFlags, float fDist, int startLod, bool overrideLod, float dt);
+	virtual void				Render(int nViewRenderFlags, void* userdata);
+	virtual void				RenderQueueItem(const renderQueueItem_t& item, int nViewRenderFlags, void* userdata);
+	virtual void				GetBoundingBox(BoundingBox& outBox);
 	virtual void				RenderPhysModel();
 	virtual void				Update(float dt);
 
@@ -58,6 +86,20 @@ protected:
 
 	void						AttachIKChain(int chain, int attach_type);
 
+	// places copies of the model for instancing preview
+	void						UpdateCopies(int numCopies);
+
+	// model physics geometry hides copies behind it
+	void						CullOccludedCopies();
+
+	CRenderList					m_renderList;
+	Matrix4x4					m_renderTransform;
+
+	DkList<CAnimatedModelCopy>	m_copies;
+
+	COcclusionBuffer			m_occlusion;
+	DkList<Vector3D>			m_occluderVerts;
+
 public:
 
 	IEqModel*					m_pModel;
@@ -66,4 +108,7 @@ public:
 	bool						m_bPhysicsEnable;
 
 	int							m_bodyGroupFlags;
+
+	// returns model description of body group at LOD or lower one, -1 if there is none
+	int							GetModelDescId(int bodyGroup, int lod) const;
 };
\ No newline at end of file
@@ -0,0 +1,559 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: KeyValues benchmarks
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "KVBenchmark.h"
+#include "KeyValuesReference.h"
+
+#include "core/DebugInterface.h"
+#include "core/IFileSystem.h"
+#include "core/cmdlib.h"
+#include "core/ppmem.h"
+
+#include "utils/KeyValues.h"
+#include "utils/VirtualStream.h"
+#include "utils/eqtimer.h"
+#include "utils/strtools.h"
+
+#include "math/math_common.h"
+
+#include "math/Random.h"
+
+#include <stdio.h>
+
+// lookup without the key index, as FindKeyBase did before
+static kvkeybase_t* KVBench_FindKeyLinear(const kvkeybase_t* section, const char* pszName)
+{
+	for(int i = 0; i < section->keys.numElem(); i++)
+	{
+		if(!stricmp(section->keys[i]->name, pszName))
+			return section->keys[i];
+	}
+
+	return NULL;
+}
+
+static void KVBench_CollectSections(kvkeybase_t* base, DkList<kvkeybase_t*>& sections, int& numKeys)
+{
+	if(base->keys.numElem() == 0)
+		return;
+
+	sections.append(base);
+	numKeys += base->keys.numElem();
+
+	for(int i = 0; i < base->keys.numElem(); i++)
+		KVBench_CollectSections(base->keys[i], sections, numKeys);
+}
+
+// looks up every child name in every section. Returns number of mismatches against linear search
+static int KVBench_QueryPass(DkList<kvkeybase_t*>& sections, bool linear)
+{
+	int numErrors = 0;
+
+	for(int i = 0; i < sections.numElem(); i++)
+	{
+		kvkeybase_t* section = sections[i];
+
+		for(int j = 0; j < section->keys.numElem(); j++)
+		{
+			const char* name = section->keys[j]->name;
+
+			kvkeybase_t* found = linear ? KVBench_FindKeyLinear(section, name) : section->FindKeyBase(name);
+
+			// duplicate names resolve to the first key
+			if(!found || stricmp(found->name, name) || found != KVBench_FindKeyLinear(section, name))
+				numErrors++;
+		}
+	}
+
+	return numErrors;
+}
+
+void KVBench_Query(const char* pszName, const char* pszBuffer, int numRepeats)
+{
+	CEqTimer timer;
+
+	kvkeybase_t* root = KV_ParseSection(pszBuffer, pszName, NULL, 0);
+
+	double parseTime = timer.GetTime(true);
+
+	if(!root)
+	{
+		MsgError("%s: parse failed\n", pszName);
+		return;
+	}
+
+	DkList<kvkeybase_t*> sections;
+	int numKeys = 0;
+
+	KVBench_CollectSections(root, sections, numKeys);
+
+	int largestSection = 0;
+	for(int i = 0; i < sections.numElem(); i++)
+		largestSection = max(largestSection, sections[i]->keys.numElem());
+
+	// counts found keys so lookups aren't optimized out
+	int numFound = 0;
+
+	timer.GetTime(true);
+
+	for(int i = 0; i < numRepeats; i++)
+	{
+		for(int j = 0; j < sections.numElem(); j++)
+		{
+			kvkeybase_t* section = sections[j];
+
+			for(int k = 0; k < section->keys.numElem(); k++)
+				numFound += KVBench_FindKeyLinear(section, section->keys[k]->name) != NULL;
+		}
+	}
+
+	double linearTime = timer.GetTime(true);
+
+	// first indexed pass builds the indices of big sections
+	int numErrors = KVBench_QueryPass(sections, false);
+
+	timer.GetTime(true);
+
+	for(int i = 0; i < sections.numElem(); i++)
+	{
+		kvkeybase_t* section = sections[i];
+
+		for(int k = 0; k < section->keys.numElem(); k++)
+			numFound += section->FindKeyBase(section->keys[k]->name) != NULL;
+	}
+
+	double coldTime = timer.GetTime(true);
+
+	for(int i = 0; i < numRepeats; i++)
+	{
+		for(int j = 0; j < sections.numElem(); j++)
+		{
+			kvkeybase_t* section = sections[j];
+
+			for(int k = 0; k < section->keys.numElem(); k++)
+				numFound += section->FindKeyBase(section->keys[k]->name) != NULL;
+		}
+	}
+
+	double indexedTime = timer.GetTime(true);
+
+	delete root;
+
+	int numLookups = numKeys * numRepeats;
+
+	// every key name is found in linear, first and repeated passes
+	if(numFound != numLookups*2 + numKeys)
+		numErrors++;
+
+	Msg("%s: %d sections, %d keys (largest section %d)\n", pszName, sections.numElem(), numKeys, largestSection);
+	Msg("  parse:   %.2f ms\n", parseTime * 1000.0);
+	Msg("  linear:  %.2f ms (%.1f ns/lookup)\n", linearTime * 1000.0, linearTime * 1e9 / max(numLookups, 1));
+	Msg("  indexed: %.2f ms (%.1f ns/lookup), first pass %.2f ms\n", indexedTime * 1000.0, indexedTime * 1e9 / max(numLookups, 1), coldTime * 1000.0);
+
+	if(numErrors)
+		MsgError("  %d lookups didn't match linear search!\n", numErrors);
+}
+
+void KVBench_QueryFile(const char* pszFileName, int numRepeats)
+{
+	long fileSize = 0;
+	char* buffer = g_fileSystem->GetFileBuffer(pszFileName, &fileSize, SP_ROOT);
+
+	if(!buffer)
+	{
+		MsgError("Can't open '%s'\n", pszFileName);
+		return;
+	}
+
+	KVBench_Query(pszFileName, buffer, numRepeats);
+
+	PPFree(buffer);
+}
+
+char* KVBench_GenerateSection(int numKeys)
+{
+	// every key takes less than 64 characters
+	int bufferSize = 64 + numKeys * 64;
+	char* buffer = (char*)PPAlloc(bufferSize);
+
+	char* str = buffer;
+	str += sprintf(str, "Shader \"BaseUnlit\"\n{\n");
+
+	for(int i = 0; i < numKeys; i++)
+		str += sprintf(str, "\t$Parameter%d \"textures/generated/texture%d\";\n", i, i);
+
+	sprintf(str, "}\n");
+
+	return buffer;
+}
+
+//-------------------------------------------------------------------------------
+// Parser throughput
+//-------------------------------------------------------------------------------
+
+typedef kvkeybase_t* (*KVPARSEFUNC)(const char* pszBuffer, int bufferSize, const char* pszName);
+
+static kvkeybase_t* KVBench_ParseV2(const char* pszBuffer, int bufferSize, const char* pszName)
+{
+	return KV_ParseSection(pszBuffer, pszName, NULL, 0);
+}
+
+static kvkeybase_t* KVBench_ParseV2Ref(const char* pszBuffer, int bufferSize, const char* pszName)
+{
+	return KVRef_ParseSection(pszBuffer, pszName, NULL, 0);
+}
+
+static kvkeybase_t* KVBench_ParseV3(const char* pszBuffer, int bufferSize, const char* pszName)
+{
+	return KV_ParseSectionV3(pszBuffer, bufferSize, pszName, NULL, 0);
+}
+
+static kvkeybase_t* KVBench_ParseV3Ref(const char* pszBuffer, int bufferSize, const char* pszName)
+{
+	return KVRef_ParseSectionV3(pszBuffer, bufferSize, pszName, NULL, 0);
+}
+
+struct kvBenchParser_t
+{
+	const char*		name;
+	KVPARSEFUNC		parse;
+	KVPARSEFUNC		reference;
+};
+
+static kvBenchParser_t s_kvBenchParsers[] = {
+	{"KV_ParseSection", KVBench_ParseV2, KVBench_ParseV2Ref},
+	{"KV_ParseSectionV3", KVBench_ParseV3, KVBench_ParseV3Ref},
+};
+
+// parse errors are expected from the mutated input
+static void KVBench_QuietSpew(SpewType_t type, const char* pMsg)
+{
+}
+
+// Install_SpewFunction does nothing outside Windows, reset to default output first
+static void KVBench_RestoreSpew()
+{
+	SetSpewFunction(nullptr);
+	Install_SpewFunction();
+}
+
+// writes line numbers and types of the keys
+static void KVBench_DumpKeyLines(kvkeybase_t* base, EqString& out)
+{
+	for(int i = 0; i < base->keys.numElem(); i++)
+	{
+		out.Append(varargs("%d:%d,", base->keys[i]->line, base->keys[i]->type));
+		KVBench_DumpKeyLines(base->keys[i], out);
+	}
+}
+
+static void KVBench_DumpTree(kvkeybase_t* base, EqString& out)
+{
+	out.Empty();
+
+	if(!base)
+	{
+		out = "NULL";
+		return;
+	}
+
+	CMemoryStream stream;
+	stream.Open(NULL, VS_OPEN_WRITE, 1024);
+
+	KV_WriteToStreamV3(&stream, base, 0, true);
+	stream.Write("\0", 1, 1);
+
+	out = (const char*)stream.GetBasePointer();
+
+	KVBench_DumpKeyLines(base, out);
+}
+
+static double KVBench_TimeParser(KVPARSEFUNC parse, const char* pszName, const char* pszBuffer, int bufferSize, int numRepeats)
+{
+	CEqTimer timer;
+
+	for(int i = 0; i < numRepeats; i++)
+		delete parse(pszBuffer, bufferSize, pszName);
+
+	return timer.GetTime();
+}
+
+void KVBench_Parse(const char* pszName, const char* pszBuffer, int bufferSize, int numRepeats)
+{
+	// parsers are restoring buffer after temporary modifications
+	char* buffer = (char*)PPAlloc(bufferSize+1);
+	memcpy(buffer, pszBuffer, bufferSize);
+	buffer[bufferSize] = 0;
+
+	double megabytes = double(bufferSize) * numRepeats / (1024.0 * 1024.0);
+
+	Msg("%s: %.1f KB\n", pszName, bufferSize / 1024.0f);
+
+	SetSpewFunction(KVBench_QuietSpew);
+
+	for(int i = 0; i < elementsOf(s_kvBenchParsers); i++)
+	{
+		kvBenchParser_t& parser = s_kvBenchParsers[i];
+
+		EqString tree, refTree;
+
+		kvkeybase_t* base = parser.parse(buffer, bufferSize, pszName);
+		KVBench_DumpTree(base, tree);
+		delete base;
+
+		base = parser.reference(buffer, bufferSize, pszName);
+		KVBench_DumpTree(base, refTree);
+		delete base;
+
+		double refTime = KVBench_TimeParser(parser.reference, pszName, buffer, bufferSize, numRepeats);
+		double time = KVBench_TimeParser(parser.parse, pszName, buffer, bufferSize, numRepeats);
+
+		KVBench_RestoreSpew();
+
+		Msg("  %s: %.1f MB/s, reference %.1f MB/s (x%.2f)\n", parser.name, megabytes / max(time, 1e-9), megabytes / max(refTime, 1e-9), refTime / max(time, 1e-9));
+
+		if(tree.Compare(refTree))
+			MsgError("  %s: tree differs from the reference parser!\n", parser.name);
+
+		SetSpewFunction(KVBench_QuietSpew);
+	}
+
+	KVBench_RestoreSpew();
+
+	PPFree(buffer);
+}
+
+static int KVBench_SkipBOM(const char* pszBuffer, int bufferSize)
+{
+	if(bufferSize >= 3 && !memcmp(pszBuffer, "\xEF\xBB\xBF", 3))
+		return 3;
+
+	return 0;
+}
+
+void KVBench_ParseFile(const char* pszFileName, int numRepeats)
+{
+	long fileSize = 0;
+	char* buffer = g_fileSystem->GetFileBuffer(pszFileName, &fileSize, SP_ROOT);
+
+	if(!buffer)
+	{
+		MsgError("Can't open '%s'\n", pszFileName);
+		return;
+	}
+
+	int start = KVBench_SkipBOM(buffer, fileSize);
+	KVBench_Parse(pszFileName, buffer + start, fileSize - start, numRepeats);
+
+	PPFree(buffer);
+}
+
+//-------------------------------------------------------------------------------
+// Fuzzing
+//-------------------------------------------------------------------------------
+
+#define KVFUZZ_MAX_GROW			512
+#define KVFUZZ_MAX_MUTATIONS	4
+#define KVFUZZ_MAX_REPORTS		4
+
+// tokens which are changing the parser state
+static const char* s_kvFuzzTokens[] = {
+	"{", "}", "[", "]", ",", ";", ":", "\"", "\\\"", "\\n", "\\",
+	"/", "*", "//", "/*", "*/", "\n", "\r\n", " ", "\t",
+	"key", "\"quoted value\"", "1.5", "section {", "}\n", ":int", ":section", "[1, 2]",
+};
+
+static int KVBench_Mutate(CUniformRandomStream& rnd, char* text, int length, int maxLength)
+{
+	int pos = length ? rnd.RandomInt(0, length-1) : 0;
+
+	switch(rnd.RandomInt(0, 4))
+	{
+		case 0:	// insert token
+		{
+			const char* token = s_kvFuzzTokens[rnd.RandomInt(0, elementsOf(s_kvFuzzTokens)-1)];
+			int tokenLen = strlen(token);
+
+			if(length + tokenLen > maxLength)
+				break;
+
+			memmove(text + pos + tokenLen, text + pos, length - pos);
+			memcpy(text + pos, token, tokenLen);
+			length += tokenLen;
+			break;
+		}
+		case 1:	// remove range
+		{
+			int count = min(rnd.RandomInt(1, 16), length - pos);
+
+			memmove(text + pos, text + pos + count, length - pos - count);
+			length -= count;
+			break;
+		}
+		case 2:	// replace character
+		{
+			const char chars[] = "{}[],;:\"/*\\\n\r\t a1";
+
+			if(length)
+				text[pos] = chars[rnd.RandomInt(0, sizeof(chars)-2)];
+			break;
+		}
+		case 3:	// duplicate range
+		{
+			int count = min(rnd.RandomInt(1, 32), length - pos);
+			int dest = rnd.RandomInt(0, length);
+
+			if(length + count > maxLength)
+				break;
+
+			memmove(text + dest + count, text + dest, length - dest);
+
+			// source is moved too if it was after insertion point
+			int src = pos >= dest ? pos + count : pos;
+
+			if(src < dest && src + count > dest)
+				count = dest - src;
+
+			memmove(text + dest, text + src, count);
+			length += count;
+			break;
+		}
+		case 4:	// truncate
+			length = pos;
+			break;
+	}
+
+	text[length] = 0;
+
+	return length;
+}
+
+int KVBench_Fuzz(const char** buffers, const int* sizes, int numBuffers, int numIterations, int seed)
+{
+	if(numBuffers <= 0)
+		return 0;
+
+	CUniformRandomStream rnd;
+	rnd.SetSeed(seed);
+
+	int maxSize = 0;
+	for(int i = 0; i < numBuffers; i++)
+		maxSize = max(maxSize, sizes[i]);
+
+	int maxLength = maxSize + KVFUZZ_MAX_GROW;
+
+	char* text = (char*)PPAlloc(maxLength+1);
+	char* copy = (char*)PPAlloc(maxLength+1);
+
+	EqString tree, refTree;
+
+	int numErrors = 0;
+
+	SetSpewFunction(KVBench_QuietSpew);
+
+	for(int i = 0; i < numIterations; i++)
+	{
+		int src = rnd.RandomInt(0, numBuffers-1);
+
+		int length = sizes[src];
+		memcpy(text, buffers[src], length);
+		text[length] = 0;
+
+		int numMutations = rnd.RandomInt(1, KVFUZZ_MAX_MUTATIONS);
+
+		for(int j = 0; j < numMutations; j++)
+			length = KVBench_Mutate(rnd, text, length, maxLength);
+
+		for(int j = 0; j < elementsOf(s_kvBenchParsers); j++)
+		{
+			kvBenchParser_t& parser = s_kvBenchParsers[j];
+
+			// each parser gets it's own copy
+			memcpy(copy, text, length+1);
+			kvkeybase_t* base = parser.parse(copy, length, "fuzz");
+			KVBench_DumpTree(base, tree);
+			delete base;
+
+			memcpy(copy, text, length+1);
+			base = parser.reference(copy, length, "fuzz");
+			KVBench_DumpTree(base, refTree);
+			delete base;
+
+			if(!tree.Compare(refTree))
+				continue;
+
+			numErrors++;
+
+			if(numErrors <= KVFUZZ_MAX_REPORTS)
+			{
+				KVBench_RestoreSpew();
+				MsgError("%s: iteration %d differs from the reference parser. Input:\n%s\n----\n", parser.name, i, text);
+				SetSpewFunction(KVBench_QuietSpew);
+			}
+		}
+	}
+
+	KVBench_RestoreSpew();
+
+	PPFree(text);
+	PPFree(copy);
+
+	return numErrors;
+}
+
+int KVBench_FuzzFiles(const char* pszCorpusPath, int numIterations, int seed)
+{
+	DkList<char*> buffers;
+	DkList<const char*> corpus;
+	DkList<int> sizes;
+
+	EqString searchPath;
+	CombinePath(searchPath, 2, pszCorpusPath, "*.*");
+
+	DKFINDDATA* findData = NULL;
+	const char* fileName = g_fileSystem->FindFirst(searchPath.ToCString(), &findData, SP_ROOT);
+
+	while(fileName)
+	{
+		if(!g_fileSystem->FindIsDirectory(findData))
+		{
+			EqString filePath;
+			CombinePath(filePath, 2, pszCorpusPath, fileName);
+
+			long fileSize = 0;
+			char* buffer = g_fileSystem->GetFileBuffer(filePath.ToCString(), &fileSize, SP_ROOT);
+
+			if(buffer)
+			{
+				int start = KVBench_SkipBOM(buffer, fileSize);
+
+				buffers.append(buffer);
+				corpus.append(buffer + start);
+				sizes.append(fileSize - start);
+			}
+		}
+
+		fileName = g_fileSystem->FindNext(findData);
+	}
+
+	if(findData)
+		g_fileSystem->FindClose(findData);
+
+	Msg("Fuzzing %d corpus files from '%s', %d iterations\n", corpus.numElem(), pszCorpusPath, numIterations);
+
+	int numErrors = KVBench_Fuzz(corpus.ptr(), sizes.ptr(), corpus.numElem(), numIterations, seed);
+
+	if(numErrors)
+		MsgError("%d parsed trees differ from the reference parsers\n", numErrors);
+	else
+		MsgInfo("All parsed trees are identical\n");
+
+	for(int i = 0; i < buffers.numElem(); i++)
+		PPFree(buffers[i]);
+
+	return numErrors;
+}
@@ -0,0 +1,28 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: KeyValues benchmarks
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef KVBENCHMARK_H
+#define KVBENCHMARK_H
+
+// loads file and runs child key lookups on all of it's sections
+void		KVBench_QueryFile(const char* pszFileName, int numRepeats);
+
+// parses buffer and runs child key lookups on all of it's sections
+void		KVBench_Query(const char* pszName, const char* pszBuffer, int numRepeats);
+
+// generates material-like file with the number of keys in a single section
+char*		KVBench_GenerateSection(int numKeys);
+
+// measures parser throughput against the reference parsers and compares the trees
+void		KVBench_ParseFile(const char* pszFileName, int numRepeats);
+void		KVBench_Parse(const char* pszName, const char* pszBuffer, int bufferSize, int numRepeats);
+
+// mutates the corpus files and compares parsed trees with the reference parsers. Returns number of mismatches
+int			KVBench_FuzzFiles(const char* pszCorpusPath, int numIterations, int seed);
+int			KVBench_Fuzz(const char** buffers, const int* sizes, int numBuffers, int numIterations, int seed);
+
+#endif // KVBENCHMARK_H
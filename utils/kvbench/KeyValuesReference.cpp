@@ -0,0 +1,789 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Previous character-by-character KeyValues parsers.
+//				Used as the reference for benchmarks and fuzzing
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <ctype.h>
+
+#include "core/DebugInterface.h"
+
+#include "utils/KeyValues.h"
+#include "utils/strtools.h"
+
+#include "KeyValuesReference.h"
+
+// from KeyValues.cpp
+EKVPairType KV_ResolvePairType( const char* string );
+char* KV_ReadProcessString( const char* pszStr );
+
+// section beginning / ending
+#define KV_SECTION_BEGIN			'{'
+#define KV_SECTION_END				'}'
+
+#define KV_ARRAY_BEGIN				'['
+#define KV_ARRAY_END				']'
+#define KV_ARRAY_SEPARATOR			','
+
+// string symbols
+#define KV_STRING_BEGIN_END			'\"'
+#define KV_STRING_NEWLINE			'\n'
+#define KV_STRING_CARRIAGERETURN	'\r'
+
+// commnent symbols
+#define KV_COMMENT_SYMBOL			'/'
+#define KV_RANGECOMMENT_BEGIN_END	'*'
+
+#define KV_TYPE_VALUESYMBOL			':'
+
+#define KV_BREAK					';'
+
+#define IsKVBufferEOF()			((pData - pszBuffer) > bufferSize-1)
+#define IsKVArrayEndOrSeparator(c)	(c == KV_ARRAY_SEPARATOR || c == KV_ARRAY_END)
+#define IsKVWhitespace(c)		(isspace(c) || c == '\0' || c == KV_STRING_NEWLINE || c == KV_STRING_CARRIAGERETURN)
+
+//-----------------------------------------------------------------------------------------
+
+enum EQuoteMode
+{
+	QM_NONE = 0,
+
+	QM_COMMENT_LINE,
+	QM_COMMENT_RANGE,
+
+	QM_STRING,
+	QM_STRING_QUOTED,
+
+	QM_SECTION,			// section or array
+};
+
+enum EParserMode
+{
+	PM_NONE = 0,
+	PM_KEY,
+	PM_VALUE,
+	PM_ARRAY,
+	PM_SECTION,
+};
+
+//-----------------------------------------------------------------------------------------
+
+
+//
+// Parses the V3 format of KeyValues into pParseTo
+//
+kvkeybase_t* KVRef_ParseSectionV3( const char* pszBuffer, int bufferSize, const char* pszFileName, kvkeybase_t* pParseTo, int nStartLine )
+{
+	kvkeybase_t* pKeyBase = pParseTo;
+
+	if(!pKeyBase)
+		pKeyBase = new kvkeybase_t;
+
+	const char* pData = (char*)pszBuffer;
+	const char* pLast = pData;
+	char c = *pData;
+
+	const char* pFirstLetter = NULL;
+
+	EQuoteMode quoteMode = QM_NONE;		// actual quoting mode
+
+	EParserMode parserMode = PM_NONE;	// parser mode for error identification
+	EParserMode lastParserMode = parserMode;
+	int lastParserModeLine = -1;
+
+	bool valueArray = false;
+	int valueArrayStartLine = -1;
+
+	int sectionDepth = 0;
+
+	int nValCounter = 0;
+
+	int nLine = nStartLine+1;
+	int nModeStartLine = -1;
+
+	// allocate 129 b in stack
+	char* key = (char*)stackalloc(KV_MAX_NAME_LENGTH+1);
+	strcpy(key, "unnamed");
+
+	kvkeybase_t* curpair = NULL;
+
+	do
+	{
+		c = *pData;
+
+		pLast = pData;
+
+		if(c == '\n')
+			nLine++;
+
+		// skip non-single character white spaces, tabs, carriage returns, and newlines
+		if(c == '\\' && (*(pData+1) == 'n' || *(pData+1) == 't' || *(pData+1) == '\"'))
+		{
+			pData++;
+			continue;
+		}
+
+		// check for comment mode enabling
+		// only when nothing is parsed or unquoted strings
+		if ( c == KV_COMMENT_SYMBOL && quoteMode == QM_NONE)
+		{
+			char commentend = *(pData+1);
+
+			if(commentend == KV_COMMENT_SYMBOL)
+			{
+				quoteMode = QM_COMMENT_LINE;
+				nModeStartLine = nLine;
+				continue;
+			}
+			else if(commentend == KV_RANGECOMMENT_BEGIN_END)
+			{
+				quoteMode = QM_COMMENT_RANGE;
+				nModeStartLine = nLine;
+				continue;
+			}
+		}
+		else if ( c == KV_STRING_NEWLINE && quoteMode == QM_COMMENT_LINE ) // check comment mode disabling
+		{
+			// Stop commentary mode after new line
+			quoteMode = QM_NONE;
+			lastParserModeLine = nModeStartLine;
+			lastParserMode = parserMode;
+			parserMode = PM_NONE;
+			continue;
+		}
+		else if ( c == KV_RANGECOMMENT_BEGIN_END && quoteMode == QM_COMMENT_RANGE )
+		{
+			char commentend = *(pData+1);
+			if(commentend == KV_COMMENT_SYMBOL)
+			{
+				quoteMode = QM_NONE;
+				pData++;
+				continue;
+			}
+		}
+
+		// skip chars when in comment mode
+		if(quoteMode == QM_COMMENT_RANGE || quoteMode == QM_COMMENT_LINE)
+			continue;
+
+		// reading a key/value characters
+		if(quoteMode == QM_STRING || quoteMode == QM_STRING_QUOTED)
+		{
+			// check for reading array
+
+			// read type name
+			if((quoteMode == QM_STRING) && (c == KV_TYPE_VALUESYMBOL))
+			{
+				if( nValCounter == 0 )
+				{
+					MsgError("'%s':%d error - unexpected type definition\n", pszFileName, nModeStartLine);
+					break;
+				}
+
+				{
+					int nLen = (pLast - pFirstLetter);
+
+					char* endChar = (char*)pFirstLetter+nLen;
+
+					char oldChr = *endChar;
+					*endChar = '\0';
+
+					// set the type
+					curpair->type = KV_ResolvePairType(pFirstLetter);
+
+					*endChar = oldChr;
+				}
+
+				// parse value type and reset
+				//pFirstLetter = pData+1;
+				quoteMode = QM_NONE;
+			}
+			else if((quoteMode == QM_STRING_QUOTED && (c == KV_STRING_BEGIN_END)) ||
+					(quoteMode == QM_STRING && ( c == KV_COMMENT_SYMBOL || c == KV_BREAK || IsKVBufferEOF() || IsKVWhitespace(c) || (valueArray && IsKVArrayEndOrSeparator(c)))))
+			{
+				// complete the key and add
+				if(!valueArray)
+					nValCounter++;
+				else if(quoteMode == QM_STRING && IsKVArrayEndOrSeparator(c))
+					pData--; // get back by ]
+
+				// force to begin commenting mode on QM_STRING
+				if (quoteMode == QM_STRING && (c == KV_COMMENT_SYMBOL))
+				{
+					char commentStartTest = *(pData + 1);
+
+					// get ready for range comment *ONLY*
+					if (commentStartTest == KV_RANGECOMMENT_BEGIN_END)
+						pData--;
+					else
+						continue;
+				}
+
+				bool typeIsOk = (curpair->type != KVPAIR_SECTION);
+
+				if(!typeIsOk)
+				{
+					MsgError("'%s':%d error KV6: type mismatch, expected 'section'\n", pszFileName, nModeStartLine);
+					break;
+				}
+
+				{
+					int nLen = (pLast - pFirstLetter);
+
+					if(nValCounter == 1)
+					{
+						// set key name
+						nLen = min(KV_MAX_NAME_LENGTH, nLen);
+						strncpy(key, pFirstLetter, nLen);
+						key[nLen] = '\0';
+
+						if(c == KV_BREAK)
+						{
+							MsgError("'%s':%d error - unexpected break\n", pszFileName, nModeStartLine);
+							
+							break;
+						}
+
+					}
+					else if(nValCounter == 2)
+					{
+						char* endChar = (char*)pFirstLetter + nLen;
+
+						char oldChr = *endChar;
+						*endChar = '\0';
+
+						// pre-process string
+						char* valueString = KV_ReadProcessString(pFirstLetter);
+						*endChar = oldChr;
+
+						if(valueArray)
+						{
+							// make it parsed if the type is different
+							kvpairvalue_t* value = curpair->CreateValue();
+							value->SetValueFromString(valueString);
+						}
+						else
+						{
+							// set or create a single value
+							kvpairvalue_t* value = curpair->values.numElem() ? curpair->values[0] : curpair->CreateValue();
+							value->SetValueFromString(valueString);
+						}
+
+						// free processed string
+						free(valueString);
+
+						curpair->SetName(key);
+						if(curpair->parent != pKeyBase)
+							pKeyBase->AddExistingKeyBase(curpair);
+					}
+				}
+
+				if(nValCounter == 2 && !valueArray)
+					nValCounter = 0;
+
+				quoteMode = QM_NONE;
+				pFirstLetter = NULL;
+
+				lastParserModeLine = nModeStartLine;
+				lastParserMode = parserMode;
+				parserMode = PM_NONE;
+			}
+		}
+		else if(quoteMode == QM_NONE) // test for begin read keys/sections
+		{
+			// skip whitespaces
+			if(isspace(c))
+				continue;
+
+			if(c == KV_BREAK) // skip old-style breaks
+				continue;
+
+			// begin section mode
+			if( c == KV_SECTION_BEGIN )
+			{
+				//Msg("start section\n");
+				if(curpair == NULL)
+				{
+					MsgError("'%s':%d error - unexpected anonymous section\n", pszFileName, nModeStartLine);
+					break;
+				}
+
+				quoteMode = QM_SECTION;
+				lastParserModeLine = nModeStartLine;
+				lastParserMode = parserMode;
+				parserMode = PM_SECTION;
+
+				nModeStartLine = nLine;
+				pFirstLetter = pData+1;
+
+				sectionDepth++;
+			}
+			else if(c == KV_ARRAY_BEGIN) // enable array parsing
+			{
+				if (nValCounter == 0 || valueArray)
+				{
+					MsgError("'%s':%d error - unexpected '['\n", pszFileName, nModeStartLine);
+					break;
+				}
+
+				lastParserModeLine = nModeStartLine;
+				lastParserMode = parserMode;
+				parserMode = PM_ARRAY;
+
+				valueArray = true;
+				valueArrayStartLine = nLine;
+				nValCounter++;
+				continue;
+			}
+			else if(IsKVArrayEndOrSeparator(c) && valueArray)
+			{
+				// add last value after separator or closing
+
+				if(c == KV_ARRAY_END)
+				{
+					lastParserModeLine = nModeStartLine;
+					lastParserMode = parserMode;
+					parserMode = PM_NONE;
+					valueArray = false;
+
+					// complete the key and add
+					nValCounter = 0;
+				}
+
+				continue;
+			}
+			else // any character initiates QM_STRING* mode
+			{
+				quoteMode = (c == KV_STRING_BEGIN_END) ? QM_STRING_QUOTED:  QM_STRING;
+
+				nModeStartLine = nLine;
+				pFirstLetter = (quoteMode == QM_STRING_QUOTED) ? pData + 1 : pData;
+
+				lastParserModeLine = nModeStartLine;
+				lastParserMode = parserMode;
+
+				if(nValCounter == 0)
+				{
+					curpair = new kvkeybase_t();
+					curpair->line = nModeStartLine;
+					parserMode = PM_KEY;
+				}
+				else
+					parserMode = PM_VALUE;
+			}
+		}
+		else if(quoteMode == QM_SECTION) // section skipper and processor
+		{
+			// skip the next section openning but increment the depths
+			if( c == KV_SECTION_BEGIN )
+			{
+				if(sectionDepth == 0)
+					pFirstLetter = pData+1;
+
+				sectionDepth++;
+			}
+			else if( c == KV_SECTION_END )
+			{
+				if(sectionDepth > 0)
+					sectionDepth--;
+
+				if(sectionDepth == 0)
+				{
+					// read buffer
+					int nLen = (pLast - pFirstLetter);
+
+					if( valueArray )
+					{
+						kvkeybase_t* newsec = new kvkeybase_t();
+						bool success = KVRef_ParseSectionV3(pFirstLetter, nLen, pszFileName, newsec, nModeStartLine-1) != NULL;
+
+						bool typeIsOk = ((curpair->values.numElem() == 0) || curpair->type == KVPAIR_SECTION);
+
+						if(success && typeIsOk)
+						{
+							// force the pair value type to SECTION
+							curpair->type = KVPAIR_SECTION;
+							curpair->AddValue(newsec);
+
+							curpair->SetName(key);
+							if(curpair->parent != pKeyBase)
+								pKeyBase->AddExistingKeyBase(curpair);
+						}
+						else
+						{
+							delete newsec;
+
+							if(!typeIsOk)
+							{
+								MsgError("'%s':%d error - type mismatch, expected 'section'\n", pszFileName, nModeStartLine);
+								break;
+							}
+						}
+
+					}
+					else
+					{
+						bool success = KVRef_ParseSectionV3(pFirstLetter, nLen, pszFileName, curpair, nModeStartLine-1) != NULL;
+
+						if(success)
+						{
+							curpair->SetName(key);
+							if(curpair->parent != pKeyBase)
+								pKeyBase->AddExistingKeyBase(curpair);
+
+							curpair = NULL; // i'ts finally done
+							*key = 0;
+						}
+					}
+
+					// disable
+					nValCounter = 0;
+					quoteMode = QM_NONE;
+
+					lastParserModeLine = nModeStartLine;
+					lastParserMode = parserMode;
+					parserMode = PM_NONE;
+
+					pFirstLetter = NULL;
+				} // depth
+			} // KV_SECTION_END
+		} // QM_SECTION
+	}
+	while(*pData++ && (pData - pszBuffer) <= bufferSize);
+
+	// check for errors
+	bool isError = false;
+
+	// if mode is not none, then is error
+	if(quoteMode != QM_NONE)
+	{
+		if(quoteMode == QM_COMMENT_RANGE)
+		{
+			MsgError("'%s':%d error - unexpected EOF, did you forgot '*/'?\n", pszFileName, nModeStartLine);
+			isError = true;
+		}
+		else if(quoteMode == QM_SECTION)
+		{
+			MsgError("'%s':%d error - missing '}'\n", pszFileName, nModeStartLine);
+			isError = true;
+		}
+		else if(quoteMode == QM_STRING_QUOTED)
+		{
+			MsgError("'%s':%d error - missing '\"'\n", pszFileName, nModeStartLine);
+			isError = true;
+		}
+	}
+
+	if(valueArray)
+	{
+		MsgError("'%s':%d error - missing ']'\n", pszFileName, valueArrayStartLine);
+		isError = true;
+	}
+
+	if(isError)
+	{
+		if(pParseTo != pKeyBase)
+			delete pKeyBase;
+		return NULL;
+	}
+
+	return pKeyBase;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+#define NOCOMMENT		0
+#define LINECOMMENT		1
+#define RANGECOMMENT	2
+
+//
+// Parses the KeyValues section string buffer to the 'pParseTo'
+//
+kvkeybase_t* KVRef_ParseSection( const char* pszBuffer, const char* pszFileName, kvkeybase_t* pParseTo, int nStartLine )
+{
+	const char* pData = (char*)pszBuffer;
+	char c;
+
+	// set the first character of data
+	c = *pData;
+
+	const char *pFirstLetter = NULL;
+	const char*	pLast = pData;
+
+	int			nSectionLetterLine = 0;
+	int			nQuoteLetterLine = 0;
+
+	bool		bInQuotes = false;
+	bool		bInSection = false;
+
+	// Skip for sections
+	int nSectionRecursionSkip = 0;
+
+	kvkeybase_t* pKeyBase = pParseTo;
+
+	if(!pKeyBase)
+		pKeyBase = new kvkeybase_t;
+
+	kvkeybase_t* pCurrentKeyBase = NULL;
+	kvkeybase_t* pPrevKeyBase = NULL;
+
+	int bCommentaryMode = NOCOMMENT;
+
+	int nValueCounter = 0;
+
+	int nLine = nStartLine;
+
+	EqString tempName;
+
+	for ( ; ; ++pData )
+	{
+		c = *pData;
+
+		if(c == '\0')
+			break;
+
+		pLast = pData;
+
+		if(c == KV_STRING_NEWLINE)
+			nLine++;
+
+		// check commentary mode
+		if ( c == KV_COMMENT_SYMBOL && !bInQuotes )
+		{
+			char commentend = *(pData+1);
+
+			// we got comment symbol again
+			if( commentend == KV_COMMENT_SYMBOL && bCommentaryMode != RANGECOMMENT )
+			{
+				bCommentaryMode = LINECOMMENT;
+				continue;
+			}
+			else if( commentend == KV_RANGECOMMENT_BEGIN_END && bCommentaryMode != LINECOMMENT )
+			{
+				bCommentaryMode = RANGECOMMENT;
+				continue;
+			}
+		}
+
+		// Stop cpp commentary mode after newline
+		if ( c == KV_STRING_NEWLINE && bCommentaryMode == 1 )
+		{
+			bCommentaryMode = NOCOMMENT;
+			continue;
+		}
+
+		if ( c == KV_RANGECOMMENT_BEGIN_END && bCommentaryMode == 2 )
+		{
+			char commentend = *(pData+1);
+			if(commentend == KV_COMMENT_SYMBOL)
+			{
+				bCommentaryMode = NOCOMMENT;
+				pData++; // little hack
+				continue;
+			}
+		}
+
+		// skip commented text
+		if(bCommentaryMode)
+			continue;
+
+		// TODO: replace/skip special characters in here
+
+		// if we found section opening character and there is a key base
+		if( c == KV_SECTION_BEGIN && !bInQuotes)
+		{
+			// keybase must be created
+			if(!pCurrentKeyBase)
+			{
+				MsgError("'%s' (%d): section has no keybase\n", pszFileName ? pszFileName : "buffer", nLine+1);
+
+				if(pParseTo != pKeyBase)
+					delete pKeyBase;
+				return NULL;
+			}
+
+			// Do skip only if we have in another section
+			if(!pFirstLetter && (nSectionRecursionSkip == 0))
+			{
+				bInSection = true;
+				pFirstLetter = pData + 1;
+				nSectionLetterLine = nLine;
+			}
+
+			// Up recursion by one
+			nSectionRecursionSkip++;
+			continue;
+		}
+
+		if( pFirstLetter && bInSection ) // if we have parsing section
+		{
+			if( c == KV_SECTION_END )
+			{
+				if(nSectionRecursionSkip > 0)
+					nSectionRecursionSkip--;
+
+				// if we have reached this section ending, start parsing it's contents
+				if(nSectionRecursionSkip == 0)
+				{
+					int nLen = (int)(pLast - pFirstLetter);
+
+					char* endChar = (char*)pFirstLetter+nLen;
+
+					char oldChr = *endChar;
+					*endChar = '\0';
+
+					// recurse
+					kvkeybase_t* pBase = KVRef_ParseSection( pFirstLetter, pszFileName, pCurrentKeyBase, nSectionLetterLine );
+
+					*endChar = oldChr;
+
+					// if it got all killed
+					if(!pBase)
+					{
+						//delete pKeyBase;
+						return NULL;
+					}
+
+					bInSection = false;
+					pFirstLetter = NULL;
+
+					// NOTE: we could emit code below to not use KV_BREAK character strictly after section
+					pCurrentKeyBase = NULL;
+					nValueCounter = 0;
+				}
+			}
+
+			continue; // don't parse the entire section until we got a section ending
+		}
+
+		// if not in quotes and found whitespace
+		// or if in quotes and there is closing character
+		// TODO: check \" inside quotes
+		if( pCurrentKeyBase && pFirstLetter &&
+			((!bInQuotes && (isspace((ubyte)c) || (c == KV_BREAK))) ||
+			(bInQuotes && (c == KV_STRING_BEGIN_END))))
+		{
+			char prevSymbol = *(pData-1);
+
+			if(bInQuotes && prevSymbol == '\\')
+			{
+				continue;
+			}
+
+			int nLen = (int)(pLast - pFirstLetter);
+
+			// close token
+			if(nValueCounter <= 0)
+			{
+				tempName.Assign( pFirstLetter, nLen );
+
+				pCurrentKeyBase->SetName(tempName.ToCString());
+			}
+			else
+			{
+				char* endChar = (char*)pFirstLetter+nLen;
+
+				char oldChr = *endChar;
+				*endChar = '\0';
+
+				char* processedValue = KV_ReadProcessString(pFirstLetter);
+
+				pCurrentKeyBase->AddValue(processedValue);
+
+				free(processedValue);
+
+				*endChar = oldChr;
+			}
+
+			pFirstLetter = NULL;
+			bInQuotes = false;
+
+			if(c == KV_BREAK)
+			{
+				pPrevKeyBase = pCurrentKeyBase;
+				pCurrentKeyBase = NULL;
+				nValueCounter = 0;
+			}
+
+			continue;
+		}
+
+		// end keybase if we got semicolon
+		if( !bInQuotes && (c == KV_BREAK) )
+		{
+			pCurrentKeyBase = NULL;
+			nValueCounter = 0;
+			continue;
+		}
+
+		// start token
+		if ( !pFirstLetter && (c != KV_BREAK) &&
+			(c != KV_SECTION_BEGIN) && (c != KV_SECTION_END))
+		{
+			// if we got quote character or this is not a space character
+			// begin new token
+
+			if((c == KV_STRING_BEGIN_END) || !isspace(c))
+			{
+				// create keybase or increment value counter
+				if( pCurrentKeyBase )
+				{
+					nValueCounter++;
+				}
+				else
+				{
+					pCurrentKeyBase = new kvkeybase_t;
+					pCurrentKeyBase->line = nLine;
+					pKeyBase->AddExistingKeyBase( pCurrentKeyBase );
+				}
+
+				if( c == KV_STRING_BEGIN_END )
+					bInQuotes = true;
+
+				nQuoteLetterLine = nLine;
+
+				pFirstLetter = pData + (bInQuotes ? 1 : 0);
+
+				continue;
+			}
+		}
+	}
+
+	if( pCurrentKeyBase )
+	{
+		MsgError("'%s' (%d): EOF passed, excepted ';'\n", pszFileName ? pszFileName : "buffer", pCurrentKeyBase->line+1);
+		if(pParseTo != pKeyBase)
+			delete pKeyBase;
+		pKeyBase = NULL;
+	}
+
+	if( bInQuotes )
+	{
+		MsgError("'%s' (%d): unexcepted end of file, you forgot to close quotes\n", pszFileName ? pszFileName : "buffer", nQuoteLetterLine+1);
+
+
+		if(pParseTo != pKeyBase)
+			delete pKeyBase;
+		pKeyBase = NULL;
+	}
+
+	if( bInSection )
+	{
+		MsgError("'%s' (%d): EOF passed, excepted '}'\n", pszFileName ? pszFileName : "buffer", nSectionLetterLine+1);
+		if(pParseTo != pKeyBase)
+			delete pKeyBase;
+		pKeyBase = NULL;
+	}
+
+	if( bCommentaryMode == 2 )
+	{
+		MsgError("'%s' (%d): EOF passed, excepted '*/', check whole text please\n", pszFileName ? pszFileName : "buffer", nLine+1);
+		if(pParseTo != pKeyBase)
+			delete pKeyBase;
+		pKeyBase = NULL;
+	}
+
+	return pKeyBase;
+}
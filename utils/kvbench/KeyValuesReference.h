@@ -0,0 +1,17 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Previous character-by-character KeyValues parsers.
+//				Used as the reference for benchmarks and fuzzing
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef KEYVALUESREFERENCE_H
+#define KEYVALUESREFERENCE_H
+
+#include "utils/KeyValues.h"
+
+kvkeybase_t*	KVRef_ParseSection( const char* pszBuffer, const char* pszFileName = NULL, kvkeybase_t* pParseTo = NULL, int nStartLine = 0 );
+kvkeybase_t*	KVRef_ParseSectionV3( const char* pszBuffer, int bufferSize, const char* pszFileName, kvkeybase_t* pParseTo, int nStartLine = 0 );
+
+#endif // KEYVALUESREFERENCE_H
@@ -0,0 +1,29 @@
+panel
+{
+	label		"HUD";
+	size		800 600;
+	scaling		"aspecth";
+
+	child label "speed"	{ label "0"; position 700 540; size 80 40; font "Roboto" 40 bold italic; align "right" "bottom"; anchors "right" "bottom"; }
+	child label "gear"	{ label "N"; position 740 500; size 40 40; font "Roboto" 30 bold; textColor 1 1 1 1; anchors "right" "bottom"; }
+	child label "timer"	{ label "00:00.00"; position 300 16; size 200 32; font "Roboto" 24; align "hcenter" "top"; anchors "hcenter" "top"; }
+
+	child image "damage"
+	{
+		atlas		"ui/hud_atlas" "damage_bar";
+		position	16 540;
+		size		200 24;
+		flipx		0;
+		flipy		0;
+		transform { rotate 0; scale 1 1; }
+	}
+
+	child panel "message"
+	{
+		visible 0;
+		size 400 64;
+		position 200 400;
+
+		child label "text" { label "\"Press any key\"\nto continue"; font "Roboto" 20; align "hcenter" "vcenter"; }
+	}
+}
@@ -0,0 +1,53 @@
+panel
+{
+	label		"Main menu";
+	position	0 0;
+	size		640 480;
+	visible		1;
+	selfvisible	0;
+
+	child image "logo"
+	{
+		path		"ui/logo";
+		position	32 32;
+		size		256 128;
+		color		1 1 1 0.85;
+		anchors		"left" "top";
+	}
+
+	child label "title"
+	{
+		label		"#MENU_TITLE";
+		position	32 180;
+		size		400 40;
+		font		"Roboto" 30 bold;
+		textColor	1 0.75 0 1;
+		align		"left" "vcenter";
+	}
+
+	child button "start"
+	{
+		label		"#MENU_START";
+		position	32 240;
+		size		200 32;
+		font		"Roboto" 20;
+		command		"ui_start_game";
+		anchors		"left" "bottom";
+	}
+
+	child button "quit"
+	{
+		label		"#MENU_QUIT";
+		position	32 280;
+		size		200 32;
+		font		"Roboto" 20;
+		command		"quit";
+
+		transform
+		{
+			rotate		0;
+			scale		1.0 1.0;
+			translate	0 0;
+		}
+	}
+}
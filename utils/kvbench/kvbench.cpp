@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: KeyValues benchmark tool
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "core/IDkCore.h"
+#include "core/DebugInterface.h"
+#include "core/IFileSystem.h"
+#include "core/cmdlib.h"
+#include "core/ppmem.h"
+
+#include "utils/strtools.h"
+
+#include "math/math_common.h"
+
+#include "KVBenchmark.h"
+
+void Usage()
+{
+	Msg("Usage: \n");
+	Msg(" kvbench -query <files> -synthetic <numKeys> -parse <files> -fuzz <corpus path> <iterations> -repeat <count> -seed <seed>\n\n");
+	Msg("-query <files> - parses files and looks up every key name in all their sections\n");
+	Msg("-synthetic <numKeys> - runs lookups on the generated section with the number of keys\n");
+	Msg("-parse <files> - measures parser throughput and compares the trees with the reference parsers\n");
+	Msg("-fuzz <corpus path> <iterations> - parses mutated corpus files, compares the trees with the reference parsers\n");
+	Msg("-repeat <count> - number of lookup and parse passes, must precede the benchmarks\n");
+	Msg("-seed <seed> - fuzzer random seed, must precede -fuzz\n");
+}
+
+int main(int argc, char* argv[])
+{
+	GetCore()->Init("kvbench", argc, argv);
+
+	Install_SpewFunction();
+
+	if(!g_fileSystem->Init(false))
+		return -1;
+
+	Msg("kvbench - KeyValues benchmark\n");
+
+	if(g_cmdLine->GetArgumentCount() <= 1)
+	{
+		Usage();
+
+		GetCore()->Shutdown();
+		return 0;
+	}
+
+	int numRepeats = 100;
+	int fuzzSeed = 0;
+	int numErrors = 0;
+
+	for(int i = 0; i < g_cmdLine->GetArgumentCount(); i++)
+	{
+		const char* arg = g_cmdLine->GetArgumentString( i );
+
+		if(!stricmp(arg, "-repeat"))
+		{
+			numRepeats = max(atoi(g_cmdLine->GetArgumentsOf(i)), 1);
+		}
+		else if(!stricmp(arg, "-query"))
+		{
+			DkList<EqString> files;
+			xstrsplit(g_cmdLine->GetArgumentsOf(i), " ", files);
+
+			for(int j = 0; j < files.numElem(); j++)
+				KVBench_QueryFile(files[j].ToCString(), numRepeats);
+		}
+		else if(!stricmp(arg, "-synthetic"))
+		{
+			int numKeys = max(atoi(g_cmdLine->GetArgumentsOf(i)), 1);
+
+			char* buffer = KVBench_GenerateSection(numKeys);
+			KVBench_Query("synthetic", buffer, numRepeats);
+			PPFree(buffer);
+		}
+		else if(!stricmp(arg, "-parse"))
+		{
+			DkList<EqString> files;
+			xstrsplit(g_cmdLine->GetArgumentsOf(i), " ", files);
+
+			for(int j = 0; j < files.numElem(); j++)
+				KVBench_ParseFile(files[j].ToCString(), numRepeats);
+		}
+		else if(!stricmp(arg, "-seed"))
+		{
+			fuzzSeed = atoi(g_cmdLine->GetArgumentsOf(i));
+		}
+		else if(!stricmp(arg, "-fuzz"))
+		{
+			DkList<EqString> args;
+			xstrsplit(g_cmdLine->GetArgumentsOf(i), " ", args);
+
+			if(!args.numElem())
+			{
+				MsgError("-fuzz requires corpus path\n");
+				continue;
+			}
+
+			int numIterations = args.numElem() > 1 ? max(atoi(args[1].ToCString()), 1) : 10000;
+
+			numErrors += KVBench_FuzzFiles(args[0].ToCString(), numIterations, fuzzSeed);
+		}
+	}
+
+	GetCore()->Shutdown();
+
+	return numErrors ? 1 : 0;
+}
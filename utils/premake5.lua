@@ -73,6 +73,39 @@ project "texcooker"
 		"texcooker/*.h"
 	}
 
+----------------------------------------------
+-- KeyValues benchmark (KVBench)
+
+project "kvbench"
+    kind "ConsoleApp"
+    uses {
+		"corelib", "frameworkLib",
+		"e2Core"
+	}
+    files {
+		"kvbench/*.cpp",
+		"kvbench/*.h"
+	}
+
+----------------------------------------------
+-- Render recording test (RHIRecord)
+
+project "rhirecord"
+    kind "ConsoleApp"
+    uses {
+		"corelib", "frameworkLib",
+		"e2Core", "eqRHIBaseLib"
+	}
+    files {
+		"rhirecord/*.cpp",
+		"rhirecord/*.h",
+		Folders.matsystem1.. "renderers/Empty/ShaderAPIRecorder.cpp",
+		Folders.matsystem1.. "renderers/Empty/*.h"
+	}
+    includedirs {
+		Folders.matsystem1.. "renderers/Empty"
+	}
+
 -- Equilibrium Graphics File manager (EGFMan)
 project "egfman"
     kind "WindowedApp"
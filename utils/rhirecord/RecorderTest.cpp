@@ -0,0 +1,323 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Render recording test
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "core/DebugInterface.h"
+#include "core/IFileSystem.h"
+#include "core/ppmem.h"
+#include "core/cmdlib.h"
+
+#include "math/DkMath.h"
+#include "math/Random.h"
+
+#include "ShaderAPIRecorder.h"
+#include "RecorderTest.h"
+
+#define RECORDERTEST_NUM_VERTS		64
+#define RECORDERTEST_NUM_INDICES	96
+#define RECORDERTEST_NUM_DRAWS		16
+
+#define RECORDERTEST_FUZZ_FILE		"rhirecord_fuzz.rhr"
+
+static void RecorderTest_SilentSpew(SpewType_t type, const char* text)
+{
+}
+
+struct recorderTestVertex_t
+{
+	Vector3D	position;
+	Vector2D	texCoord;
+};
+
+struct recorderTestScene_t
+{
+	IVertexFormat*	format;
+	IVertexBuffer*	staticVB;
+	IVertexBuffer*	dynamicVB;
+	IIndexBuffer*	indexBuffer;
+
+	ITexture*		textures[2];
+	ITexture*		renderTarget;
+
+	IShaderProgram*	shader;
+
+	IRenderState*	blendStates[2];
+	IRenderState*	depthState;
+	IRenderState*	rasterState;
+};
+
+static void RecorderTest_FillVerts(recorderTestVertex_t* verts, int numVerts, float phase)
+{
+	for(int i = 0; i < numVerts; i++)
+	{
+		float a = (float)i / (float)numVerts * PI_F * 2.0f + phase;
+
+		verts[i].position = Vector3D(sinf(a), cosf(a), (float)i);
+		verts[i].texCoord = Vector2D(sinf(a) * 0.5f + 0.5f, cosf(a) * 0.5f + 0.5f);
+	}
+}
+
+static void RecorderTest_CreateScene(IShaderAPI* api, recorderTestScene_t& scene)
+{
+	VertexFormatDesc_t format[] = {
+		{ 0, 3, VERTEXATTRIB_POSITION, ATTRIBUTEFORMAT_FLOAT, "position" },
+		{ 0, 2, VERTEXATTRIB_TEXCOORD, ATTRIBUTEFORMAT_FLOAT, "texcoord" },
+	};
+
+	scene.format = api->CreateVertexFormat(format, elementsOf(format));
+
+	recorderTestVertex_t verts[RECORDERTEST_NUM_VERTS];
+	RecorderTest_FillVerts(verts, RECORDERTEST_NUM_VERTS, 0.0f);
+
+	uint16 indices[RECORDERTEST_NUM_INDICES];
+	for(int i = 0; i < RECORDERTEST_NUM_INDICES; i++)
+		indices[i] = i % RECORDERTEST_NUM_VERTS;
+
+	scene.staticVB = api->CreateVertexBuffer(BUFFER_STATIC, RECORDERTEST_NUM_VERTS, sizeof(recorderTestVertex_t), verts);
+	scene.dynamicVB = api->CreateVertexBuffer(BUFFER_DYNAMIC, RECORDERTEST_NUM_VERTS, sizeof(recorderTestVertex_t), NULL);
+	scene.indexBuffer = api->CreateIndexBuffer(RECORDERTEST_NUM_INDICES, sizeof(uint16), BUFFER_STATIC, indices);
+
+	scene.textures[0] = api->CreateProceduralTexture("_rhirecord_tex0", FORMAT_RGBA8, 64, 64);
+	scene.textures[1] = api->CreateProceduralTexture("_rhirecord_tex1", FORMAT_RGBA8, 128, 32);
+	scene.renderTarget = api->CreateNamedRenderTarget("_rhirecord_rt", 256, 256, FORMAT_RGBA8);
+
+	// replay looks up shaders by name
+	scene.shader = api->CreateNewShaderProgram("RHIRecordTest");
+
+	BlendStateParam_t blend;
+	scene.blendStates[0] = api->CreateBlendingState(blend);
+
+	blend.blendEnable = true;
+	blend.srcFactor = BLENDFACTOR_SRC_ALPHA;
+	blend.dstFactor = BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+	scene.blendStates[1] = api->CreateBlendingState(blend);
+
+	DepthStencilStateParams_t depth;
+	scene.depthState = api->CreateDepthStencilState(depth);
+
+	RasterizerStateParams_t raster;
+	scene.rasterState = api->CreateRasterizerState(raster);
+}
+
+static void RecorderTest_DestroyScene(IShaderAPI* api, recorderTestScene_t& scene)
+{
+	api->Reset(STATE_RESET_ALL);
+	api->Apply();
+
+	api->DestroyVertexFormat(scene.format);
+	api->DestroyVertexBuffer(scene.staticVB);
+	api->DestroyVertexBuffer(scene.dynamicVB);
+	api->DestroyIndexBuffer(scene.indexBuffer);
+
+	api->FreeTexture(scene.textures[0]);
+	api->FreeTexture(scene.textures[1]);
+	api->FreeTexture(scene.renderTarget);
+
+	api->DestroyShaderProgram(scene.shader);
+
+	api->DestroyRenderState(scene.blendStates[0]);
+	api->DestroyRenderState(scene.blendStates[1]);
+	api->DestroyRenderState(scene.depthState);
+	api->DestroyRenderState(scene.rasterState);
+}
+
+static void RecorderTest_DrawFrame(IShaderAPI* api, recorderTestScene_t& scene, int frame)
+{
+	// dynamic buffer is uploaded each frame
+	recorderTestVertex_t verts[RECORDERTEST_NUM_VERTS];
+	RecorderTest_FillVerts(verts, RECORDERTEST_NUM_VERTS, (float)frame * 0.1f);
+
+	scene.dynamicVB->Update(verts, RECORDERTEST_NUM_VERTS, 0, true);
+
+	api->ChangeRenderTarget(scene.renderTarget);
+	api->Clear(true, true, false, ColorRGBA(0.0f, 0.0f, 0.0f, 1.0f));
+
+	api->SetShader(scene.shader);
+	api->SetVertexFormat(scene.format);
+	api->SetIndexBuffer(scene.indexBuffer);
+	api->SetDepthStencilState(scene.depthState);
+	api->SetRasterizerState(scene.rasterState);
+
+	for(int i = 0; i < RECORDERTEST_NUM_DRAWS; i++)
+	{
+		api->SetVertexBuffer((i & 1) ? scene.dynamicVB : scene.staticVB, 0);
+		api->SetTexture(scene.textures[(i >> 1) & 1], NULL, 0);
+		api->SetBlendingState(scene.blendStates[(i >> 2) & 1]);
+
+		api->SetMatrixMode(MATRIXMODE_WORLD);
+		api->LoadMatrix(translate((float)i, (float)frame, 0.0f));
+
+		api->SetShaderConstantVector4D("BaseColor", Vector4D((float)i / RECORDERTEST_NUM_DRAWS, 1.0f, 1.0f, 1.0f));
+
+		api->Apply();
+		api->DrawIndexedPrimitives(PRIM_TRIANGLES, 0, RECORDERTEST_NUM_INDICES - (i % 4) * 3, 0, RECORDERTEST_NUM_VERTS);
+	}
+
+	api->ChangeRenderTargetToBackBuffer();
+
+	// non-indexed draw with texture from render target
+	api->SetTexture(scene.renderTarget, NULL, 0);
+	api->SetIndexBuffer(NULL);
+	api->Apply();
+	api->DrawNonIndexedPrimitives(PRIM_TRIANGLE_STRIP, 0, 4);
+}
+
+int RecorderTest_RecordReplay(ShaderAPIRecorder* api, const char* pszFileName, int numFrames, int numRepeats)
+{
+	recorderTestScene_t scene;
+	RecorderTest_CreateScene(api, scene);
+
+	// recording starts at the end of the frame
+	api->StartRecording(numFrames);
+	api->EndFrame();
+
+	recordFrameStats_t recorded;
+	recorded.Reset();
+
+	for(int i = 0; i < numFrames; i++)
+	{
+		RecorderTest_DrawFrame(api, scene, i);
+		api->EndFrame();
+
+		recorded.Add(api->GetLastFrameStats());
+	}
+
+	int numErrors = 0;
+
+	if(api->IsRecording())
+	{
+		MsgError("Recording did not stop after %d frames\n", numFrames);
+		api->StopRecording();
+		numErrors++;
+	}
+
+	if(!api->SaveRecording(pszFileName))
+	{
+		RecorderTest_DestroyScene(api, scene);
+		return numErrors + 1;
+	}
+
+	// replay counts go to the next frame stats
+	api->EndFrame();
+
+	if(!ShaderAPIRecorder::ReplayRecording(api, pszFileName, numRepeats))
+		numErrors++;
+
+	api->EndFrame();
+
+	const recordFrameStats_t& replayed = api->GetLastFrameStats();
+
+	if(replayed.drawCalls != recorded.drawCalls * numRepeats)
+	{
+		MsgError("Replay draw calls %d, expected %d\n", replayed.drawCalls, recorded.drawCalls * numRepeats);
+		numErrors++;
+	}
+
+	if(replayed.primitives != recorded.primitives * numRepeats)
+	{
+		MsgError("Replay primitives %d, expected %d\n", replayed.primitives, recorded.primitives * numRepeats);
+		numErrors++;
+	}
+
+	if(replayed.constantUpdates != recorded.constantUpdates * numRepeats)
+	{
+		MsgError("Replay constant updates %d, expected %d\n", replayed.constantUpdates, recorded.constantUpdates * numRepeats);
+		numErrors++;
+	}
+
+	RecorderTest_DestroyScene(api, scene);
+
+	if(!numErrors)
+		MsgInfo("Replay of %d frames x %d matches the recording\n", numFrames, numRepeats);
+
+	return numErrors;
+}
+
+int RecorderTest_Fuzz(ShaderAPIRecorder* api, const char* pszFileName, int numIterations, int seed)
+{
+	long fileSize = 0;
+	ubyte* fileData = (ubyte*)g_fileSystem->GetFileBuffer(pszFileName, &fileSize);
+
+	if(!fileData)
+	{
+		MsgError("Cannot open render recording '%s'\n", pszFileName);
+		return 0;
+	}
+
+	if(fileSize <= (long)sizeof(recordStreamHdr_t))
+	{
+		MsgError("'%s' is empty\n", pszFileName);
+		PPFree(fileData);
+		return 0;
+	}
+
+	ubyte* mutated = (ubyte*)PPAlloc(fileSize);
+
+	CUniformRandomStream rnd;
+	rnd.SetSeed(seed);
+
+	Msg("Fuzzing replay of '%s', %d iterations\n", pszFileName, numIterations);
+
+	// error messages of damaged streams are expected
+	SetSpewFunction(RecorderTest_SilentSpew);
+
+	int numAccepted = 0;
+	int streamStart = sizeof(recordStreamHdr_t);
+
+	for(int i = 0; i < numIterations; i++)
+	{
+		memcpy(mutated, fileData, fileSize);
+
+		int numMutations = rnd.RandomInt(1, 8);
+
+		for(int j = 0; j < numMutations; j++)
+		{
+			int pos = rnd.RandomInt(streamStart, fileSize-1);
+
+			switch(rnd.RandomInt(0, 2))
+			{
+				case 0:	// random byte
+					mutated[pos] = rnd.RandomInt(0, 255);
+					break;
+				case 1:	// bad integer
+				{
+					static const int badValues[] = {0, -1, -2147483647-1, 2147483647, 65536};
+					int value = badValues[rnd.RandomInt(0, elementsOf(badValues)-1)];
+
+					if(pos + (int)sizeof(int) <= fileSize)
+						memcpy(mutated + pos, &value, sizeof(int));
+					break;
+				}
+				case 2:	// flipped bit
+					mutated[pos] ^= 1 << rnd.RandomInt(0, 7);
+					break;
+			}
+		}
+
+		IFile* pFile = g_fileSystem->Open(RECORDERTEST_FUZZ_FILE, "wb", SP_MOD);
+
+		if(!pFile)
+			break;
+
+		pFile->Write(mutated, 1, fileSize);
+		g_fileSystem->Close(pFile);
+
+		if(ShaderAPIRecorder::ReplayRecording(api, RECORDERTEST_FUZZ_FILE, 1))
+			numAccepted++;
+	}
+
+	SetSpewFunction(NULL);
+	Install_SpewFunction();
+
+	g_fileSystem->FileRemove(RECORDERTEST_FUZZ_FILE, SP_MOD);
+
+	PPFree(mutated);
+	PPFree(fileData);
+
+	MsgInfo("%d of %d damaged streams replayed, the rest rejected\n", numAccepted, numIterations);
+
+	return numAccepted;
+}
@@ -0,0 +1,19 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Render recording test
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RECORDERTEST_H
+#define RECORDERTEST_H
+
+class ShaderAPIRecorder;
+
+// records synthetic frames to file, replays them and compares draw counters. Returns number of errors
+int		RecorderTest_RecordReplay(ShaderAPIRecorder* api, const char* pszFileName, int numFrames, int numRepeats);
+
+// replays randomly damaged copies of recording. Must not crash. Returns number of accepted streams
+int		RecorderTest_Fuzz(ShaderAPIRecorder* api, const char* pszFileName, int numIterations, int seed);
+
+#endif // RECORDERTEST_H
@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Copyright  Inspiration Byte
+// 2009-2020
+//////////////////////////////////////////////////////////////////////////////////
+// Description: Render recording and replay test tool
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "core/IDkCore.h"
+#include "core/DebugInterface.h"
+#include "core/IFileSystem.h"
+#include "core/cmdlib.h"
+#include "core/ConVar.h"
+
+#include "utils/strtools.h"
+
+#include "ShaderAPIRecorder.h"
+#include "RecorderTest.h"
+
+IShaderAPI* g_pShaderAPI = NULL;
+
+// those are provided by material system which is not used here
+ConVar r_loadmiplevel("r_loadmiplevel", "0", 0, 3, "Mipmap level to load, needs texture reloading");
+ConVar r_anisotropic("r_anisotropic", "4", 1, 16, "Mipmap anisotropic filtering quality, needs texture reloading");
+
+void Usage()
+{
+	Msg("Usage: \n");
+	Msg(" rhirecord -frames <count> -repeat <count> -file <filename> -fuzz <iterations> -seed <seed>\n\n");
+	Msg("-frames <count> - number of synthetic frames to record, default is 3\n");
+	Msg("-repeat <count> - number of replays of the recording, default is 2\n");
+	Msg("-file <filename> - recording file, default is rhirecord_test.rhr\n");
+	Msg("-fuzz <iterations> - replays damaged copies of the recording, run under address sanitizer\n");
+	Msg("-seed <seed> - fuzzer random seed\n");
+}
+
+int main(int argc, char* argv[])
+{
+	GetCore()->Init("rhirecord", argc, argv);
+
+	Install_SpewFunction();
+
+	if(!g_fileSystem->Init(false))
+		return -1;
+
+	Msg("rhirecord - render recording test\n");
+
+	int numFrames = 3;
+	int numRepeats = 2;
+	int numFuzzIterations = 0;
+	int fuzzSeed = 0;
+	EqString fileName("rhirecord_test.rhr");
+
+	for(int i = 0; i < g_cmdLine->GetArgumentCount(); i++)
+	{
+		const char* arg = g_cmdLine->GetArgumentString( i );
+
+		if(!stricmp(arg, "-frames"))
+			numFrames = max(atoi(g_cmdLine->GetArgumentsOf(i)), 1);
+		else if(!stricmp(arg, "-repeat"))
+			numRepeats = max(atoi(g_cmdLine->GetArgumentsOf(i)), 1);
+		else if(!stricmp(arg, "-file"))
+			fileName = g_cmdLine->GetArgumentsOf(i);
+		else if(!stricmp(arg, "-fuzz"))
+			numFuzzIterations = max(atoi(g_cmdLine->GetArgumentsOf(i)), 1);
+		else if(!stricmp(arg, "-seed"))
+			fuzzSeed = atoi(g_cmdLine->GetArgumentsOf(i));
+		else if(!stricmp(arg, "-help"))
+			Usage();
+	}
+
+	shaderAPIParams_t params;
+
+	ShaderAPIRecorder* api = new ShaderAPIRecorder();
+	api->Init(params);
+
+	g_pShaderAPI = api;
+
+	int numErrors = RecorderTest_RecordReplay(api, fileName.ToCString(), numFrames, numRepeats);
+
+	if(!numErrors && numFuzzIterations)
+		RecorderTest_Fuzz(api, fileName.ToCString(), numFuzzIterations, fuzzSeed);
+
+	api->Shutdown();
+	delete api;
+
+	g_pShaderAPI = NULL;
+
+	GetCore()->Shutdown();
+
+	return numErrors ? 1 : 0;
+}